@@ -1,16 +1,33 @@
 /***************************************************************************************************
- * 
+ *
  * Header for for Acuvim2.cpp
- * 
+ *
  * Date: 30/03/2023
- * 
+ *
  * Author: Shaun Mcsherry
- * 
+ *
  * ************************************************************************************************/
 #ifndef ACUVIM2_H
 #define ACUVIM2_H
 
-#define DEBUG_TX Serial.println 
+#include <mbed.h>
+#include <SPI.h>
+#include <Ethernet.h>
+#include <ArduinoModbus.h>
+
+#define DEBUG_TX Serial.println
+
+/* Largest number of registers, over all its blocks, any profile may read */
+#define ACUVIM_MAX_PROFILE_REGS   30U
+
+/* Largest number of register blocks (one transaction each) in a profile */
+#define ACUVIM_MAX_PROFILE_BLOCKS 2U
+
+/* Stack for each meter's poll thread */
+#define ACUVIM_POLL_STACK_SIZE    4096U
+
+/* Marks a measurement that is not part of a register profile */
+#define ACU_FIELD_NOT_READ        (-1)
 
 typedef struct ACUVIM_BASIC_MEASUREMENT_20MS
 {
@@ -31,24 +48,116 @@ typedef struct ACUVIM_BASIC_MEASUREMENT_20MS
   double frequency;            /* Hertz */
 }acuvimBasicMeasurement20ms_t;
 
-class ACUVIM_II 
+/* Each measurement that a register profile can map */
+typedef enum ACUVIM_MEAS_FIELD_ENUM
+{
+  ACU_FIELD_FREQUENCY             = 0,
+  ACU_FIELD_PHASE_VOLTAGE_A       = 1,
+  ACU_FIELD_PHASE_VOLTAGE_B       = 2,
+  ACU_FIELD_PHASE_VOLTAGE_C       = 3,
+  ACU_FIELD_AVERAGE_PHASE_VOLTAGE = 4,
+  ACU_FIELD_LINE_VOLTAGE_A        = 5,
+  ACU_FIELD_LINE_VOLTAGE_B        = 6,
+  ACU_FIELD_LINE_VOLTAGE_C        = 7,
+  ACU_FIELD_AVERAGE_LINE_VOLTAGE  = 8,
+  ACU_FIELD_PHASE_CURRENT_A       = 9,
+  ACU_FIELD_PHASE_CURRENT_B       = 10,
+  ACU_FIELD_PHASE_CURRENT_C       = 11,
+  ACU_FIELD_AVERAGE_PHASE_CURRENT = 12,
+  ACU_FIELD_TOTAL_POWER_REAL      = 13,
+  ACU_FIELD_TOTAL_POWER_REACTIVE  = 14,
+  NOOF_ACU_FIELDS                 = 15
+}acuvimMeasField_t;
+
+/* A block of consecutive holding registers, read in one transaction */
+typedef struct ACUVIM_REG_BLOCK_STRUCT
+{
+  uint16_t startAddr;                     /* first holding register of the block */
+  uint8_t  noofRegs;                      /* registers in the block */
+}acuvimRegBlock_t;
+
+/* A register profile describes the blocks of registers read from a meter on each poll and where
+   each measurement sits within them (offset in registers, counting on through the blocks in
+   order). Each value is an IEEE-754 float in a register pair, high word first. */
+typedef struct ACUVIM_REG_PROFILE_STRUCT
+{
+  uint8_t  mbId;                          /* Modbus unit id */
+  uint8_t  noofBlocks;                    /* 1 to ACUVIM_MAX_PROFILE_BLOCKS */
+  acuvimRegBlock_t blocks[ACUVIM_MAX_PROFILE_BLOCKS];
+  uint16_t pollPeriod_ms;                 /* time between polls */
+  int8_t   fieldOffset[NOOF_ACU_FIELDS];  /* ACU_FIELD_NOT_READ if not in the blocks */
+}acuvimRegProfile_t;
+
+extern const acuvimRegProfile_t ACUVIM_PROFILE_BASIC_20MS;
+extern const acuvimRegProfile_t ACUVIM_PROFILE_FREQ_POWER;
+
+/* State of the connection to a meter, managed by its poll thread */
+typedef enum ACUVIM_LINK_STATE_ENUM
+{
+  ACU_LINK_DOWN       = 0,   /* Ethernet link down - no attempts made */
+  ACU_LINK_BACKOFF    = 1,   /* waiting before the next connection attempt */
+  ACU_LINK_CONNECTING = 2,
+  ACU_LINK_CONNECTED  = 3
+}acuvimLinkState_t;
+
+typedef struct ACUVIM_CONN_STATS_STRUCT
+{
+  uint32_t connectAttempts;
+  uint32_t connectFailures;
+  uint32_t disconnects;
+  uint32_t linkDownEvents;
+  uint32_t txnOk;
+  uint32_t txnFailures;
+  uint32_t connectedSince_ms;
+}acuvimConnStats_t;
+
+class ACUVIM_II
 {
   private:
-    bool AcuvimFault;
-    acuvimBasicMeasurement20ms_t acuvim;
-    void BasicRequest20ms(void);
-    bool BasicRead20ms(void);
-    bool CheckModbus(void);
+    uint8_t AcuvimFault;
+    IPAddress serverIp;
+    const acuvimRegProfile_t *profile;
+    EthernetClient ethClient;
+    ModbusTCPClient modbusTCPClient;
+    rtos::Thread pollThread;
+    rtos::Mutex dataMutex;
+    acuvimBasicMeasurement20ms_t acuvim;     /* latest published measurements */
+    uint16_t registers[ACUVIM_MAX_PROFILE_REGS];  /* registers of the last poll */
+    bool isNewDataFlag;
+    volatile acuvimLinkState_t linkState;
+    volatile bool isConnectedFlag;
+    uint32_t nextAttempt_ms;
+    uint8_t consecutiveFailures;
+    uint8_t txnFailures;
+    rtos::Mutex statsMutex;
+    acuvimConnStats_t connStats;
+    void PollTask(void);
+    bool ProfileRequest(void);
+    void ProfileRead(void);
+    bool ManageConnection(void);
+    void ScheduleReconnect(void);
+    void SetLinkState(acuvimLinkState_t newState);
 
   public:
-    ACUVIM_II()  //constructor
+    ACUVIM_II() : modbusTCPClient(ethClient),
+                  pollThread(osPriorityBelowNormal, ACUVIM_POLL_STACK_SIZE)  //constructor
     {
-      ;      
-    } 
-    void Init(void);
+      AcuvimFault = 0U;
+      profile = &ACUVIM_PROFILE_BASIC_20MS;
+      isNewDataFlag = false;
+      linkState = ACU_LINK_CONNECTING;
+      isConnectedFlag = false;
+      nextAttempt_ms = 0U;
+      consecutiveFailures = 0U;
+      txnFailures = 0U;
+      connStats = {0U, 0U, 0U, 0U, 0U, 0U, 0U};
+    }
+    void Init(IPAddress meterIp, const acuvimRegProfile_t *regProfile);
     bool Control(acuvimBasicMeasurement20ms_t *measurements);
     bool GetFaultState(void);
+    bool IsConnected(void);
+    void GetConnStats(acuvimConnStats_t *stats);
 };
 
-#endif */ ACUVIM2_H */
-  
+#endif /* ACUVIM2_H */
+
@@ -12,7 +12,6 @@
 
 #define CAB1000_MAX_DEMAND    1542
 #define CAB1000_MIN_DEMAND    -1462
-#define LUT_MAX_INDEX         32
 
 /* general definitions */
 #define INT16_MAX     32767
@@ -25,6 +24,38 @@
 /* The time allowed for the inverter to be READY after enable signal is sent */
 #define INVERTER_STARTUP_DELAY_MS    10000U
 
+#define NOMINAL_GRID_FREQ            50.0      /* in Hz */
+
+/* Degraded (open-loop) operation when the meter measurement is lost */
+#define DEGRADED_MAX_TIME_MS         300000UL  /* longest time open-loop before stopping */
+
+/* Stop if no frequency source is available for this long (ms) */
+#define FREQ_LOSS_STOP_MS            2000U
+
+/* Uncomment if grid frequency is wired to analogue input 0 as a standby source (as on HIL) */
+//#define FREQ_ANALOGUE_FITTED
+
+/* Uncomment if the grid voltage waveform is wired to analogue input 2, through a transducer giving
+   0-10V centred on 5V, to estimate frequency from the waveform (FreqEst.cpp) */
+//#define FREQ_EST_FITTED
+
+/* Power control structure (ctrlStructureEnum_t, PowerControl.h):
+   CTRL_PID_ONLY     - the PID gives the whole inverter command
+   CTRL_FF_PLUS_TRIM - the inverse inverter characteristic (InvLut.cpp) gives the command for the
+                       demand, and the PID only trims the residual
+   PID only until the feedforward has been proven on site, which then opts in with the "ctrl"
+   serial command */
+#define CTRL_STRUCTURE_DEFAULT       CTRL_PID_ONLY
+
+/* Dead time compensation of the power PID by a Smith predictor (SmithPred.cpp): true for the PID
+   to see the power the inverter will deliver once the CAN, inverter and meter delays have passed,
+   so its gains can be raised. Can be changed at run time with the "smith" serial command */
+#define CTRL_SMITH_DEFAULT           false
+
+/* Uncomment to output a trace line on the serial port for every meter sample, for analysis by
+   tools/compliance_analyser */
+//#define CTRL_TRACE
+
 /* define the firmware loaded on the CAB1000 controller */
 //#define CAB1000_FW_3C625C9
 #define CAB1000_FW_6DE948B
@@ -40,6 +71,11 @@
 //#define GRID_VOLTAGE_660_RMS
 #define GRID_VOLTAGE_690_RMS
 
+/* Define only one of the site metering arrangements below (see meterConfig in MeterAgg.cpp) */
+#define SITE_SINGLE_METER
+//#define SITE_GRID_AND_INVERTER_METERS
+//#define SITE_DUAL_INCOMER
+
 /* inverter status */
 typedef enum STATE_BITS_ENUM
 {
@@ -0,0 +1,279 @@
+/***************************************************************************************************
+ *
+ * Control kernels
+ *
+ * The small numeric kernels of power control, templated on the numeric type T so that each can be
+ * run in double (as the firmware does), float or a Q format (FixedQ.h):
+ * - KERNEL_ScaleEngUnit, KERNEL_Unscale - engineering units to and from the per unit range of the
+ *   PID (POWER_CTRL::ScaleEngUnit, Unscale),
+ * - KERNEL_ScaleAnalogue - per unit to the 0 to 10.5V analogue outputs (POWER_CTRL::ScaleAnalogue),
+ * - LP_FILTER - the first order low pass filter of the generated lp_filter.c, with the same
+ *   difference equation and one step delay.
+ * The PID (PidCtrl.cpp) and the response curves (RespCurve.h) are templated in the same way.
+ *
+ * Conversions between integers and T go through CTRL_NUMERIC<T>, so a fixed point instance works
+ * on its raw value where a product would not fit its range (e.g. 15000 x 1.0 in Q7.24). Literals
+ * are written T(x), so a float or fixed point instance does no double arithmetic.
+ *
+ * tools/kernel_check checks each instance against double and times it.
+ *
+ * Date: 16/10/2026
+ *
+ * Author: Shaun Mcsherry
+ *
+ * ************************************************************************************************/
+#ifndef CTRL_KERNEL_H
+#define CTRL_KERNEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "APP/FixedQ.h"
+
+#define KERNEL_ANALOGUE_FULL_SCALE_V  10.5
+
+/* The generated filter: 6Hz cut off, stepped every 20ms */
+#define LP_FILTER_CUTOFF_HZ           6.0
+#define LP_FILTER_STEP_S              0.02
+#define LP_FILTER_TWO_PI              6.283185307179586
+
+/* Integer conversions for floating point types */
+template <typename T>
+struct CTRL_NUMERIC
+{
+  /* value / (span / 2) */
+  static T PerUnit(int32_t value, int32_t span)
+  {
+    return (T)value / ((T)span / T(2.0));
+  }
+
+  /* value * (span / 2), truncated towards zero */
+  static int32_t FromPerUnit(T value, int32_t span)
+  {
+    return (int32_t)(value * ((T)span / T(2.0)));
+  }
+};
+
+/* Integer conversions for Q formats, on the raw value so nothing overflows before the result */
+template <uint8_t FRAC>
+struct CTRL_NUMERIC<FIXED_Q<FRAC> >
+{
+  static FIXED_Q<FRAC> PerUnit(int32_t value, int32_t span)
+  {
+    int64_t scaled = (int64_t)value * ((int64_t)2 << FRAC);
+    int64_t half = ((span >= 0) ? (int64_t)span : -(int64_t)span) / 2;
+
+    if (0 == span)
+    {
+      return FIXED_Q<FRAC>::FromRaw((value >= 0) ? INT32_MAX : INT32_MIN);
+    }
+
+    /* rounded to nearest */
+    scaled += (((scaled >= 0) == (span >= 0)) ? half : -half);
+    scaled /= (int64_t)span;
+
+    return FIXED_Q<FRAC>::FromRaw((scaled > (int64_t)INT32_MAX) ? INT32_MAX :
+                                  ((scaled < (int64_t)INT32_MIN) ? INT32_MIN : (int32_t)scaled));
+  }
+
+  static int32_t FromPerUnit(FIXED_Q<FRAC> value, int32_t span)
+  {
+    return (int32_t)((((int64_t)value.Raw() * (int64_t)span) / 2) / ((int64_t)1 << FRAC));
+  }
+};
+
+/***************************************************************************************************
+ *
+ * KERNEL_ScaleEngUnit
+ * This function scales a number representing engineering units, e.g. kW to a value between
+ * +1.0 and -1.0 (if value is within min-max limits).
+ * If limit is set and the result is > 1.0 it is limited to 1.0, and if < -1.0 it is limited
+ * to -1.0.
+ * If limit is not set, the scaled value can exceed -1.0 and 1.0 if it is outside the min-
+ * max limits.
+ *
+ * Parameter(s):
+ * value - the demanded or measured value (as an engineering unit).
+ * max - the maximum expected demanded value.
+ * min - the minimum expected demanded value.
+ * limit - if true, scaled value cannot exceed +1.0 or -1.0.
+ *
+ * Return:
+ * A value between -1.0 and 1.0
+ *
+ **************************************************************************************************/
+template <typename T>
+inline T KERNEL_ScaleEngUnit(int16_t value, int16_t min, int16_t max, bool limit)
+{
+  T scaledValue;
+
+  scaledValue = CTRL_NUMERIC<T>::PerUnit((int32_t)value, (int32_t)max - (int32_t)min);
+
+  if (true == limit)
+  {
+    if (scaledValue > T(1.0))
+    {
+      scaledValue = T(1.0);
+    }
+    else if (scaledValue < T(-1.0))
+    {
+      scaledValue = T(-1.0);
+    }
+    else
+    {
+      /* within limits */
+    }
+  }
+
+  return scaledValue;
+}
+
+/***************************************************************************************************
+ *
+ * KERNEL_Unscale
+ * This function restores a scaled number back into engineering units.
+ * If the descaled number is outside the min/max limits, the number is limited to these limits.
+ *
+ * Parameter(s):
+ * value - the scaled number.
+ * max - the maximum expected converted value.
+ * min - the minimum expected converted value.
+ *
+ * Return:
+ * The value in engineering units, min to max
+ *
+ **************************************************************************************************/
+template <typename T>
+inline int16_t KERNEL_Unscale(T value, int16_t min, int16_t max)
+{
+  int32_t engUnit;
+
+  engUnit = CTRL_NUMERIC<T>::FromPerUnit(value, (int32_t)max - (int32_t)min);
+
+  if (engUnit > (int32_t)max)
+  {
+    engUnit = max;
+  }
+  else if (engUnit < (int32_t)min)
+  {
+    engUnit = min;
+  }
+  else
+  {
+    /* within limits */
+  }
+
+  return (int16_t)engUnit;
+}
+
+/***************************************************************************************************
+ *
+ * KERNEL_ScaleAnalogue
+ * This function scales the -1.0 to +1.0 pid values to 0 to 10.5V values suitable for analogue
+ * output channels.
+ *
+ * Parameter(s):
+ * value - value to convert
+ *
+ * Return:
+ * the converted value, 0 to KERNEL_ANALOGUE_FULL_SCALE_V
+ *
+ **************************************************************************************************/
+template <typename T>
+inline T KERNEL_ScaleAnalogue(T value)
+{
+  T scaledValue;
+
+  scaledValue = ((value / T(2.0)) + T(0.5)) * T(KERNEL_ANALOGUE_FULL_SCALE_V);
+
+  if (scaledValue > T(KERNEL_ANALOGUE_FULL_SCALE_V))
+  {
+    scaledValue = T(KERNEL_ANALOGUE_FULL_SCALE_V);
+  }
+  if (scaledValue < T(0.0))
+  {
+    scaledValue = T(0.0);
+  }
+
+  return scaledValue;
+}
+
+/* First order low pass filter, forward Euler, as generated in lp_filter.c:
+     filtered(k) = gain.in(k-1) + (1 - gain).filtered(k-1), gain = 2.pi.fc.dt
+   The output lags the input by one step. gain must be below 1 (fc.dt below 0.16). */
+template <typename T>
+class LP_FILTER
+{
+  private:
+    T gain;
+    T complement;              /* 1 - gain */
+    T filtered;
+    T previousIn;
+
+  public:
+    LP_FILTER()  //constructor
+    {
+      Init(LP_FILTER_CUTOFF_HZ, LP_FILTER_STEP_S);
+    }
+
+    /***********************************************************************************************
+     * Init
+     *
+     * This function sets the cut off and step, and clears the filter.
+     *
+     * Parameters:
+     * cutoff_hz - cut off frequency
+     * step_s - time between steps
+     *
+     * Return:
+     * None
+     *
+     **********************************************************************************************/
+    void Init(double cutoff_hz, double step_s)
+    {
+      double k = LP_FILTER_TWO_PI * cutoff_hz * step_s;
+
+      gain = T(k);
+      complement = T(1 - k);
+      Reset(T(0.0));
+    }
+
+    /***********************************************************************************************
+     * Reset
+     *
+     * This function starts the filter in steady state at a value.
+     *
+     * Parameters:
+     * value - the value
+     *
+     * Return:
+     * None
+     *
+     **********************************************************************************************/
+    void Reset(T value)
+    {
+      filtered = value;
+      previousIn = value;
+    }
+
+    /***********************************************************************************************
+     * Step
+     *
+     * This function steps the filter.
+     *
+     * Parameters:
+     * in - the input
+     *
+     * Return:
+     * The filtered value, from the inputs up to the last step
+     *
+     **********************************************************************************************/
+    T Step(T in)
+    {
+      filtered = (previousIn * gain) + (filtered * complement);
+      previousIn = in;
+
+      return filtered;
+    }
+};
+
+#endif /* CTRL_KERNEL_H */
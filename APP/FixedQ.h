@@ -0,0 +1,204 @@
+/***************************************************************************************************
+ *
+ * Q format fixed point
+ *
+ * FIXED_Q<FRAC> is a signed 32 bit number with FRAC fractional bits, e.g. FIXED_Q<16> is Q15.16:
+ * range +/-32768, resolution 1.5e-5. It stands in for double or float in the templated control
+ * kernels (PidCtrl.cpp, RespCurve.h, CtrlKernel.h), so a kernel can be run on integer arithmetic
+ * alone, e.g. on a core without a double precision FPU.
+ *
+ * - Addition, subtraction and multiplication saturate at the ends of the range rather than wrap,
+ *   so an overflowing intermediate (e.g. a large error times a gain) is limited like an output.
+ * - Multiplication and division round to nearest.
+ * - Division by zero gives the end of the range with the sign of the dividend.
+ * - Conversions to and from floating point are explicit, so a kernel cannot fall back on floating
+ *   point arithmetic without it showing. Constants, e.g. T(0.5), are converted by the compiler.
+ *
+ * Date: 16/10/2026
+ *
+ * Author: Shaun Mcsherry
+ *
+ * ************************************************************************************************/
+#ifndef FIXED_Q_H
+#define FIXED_Q_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+template <uint8_t FRAC>
+class FIXED_Q
+{
+  static_assert((FRAC >= 1U) && (FRAC <= 30U), "a Q format needs 1 to 30 fractional bits");
+
+  private:
+    int32_t raw;
+
+    static constexpr int64_t ONE = (int64_t)1 << FRAC;
+
+    static constexpr int32_t Saturate(int64_t value)
+    {
+      return (value > (int64_t)INT32_MAX) ? INT32_MAX :
+             ((value < (int64_t)INT32_MIN) ? INT32_MIN : (int32_t)value);
+    }
+
+    static constexpr int32_t FromDouble(double value)
+    {
+      return (value >= ((double)INT32_MAX / (double)ONE)) ? INT32_MAX :
+             ((value <= ((double)INT32_MIN / (double)ONE)) ? INT32_MIN :
+              (int32_t)((value * (double)ONE) + ((value >= 0.0) ? 0.5 : -0.5)));
+    }
+
+  public:
+    constexpr FIXED_Q() : raw(0)
+    {
+    }
+
+    explicit constexpr FIXED_Q(double value) : raw(FromDouble(value))
+    {
+    }
+
+    static constexpr FIXED_Q FromRaw(int32_t value)
+    {
+      FIXED_Q result;
+
+      result.raw = value;
+
+      return result;
+    }
+
+    constexpr int32_t Raw(void) const
+    {
+      return raw;
+    }
+
+    explicit constexpr operator double() const
+    {
+      return (double)raw / (double)ONE;
+    }
+
+    explicit constexpr operator float() const
+    {
+      return (float)raw / (float)ONE;
+    }
+
+    /* truncates towards zero, as a cast from floating point does */
+    explicit constexpr operator int32_t() const
+    {
+      return (int32_t)((int64_t)raw / ONE);
+    }
+
+    friend constexpr FIXED_Q operator+(FIXED_Q a, FIXED_Q b)
+    {
+      return FromRaw(Saturate((int64_t)a.raw + (int64_t)b.raw));
+    }
+
+    friend constexpr FIXED_Q operator-(FIXED_Q a, FIXED_Q b)
+    {
+      return FromRaw(Saturate((int64_t)a.raw - (int64_t)b.raw));
+    }
+
+    friend constexpr FIXED_Q operator-(FIXED_Q a)
+    {
+      return FromRaw(Saturate(-(int64_t)a.raw));
+    }
+
+    friend constexpr FIXED_Q operator*(FIXED_Q a, FIXED_Q b)
+    {
+      /* arithmetic shift, so the rounding is to nearest with halves upwards */
+      return FromRaw(Saturate((((int64_t)a.raw * (int64_t)b.raw) + (ONE / 2)) >> FRAC));
+    }
+
+    friend constexpr FIXED_Q operator/(FIXED_Q a, FIXED_Q b)
+    {
+      return (0 == b.raw) ? FromRaw((a.raw >= 0) ? INT32_MAX : INT32_MIN) :
+             FromRaw(Saturate((((int64_t)a.raw * ONE) +
+                               ((((a.raw >= 0) == (b.raw >= 0)) ? 1 : -1) *
+                                (((b.raw >= 0) ? (int64_t)b.raw : -(int64_t)b.raw) / 2))) /
+                              (int64_t)b.raw));
+    }
+
+    FIXED_Q &operator+=(FIXED_Q b)
+    {
+      *this = *this + b;
+      return *this;
+    }
+
+    FIXED_Q &operator-=(FIXED_Q b)
+    {
+      *this = *this - b;
+      return *this;
+    }
+
+    FIXED_Q &operator*=(FIXED_Q b)
+    {
+      *this = *this * b;
+      return *this;
+    }
+
+    FIXED_Q &operator/=(FIXED_Q b)
+    {
+      *this = *this / b;
+      return *this;
+    }
+
+    friend constexpr bool operator==(FIXED_Q a, FIXED_Q b) { return a.raw == b.raw; }
+    friend constexpr bool operator!=(FIXED_Q a, FIXED_Q b) { return a.raw != b.raw; }
+    friend constexpr bool operator<(FIXED_Q a, FIXED_Q b) { return a.raw < b.raw; }
+    friend constexpr bool operator<=(FIXED_Q a, FIXED_Q b) { return a.raw <= b.raw; }
+    friend constexpr bool operator>(FIXED_Q a, FIXED_Q b) { return a.raw > b.raw; }
+    friend constexpr bool operator>=(FIXED_Q a, FIXED_Q b) { return a.raw >= b.raw; }
+
+    /***********************************************************************************************
+     * sqrt
+     *
+     * This function returns the square root, by integer bisection of the raw value scaled up by
+     * FRAC bits, so it is found without floating point. Found by argument dependent lookup, so a
+     * kernel calls sqrt() for every numeric type alike.
+     *
+     * Parameters:
+     * a - the number
+     *
+     * Return:
+     * The square root, rounded down, 0 for a negative number
+     *
+     **********************************************************************************************/
+    friend FIXED_Q sqrt(FIXED_Q a)
+    {
+      uint64_t square;
+      uint64_t root = 0U;
+      uint64_t bit = (uint64_t)1 << 62;
+
+      if (a.raw <= 0)
+      {
+        return FIXED_Q();
+      }
+
+      square = (uint64_t)a.raw << FRAC;
+
+      while (bit > square)
+      {
+        bit >>= 2;
+      }
+
+      while (0U != bit)
+      {
+        if (square >= (root + bit))
+        {
+          square -= root + bit;
+          root = (root >> 1) + bit;
+        }
+        else
+        {
+          root >>= 1;
+        }
+        bit >>= 2;
+      }
+
+      return FromRaw(Saturate((int64_t)root));
+    }
+};
+
+typedef FIXED_Q<16> fixedQ16_t;       /* Q15.16, +/-32768, for engineering units */
+typedef FIXED_Q<24> fixedQ24_t;       /* Q7.24, +/-128, for per unit quantities */
+
+#endif /* FIXED_Q_H */
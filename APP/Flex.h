@@ -17,7 +17,9 @@ typedef enum FLEX_CONTROL_MODE_ENUM
   FFR     = 8,
   DS3     = 16,
   PID_TEST1 = 32,
-  PID_TEST2 = 33
+  PID_TEST2 = 33,
+  DM      = 64,
+  DR      = 128
 }flexControlModeEnum_t;
 
 typedef struct FLEX_OPERATING_STATE_STRUCT
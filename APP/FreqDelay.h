@@ -0,0 +1,52 @@
+/***************************************************************************************************
+ *
+ * Header for for FreqDelay.cpp
+ *
+ * Date: 16/10/2026
+ *
+ * Author: Shaun Mcsherry
+ *
+ * ************************************************************************************************/
+#ifndef FREQ_DELAY_H
+#define FREQ_DELAY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Samples held by a delay line - 2.5s of history at a 20ms cadence */
+#define FREQ_DELAY_CAPACITY      128U
+#define FREQ_DELAY_MAX_MS        2000U
+
+typedef struct FREQ_DELAY_SAMPLE_STRUCT
+{
+  uint32_t time_ms;
+  double frequency;
+}freqDelaySampleStruct_t;
+
+class FREQ_DELAY
+{
+  private:
+    freqDelaySampleStruct_t samples[FREQ_DELAY_CAPACITY];
+    uint16_t tail;               /* oldest sample still needed (the read cursor) */
+    uint16_t count;
+    uint32_t delay_ms;
+    double defaultFrequency;
+    uint32_t achievedDelay_ms;
+
+  public:
+    FREQ_DELAY()  //constructor
+    {
+      tail = 0U;
+      count = 0U;
+      delay_ms = 0U;
+      defaultFrequency = 0.0;
+      achievedDelay_ms = 0U;
+    }
+    void Init(uint32_t delay, double frequency);
+    void Push(uint32_t time_ms, double frequency);
+    double Read(uint32_t now_ms);
+    uint32_t GetDelay(void);
+    uint32_t GetAchievedDelay(void);
+};
+
+#endif /* FREQ_DELAY_H */
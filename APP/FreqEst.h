@@ -0,0 +1,95 @@
+/***************************************************************************************************
+ *
+ * Header for for FreqEst.cpp
+ *
+ * Date: 16/10/2026
+ *
+ * Author: Shaun Mcsherry
+ *
+ * ************************************************************************************************/
+#ifndef FREQ_EST_H
+#define FREQ_EST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FREQ_EST_SAMPLE_RATE_HZ    10000U    /* waveform sample rate */
+#define FREQ_EST_NOMINAL_HZ        50.0
+
+/* Frequency is measured over this many half cycles (an even number, so the DC offset cancels).
+   An estimate is made at every zero crossing. */
+#define FREQ_EST_WINDOW            8U
+
+/* Waveform low pass filter, to stop harmonics and noise causing extra crossings */
+#define FREQ_EST_LPF_HZ            150.0
+
+/* A crossing must come this fraction of the amplitude after the waveform was last on the
+   other side of zero */
+#define FREQ_EST_HYSTERESIS        0.2
+
+/* Fraction of each cycle's mean added to the DC offset */
+#define FREQ_EST_DC_GAIN           0.2
+
+/* Waveforms smaller than this (ADC counts, peak) are treated as lost */
+#define FREQ_EST_MIN_AMPLITUDE     1000.0
+
+/* Plausible frequency - half cycles outside this restart the window */
+#define FREQ_EST_MIN_HZ            45.0
+#define FREQ_EST_MAX_HZ            55.0
+
+/* RoCoF is the change in frequency over this many estimates (half cycles) */
+#define FREQ_EST_ROCOF_ESTIMATES   50U
+#define FREQ_EST_HISTORY           64U
+
+#define FREQ_EST_ADC_MID           32768.0   /* DC offset assumed until one has been measured */
+
+typedef struct FREQ_EST_POINT_STRUCT
+{
+  double time;          /* sample number */
+  double frequency;     /* Hz */
+}freqEstPointStruct_t;
+
+/* Frequency estimator for a sampled voltage waveform. The waveform is low pass filtered, its DC
+   offset removed and zero crossings are interpolated to a fraction of a sample. */
+class FREQ_EST
+{
+  private:
+    double sampleRate;
+    double lpfCoeff;
+    double filtered;
+    double previous;
+    double dcOffset;
+    double dcSum;
+    uint32_t dcCount;
+    double amplitude;
+    double peak;
+    bool isPositive;         /* waveform last settled above zero */
+    bool isArmed;            /* waveform has passed the hysteresis, a crossing may follow */
+    bool isFullCycle;        /* a rising crossing has been seen, so the sums cover a cycle */
+    double sampleCount;      /* samples processed - a double counts exactly for far longer than
+                                the controller runs, and does not wrap */
+    double crossings[FREQ_EST_WINDOW + 1U];
+    uint8_t noofCrossings;
+    freqEstPointStruct_t history[FREQ_EST_HISTORY];
+    uint8_t historyHead;
+    uint8_t noofHistory;
+    double frequency;
+    double rocof;
+    bool isValid;
+    bool isRocofValid;
+    void Crossing(double time);
+    void Estimate(void);
+
+  public:
+    FREQ_EST()  //constructor
+    {
+      Init(FREQ_EST_SAMPLE_RATE_HZ);
+    }
+    void Init(uint32_t sampleRate_hz);
+    void Reset(void);
+    void Process(const uint16_t *samples, uint16_t noofSamples);
+    bool GetFrequency(double *estimate, uint16_t *age_ms);
+    bool GetRocof(double *estimate);
+};
+
+#endif /* FREQ_EST_H */
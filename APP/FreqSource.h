@@ -0,0 +1,109 @@
+/***************************************************************************************************
+ *
+ * Header for for FreqSource.cpp
+ *
+ * Date: 16/10/2026
+ *
+ * Author: Shaun Mcsherry
+ *
+ * ************************************************************************************************/
+#ifndef FREQ_SOURCE_H
+#define FREQ_SOURCE_H
+
+#include <stdint.h>
+#include "MeterAgg.h"
+
+class HIL_TEST;
+class FREQ_EST;
+
+#define MAX_NOOF_FREQ_SOURCES   4U
+
+/* A source is stale if its sample is older than this (ms) - two missed 20ms meter polls */
+#define FREQ_STALE_MS           45U
+
+/* Plausible grid frequency range (Hz) */
+#define FREQ_MIN_VALID_HZ       45.0
+#define FREQ_MAX_VALID_HZ       55.0
+
+/* Sources disagreeing by more than this are cross-validation failures (Hz) */
+#define FREQ_XVAL_TOL_HZ        0.1
+
+/* Time any step between sources is blended out over after a switch (ms) */
+#define FREQ_BLEND_MS           200U
+
+/* Time a higher priority source must be valid before switching back to it (ms) */
+#define FREQ_RESTORE_MS         1000U
+
+#define FREQ_NO_SOURCE          0xFFU
+
+typedef enum FREQ_SOURCE_TYPE_ENUM
+{
+  FREQ_SRC_METER      = 0,   /* a meter, identified by its frequency priority */
+  FREQ_SRC_ANALOGUE   = 1,   /* analogue input 0 (HIL or site frequency transducer) */
+  FREQ_SRC_WAVEFORM   = 2    /* frequency estimated from the voltage waveform (FreqEst) */
+}freqSourceTypeEnum_t;
+
+typedef struct FREQ_SOURCE_CONFIG_STRUCT
+{
+  freqSourceTypeEnum_t type;
+  uint8_t meterPriority;       /* for FREQ_SRC_METER only */
+}freqSourceConfigStruct_t;
+
+typedef struct FREQ_SOURCE_SAMPLE_STRUCT
+{
+  double frequency;            /* Hertz */
+  uint16_t age_ms;
+  bool isFresh;                /* present, not stale and plausible */
+  bool isValid;                /* fresh and agrees with the other sources */
+}freqSourceSampleStruct_t;
+
+typedef struct FREQ_SOURCE_STATS_STRUCT
+{
+  uint32_t switchovers;
+  uint32_t staleEvents;        /* active source dropped because it went stale */
+  uint32_t deviationEvents;    /* active source dropped because it disagreed with the others */
+  uint32_t xvalAlarms;         /* two sources disagree with no third to decide between them */
+}freqSourceStatsStruct_t;
+
+class FREQ_SOURCE
+{
+  private:
+    METER_AGG *meterAgg;
+    HIL_TEST *analogue;
+    FREQ_EST *waveform;
+    freqSourceSampleStruct_t samples[MAX_NOOF_FREQ_SOURCES];
+    uint8_t noofSources;
+    uint8_t activeSource;
+    uint16_t restoreTime_ms;
+    double output;
+    double blendOffset;
+    double blendStep;
+    bool isXvalAlarm;
+    freqSourceStatsStruct_t stats;
+    void ReadSources(void);
+    void CrossValidate(void);
+    void SwitchSource(uint8_t newSource);
+
+  public:
+    FREQ_SOURCE()  //constructor
+    {
+      meterAgg = NULL;
+      analogue = NULL;
+      waveform = NULL;
+      noofSources = 0U;
+      activeSource = FREQ_NO_SOURCE;
+      restoreTime_ms = 0U;
+      output = 0.0;
+      blendOffset = 0.0;
+      blendStep = 0.0;
+      isXvalAlarm = false;
+      stats = {0U, 0U, 0U, 0U};
+    }
+    void Init(METER_AGG *meters, HIL_TEST *analogueIn, FREQ_EST *waveformEst);
+    bool Control(void);
+    bool GetFrequency(double *frequency);
+    uint8_t GetActiveSource(void);
+    void GetStats(freqSourceStatsStruct_t *sourceStats);
+};
+
+#endif /* FREQ_SOURCE_H */
@@ -0,0 +1,60 @@
+/***************************************************************************************************
+ *
+ * Header for for GainSched.cpp
+ *
+ * Date: 16/10/2026
+ *
+ * Author: Shaun Mcsherry
+ *
+ * ************************************************************************************************/
+#ifndef GAIN_SCHED_H
+#define GAIN_SCHED_H
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Band edges are evenly spaced from zero to rated power, in either direction */
+#define GAIN_SCHED_BANDS           5U
+#define GAIN_SCHED_MAX_FACTOR      4.0
+
+typedef enum GAIN_SCHED_CLASS_ENUM
+{
+  GAIN_SCHED_TRADING        = 0,    /* TRADING - scheduled ramps */
+  GAIN_SCHED_RESPONSE       = 1,    /* DC, DM, DR, FFR, DS3 - frequency response */
+  GAIN_SCHED_TEST           = 2,    /* PID_TEST1, PID_TEST2 */
+  NOOF_GAIN_SCHED_CLASSES   = 3
+}gainSchedClassEnum_t;
+
+/* Factors applied to the base (tuned) PID gains */
+typedef struct GAIN_SCHED_SET_STRUCT
+{
+  double kp;
+  double ki;
+  double kd;
+}gainSchedSetStruct_t;
+
+/* Gain scheduling by operating mode class and power level, interpolated between band edges */
+class GAIN_SCHED
+{
+  private:
+    gainSchedSetStruct_t table[NOOF_GAIN_SCHED_CLASSES][GAIN_SCHED_BANDS];
+    bool isEnabled;
+
+  public:
+    GAIN_SCHED()  //constructor
+    {
+      isEnabled = false;       /* until validated on site */
+      Restore();
+    }
+    void Restore(void);
+    void GetFactors(gainSchedClassEnum_t schedClass, double power, double rated,
+                    gainSchedSetStruct_t *factors);
+    bool SetFactors(gainSchedClassEnum_t schedClass, uint8_t band,
+                    const gainSchedSetStruct_t *factors);
+    void Command(String command);
+};
+
+extern GAIN_SCHED gainSchedObj;
+
+#endif /* GAIN_SCHED_H */
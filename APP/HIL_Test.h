@@ -25,5 +25,5 @@ class HIL_TEST
     double GetPower(void);
 };
 
-#endif */ HIL_TEST_H */
+#endif /* HIL_TEST_H */
   
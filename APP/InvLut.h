@@ -0,0 +1,142 @@
+/***************************************************************************************************
+ *
+ * Header for for InvLut.cpp
+ *
+ * Date: 16/10/2026
+ *
+ * Author: Shaun Mcsherry
+ *
+ * ************************************************************************************************/
+#ifndef INV_LUT_H
+#define INV_LUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "APP/UniformLut.h"
+
+#define INV_LUT_MAX_ROWS      32U
+
+/* Both directions are looked up on uniform grids of this many points. The CAB1000 table is
+   measured every 1000 (0.1kW), so at 250 spacing the forward grid is exact and the inverse is
+   within 5 (0.1kW) of the table */
+#define INV_LUT_GRID_POINTS   121U
+
+/* Adaptation - a loaded point counts as this many learnt samples, and learnt points are kept at
+   least INV_LUT_MIN_STEP apart so the characteristic stays invertible */
+#define INV_LUT_PRIOR_WEIGHT  20.0
+#define INV_LUT_MIN_STEP      1.0      /* 0.1kW units */
+#define INV_LUT_MIN_FORGETTING 0.9
+
+/* One measured point of the inverter characteristic - all in 0.1kW units */
+typedef struct INV_LUT_ROW_STRUCT
+{
+  double command;              /* requested power */
+  double power;                /* actual power */
+}invLutRowStruct_t;
+
+typedef UNIFORM_LUT<INV_LUT_GRID_POINTS> invLutGrid_t;
+
+typedef struct INV_LUT_GRIDS_STRUCT
+{
+  invLutGrid_t forward;        /* power for a request */
+  invLutGrid_t inverse;        /* request for a power */
+}invLutGridsStruct_t;
+
+/***************************************************************************************************
+ * InvLutGrids
+ *
+ * This function resamples a characteristic onto the forward and inverse grids. It is constexpr,
+ * so a table known at compile time is resampled by the compiler.
+ *
+ * Parameters:
+ * table - the measured points, in increasing order
+ * tableRows - number of points, at least 2
+ *
+ * Return:
+ * The grids
+ *
+ **************************************************************************************************/
+constexpr invLutGridsStruct_t InvLutGrids(const invLutRowStruct_t *table, uint8_t tableRows)
+{
+  return {invLutGrid_t::Build(table, tableRows, &invLutRowStruct_t::command,
+                              &invLutRowStruct_t::power),
+          invLutGrid_t::Build(table, tableRows, &invLutRowStruct_t::power,
+                              &invLutRowStruct_t::command)};
+}
+
+/* Measured CAB1000 characteristic (690V grid) */
+constexpr invLutRowStruct_t CAB1000_LUT[] =
+{
+   /* Requested power, actual power - all in 0.1kW units */
+  {   -15000.0,           -15000.0},
+  {   -14000.0,           -14005.0},
+  {   -13000.0,           -13000.0},
+  {   -12000.0,           -11906.0},
+  {   -11000.0,           -10905.0},
+  {   -10000.0,           -9920.0},
+  {   -9000.0,            -8890.0},
+  {   -8000.0,            -7840.0},
+  {   -7000.0,            -6810.0},
+  {   -6000.0,            -5800.0},
+  {   -5000.0,            -4770.0},
+  {   -4000.0,            -3750.0},
+  {   -3000.0,            -2780.0},
+  {   -2000.0,            -1780.0},
+  {   -1000.0,            -890.0},
+  {   0.0,                10.0},
+  {   1000.0,             890.0},
+  {   2000.0,             1780.0},
+  {   3000.0,             2800.0},
+  {   4000.0,             3800.0},
+  {   5000.0,             4750.0},
+  {   6000.0,             5760.0},
+  {   7000.0,             6780.0},
+  {   8000.0,             7810.0},
+  {   9000.0,             8820.0},
+  {   10000.0,            9850.0},
+  {   11000.0,            10870.0},
+  {   12000.0,            11900.0},
+  {   13000.0,            12910.0},
+  {   14000.0,            13920.0},
+  {   15000.0,            15000.0}
+};
+
+constexpr uint8_t CAB1000_LUT_ROWS = (uint8_t)(sizeof(CAB1000_LUT) / sizeof(CAB1000_LUT[0]));
+
+/* Inverter characteristic, interpolated linearly between measured points and held beyond the
+   first and last. Both columns must increase. The power column can be adapted online from
+   measured (command, power) pairs (see Adapt) within a bound of the loaded table. Lookups are
+   made on uniform grids, resampled whenever the points change. */
+class INV_LUT
+{
+  private:
+    invLutRowStruct_t rows[INV_LUT_MAX_ROWS];
+    double loaded[INV_LUT_MAX_ROWS];     /* power column as loaded by Init */
+    double weight[INV_LUT_MAX_ROWS];     /* information behind each point, see Adapt */
+    uint8_t noofRows;
+    double forgetting;
+    double maxDeviation;
+    invLutGridsStruct_t grids;
+    void Bound(uint8_t row);
+    void Resample(void);
+
+  public:
+    INV_LUT()  //constructor
+    {
+      noofRows = 0U;
+      forgetting = 1.0;
+      maxDeviation = 0.0;
+    }
+    bool Init(const invLutRowStruct_t *table, uint8_t tableRows,
+              const invLutGridsStruct_t *tableGrids);
+    double Command(double power);
+    double Power(double command);
+    void SetAdaptation(double newForgetting, double newMaxDeviation);
+    bool Adapt(double command, double power);
+    void Restore(void);
+    uint8_t GetNoofRows(void);
+    bool GetRow(uint8_t row, invLutRowStruct_t *point, double *loadedPower, double *pointWeight);
+    bool Load(const double *power, const double *pointWeight, uint8_t tableRows);
+};
+
+#endif /* INV_LUT_H */
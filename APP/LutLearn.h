@@ -0,0 +1,96 @@
+/***************************************************************************************************
+ *
+ * Header for for LutLearn.cpp
+ *
+ * Date: 16/10/2026
+ *
+ * Author: Shaun Mcsherry
+ *
+ * ************************************************************************************************/
+#ifndef LUT_LEARN_H
+#define LUT_LEARN_H
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "APP/InvLut.h"
+
+/* Steady state - command and power are averaged over the window, and the pair is only learnt if
+   neither moved by more than its band (fraction of rated power) during it */
+#define LUT_LEARN_WINDOW_MS        1000U
+#define LUT_LEARN_COMMAND_BAND     0.005
+#define LUT_LEARN_POWER_BAND       0.01
+#define LUT_LEARN_MAX_STEP_MS      100U      /* a longer gap between samples restarts the window */
+
+/* Learning */
+#define LUT_LEARN_FORGETTING       0.995     /* per learnt pair, about 200 pairs of memory */
+#define LUT_LEARN_MAX_DEVIATION    0.05      /* fraction of rated power a point may move */
+#define LUT_LEARN_OUTLIER          0.05      /* fraction of rated power, larger errors are rejected,
+                                                e.g. while the inverter is derating */
+
+/* Persistence */
+#define LUT_LEARN_NVR_KEY          "/kv/lut"
+#define LUT_LEARN_NVR_VERSION      1U
+#define LUT_LEARN_SAVE_PERIOD_MS   600000UL
+#define LUT_LEARN_SAVE_CHANGE      5.0       /* only save if a point has moved by this (0.1kW) */
+
+typedef struct LUT_LEARN_NVR_RECORD_STRUCT
+{
+  uint32_t version;
+  uint32_t noofRows;
+  double power[INV_LUT_MAX_ROWS];
+  float weight[INV_LUT_MAX_ROWS];
+}lutLearnNvrRecordStruct_t;
+
+typedef struct LUT_LEARN_STATS_STRUCT
+{
+  uint32_t learnt;             /* pairs learnt */
+  uint32_t outliers;           /* steady pairs rejected */
+  double lastError;            /* learnt minus predicted power for the last pair (0.1kW units) */
+}lutLearnStatsStruct_t;
+
+/* Online learning of the inverter characteristic from steady state (command, power) pairs */
+class LUT_LEARN
+{
+  private:
+    INV_LUT *lut;
+    double maxPower;           /* 0.1kW units */
+    bool isEnabled;
+    double savedPower[INV_LUT_MAX_ROWS];
+    uint32_t saveTimer_ms;
+    uint16_t oldSysCount;
+    bool isTiming;
+    uint32_t window_ms;
+    uint16_t windowSamples;
+    double commandSum;
+    double powerSum;
+    double commandMin;
+    double commandMax;
+    double powerMin;
+    double powerMax;
+    lutLearnStatsStruct_t stats;
+    void Learn(double command, double power);
+    void Save(void);
+
+  public:
+    LUT_LEARN()  //constructor
+    {
+      lut = NULL;
+      maxPower = 0.0;
+      isEnabled = true;
+      saveTimer_ms = 0U;
+      oldSysCount = 0U;
+      isTiming = false;
+      stats = {0U, 0U, 0.0};
+      Restart();
+    }
+    void Init(INV_LUT *characteristic, uint16_t maxRated);
+    void Update(double command, double measuredPower, uint16_t sysCount);
+    void Restart(void);
+    void GetStats(lutLearnStatsStruct_t *learnStats);
+    void Command(String command);
+};
+
+extern LUT_LEARN lutLearnObj;
+
+#endif /* LUT_LEARN_H */
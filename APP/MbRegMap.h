@@ -0,0 +1,88 @@
+/***************************************************************************************************
+ *
+ * Header for for MbRegMap.cpp
+ *
+ * This header is included by the Modbus slave (C), so it must only contain C declarations.
+ *
+ * Date: 16/10/2026
+ *
+ * Author: Shaun Mcsherry
+ *
+ * ************************************************************************************************/
+#ifndef MB_REG_MAP_H
+#define MB_REG_MAP_H
+
+#include <stdint.h>
+
+/* Holding register map */
+#define MB_GENERAL_REGS           8U        /* 0x0000 - 0x0007 general purpose registers */
+
+#define MB_CURVE_SELECT_REG       0x0008U   /* curve to load (respCurveIdEnum_t). Writing starts
+                                               a new staged table copied from the active one */
+#define MB_CURVE_NOOF_KNOTS_REG   0x0009U   /* number of knots in the staged table */
+#define MB_CURVE_COMMAND_REG      0x000AU   /* write MB_CURVE_CMD_xxx, read MB_CURVE_STATUS_xxx */
+#define MB_BMS_SOC_REG            0x000BU   /* write the BMS SoC, read the SoC estimate
+                                               (0.01% units) */
+#define MB_CURVE_KNOT_BASE_REG    0x0010U   /* knot pairs: frequency deviation (mHz, signed) then
+                                               power (0.01% of rated, signed, + is export).
+                                               Reads return the active table */
+#define MB_CURVE_MAX_KNOTS        16U
+
+#define MB_TP_RUN_REG             0x0030U   /* write a test profile id (tpProfileIdEnum_t) to start
+                                               it, 0 to stop. Reads the running profile */
+#define MB_TP_NOOF_SEGMENTS_REG   0x0031U   /* number of segments in the user profile */
+#define MB_TP_REPEATS_REG         0x0032U   /* user profile passes, 0 for ever */
+#define MB_TP_SEGMENT_BASE_REG    0x0040U   /* user profile segments, 4 registers each: duration
+                                               (0.1s), type (0 step, 1 ramp), value (step: mHz
+                                               from 50Hz, ramp: mHz/s, signed), marker (0/1).
+                                               A segment is set when its marker is written */
+#define MB_TP_REGS_PER_SEGMENT    4U
+#define MB_TP_MAX_SEGMENTS        16U
+#define MB_TP_SEGMENT_END_REG     (MB_TP_SEGMENT_BASE_REG + \
+                                   (MB_TP_REGS_PER_SEGMENT * MB_TP_MAX_SEGMENTS))
+
+#define MB_SCHED_START_HI_REG     0x0080U   /* trading schedule start (s since 1970, UTC), high
+                                               word. Writing starts a new staged schedule copied
+                                               from the active one */
+#define MB_SCHED_START_LO_REG     0x0081U   /* low word, sets the start. Must be on a settlement
+                                               period boundary */
+#define MB_SCHED_NOOF_PERIODS_REG 0x0082U   /* number of settlement periods in the schedule */
+#define MB_SCHED_RAMP_REG         0x0083U   /* ramp between periods (s) */
+#define MB_SCHED_COMMAND_REG      0x0084U   /* write MB_CURVE_CMD_xxx, read MB_CURVE_STATUS_xxx */
+#define MB_TIME_HI_REG            0x0088U   /* clock (s since 1970, UTC), high word. Reading
+                                               latches the low word and milliseconds */
+#define MB_TIME_LO_REG            0x0089U   /* low word */
+#define MB_TIME_MS_REG            0x008AU   /* milliseconds. Writing sets the clock */
+#define MB_SCHED_POWER_BASE_REG   0x0090U   /* power for each period (0.1kW, signed, + is export).
+                                               Reads return the active schedule */
+#define MB_SCHED_MAX_PERIODS      96U
+
+#define MB_NOOF_HOLD_REGS         (MB_SCHED_POWER_BASE_REG + MB_SCHED_MAX_PERIODS)
+
+#define MB_CURVE_CMD_COMMIT       1U
+#define MB_CURVE_CMD_DISCARD      2U
+
+#define MB_CURVE_STATUS_IDLE      0U        /* nothing staged */
+#define MB_CURVE_STATUS_STAGING   1U        /* table being written */
+#define MB_CURVE_STATUS_PENDING   2U        /* committed, waiting to be swapped in */
+#define MB_CURVE_STATUS_ACTIVE    3U        /* last commit is in use */
+#define MB_CURVE_STATUS_REJECTED  4U        /* last commit or write failed validation */
+
+#define MB_CURVE_X_SCALE          1000.0    /* register units per Hz */
+#define MB_CURVE_Y_SCALE          10000.0   /* register units per unit power fraction */
+#define MB_SOC_SCALE              10000.0   /* register units per unit SoC */
+#define MB_TP_DURATION_SCALE      100U      /* ms per register unit */
+#define MB_TP_FREQ_SCALE          1000.0    /* register units per Hz */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int MB_HoldRead(uint16_t address, uint16_t *value);
+int MB_HoldWrite(uint16_t address, uint16_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MB_REG_MAP_H */
@@ -0,0 +1,62 @@
+/***************************************************************************************************
+ * 
+ * Header for for MeterAgg.cpp
+ * 
+ * Date: 16/10/2026
+ * 
+ * Author: Shaun Mcsherry
+ * 
+ * ************************************************************************************************/
+#ifndef METER_AGG_H
+#define METER_AGG_H
+
+#include "Acuvim2.h"
+#include "Controller.h"
+
+#define MAX_NOOF_METERS       4U
+
+/* A meter is considered stale if it has not delivered a sample in this time (ms) */
+#define METER_STALE_MS        100U
+
+/* How each meter's power contributes to the aggregated measurement */
+typedef enum METER_ROLE_ENUM
+{
+  METER_ROLE_INCOMER    = 0,   /* power is summed with all other incomers */
+  METER_ROLE_INVERTER   = 1,   /* power is used if any incomer is stale */
+  METER_ROLE_FREQ_ONLY  = 2    /* power is not used */
+}meterRoleEnum_t;
+
+typedef struct METER_CONFIG_STRUCT
+{
+  uint8_t ipAddress[4];
+  const acuvimRegProfile_t *profile;
+  meterRoleEnum_t role;
+  uint8_t freqPriority;        /* 0 is the preferred frequency source */
+}meterConfigStruct_t;
+
+class METER_AGG
+{
+  private:
+    ACUVIM_II meters[MAX_NOOF_METERS];
+    acuvimBasicMeasurement20ms_t latest[MAX_NOOF_METERS];
+    uint16_t sampleAge_ms[MAX_NOOF_METERS];
+    uint8_t noofMeters;
+    uint8_t freqMeter;
+    bool IsMeterHealthy(uint8_t meterIndex);
+    uint8_t SelectFreqMeter(void);
+    bool AggregatePower(acuvimBasicMeasurement20ms_t *measurements);
+
+  public:
+    METER_AGG()  //constructor
+    {
+      noofMeters = 0U;
+      freqMeter = 0U;
+    } 
+    void Init(void);
+    bool Control(acuvimBasicMeasurement20ms_t *measurements);
+    bool GetFaultState(void);
+    bool GetFrequency(uint8_t freqRank, double *frequency);
+    bool GetFrequencySample(uint8_t freqPriority, double *frequency, uint16_t *age_ms);
+};
+
+#endif /* METER_AGG_H */
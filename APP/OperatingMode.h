@@ -10,37 +10,161 @@
 #ifndef OPERATING_MODE_H
 #define OPERATING_MODE_H
 
+#include "RespCurve.h"
+#include "FreqDelay.h"
+
+/* Power demand ramp - one per operating mode */
+typedef struct MODE_RAMP_STRUCT
+{
+  int16_t target;              /* 0.1kW units */
+  int16_t demand;              /* 0.1kW units */
+  double ratePer_ms;
+  uint16_t oldSysCount;
+  bool isRamping;
+}modeRampStruct_t;
+
+/* Dynamic frequency services: a delayed frequency, a response curve and a ramp */
+typedef enum DYN_SERVICE_ENUM
+{
+  DYN_SERVICE_DC      = 0,   /* Dynamic Containment */
+  DYN_SERVICE_DM      = 1,   /* Dynamic Moderation */
+  DYN_SERVICE_DR      = 2,   /* Dynamic Regulation */
+  NOOF_DYN_SERVICES   = 3
+}dynServiceEnum_t;
+
+typedef struct DYN_SERVICE_CONFIG_STRUCT
+{
+  respCurveIdEnum_t curve;     /* response envelope */
+  uint16_t delay_ms;           /* delay applied to the measured frequency */
+  uint16_t ramp_ms;            /* time to move to a new target */
+}dynServiceConfigStruct_t;
+
+typedef struct DYN_SERVICE_STATE_STRUCT
+{
+  FREQ_DELAY delay;
+  modeRampStruct_t ramp;
+  double oldFreqDeviation;
+  bool isTargetValid;          /* false forces the target to be recalculated */
+}dynServiceStateStruct_t;
+
+typedef enum FFR_TYPE_ENUM
+{
+  FFR_STATIC  = 0,   /* full contracted power when frequency falls below the trigger */
+  FFR_DYNAMIC = 1    /* power proportional to frequency deviation outside the deadband */
+}ffrTypeEnum_t;
+
+typedef enum FFR_STATE_ENUM
+{
+  FFR_ARMED       = 0,
+  FFR_DELIVERING  = 1,
+  FFR_RECOVERING  = 2   /* sustain time expired - waiting for frequency to recover */
+}ffrStateEnum_t;
+
+typedef struct FFR_CONFIG_STRUCT
+{
+  ffrTypeEnum_t type;
+  double contractedPower;      /* 0.1kW units, 0 for the maximum rating */
+  double triggerFreq;          /* Hz, static only */
+  double deadband;             /* Hz either side of nominal, dynamic only */
+  double droop;                /* Hz beyond the deadband for full power, dynamic only */
+  uint32_t delivery_ms;        /* time to go from zero to full contracted power */
+  uint32_t sustain_ms;         /* longest continuous delivery */
+  uint16_t delay_ms;           /* delay applied to the measured frequency */
+}ffrConfigStruct_t;
+
+extern const ffrConfigStruct_t FFR_DEFAULT_CONFIG;
+
+/* EirGrid DS3 reserve products, each defined by the time window it covers after an event */
+typedef enum DS3_PRODUCT_ENUM
+{
+  DS3_FFR           = 0,   /* full by 2s, held to 10s */
+  DS3_POR           = 1,   /* full by 5s, held to 15s */
+  DS3_SOR           = 2,   /* full by 15s, held to 90s */
+  DS3_TOR1          = 3,   /* full by 90s, held to 5 minutes */
+  DS3_TOR2          = 4,   /* full by 5 minutes, held to 20 minutes */
+  NOOF_DS3_PRODUCTS = 5
+}ds3ProductEnum_t;
+
+typedef enum DS3_PRODUCT_STATE_ENUM
+{
+  DS3_ARMED     = 0,
+  DS3_ACTIVE    = 1,
+  DS3_COMPLETE  = 2    /* window ended - waiting for frequency to recover */
+}ds3ProductStateEnum_t;
+
+typedef struct DS3_PRODUCT_CONFIG_STRUCT
+{
+  double volume;               /* fraction of rated power, 0 if not contracted */
+  double triggerFreq;          /* Hz */
+  bool isRocofTriggered;       /* also triggered by a falling RoCoF event (Rocof.cpp) */
+  uint32_t response_ms;        /* full volume by this time after the trigger */
+  uint32_t sustainEnd_ms;      /* volume held until this time after the trigger */
+}ds3ProductConfigStruct_t;
+
+typedef struct DS3_PRODUCT_STATUS_STRUCT
+{
+  ds3ProductStateEnum_t state;
+  uint32_t elapsed_ms;         /* time since the product was triggered */
+}ds3ProductStatusStruct_t;
+
+extern const ds3ProductConfigStruct_t DS3_DEFAULT_CONFIG[NOOF_DS3_PRODUCTS];
+
 class OP_MODE 
 {
   private:
-    uint16_t UpdateHeadTail(uint16_t *headIndex, uint16_t maxIndex);
-    uint16_t DC_SmallDelivery (double freqDev);
-    uint16_t DC_LargeDelivery (double freqDev);
-    bool DC_RampPowerDemand(int16_t target, 
-                            int16_t measuredPower, 
-                            int16_t *newDemand, 
-                            uint16_t rampTime, 
-                            double rampRatePer_ms);
-    int16_t DC_UpdatePowerTarget(double freqDiff);
-    double DC_Test_1_1(void);
-    double DC_Test_1_2(void);
-    double DC_Test_1_5(void);
-    double DC_Test_1_7(void);
-    double DC_Test_1_9(void);
-    double DC_Test_1_11(void);
-    double DC_Test_1_13(void);
+    dynServiceStateStruct_t dynState[NOOF_DYN_SERVICES];
+    dynServiceEnum_t dynActive;
+    double delayedFreq;
+    FREQ_DELAY ffrDelay;
+    modeRampStruct_t ffrRamp;
+    ffrConfigStruct_t ffrConfig;
+    ffrStateEnum_t ffrState;
+    uint32_t ffrDeliveryTime_ms;
+    ds3ProductConfigStruct_t ds3Config[NOOF_DS3_PRODUCTS];
+    ds3ProductStatusStruct_t ds3Status[NOOF_DS3_PRODUCTS];
+    modeRampStruct_t ds3Ramp;
+    uint16_t ds3OldSysCount;
+    void InitRamp(modeRampStruct_t *ramp);
+    int16_t RampDemand(modeRampStruct_t *ramp, uint16_t sysCount);
+    bool RampPowerDemand(int16_t target, 
+                         int16_t measuredPower, 
+                         int16_t *newDemand, 
+                         uint16_t rampTime, 
+                         double rampRatePer_ms);
+    int16_t Dyn_UpdatePowerTarget(respCurveIdEnum_t curve, double freqDiff);
+    int16_t Dyn_Control(dynServiceEnum_t service, double frequency, uint16_t sysCount);
+    int16_t FFR_UpdatePowerTarget(double frequency, double contractedPower, uint16_t elapsed_ms);
+    double DS3_UpdateProduct(ds3ProductEnum_t product, bool isRocofEvent, double frequency, 
+                             uint16_t elapsed_ms);
   public:
     OP_MODE()  //constructor
     {
-      ;      
+      dynActive = DYN_SERVICE_DC;
+      delayedFreq = 0.0;
+      ffrState = FFR_ARMED;
+      ffrDeliveryTime_ms = 0U;
+      ffrConfig = FFR_DEFAULT_CONFIG;
+      ds3OldSysCount = 0U;
+
+      for (uint8_t product = 0U; product < NOOF_DS3_PRODUCTS; product++)
+      {
+        ds3Config[product] = DS3_DEFAULT_CONFIG[product];
+        ds3Status[product] = {DS3_ARMED, 0U};
+      }
     } 
-    void DC_Init(uint16_t maxPower, uint16_t systemCounter);
+    void Init(uint16_t maxPower);
     int16_t DC_Control(double frequency, uint16_t sysCount);
-    uint16_t FFR_Control(double frequency);
-    uint16_t DS3_Control(double frequency);
+    int16_t DM_Control(double frequency, uint16_t sysCount);
+    int16_t DR_Control(double frequency, uint16_t sysCount);
+    uint32_t Dyn_GetAchievedDelay(void);
+    double GetDelayedFrequency(void);
+    bool FFR_Configure(const ffrConfigStruct_t *config);
+    int16_t FFR_Control(double frequency, uint16_t sysCount);
+    bool DS3_Configure(ds3ProductEnum_t product, const ds3ProductConfigStruct_t *config);
+    int16_t DS3_Control(double frequency, uint16_t sysCount);
     int16_t PID_TestControl1(uint16_t sysCount);
     int16_t PID_TestControl2(void);
 };
 
-#endif */ OPERATING_MODE_H */
+#endif /* OPERATING_MODE_H */
   
@@ -0,0 +1,113 @@
+/***************************************************************************************************
+ *
+ * Header for for PidAutoTune.cpp
+ *
+ * Date: 16/10/2026
+ *
+ * Author: Shaun Mcsherry
+ *
+ * ************************************************************************************************/
+#ifndef PID_AUTOTUNE_H
+#define PID_AUTOTUNE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "APP/PidCtrl.h"
+
+/* Relay experiment - amplitude and hysteresis are fractions of the output limit (rated power) */
+#define AUTOTUNE_RELAY_AMPLITUDE   0.05
+#define AUTOTUNE_HYSTERESIS        0.005     /* above the measurement noise */
+#define AUTOTUNE_CYCLES            4U        /* consistent cycles needed, after the first */
+#define AUTOTUNE_CYCLE_TOLERANCE   0.1       /* fraction the period and amplitude may vary */
+#define AUTOTUNE_RELAY_TIMEOUT_S   30.0
+
+/* Validation step test - a setpoint step with the new gains */
+#define AUTOTUNE_STEP              0.05      /* fraction of the output limit */
+#define AUTOTUNE_VALIDATE_S        3.0
+#define AUTOTUNE_SETTLE_BAND       0.05      /* fraction of the step */
+#define AUTOTUNE_MAX_SETTLE_S      2.0
+#define AUTOTUNE_MAX_OVERSHOOT     0.2       /* fraction of the step */
+
+typedef enum AUTOTUNE_RULE_ENUM
+{
+  AUTOTUNE_ZN           = 0,    /* Ziegler-Nichols, fast but oscillatory */
+  AUTOTUNE_TL           = 1,    /* Tyreus-Luyben, more damped than ZN */
+  AUTOTUNE_SIMC         = 2     /* Skogestad IMC on a first order plus delay model, PI only */
+}autotuneRuleEnum_t;
+
+typedef enum AUTOTUNE_STATE_ENUM
+{
+  AUTOTUNE_IDLE         = 0,
+  AUTOTUNE_RELAY        = 1,
+  AUTOTUNE_VALIDATE     = 2,
+  AUTOTUNE_DONE         = 3,    /* gains identified and validated */
+  AUTOTUNE_FAILED       = 4
+}autotuneStateEnum_t;
+
+typedef struct AUTOTUNE_RESULT_STRUCT
+{
+  double ku;                   /* ultimate gain */
+  double tu_s;                 /* ultimate period */
+  double tau_s;                /* first order plus dead time model with the same ultimate point */
+  double theta_s;
+  double kp;
+  double ki;                   /* per second */
+  double kd;                   /* seconds */
+  double overshoot;            /* validation step, fraction of the step */
+  double settle_s;             /* validation step, < 0 if it did not settle */
+}autotuneResultStruct_t;
+
+/* Relay feedback auto-tuning: the output is switched either side of an operating point until the
+   measurement oscillates steadily, which gives the ultimate gain and period. Gains are then
+   calculated by the selected rule and checked with a setpoint step. */
+class PID_AUTOTUNE
+{
+  private:
+    autotuneStateEnum_t state;
+    autotuneRuleEnum_t rule;
+    bool isDerivative;
+    pidCtrlConfigStruct_t config;
+    PID_CTRL pid;
+    double processGain;
+    double setpoint;
+    double command;            /* output at the operating point */
+    double amplitude;
+    double hysteresis;
+    double output;
+    bool isRelayHigh;
+    double time_s;
+    double lastRise_s;         /* time of the last switch high, < 0 before the first */
+    double cycleMax;
+    double cycleMin;
+    uint8_t cycles;
+    double lastPeriod_s;
+    double lastAmplitude;
+    double step;
+    autotuneResultStruct_t result;
+    const char *failure;
+    void Fail(const char *reason);
+    void Relay(double measured);
+    bool Calculate(void);
+    void Validate(double measured, double dt_s);
+
+  public:
+    PID_AUTOTUNE()  //constructor
+    {
+      state = AUTOTUNE_IDLE;
+      rule = AUTOTUNE_SIMC;
+      isDerivative = false;
+      processGain = 1.0;
+      failure = "";
+      result = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, -1.0};
+    }
+    bool Start(double operatingPoint, double operatingCommand, const pidCtrlConfigStruct_t *base,
+               double gain, autotuneRuleEnum_t tuneRule, bool useDerivative);
+    double Update(double measured, double dt_s);
+    void Stop(void);
+    bool IsRunning(void);
+    autotuneStateEnum_t GetState(void);
+    const char *GetFailure(void);
+    void GetResult(autotuneResultStruct_t *tuneResult);
+};
+
+#endif /* PID_AUTOTUNE_H */
@@ -0,0 +1,78 @@
+/***************************************************************************************************
+ *
+ * Header for for PidCtrl.cpp
+ *
+ * Date: 16/10/2026
+ *
+ * Author: Shaun Mcsherry
+ *
+ * ************************************************************************************************/
+#ifndef PID_CTRL_H
+#define PID_CTRL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Derivative filter time constant is Td / PID_CTRL_DERIV_N */
+#define PID_CTRL_DERIV_N          10.0
+
+/* A step longer than this (s) is treated as a restart and limited to it */
+#define PID_CTRL_MAX_DT_S         0.1
+
+template <typename T>
+struct PID_CTRL_CONFIG_STRUCT
+{
+  T kp;
+  T ki;                        /* per second */
+  T kd;                        /* seconds */
+  T setpointWeight;            /* b - fraction of the setpoint in the proportional term */
+  T derivWeight;               /* c - fraction of the setpoint in the derivative term */
+  T trackingTime_s;            /* back-calculation time constant, 0 to derive it from the gains */
+  T outMin;
+  T outMax;
+  T rateLimit;                 /* largest output change per second, 0 for none */
+};
+
+typedef PID_CTRL_CONFIG_STRUCT<double> pidCtrlConfigStruct_t;
+
+/* Fixed step PID controller. Compute runs exactly once per call with the supplied time step.
+   The integrator is wound back towards the output actually applied (back-calculation), so it
+   does not wind up when the output is limited here or saturates downstream (see Track).
+   The controller is templated on its numeric type; PidCtrl.cpp instantiates it for double (the
+   firmware's PID_CTRL), float and the Q formats of FixedQ.h. */
+template <typename T>
+class PID_CTRL_T
+{
+  private:
+    PID_CTRL_CONFIG_STRUCT<T> config;
+    T integral;
+    T derivative;
+    T lastDerivInput;
+    T lastPropInput;           /* b.r - y at the last step */
+    T output;                  /* last output, limited */
+    T unlimited;               /* last output before limiting */
+    T lastDt_s;
+    bool isSaturated;
+    bool isStarted;
+    T TrackingGain(T dt_s);
+
+  public:
+    PID_CTRL_T()  //constructor
+    {
+      config = {T(0.0), T(0.0), T(0.0), T(1.0), T(0.0), T(0.0), T(-1.0), T(1.0), T(0.0)};
+      Reset(T(0.0), T(0.0));
+    }
+    void SetConfig(const PID_CTRL_CONFIG_STRUCT<T> *newConfig);
+    void GetConfig(PID_CTRL_CONFIG_STRUCT<T> *currentConfig);
+    void SetTunings(T kp, T ki, T kd);
+    void SetOutputLimits(T outMin, T outMax);
+    void Reset(T initialOutput, T measured);
+    T Compute(T setpoint, T measured, T dt_s);
+    void Track(T applied);
+    bool IsSaturated(void);
+    T GetOutput(void);
+};
+
+typedef PID_CTRL_T<double> PID_CTRL;
+
+#endif /* PID_CTRL_H */
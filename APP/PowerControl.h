@@ -11,7 +11,6 @@
 #define POWER_CONTROL_H
 
 
-#include <PID_v1.h>
 #include "Controller.h"
 //#include "../UTILS/PID.h"
 
@@ -40,6 +39,12 @@ typedef enum PC_AC_MODE_ENUM
     AC_CURRENT_CONTROL_MODE = 1
 }pcAcModeEnum_t;
 
+typedef enum CTRL_STRUCTURE_ENUM
+{
+    CTRL_PID_ONLY         = 0,    /* PID output is the inverter command */
+    CTRL_FF_PLUS_TRIM     = 1     /* inverse characteristic feedforward plus PID trim */
+}ctrlStructureEnum_t;
+
 /* Each object to control, i.e. current and power, has a real and reactive element */
 //typedef struct PC_AC_OBJ_STRUCT_T
 //{
@@ -68,15 +73,33 @@ class POWER_CTRL
     double i_currentGain;
     double d_currentGain;
 
+    double openLoopDemand;    /* last command sent in degraded (open-loop) mode */
+    uint16_t pidSysCount;     /* system counter at the last PID step */
+    ctrlStructureEnum_t ctrlStructure;
+    bool isStructureChanged;  /* the PID must take over from the last command */
+    double feedforward;       /* feedforward part of the last power command */
+    double trimReference;     /* modelled response to the feedforward, the PID trim setpoint */
+
     void GetStoredParams(void);
+    void SaveParams(void);
     inline double ScaleEngUnit(int16_t value, int16_t min, int16_t max, bool limit);
     inline int16_t Unscale(double value, int16_t min, int16_t max);
     bool ManagePower(uint16_t sysCount);
+    double GetModeDemand(double frequency, uint16_t sysCount);
+    bool ManagePowerOpenLoop(double frequency, uint16_t sysCount);
+    bool ManagePowerRocof(uint16_t sysCount);
+    void ResumeClosedLoop(void);
+    bool ManageAutoTune(double dt_s);
     bool ReadMeter(void);
     bool TxInverterOnOff(bool inverterEnable);
     void PidParamsAnaOut(double setpoint, double measuredValue, double pidOut);
     double ScaleAnalogue(double value);
-    void PID_TuneParams(void);
+    void SerialCommand(void);
+    void PID_TuneParams(String pidCommand);
+    void CtrlCommand(String command);
+    void AutoTuneCommand(String command);
+    void SmithCommand(String command);
+    void TraceSample(double frequency, double demand);
   public:
     POWER_CTRL() //constructor
     {
@@ -90,6 +113,13 @@ class POWER_CTRL
       i_currentGain = 0.2;
       d_currentGain = 0.0;
 
+      openLoopDemand = 0.0;
+      pidSysCount = 0U;
+      ctrlStructure = CTRL_STRUCTURE_DEFAULT;
+      isStructureChanged = false;
+      feedforward = 0.0;
+      trimReference = 0.0;
+
       /* Comment out as necessary */
       mode = AC_POWER_CONTROL_MODE;
       //static pcAcModeEnum_t mode = AC_CURRENT_CONTROL_MODE;
@@ -104,6 +134,8 @@ class POWER_CTRL
     int16_t GetPowerRealControl(void);
     int16_t GetCurrentControl(void);
     double DemandAdjust(double powerDemand);
+    void SetCtrlStructure(ctrlStructureEnum_t structure);
+    ctrlStructureEnum_t GetCtrlStructure(void);
     void DisplayControllerState(statusBitsEnum_t state);
 };
 
@@ -0,0 +1,107 @@
+/***************************************************************************************************
+ *
+ * Header for for ReactCtrl.cpp
+ *
+ * Date: 16/10/2026
+ *
+ * Author: Shaun Mcsherry
+ *
+ * ************************************************************************************************/
+#ifndef REACT_CTRL_H
+#define REACT_CTRL_H
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "APP/PidCtrl.h"
+
+#define REACT_MODE_DEFAULT        REACT_OFF
+#define REACT_PRIORITY_DEFAULT    REACT_PRIORITY_P
+
+#define REACT_MIN_PF              0.8       /* smallest power factor that can be set */
+#define REACT_VOLT_VAR_TAU_MS     2000.0    /* voltage filter, 90% of a step in about 5s */
+#define REACT_MIN_VOLTAGE         0.5       /* per unit, a lower reading is not a measurement */
+#define VOLT_VAR_POINTS           4U
+
+/* Reactive power trim PI, and the command rate limit in reactive rating per second */
+#define REACT_PID_KP              0.2
+#define REACT_PID_KI              2.0
+#define REACT_RATE_LIMIT          2.0
+
+typedef enum REACT_MODE_ENUM
+{
+  REACT_OFF             = 0,    /* no reactive power is commanded */
+  REACT_FIXED_Q         = 1,    /* fixed reactive power */
+  REACT_FIXED_PF        = 2,    /* reactive power in proportion to the real power */
+  REACT_VOLT_VAR        = 3,    /* reactive power from the line voltage by a droop curve */
+  NOOF_REACT_MODES      = 4
+}reactModeEnum_t;
+
+/* Which of real and reactive power is cut back when both do not fit in the apparent rating */
+typedef enum REACT_PRIORITY_ENUM
+{
+  REACT_PRIORITY_P      = 0,
+  REACT_PRIORITY_Q      = 1
+}reactPriorityEnum_t;
+
+typedef struct VOLT_VAR_POINT_STRUCT
+{
+  double voltage;              /* per unit of the nominal line voltage */
+  double reactive;             /* fraction of the reactive rating, positive for export */
+}voltVarPointStruct_t;
+
+/* Reactive power control. The target comes from the mode, and a PI trims the command so the
+   measured reactive power meets it. Reactive power is positive when exported (over-excited,
+   raising the voltage), as real power is positive when exported. */
+class REACT_CTRL
+{
+  private:
+    reactModeEnum_t mode;
+    reactPriorityEnum_t priority;
+    double fixedReactive;      /* 0.1kVAr units */
+    double powerFactor;        /* positive exports reactive power, negative imports it */
+    voltVarPointStruct_t curve[VOLT_VAR_POINTS];
+    double nominalVoltage;     /* line volts */
+    double maxReactive;        /* 0.1kVAr units */
+    double voltage;            /* filtered, per unit */
+    bool isVoltageValid;
+    PID_CTRL pid;
+    double target;             /* 0.1kVAr units */
+    double reactiveCommand;    /* last command, 0.1kVAr units */
+    double measured;           /* last measurement, 0.1kVAr units */
+    double VoltVar(double perUnit);
+
+  public:
+    REACT_CTRL()  //constructor
+    {
+      mode = REACT_MODE_DEFAULT;
+      priority = REACT_PRIORITY_DEFAULT;
+      fixedReactive = 0.0;
+      powerFactor = 1.0;
+      curve[0] = {0.92, 0.44};
+      curve[1] = {0.98, 0.0};
+      curve[2] = {1.02, 0.0};
+      curve[3] = {1.08, -0.44};
+      nominalVoltage = 1.0;
+      maxReactive = 0.0;
+      voltage = 1.0;
+      isVoltageValid = false;
+      target = 0.0;
+      reactiveCommand = 0.0;
+      measured = 0.0;
+    }
+    void Init(double nominalLineVoltage, double ratedReactive);
+    bool SetMode(reactModeEnum_t newMode, double value);
+    bool SetCurve(const voltVarPointStruct_t *points);
+    void SetPriority(reactPriorityEnum_t newPriority);
+    double Target(double realPower, double lineVoltage, double dt_s);
+    void Limits(double realDemand, double apparentRating, double *realLimit,
+                double *reactiveLimit);
+    double Compute(double reactiveLimit, double measuredReactive, double dt_s);
+    double Hold(double realCommand, double apparentRating);
+    void Command(String command);
+};
+
+extern REACT_CTRL reactCtrlObj;
+
+#endif /* REACT_CTRL_H */
@@ -0,0 +1,255 @@
+/***************************************************************************************************
+ *
+ * Header for for RespCurve.cpp
+ *
+ * Date: 16/10/2026
+ *
+ * Author: Shaun Mcsherry
+ *
+ * ************************************************************************************************/
+#ifndef RESP_CURVE_H
+#define RESP_CURVE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+
+#define RESP_CURVE_MAX_KNOTS     16U
+
+/* Largest power fraction a curve may demand (full import or export) */
+#define RESP_CURVE_MAX_Y         1.0
+
+/* Knots closer than this (Hz) to an equal spacing are treated as a uniform grid */
+#define RESP_CURVE_UNIFORM_TOL   1.0e-6
+
+/* Response curves that can be loaded at runtime */
+typedef enum RESP_CURVE_ID_ENUM
+{
+  RESP_CURVE_DC     = 0,   /* Dynamic Containment */
+  RESP_CURVE_DM     = 1,   /* Dynamic Moderation */
+  RESP_CURVE_DR     = 2,   /* Dynamic Regulation */
+  NOOF_RESP_CURVES  = 3
+}respCurveIdEnum_t;
+
+/* A knot maps frequency deviation from nominal (Hz) to a fraction of rated power. Positive
+   power is export, so under-frequency knots have positive power. */
+template <typename T>
+struct RESP_CURVE_KNOT_STRUCT
+{
+  T x;         /* frequency deviation, Hz */
+  T y;         /* power fraction, -1.0 to 1.0 */
+};
+
+template <typename T>
+struct RESP_CURVE_TABLE_STRUCT
+{
+  RESP_CURVE_KNOT_STRUCT<T> knots[RESP_CURVE_MAX_KNOTS];
+  T slope[RESP_CURVE_MAX_KNOTS];          /* slope of the segment starting at each knot */
+  uint8_t noofKnots;
+  bool isUniform;
+  T invSpacing;                           /* 1 / knot spacing, uniform tables only */
+};
+
+typedef RESP_CURVE_KNOT_STRUCT<double> respCurveKnotStruct_t;
+typedef RESP_CURVE_TABLE_STRUCT<double> respCurveTableStruct_t;
+
+/* Default curves, as published by National Grid ESO. The host tools (compliance_analyser,
+   kernel_check) include these too, so they check against the curves the firmware runs */
+constexpr respCurveKnotStruct_t RESP_CURVE_DC_KNOTS[] =
+{
+  /* freq dev (Hz), power fraction */
+  { -0.5,           1.0   },
+  { -0.2,           0.05  },
+  { -0.015,         0.0   },
+  {  0.015,         0.0   },
+  {  0.2,          -0.05  },
+  {  0.5,          -1.0   }
+};
+
+constexpr respCurveKnotStruct_t RESP_CURVE_DM_KNOTS[] =
+{
+  /* freq dev (Hz), power fraction */
+  { -0.2,           1.0   },
+  { -0.1,           0.05  },
+  { -0.015,         0.0   },
+  {  0.015,         0.0   },
+  {  0.1,          -0.05  },
+  {  0.2,          -1.0   }
+};
+
+constexpr respCurveKnotStruct_t RESP_CURVE_DR_KNOTS[] =
+{
+  /* freq dev (Hz), power fraction */
+  { -0.2,           1.0   },
+  { -0.015,         0.0   },
+  {  0.015,         0.0   },
+  {  0.2,          -1.0   }
+};
+
+constexpr uint8_t RESP_CURVE_DC_NOOF_KNOTS =
+  (uint8_t)(sizeof(RESP_CURVE_DC_KNOTS) / sizeof(RESP_CURVE_DC_KNOTS[0]));
+constexpr uint8_t RESP_CURVE_DM_NOOF_KNOTS =
+  (uint8_t)(sizeof(RESP_CURVE_DM_KNOTS) / sizeof(RESP_CURVE_DM_KNOTS[0]));
+constexpr uint8_t RESP_CURVE_DR_NOOF_KNOTS =
+  (uint8_t)(sizeof(RESP_CURVE_DR_KNOTS) / sizeof(RESP_CURVE_DR_KNOTS[0]));
+
+/***************************************************************************************************
+ * CURVE_Build
+ *
+ * This function fills a table from knots, with the segment slopes and grid spacing worked out in
+ * double and then converted, so a float or fixed point table is as close as its type allows. The
+ * knots are not checked (see RESP_CURVE::Prepare).
+ *
+ * Parameters:
+ * knots - the knots, in strictly increasing frequency order; may be the table's own knots
+ * noofKnots - number of knots, 2 to RESP_CURVE_MAX_KNOTS
+ * table - the table to fill
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+template <typename T>
+void CURVE_Build(const respCurveKnotStruct_t *knots, uint8_t noofKnots,
+                 RESP_CURVE_TABLE_STRUCT<T> *table)
+{
+  uint8_t knot;
+  double spacing;
+  double firstSpacing;
+
+  firstSpacing = knots[1].x - knots[0].x;
+  table->isUniform = true;
+
+  for (knot = 0U; knot < (noofKnots - 1U); knot++)
+  {
+    spacing = knots[knot + 1U].x - knots[knot].x;
+    table->slope[knot] = T((knots[knot + 1U].y - knots[knot].y) / spacing);
+
+    if (fabs(spacing - firstSpacing) > RESP_CURVE_UNIFORM_TOL)
+    {
+      table->isUniform = false;
+    }
+  }
+
+  for (knot = 0U; knot < noofKnots; knot++)
+  {
+    table->knots[knot].x = T(knots[knot].x);
+    table->knots[knot].y = T(knots[knot].y);
+  }
+
+  table->slope[noofKnots - 1U] = T(0.0);
+  table->invSpacing = T(1.0 / firstSpacing);
+  table->noofKnots = noofKnots;
+}
+
+/***************************************************************************************************
+ * CURVE_Evaluate
+ *
+ * This function interpolates a table: a segment lookup and one multiply-add. Tables with equally
+ * spaced knots are indexed directly, others are binary searched (at most
+ * log2(RESP_CURVE_MAX_KNOTS) steps). Outside the table the end values are held.
+ *
+ * Parameters:
+ * table - the table
+ * x - frequency deviation from nominal (Hz)
+ *
+ * Return:
+ * Power fraction, positive for export. Zero if the table is empty.
+ *
+ **************************************************************************************************/
+template <typename T>
+T CURVE_Evaluate(const RESP_CURVE_TABLE_STRUCT<T> *table, T x)
+{
+  uint8_t segment;
+  uint8_t low;
+  uint8_t high;
+  uint8_t mid;
+  T y;
+
+  if (0U == table->noofKnots)
+  {
+    y = T(0.0);
+  }
+  else if (x <= table->knots[0].x)
+  {
+    y = table->knots[0].y;
+  }
+  else if (x >= table->knots[table->noofKnots - 1U].x)
+  {
+    y = table->knots[table->noofKnots - 1U].y;
+  }
+  else
+  {
+    if (true == table->isUniform)
+    {
+      /* through int32_t, the one integer conversion every numeric type has */
+      segment = (uint8_t)(int32_t)((x - table->knots[0].x) * table->invSpacing);
+
+      if (segment > (table->noofKnots - 2U))
+      {
+        segment = table->noofKnots - 2U;
+      }
+    }
+    else
+    {
+      low = 0U;
+      high = table->noofKnots - 1U;
+
+      while ((uint8_t)(high - low) > 1U)
+      {
+        mid = (low + high) / 2U;
+
+        if (x < table->knots[mid].x)
+        {
+          high = mid;
+        }
+        else
+        {
+          low = mid;
+        }
+      }
+      segment = low;
+    }
+
+    y = table->knots[segment].y + (table->slope[segment] * (x - table->knots[segment].x));
+  }
+
+  return y;
+}
+
+/* A curve is double buffered: the control loop evaluates the active table while a new one is
+   staged from another thread. A committed table is swapped in by Update() between ticks. */
+class RESP_CURVE
+{
+  private:
+    respCurveTableStruct_t tables[2];
+    volatile uint8_t activeTable;
+    volatile bool isSwapPending;
+    bool Prepare(respCurveTableStruct_t *table);
+
+  public:
+    RESP_CURVE()  //constructor
+    {
+      tables[0].noofKnots = 0U;
+      tables[1].noofKnots = 0U;
+      activeTable = 0U;
+      isSwapPending = false;
+    }
+    bool Init(const respCurveKnotStruct_t *knots, uint8_t noofKnots);
+    bool BeginEdit(void);
+    bool SetKnot(uint8_t index, double x, double y);
+    bool SetNoofKnots(uint8_t noofKnots);
+    bool Commit(void);
+    void Update(void);
+    double Evaluate(double x);
+    bool IsSwapPending(void);
+    uint8_t GetNoofKnots(void);
+    bool GetKnot(uint8_t index, respCurveKnotStruct_t *knot);
+};
+
+extern RESP_CURVE respCurveObj[NOOF_RESP_CURVES];
+
+extern void CURVE_Init(void);
+extern void CURVE_Update(void);
+
+#endif /* RESP_CURVE_H */
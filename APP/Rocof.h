@@ -0,0 +1,108 @@
+/***************************************************************************************************
+ *
+ * Header for for Rocof.cpp
+ *
+ * Date: 16/10/2026
+ *
+ * Author: Shaun Mcsherry
+ *
+ * ************************************************************************************************/
+#ifndef ROCOF_H
+#define ROCOF_H
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreqDelay.h"
+
+/* Defaults - all can be changed at run time over the serial port (see Command) */
+#define ROCOF_DEFAULT_WINDOW_MS    100U     /* RoCoF is the frequency change over this window */
+#define ROCOF_DEFAULT_FILTER_MS    20U      /* noise filter time constant, 0 for none */
+#define ROCOF_DEFAULT_TRIGGER      0.5      /* in Hz/s, either direction */
+#define ROCOF_DEFAULT_DURATION_MS  0U       /* RoCoF must stay past the trigger for this long */
+
+/* The event clears once RoCoF falls below this fraction of the trigger */
+#define ROCOF_REARM_FRACTION       0.5
+
+/* Frequency is sampled into the window when it changes, at most this often, and at least
+   every ROCOF_MAX_SAMPLE_MS when it holds */
+#define ROCOF_MIN_SAMPLE_MS        5U
+#define ROCOF_MAX_SAMPLE_MS        20U
+#define ROCOF_MIN_WINDOW_MS        20U
+#define ROCOF_MAX_WINDOW_MS        600U     /* FREQ_DELAY_CAPACITY samples at ROCOF_MIN_SAMPLE_MS */
+#define ROCOF_MAX_FILTER_MS        1000U
+
+typedef enum ROCOF_EVENT_ENUM
+{
+  ROCOF_NO_EVENT  = 0,
+  ROCOF_FALLING   = 1,    /* frequency falling faster than the trigger */
+  ROCOF_RISING    = 2     /* frequency rising faster than the trigger */
+}rocofEventEnum_t;
+
+typedef struct ROCOF_CONFIG_STRUCT
+{
+  uint16_t window_ms;
+  uint16_t filter_ms;
+  double trigger;              /* Hz/s */
+  uint16_t duration_ms;
+}rocofConfigStruct_t;
+
+typedef struct ROCOF_STATS_STRUCT
+{
+  uint32_t events;
+  uint32_t responses;          /* events that a demand was sent for */
+  uint32_t lastLatency_us;     /* trigger to CAN frame */
+  uint32_t minLatency_us;
+  uint32_t maxLatency_us;
+  uint32_t totalLatency_us;
+  double lastEventRocof;       /* Hz/s, at the start of the last event */
+}rocofStatsStruct_t;
+
+/* Rate of change of frequency, with a threshold trigger for a fast response */
+class ROCOF
+{
+  private:
+    rocofConfigStruct_t config;
+    FREQ_DELAY window;
+    double rocof;
+    double filterCoeff;
+    double lastFrequency;
+    uint32_t lastSample_ms;
+    uint32_t lastUpdate_ms;
+    uint32_t beyond_ms;          /* time RoCoF has been past the trigger */
+    bool isSampled;
+    bool isValid;
+    rocofEventEnum_t event;
+    bool isNewEvent;
+    bool isResponsePending;      /* no changed demand sent yet for the event */
+    uint32_t trigger_us;
+    uint32_t windowStart_ms;     /* start of the window that triggered the event */
+    rocofStatsStruct_t stats;
+    void UpdateEvent(uint16_t elapsed_ms);
+
+  public:
+    ROCOF()  //constructor
+    {
+      config = {ROCOF_DEFAULT_WINDOW_MS, ROCOF_DEFAULT_FILTER_MS, ROCOF_DEFAULT_TRIGGER,
+                ROCOF_DEFAULT_DURATION_MS};
+      stats = {0U, 0U, 0U, 0U, 0U, 0U, 0.0};
+      Reset();
+    }
+    void Reset(void);
+    void Update(double frequency);
+    double GetRocof(void);
+    bool IsValid(void);
+    rocofEventEnum_t GetEvent(void);
+    bool GetNewEvent(void);
+    uint32_t GetEventAge(void);
+    bool IsResponsePending(void);
+    void RecordResponse(void);
+    bool SetConfig(const rocofConfigStruct_t *newConfig);
+    void GetConfig(rocofConfigStruct_t *currentConfig);
+    void GetStats(rocofStatsStruct_t *rocofStats);
+    void Command(String command);
+};
+
+extern ROCOF rocofObj;
+
+#endif /* ROCOF_H */
@@ -0,0 +1,73 @@
+/***************************************************************************************************
+ *
+ * Header for for Schedule.cpp
+ *
+ * Date: 16/10/2026
+ *
+ * Author: Shaun Mcsherry
+ *
+ * ************************************************************************************************/
+#ifndef SCHEDULE_H
+#define SCHEDULE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SCHED_PERIOD_S           1800U     /* settlement period */
+#define SCHED_MAX_PERIODS        96U       /* 48 hours */
+#define SCHED_DEFAULT_RAMP_S     60U       /* ramp between periods, centred on the boundary */
+
+/* Persistence */
+#define SCHED_NVR_KEY            "/kv/sched"
+#define SCHED_NVR_VERSION        1U
+
+/* A schedule is a run of consecutive settlement periods, each with a power setpoint */
+typedef struct SCHED_TABLE_STRUCT
+{
+  uint32_t version;                     /* SCHED_NVR_VERSION, the table is stored as it is */
+  uint32_t start;                       /* start of the first period (s since 1970, UTC) */
+  int16_t power[SCHED_MAX_PERIODS];     /* 0.1kW units, + is export */
+  uint16_t ramp_s;                      /* ramp between periods of different power, 0 to step */
+  uint8_t noofPeriods;
+}schedTableStruct_t;
+
+/* The schedule is double buffered in the same way as a response curve: the control loop runs the
+   active table while a replacement is staged from another thread. A committed table is swapped
+   in by Update() between ticks. */
+class SCHEDULE
+{
+  private:
+    schedTableStruct_t tables[2];
+    volatile uint8_t activeTable;
+    volatile bool isSwapPending;
+    bool isSavePending;
+    double PeriodPower(const schedTableStruct_t *table, int32_t period);
+
+  public:
+    SCHEDULE()  //constructor
+    {
+      tables[0].noofPeriods = 0U;
+      tables[1].noofPeriods = 0U;
+      activeTable = 0U;
+      isSwapPending = false;
+      isSavePending = false;
+    }
+    void Init(void);
+    bool BeginEdit(void);
+    bool SetStart(uint32_t start);
+    bool SetPower(uint8_t index, int16_t power);
+    bool SetNoofPeriods(uint8_t noofPeriods);
+    bool SetRamp(uint16_t ramp_s);
+    bool Commit(void);
+    void Update(void);
+    bool GetDemand(double *demand);
+    bool IsSwapPending(void);
+    uint32_t GetStart(void);
+    uint8_t GetNoofPeriods(void);
+    uint16_t GetRamp(void);
+    int16_t GetPower(uint8_t index);
+};
+
+extern SCHEDULE scheduleObj;
+
+#endif /* SCHEDULE_H */
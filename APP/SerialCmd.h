@@ -0,0 +1,17 @@
+/***************************************************************************************************
+ *
+ * Header for for SerialCmd.cpp
+ *
+ * Date: 16/10/2026
+ *
+ * Author: Shaun Mcsherry
+ *
+ * ************************************************************************************************/
+#ifndef SERIAL_CMD_H
+#define SERIAL_CMD_H
+
+#include <Arduino.h>
+
+extern String CMD_NextToken(const String &command, int *position);
+
+#endif /* SERIAL_CMD_H */
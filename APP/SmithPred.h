@@ -0,0 +1,112 @@
+/***************************************************************************************************
+ *
+ * Header for for SmithPred.cpp
+ *
+ * Date: 16/10/2026
+ *
+ * Author: Shaun Mcsherry
+ *
+ * ************************************************************************************************/
+#ifndef SMITH_PRED_H
+#define SMITH_PRED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Model limits */
+#define SMITH_MAX_TAU_S           5.0
+#define SMITH_MAX_DEAD_TIME_S     0.5
+#define SMITH_MIN_GAIN            0.5
+#define SMITH_MAX_GAIN            2.0
+#define SMITH_HISTORY             64U       /* model samples, over SMITH_MAX_DEAD_TIME_S at 20ms */
+#define SMITH_MAX_GAP_S           0.2       /* a longer gap between samples restarts the model */
+
+/* Dead time measurement - a command step of at least SMITH_STEP_DETECT of rated power, from steady
+   state, is timed until the power has moved SMITH_RESPONSE_DETECT of the step */
+#define SMITH_STEP_DETECT         0.02
+#define SMITH_RESPONSE_DETECT     0.2
+#define SMITH_MEASURE_TIMEOUT_S   1.0
+#define SMITH_DEAD_TIME_FILTER    0.25      /* weight of each new measurement */
+
+/* First order plus dead time model of the inverter, from the command to the measured power */
+typedef struct SMITH_MODEL_STRUCT
+{
+  double gain;                 /* measured power per unit of expected power */
+  double tau_s;                /* time constant */
+  double deadTime_s;           /* CAN, inverter and meter transport delay */
+}smithModelStruct_t;
+
+typedef struct SMITH_SAMPLE_STRUCT
+{
+  uint32_t time_us;
+  double power;
+}smithSampleStruct_t;
+
+typedef struct SMITH_DEAD_TIME_STRUCT
+{
+  double deadTime_s;           /* filtered measurement, < 0 before the first */
+  double last_s;               /* last measurement */
+  uint32_t measurements;
+  uint32_t timeouts;           /* steps with no response in SMITH_MEASURE_TIMEOUT_S */
+}smithDeadTimeStruct_t;
+
+/* Smith predictor: the PID is given the measurement with the modelled effect of the dead time
+   removed, so it controls the model of the inverter without its delay and can be tuned harder.
+   Where the model is wrong the measurement still corrects it, one dead time later. */
+class SMITH_PRED
+{
+  private:
+    smithModelStruct_t model;
+    bool isEnabled;
+    bool isDeadTimeTracked;    /* the model dead time follows the measurement */
+    double maxPower;
+    double input;              /* expected power of the command in force */
+    bool isInputKnown;         /* a command has been sent since the model started */
+    double undelayed;          /* model output without the dead time */
+    smithSampleStruct_t history[SMITH_HISTORY];
+    uint16_t head;             /* newest sample */
+    bool isStarted;
+    uint32_t lastTime_us;
+    double lastMeasured;
+    bool isMeasuring;
+    uint32_t stepTime_us;
+    double stepSize;
+    double stepBase;           /* measured power before the step */
+    smithDeadTimeStruct_t deadTime;
+    double Delayed(uint32_t now_us);
+    void MeasureDeadTime(double measured, uint32_t now_us, double dt_s);
+
+  public:
+    SMITH_PRED()  //constructor
+    {
+      model = {1.0, 0.1, 0.0};
+      isEnabled = false;
+      isDeadTimeTracked = false;
+      maxPower = 1.0;
+      input = 0.0;
+      isInputKnown = false;
+      undelayed = 0.0;
+      head = 0U;
+      isStarted = false;
+      lastTime_us = 0U;
+      lastMeasured = 0.0;
+      isMeasuring = false;
+      stepTime_us = 0U;
+      stepSize = 0.0;
+      stepBase = 0.0;
+      deadTime = {-1.0, -1.0, 0U, 0U};
+    }
+    bool Init(const smithModelStruct_t *initModel, double rated);
+    bool SetModel(const smithModelStruct_t *newModel);
+    void GetModel(smithModelStruct_t *currentModel);
+    void SetEnabled(bool enable);
+    bool IsEnabled(void);
+    void SetDeadTimeTracked(bool track);
+    bool IsDeadTimeTracked(void);
+    void Reset(double power, uint32_t now_us);
+    void Sent(double expectedPower, uint32_t now_us);
+    double Feedback(double measured, uint32_t now_us);
+    void GetDeadTime(smithDeadTimeStruct_t *measuredDeadTime);
+};
+
+#endif /* SMITH_PRED_H */
@@ -0,0 +1,86 @@
+/***************************************************************************************************
+ *
+ * Header for for SocMgr.cpp
+ *
+ * Date: 16/10/2026
+ *
+ * Author: Shaun Mcsherry
+ *
+ * ************************************************************************************************/
+#ifndef SOC_MGR_H
+#define SOC_MGR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Battery */
+#define SOC_CAPACITY_KWH           2000.0    /* usable energy */
+#define SOC_CHARGE_EFFICIENCY      0.95      /* grid to battery */
+#define SOC_DISCHARGE_EFFICIENCY   0.95      /* battery to grid */
+#define SOC_POWER_UNIT_KW          0.1       /* measured power is in the power demand units */
+
+/* SoC limits - availability is derated linearly over the band inside each limit */
+#define SOC_DEFAULT                0.5       /* used if no SoC has been stored */
+#define SOC_MIN                    0.05
+#define SOC_MAX                    0.95
+#define SOC_DERATE_BAND            0.10
+
+/* SoC management baseline - power added to the response demand to bring SoC back to target */
+#define SOC_TARGET                 0.5
+#define SOC_BASELINE_DEADBAND      0.15      /* no baseline within target +/- this */
+#define SOC_BASELINE_GAIN          2.0       /* fraction of rated power per unit SoC outside it */
+#define SOC_BASELINE_MAX           0.2       /* fraction of rated power */
+
+/* BMS correction - fraction of the difference removed on each BMS reading */
+#define SOC_BMS_CORRECTION_GAIN    0.05
+
+/* Persistence */
+#define SOC_NVR_KEY                "/kv/soc"
+#define SOC_NVR_VERSION            1U
+#define SOC_SAVE_PERIOD_MS         60000UL
+#define SOC_SAVE_CHANGE            0.001     /* only save if SoC has moved by this much */
+#define SOC_MAX_STEP_MS            1000U     /* longer gaps are not integrated */
+
+typedef struct SOC_NVR_RECORD_STRUCT
+{
+  uint32_t version;
+  double soc;
+}socNvrRecordStruct_t;
+
+class SOC_MGR
+{
+  private:
+    double soc;                /* 0.0 to 1.0 */
+    double savedSoc;
+    uint32_t saveTimer_ms;
+    uint16_t oldSysCount;
+    bool isTiming;
+    double maxPower;           /* 0.1kW units */
+    volatile uint16_t bmsSoc;  /* 0.01% units, written from the Modbus context */
+    volatile bool isBmsPending;
+    void Save(void);
+
+  public:
+    SOC_MGR()  //constructor
+    {
+      soc = SOC_DEFAULT;
+      savedSoc = SOC_DEFAULT;
+      saveTimer_ms = 0U;
+      oldSysCount = 0U;
+      isTiming = false;
+      maxPower = 0.0;
+      bmsSoc = 0U;
+      isBmsPending = false;
+    }
+    void Init(uint16_t maxRated);
+    void Update(double measuredPower, uint16_t sysCount);
+    void SetBmsSoc(uint16_t bmsSoc_x100);
+    double GetSoc(void);
+    double GetBaseline(void);
+    double Limit(double demand);
+    void GetAvailability(double *exportAvail, double *importAvail);
+};
+
+extern SOC_MGR socMgrObj;
+
+#endif /* SOC_MGR_H */
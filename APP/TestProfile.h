@@ -0,0 +1,118 @@
+/***************************************************************************************************
+ *
+ * Header for for TestProfile.cpp
+ *
+ * Date: 16/10/2026
+ *
+ * Author: Shaun Mcsherry
+ *
+ * ************************************************************************************************/
+#ifndef TEST_PROFILE_H
+#define TEST_PROFILE_H
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TP_MAX_SEGMENTS        16U
+#define TP_START_FREQ          50.0     /* in Hz, frequency at the start of every pass */
+#define TP_MIN_FREQ            45.0     /* in Hz, profile frequency is held within these */
+#define TP_MAX_FREQ            55.0
+#define TP_MARKER_OUTPUT       1U       /* digital output marking test events */
+
+/* Profile started at power up, for test rigs only. A running profile replaces the measured
+   frequency in every mode (and the RoCoF derived from it), so it must not be left on in a unit
+   that delivers a service. Without it a profile waits for a serial or Modbus command. */
+//#define TP_AUTOSTART_PROFILE   TP_PROFILE_DC_1_13
+
+typedef enum TP_PROFILE_ID_ENUM
+{
+  TP_PROFILE_NONE     = 0,   /* no profile - measured frequency is used */
+  TP_PROFILE_USER     = 1,   /* loaded over serial or Modbus */
+  TP_PROFILE_DC_1_1   = 2,   /* National Grid DC compliance tests */
+  TP_PROFILE_DC_1_2   = 3,
+  TP_PROFILE_DC_1_5   = 4,
+  TP_PROFILE_DC_1_7   = 5,
+  TP_PROFILE_DC_1_9   = 6,
+  TP_PROFILE_DC_1_11  = 7,
+  TP_PROFILE_DC_1_13  = 8,
+  NOOF_TP_PROFILES    = 9
+}tpProfileIdEnum_t;
+
+typedef enum TP_SEG_TYPE_ENUM
+{
+  TP_SEG_STEP = 0,   /* hold a frequency */
+  TP_SEG_RAMP = 1    /* ramp from the previous segment's end frequency */
+}tpSegTypeEnum_t;
+
+typedef struct TP_SEGMENT_STRUCT
+{
+  uint32_t duration_ms;
+  tpSegTypeEnum_t type;
+  double value;                /* STEP: frequency (Hz), RAMP: slope (Hz/s) */
+  bool marker;                 /* marker output level during the segment */
+}tpSegmentStruct_t;
+
+typedef struct TP_PROFILE_STRUCT
+{
+  const tpSegmentStruct_t *segments;
+  uint8_t noofSegments;
+  uint16_t repeats;            /* 0 repeats for ever */
+}tpProfileStruct_t;
+
+class TEST_PROFILE
+{
+  private:
+    tpSegmentStruct_t userSegments[TP_MAX_SEGMENTS];
+    tpProfileStruct_t userProfile;
+    const tpProfileStruct_t *profile;
+    tpProfileIdEnum_t runningId;
+    uint8_t segIndex;
+    uint32_t segElapsed_ms;
+    uint16_t passCount;
+    double segStartFreq;
+    double frequency;
+    bool isMarker;
+    uint16_t oldSysCount;
+    volatile tpProfileIdEnum_t requestedId;
+    volatile bool isRequestPending;
+    void StartSegment(void);
+    void SetMarker(bool level);
+    bool IsUserEditable(void);
+
+  public:
+    TEST_PROFILE()  //constructor
+    {
+      userProfile.segments = userSegments;
+      userProfile.noofSegments = 0U;
+      userProfile.repeats = 0U;
+      profile = NULL;
+      runningId = TP_PROFILE_NONE;
+      segIndex = 0U;
+      segElapsed_ms = 0U;
+      passCount = 0U;
+      segStartFreq = TP_START_FREQ;
+      frequency = TP_START_FREQ;
+      isMarker = false;
+      oldSysCount = 0U;
+      requestedId = TP_PROFILE_NONE;
+      isRequestPending = false;
+    }
+    void Init(void);
+    void Control(uint16_t sysCount);
+    bool GetFrequency(double *testFrequency);
+    bool Start(tpProfileIdEnum_t id);
+    tpProfileIdEnum_t GetRunningId(void);
+    bool GetMarker(void);
+    bool SetSegment(uint8_t index, const tpSegmentStruct_t *segment);
+    bool GetSegment(uint8_t index, tpSegmentStruct_t *segment);
+    bool SetNoofSegments(uint8_t noofSegments);
+    uint8_t GetNoofSegments(void);
+    bool SetRepeats(uint16_t repeats);
+    uint16_t GetRepeats(void);
+    void Command(String command);
+};
+
+extern TEST_PROFILE testProfileObj;
+
+#endif /* TEST_PROFILE_H */
@@ -0,0 +1,134 @@
+/***************************************************************************************************
+ *
+ * Uniform grid lookup table
+ *
+ * A piecewise linear characteristic, given as a table of points, is resampled onto N evenly spaced
+ * points so that a lookup is one index calculation and one multiply-add, whatever the length of
+ * the table. Build is constexpr, so a table known at compile time is resampled by the compiler
+ * into flash; it can also be called at run time when the table changes.
+ *
+ * The table is any array of structures with two increasing double columns, chosen by pointer to
+ * member, so the same table gives both the characteristic and its inverse:
+ *
+ *   UNIFORM_LUT<121>::Build(table, rows, &row_t::x, &row_t::y)   y for x
+ *   UNIFORM_LUT<121>::Build(table, rows, &row_t::y, &row_t::x)   x for y
+ *
+ * Between points of the table the resampled characteristic is exact where grid points fall on
+ * table points, and cuts the corner where they do not. Lookups beyond the first and last points
+ * hold the end values.
+ *
+ * Date: 16/10/2026
+ *
+ * Author: Shaun Mcsherry
+ *
+ * ************************************************************************************************/
+#ifndef UNIFORM_LUT_H
+#define UNIFORM_LUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+template <uint16_t N>
+class UNIFORM_LUT
+{
+  static_assert(N >= 2U, "a uniform LUT needs at least two points");
+
+  private:
+    double first;              /* x of the first grid point */
+    double invStep;            /* grid points per unit of x */
+    double value[N];           /* y at each grid point */
+    double delta[N];           /* y change to the next grid point, 0 for the last */
+
+  public:
+    constexpr UNIFORM_LUT() : first(0.0), invStep(0.0), value{}, delta{}
+    {
+    }
+
+    /***********************************************************************************************
+     * Build
+     *
+     * This function resamples a table onto the grid, spanning the first to the last point.
+     *
+     * Parameters:
+     * table - the points, increasing in both columns
+     * rows - number of points, at least 2
+     * xColumn - the column looked up
+     * yColumn - the column returned
+     *
+     * Return:
+     * The resampled table
+     *
+     **********************************************************************************************/
+    template <typename ROW>
+    static constexpr UNIFORM_LUT Build(const ROW *table, uint8_t rows, double ROW::*xColumn,
+                                       double ROW::*yColumn)
+    {
+      UNIFORM_LUT lut;
+      double step = (table[rows - 1U].*xColumn - table[0].*xColumn) / (double)(N - 1U);
+      double x = 0.0;
+      uint8_t row = 0U;
+      uint16_t point = 0U;
+
+      lut.first = table[0].*xColumn;
+      lut.invStep = 1.0 / step;
+
+      for (point = 0U; point < N; point++)
+      {
+        x = lut.first + ((double)point * step);
+
+        /* find the segment the grid point is in */
+        while ((row < (rows - 2U)) && (x > table[row + 1U].*xColumn))
+        {
+          row++;
+        }
+
+        lut.value[point] = table[row].*yColumn +
+                           (((x - table[row].*xColumn) /
+                             (table[row + 1U].*xColumn - table[row].*xColumn)) *
+                            (table[row + 1U].*yColumn - table[row].*yColumn));
+      }
+      /* the last grid point is the last table point exactly, whatever the rounding */
+      lut.value[N - 1U] = table[rows - 1U].*yColumn;
+
+      for (point = 0U; point < (N - 1U); point++)
+      {
+        lut.delta[point] = lut.value[point + 1U] - lut.value[point];
+      }
+      lut.delta[N - 1U] = 0.0;
+
+      return lut;
+    }
+
+    /***********************************************************************************************
+     * Lookup
+     *
+     * This function interpolates the characteristic.
+     *
+     * Parameters:
+     * x - the value to look up
+     *
+     * Return:
+     * The interpolated value, held at the end values beyond the table
+     *
+     **********************************************************************************************/
+    constexpr double Lookup(double x) const
+    {
+      double position = (x - first) * invStep;
+      uint16_t point = 0U;
+
+      if (position <= 0.0)
+      {
+        return value[0];
+      }
+      if (position >= (double)(N - 1U))
+      {
+        return value[N - 1U];
+      }
+
+      point = (uint16_t)position;
+
+      return value[point] + ((position - (double)point) * delta[point]);
+    }
+};
+
+#endif /* UNIFORM_LUT_H */
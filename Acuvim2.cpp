@@ -1,8 +1,8 @@
 /***************************************************************************************************
  * Acuvim2
  * 
- * This module reads the Acuvim meter.
- *
+ * This module reads the Acuvim meter. Each meter instance has its own connection, register
+ * profile and poll thread, so any number of meters can be read concurrently.
  *
  * Date:
  * 28/03/2023
@@ -16,21 +16,32 @@
 #include <ArduinoModbus.h>
 #include <SPI.h>
 #include <Ethernet.h>
+#include <string.h>
 #include "APP/Acuvim2.h"
 #include "HAL/HAL_Timer.h"
 
 #define ACUVIM_TIMEOUT            FIFTEEN_SECONDS_MS
 #define ACUVIM_RESPONSE_TIMEOUT   TEN_SECONDS_MS
 
+/* Connection management of each meter */
+#define ACUVIM_CONNECT_TIMEOUT_MS     200U    /* longest a connection attempt may take */
+#define ACUVIM_RESPONSE_TIMEOUT_MS    100U    /* longest a meter may take to answer */
+#define ACUVIM_MAX_TXN_FAILURES       3U      /* failed transactions before reconnecting */
+#define ACUVIM_BACKOFF_MIN_MS         100U    /* first reconnect delay */
+#define ACUVIM_BACKOFF_MAX_MS         10000U  /* reconnect delay limit */
+#define ACUVIM_BACKOFF_JITTER_PCT     25      /* +/- random spread of the reconnect delay */
+#define ACUVIM_IDLE_POLL_MS           20U     /* poll interval while link down or backing off */
+
 /* uncomment for additional debug output */
 //#define DEBUG_ACUVIEW
 
-#define NOOF_BASIC_REGS_20MS              30
+#define ACUVIM_MB_PORT                    502
 #define ACCUVIM_MB_ID                     1
 
 #define ACUVIM_MB_FREQ_ADDR               0x3400 /* TBD */
 #define ACUVIM_MB_REAL_POWER_TOTAL_ADDR   0x3400 /* TBD */
 #define ACUVIM_MB_BASIC_20MS_ADDR         0x3400
+#define ACUVIM_MB_POWER_OFFSET            26     /* real then reactive power, within the block */
 
 typedef enum ACUVIM_FAULT
 {
@@ -39,66 +50,138 @@ typedef enum ACUVIM_FAULT
   ACU_FAULT_NO_ETH_CONNECTION = 2
 }acuvimFault_t;
 
-typedef enum READ_STATE_ENUM
+/* Every measurement available within 20ms, frequency first */
+const acuvimRegProfile_t ACUVIM_PROFILE_BASIC_20MS =
+{
+  ACCUVIM_MB_ID, 1U, {{ACUVIM_MB_BASIC_20MS_ADDR, 30U}, {0U, 0U}}, 20U,
+  {
+    0,  /* frequency */
+    2,  /* phase voltage A */
+    4,  /* phase voltage B */
+    6,  /* phase voltage C */
+    8,  /* average phase voltage */
+    10, /* line voltage A */
+    12, /* line voltage B */
+    14, /* line voltage C */
+    16, /* average line voltage */
+    18, /* phase current A */
+    20, /* phase current B */
+    22, /* phase current C */
+    24, /* average phase current */
+    26, /* total real power */
+    28  /* total reactive power */
+  }
+};
+
+/* Frequency and power only, for meters that only contribute to aggregation - 6 registers in two
+   blocks rather than the 30 of the whole basic block */
+const acuvimRegProfile_t ACUVIM_PROFILE_FREQ_POWER =
 {
-  ACUVIM_READ_IDLE               = 0,
-  ACUVIM_READ_IN_PROGRESS        = 1
-}acuvimReadState_t;
+  ACCUVIM_MB_ID, 2U,
+  {{ACUVIM_MB_BASIC_20MS_ADDR, 2U}, {ACUVIM_MB_BASIC_20MS_ADDR + ACUVIM_MB_POWER_OFFSET, 4U}}, 20U,
+  {
+    0,                  /* frequency */
+    ACU_FIELD_NOT_READ, ACU_FIELD_NOT_READ, ACU_FIELD_NOT_READ, ACU_FIELD_NOT_READ,
+    ACU_FIELD_NOT_READ, ACU_FIELD_NOT_READ, ACU_FIELD_NOT_READ, ACU_FIELD_NOT_READ,
+    ACU_FIELD_NOT_READ, ACU_FIELD_NOT_READ, ACU_FIELD_NOT_READ, ACU_FIELD_NOT_READ,
+    2,                  /* total real power */
+    4                   /* total reactive power */
+  }
+};
+
+/* Where each field of a register profile lands in the measurement structure */
+static double acuvimBasicMeasurement20ms_t::* const fieldMember[NOOF_ACU_FIELDS] =
+{
+  &acuvimBasicMeasurement20ms_t::frequency,
+  &acuvimBasicMeasurement20ms_t::phaseVoltageA,
+  &acuvimBasicMeasurement20ms_t::phaseVoltageB,
+  &acuvimBasicMeasurement20ms_t::phaseVoltageC,
+  &acuvimBasicMeasurement20ms_t::averagePhaseVoltage,
+  &acuvimBasicMeasurement20ms_t::lineVoltageA,
+  &acuvimBasicMeasurement20ms_t::lineVoltageB,
+  &acuvimBasicMeasurement20ms_t::lineVoltageC,
+  &acuvimBasicMeasurement20ms_t::averageLineVoltage,
+  &acuvimBasicMeasurement20ms_t::phaseCurrentA,
+  &acuvimBasicMeasurement20ms_t::phaseCurrentB,
+  &acuvimBasicMeasurement20ms_t::phaseCurrentC,
+  &acuvimBasicMeasurement20ms_t::averagePhaseCurrent,
+  &acuvimBasicMeasurement20ms_t::totalPowerReal,
+  &acuvimBasicMeasurement20ms_t::totalPowerReactive
+};
 
-EthernetClient ethClient;
-ModbusTCPClient modbusTCPClient(ethClient);
 IPAddress acuvimClientIp(192, 168, 20, 160);            
 IPAddress acuvimClientDns(0, 0, 0, 0);                  
 IPAddress acuvimClientSubnet(255, 255, 255, 0);     
 IPAddress acuvimClientGateway(0, 0, 0, 0);         
-IPAddress acuvimServerIp(192, 168, 20, 140);            /* Acuvim IP address*/ 
 
-bool AcuvimFault = false;
-acuvimBasicMeasurement20ms_t acuvim;
+/* The Ethernet interface is shared by all meters, so it is only started once */
+static bool isEthernetStarted = false;
+static acuvimFault_t ethernetFault = ACU_FAULT_SHIELD_OK;
 
 /* private functions */
 /***************************************************************************************************
- * CheckModbus
+ * EthernetStart
  * 
- * This function is called before each transaction to verify whether Modbus is connected.
- *
- * If not, it attempts to connect.
+ * This function starts the Ethernet interface used by all meters. Only the first call does any
+ * work, later calls return the result of the first.
  *
  * Parameters:
  * None
  *
  * Return:
- * true if modbus connected, otherwise false
+ * The Ethernet fault state
  *
  **************************************************************************************************/
-bool ACUVIM_II::CheckModbus(void)
+static acuvimFault_t EthernetStart(void)
 {
-  bool isConnected = true;
+  /* Enter a MAC address for your controller below.
+      Newer Ethernet shields have a MAC address printed on a sticker on the shield */
+  uint8_t mac[] = 
+  {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+  }; 
 
-  if (!modbusTCPClient.connected()) 
+  if (false == isEthernetStarted)
   {
-    // client not connected, start the Modbus TCP client
-    Serial.println("Attempting to connect to Modbus TCP server");
+    isEthernetStarted = true;
 
-      if (!modbusTCPClient.begin(acuvimServerIp, 502)) 
-      {
-        Serial.println("Modbus TCP Client failed to connect!");
-        isConnected = false;
-      } 
-      else 
-      {
-        Serial.println("Modbus TCP Client connected");
-        isConnected = true;
-      }
-  }      
+    /* Get MAC address of ethernet shield */
+    Ethernet.MACAddress(mac);
+
+    /* start the Ethernet connection and the server: */
+    Ethernet.begin(mac, acuvimClientIp, 
+                        acuvimClientDns, 
+                        acuvimClientGateway, 
+                        acuvimClientSubnet, ACUVIM_TIMEOUT, ACUVIM_RESPONSE_TIMEOUT);
+
+    /* Check for Ethernet hardware present */
+    if (EthernetNoHardware == Ethernet.hardwareStatus()) 
+    {
+      Serial.println("Ethernet shield not found");
+      ethernetFault = ACU_FAULT_NO_ETH_SHIELD;
+    }
+    else if (Ethernet.linkStatus() == LinkOFF) 
+    {
+      Serial.println("Accuvim ethernet cable is not connected.");
+      ethernetFault = ACU_FAULT_NO_ETH_CONNECTION;
+    }
+    else
+    {
+      ethernetFault = ACU_FAULT_SHIELD_OK;
+    }
+  }
+
+  return ethernetFault;
 }
 
 /***************************************************************************************************
- * BasicRead20ms
+ * ScheduleReconnect
  * 
- * This function is called to read the requested basic measurements.
- *
- * It first checks all the data has been received and then copies it into the data structure.
+ * This function counts a failed connection (a refused connection, a dropped connection or a meter
+ * that stopped answering) and schedules the next connection attempt using exponential backoff
+ * with jitter, so that a dead meter is retried ever less often and several meters do not retry
+ * in lock step. The count is only cleared by a good transaction, so a meter that accepts a
+ * connection but never answers is also backed off.
  *
  * Parameters:
  * None
@@ -107,90 +190,293 @@ bool ACUVIM_II::CheckModbus(void)
  * None
  *
  **************************************************************************************************/
-bool ACUVIM_II::BasicRead20ms(void)
+void ACUVIM_II::ScheduleReconnect(void)
 {
-  int noofValues;
-  int16_t valueArray[NOOF_BASIC_REGS_20MS];
-  uint8_t loopCount;
-  bool isNewData = false;
+  uint32_t backoff_ms = ACUVIM_BACKOFF_MIN_MS;
+  uint8_t failures;
+  int32_t jitter_ms;
 
-  if(true == CheckModbus())
-  { 
-    /* Check to see how many values received */
-    noofValues = modbusTCPClient.available();
+  if (consecutiveFailures < UINT8_MAX)
+  {
+    consecutiveFailures++;
+  }
+  failures = consecutiveFailures;
 
-    if (NOOF_BASIC_REGS_20MS == noofValues)   // only proceed if all expected values
-    {                                         // have been received.
-      for(loopCount = 0; loopCount < NOOF_BASIC_REGS_20MS; loopCount++)
-      {
-        valueArray[loopCount] = modbusTCPClient.read();
-      }
+  while ((failures > 0U) && (backoff_ms < ACUVIM_BACKOFF_MAX_MS))
+  {
+    backoff_ms *= 2U;
+    failures--;
+  }
 
-      /* update measurement structure */
-      acuvim.frequency            = (double)((uint32_t)valueArray[0] + 
-                                              (uint32_t)(valueArray[1] << 16U));
+  if (backoff_ms > ACUVIM_BACKOFF_MAX_MS)
+  {
+    backoff_ms = ACUVIM_BACKOFF_MAX_MS;
+  }
 
-      acuvim.phaseVoltageA        = (double)((uint32_t)valueArray[2] + 
-                                              (uint32_t)(valueArray[3] << 16U));
+  /* +/- ACUVIM_BACKOFF_JITTER_PCT % */
+  jitter_ms = (int32_t)random(-(long)ACUVIM_BACKOFF_JITTER_PCT,
+                              (long)ACUVIM_BACKOFF_JITTER_PCT + 1L);
+  jitter_ms = (jitter_ms * (int32_t)backoff_ms) / 100;
 
-      acuvim.phaseVoltageB        = (double)((uint32_t)valueArray[4] + 
-                                              (uint32_t)(valueArray[5] << 16U));
+  nextAttempt_ms = millis() + (uint32_t)((int32_t)backoff_ms + jitter_ms);
+  linkState = ACU_LINK_BACKOFF;
+}
 
-      acuvim.phaseVoltageC        = (double)((uint32_t)valueArray[6] + 
-                                              (uint32_t)(valueArray[7] << 16U));
+/***************************************************************************************************
+ * SetLinkState
+ * 
+ * This function records a change of connection state, updating the statistics and the flag the
+ * control loop checks.
+ *
+ * Parameters:
+ * newState - the new connection state
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void ACUVIM_II::SetLinkState(acuvimLinkState_t newState)
+{
+  if (newState != linkState)
+  {
+    statsMutex.lock();
+    if (ACU_LINK_CONNECTED == newState)
+    {
+      connStats.connectedSince_ms = millis();
+    }
+    else if (ACU_LINK_CONNECTED == linkState)
+    {
+      connStats.disconnects++;
+    }
+    if (ACU_LINK_DOWN == newState)
+    {
+      connStats.linkDownEvents++;
+    }
+    statsMutex.unlock();
+  }
 
-      acuvim.averagePhaseVoltage  = (double)((uint32_t)valueArray[8] + 
-                                              (uint32_t)(valueArray[9] << 16U));
+  linkState = newState;
+  isConnectedFlag = (ACU_LINK_CONNECTED == newState);
+}
 
-      acuvim.lineVoltageA         = (double)((uint32_t)valueArray[10] + 
-                                              (uint32_t)(valueArray[11] << 16U));
+/***************************************************************************************************
+ * ManageConnection
+ * 
+ * This is the connection manager, called on the meter's poll thread before each transaction.
+ * It holds off while the Ethernet link is down, retries a lost connection with exponential
+ * backoff and jitter, and bounds each connection attempt by ACUVIM_CONNECT_TIMEOUT_MS. The
+ * control loop never waits on any of this; it only sees the connected flag.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * true if modbus connected, otherwise false
+ *
+ **************************************************************************************************/
+bool ACUVIM_II::ManageConnection(void)
+{
+  if (LinkOFF == Ethernet.linkStatus())
+  {
+    if (ACU_LINK_DOWN != linkState)
+    {
+      Serial.println("Acuvim ethernet link down");
+      modbusTCPClient.stop();
+      SetLinkState(ACU_LINK_DOWN);
+    }
+  }
+  else
+  {
+    switch (linkState)
+    {
+      case ACU_LINK_DOWN:
+        /* link restored - connect straight away */
+        Serial.println("Acuvim ethernet link up");
+        consecutiveFailures = 0U;
+        SetLinkState(ACU_LINK_CONNECTING);
+        break;
 
-      acuvim.lineVoltageB         = (double)((uint32_t)valueArray[12] + 
-                                              (uint32_t)(valueArray[13] << 16U));
+      case ACU_LINK_BACKOFF:
+        if ((int32_t)(millis() - nextAttempt_ms) >= 0)
+        {
+          SetLinkState(ACU_LINK_CONNECTING);
+        }
+        break;
 
-      acuvim.lineVoltageC         = (double)((uint32_t)valueArray[14] + 
-                                              (uint32_t)(valueArray[15] << 16U));
+      case ACU_LINK_CONNECTED:
+        if (!modbusTCPClient.connected())
+        {
+          Serial.println("Modbus TCP Client disconnected");
+          modbusTCPClient.stop();
+          SetLinkState(ACU_LINK_BACKOFF);
+          ScheduleReconnect();
+        }
+        break;
 
-      acuvim.averageLineVoltage   = (double)((uint32_t)valueArray[16] + 
-                                              (uint32_t)(valueArray[17] << 16U));
+      default:
+        break;
+    }
 
-      acuvim.phaseCurrentA        = (double)((uint32_t)valueArray[18] + 
-                                              (uint32_t)(valueArray[19] << 16U));
+    if (ACU_LINK_CONNECTING == linkState)
+    {
+      statsMutex.lock();
+      connStats.connectAttempts++;
+      statsMutex.unlock();
 
-      acuvim.phaseCurrentB        = (double)((uint32_t)valueArray[20] + 
-                                              (uint32_t)(valueArray[21] << 16U));
+      if (!modbusTCPClient.begin(serverIp, ACUVIM_MB_PORT)) 
+      {
+        statsMutex.lock();
+        connStats.connectFailures++;
+        statsMutex.unlock();
 
-      acuvim.phaseCurrentC        = (double)((uint32_t)valueArray[22] + 
-                                              (uint32_t)(valueArray[23] << 16U));
+        if (0U == consecutiveFailures)
+        {
+          Serial.println("Modbus TCP Client failed to connect!");
+        }
+        modbusTCPClient.stop();
+        ScheduleReconnect();
+      } 
+      else 
+      {
+        Serial.println("Modbus TCP Client connected");
+        txnFailures = 0U;
+        SetLinkState(ACU_LINK_CONNECTED);
+      }
+    }
+  }
 
-      acuvim.averagePhaseCurrent  = (double)((uint32_t)valueArray[24] + 
-                                              (uint32_t)(valueArray[25] << 16U));
+  return (ACU_LINK_CONNECTED == linkState);
+}
 
-      acuvim.totalPowerReal       = (double)((uint32_t)valueArray[26] + 
-                                              (uint32_t)(valueArray[27] << 16U));
-                                              
-      acuvim.totalPowerReactive   = (double)((uint32_t)valueArray[28] + 
-                                              (uint32_t)(valueArray[29] << 16U));
+/***************************************************************************************************
+ * ProfileRead
+ * 
+ * This function is called to decode the registers read for the register profile.
+ *
+ * Each field the profile maps is an IEEE-754 float in a register pair, high word first, and is
+ * copied into the data structure. The structure is published to the control loop under the data
+ * mutex.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void ACUVIM_II::ProfileRead(void)
+{
+  uint32_t bits;
+  float value;
+  uint8_t loopCount;
+  int8_t offset;
+  acuvimBasicMeasurement20ms_t readData = acuvim;
 
-      isNewData = true;                                                
-    }/* if (NOOF_BASIC_REGS_20MS == noofValues) */
-  }/* if(true == APP_AcuvimCheck()) */
-  
-  return isNewData;
+  /* update measurement structure */
+  for(loopCount = 0; loopCount < (uint8_t)NOOF_ACU_FIELDS; loopCount++)
+  {
+    offset = profile->fieldOffset[loopCount];
+
+    if (ACU_FIELD_NOT_READ != offset)
+    {
+      bits = ((uint32_t)registers[offset] << 16U) | (uint32_t)registers[offset + 1];
+      memcpy(&value, &bits, sizeof(value));
+      readData.*fieldMember[loopCount] = (double)value;
+    }
+  }
+
+  dataMutex.lock();
+  acuvim = readData;
+  isNewDataFlag = true;
+  dataMutex.unlock();
 }
 
 /****************************************************************************************************
- * BasicRequest20ms
+ * ProfileRequest
+ * 
+ * This function is called to request the blocks of registers described by the register profile,
+ * one transaction each. The transactions block until the meter responds or times out, so it is
+ * only ever called from the meter's poll thread.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * true if the meter returned every register of the profile, otherwise false
+ *
+ **************************************************************************************************/
+bool ACUVIM_II::ProfileRequest(void)
+{
+  bool isResponse = false;
+  uint8_t block;
+  uint8_t index = 0U;
+  uint8_t loopCount;
+
+  if(true == ManageConnection())
+  {
+    isResponse = true;
+
+    for (block = 0U; (true == isResponse) && (block < profile->noofBlocks); block++)
+    {
+      if (!modbusTCPClient.requestFrom(profile->mbId,
+                                       HOLDING_REGISTERS, 
+                                       profile->blocks[block].startAddr, 
+                                       profile->blocks[block].noofRegs)) 
+      {
+        statsMutex.lock();
+        connStats.txnFailures++;
+        statsMutex.unlock();
+
+        if (0U == txnFailures)
+        {
+          Serial.print("Failed to send Acuview read request: ");
+          Serial.println(modbusTCPClient.lastError());
+        }
+
+        /* a meter that stops answering is treated as disconnected */
+        txnFailures++;
+        if (txnFailures >= ACUVIM_MAX_TXN_FAILURES)
+        {
+          Serial.println("Acuvim not responding, reconnecting");
+          modbusTCPClient.stop();
+          SetLinkState(ACU_LINK_BACKOFF);
+          ScheduleReconnect();
+        }
+        isResponse = false;
+      }
+      else
+      {
+        statsMutex.lock();
+        connStats.txnOk++;
+        statsMutex.unlock();
+        txnFailures = 0U;
+        consecutiveFailures = 0U;
+
+        /* only proceed if all expected values have been received */
+        if (profile->blocks[block].noofRegs == modbusTCPClient.available())
+        {
+          for (loopCount = 0U; loopCount < profile->blocks[block].noofRegs; loopCount++)
+          {
+            registers[index] = (uint16_t)modbusTCPClient.read();
+            index++;
+          }
+        }
+        else
+        {
+          isResponse = false;
+        }
+      }
+    }
+  }
+
+  return isResponse;
+}
+
+/***************************************************************************************************
+ * PollTask
  * 
- * This function is called to request the basic measurements that can be returned within 20ms:
- * - phase voltage (A, B, C)
- * - Average phase voltage
- * - line voltage (A-B, B-C, C-A)
- * - Average line voltage
- * - phase current (A, B, C)
- * - average phase current
- * - total active/reactive power 
- * - frequency
+ * This is the body of the meter's poll thread. Each meter polls on its own thread so that a slow
+ * or absent meter never holds up the control loop or any other meter.
  *
  * Parameters:
  * None
@@ -199,16 +485,37 @@ bool ACUVIM_II::BasicRead20ms(void)
  * None
  *
  **************************************************************************************************/
-void ACUVIM_II::BasicRequest20ms(void)
+void ACUVIM_II::PollTask(void)
 {
-  if(true == CheckModbus())
-  {      
-    if (!modbusTCPClient.requestFrom(HOLDING_REGISTERS, 
-                                    ACUVIM_MB_BASIC_20MS_ADDR, 
-                                    NOOF_BASIC_REGS_20MS)) 
+  uint32_t startTime;
+  uint32_t elapsedTime;
+
+  while (true)
+  {
+    startTime = millis();
+
+    if (true == ProfileRequest())
+    {
+      ProfileRead();
+    }
+
+    /* hold the poll period, but always yield to lower priority threads */
+    elapsedTime = millis() - startTime;
+
+    if ((ACU_LINK_DOWN == linkState) || (ACU_LINK_BACKOFF == linkState))
+    {
+      /* nothing to do until the link returns or the backoff expires */
+      elapsedTime = 0U;
+      rtos::ThisThread::sleep_for(std::chrono::milliseconds(ACUVIM_IDLE_POLL_MS));
+    }
+
+    if (elapsedTime < profile->pollPeriod_ms)
     {
-      Serial.print("Failed to send Acuview read request: ");
-      Serial.println(modbusTCPClient.lastError());
+      rtos::ThisThread::sleep_for(std::chrono::milliseconds(profile->pollPeriod_ms - elapsedTime));
+    }
+    else
+    {
+      rtos::ThisThread::sleep_for(std::chrono::milliseconds(1));
     }
   }
 }
@@ -219,57 +526,64 @@ void ACUVIM_II::BasicRequest20ms(void)
 /***************************************************************************************************
  * Init
  * 
- * This function configures the controller as a Modbus TCP client to read the meter
+ * This function configures the controller as a Modbus TCP client to read the meter and starts
+ * the meter's poll thread.
  *
  * Parameters:
- * None
+ * meterIp - IP address of the meter
+ * regProfile - the register profile to read from the meter
  *
  * Return:
  * None
  *
  **************************************************************************************************/
-void ACUVIM_II::Init(void)
+void ACUVIM_II::Init(IPAddress meterIp, const acuvimRegProfile_t *regProfile)
 {
-  /* Enter a MAC address for your controller below.
-      Newer Ethernet shields have a MAC address printed on a sticker on the shield */
-  uint8_t mac[] = 
-  {
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-  }; 
+  uint16_t noofRegs;
+  uint8_t block;
 
   Serial.println("Initialising AcuVim II");
 
-  /* Get MAC address of ethernet shield */
-  Ethernet.MACAddress(mac);
-
-  /* start the Ethernet connection and the server: */
-  Ethernet.begin(mac, acuvimClientIp, 
-                      acuvimClientDns, 
-                      acuvimClientGateway, 
-                      acuvimClientSubnet, ACUVIM_TIMEOUT, ACUVIM_RESPONSE_TIMEOUT);
-  //Ethernet.begin(mac, acuvimClient);
-  /* Check for Ethernet hardware present */
-  if (EthernetNoHardware == Ethernet.hardwareStatus()) 
+  serverIp = meterIp;
+  profile = regProfile;
+
+  /* A missing shield is permanent, the link state is managed by the poll thread */
+  if (ACU_FAULT_NO_ETH_SHIELD == EthernetStart())
   {
-    Serial.println("Ethernet shield not found");
     AcuvimFault = ACU_FAULT_NO_ETH_SHIELD;
   }
-  else if (Ethernet.linkStatus() == LinkOFF) 
+  else
+  {
+    AcuvimFault = ACU_FAULT_SHIELD_OK;
+  }
+
+  modbusTCPClient.setTimeout(ACUVIM_RESPONSE_TIMEOUT_MS);
+  ethClient.setSocketTimeout(ACUVIM_CONNECT_TIMEOUT_MS);
+
+  noofRegs = 0U;
+  for (block = 0U; block < profile->noofBlocks; block++)
   {
-    Serial.println("Accuvim ethernet cable is not connected.");
+    noofRegs += profile->blocks[block].noofRegs;
+  }
+
+  if ((profile->noofBlocks < 1U) || (profile->noofBlocks > ACUVIM_MAX_PROFILE_BLOCKS) ||
+      (noofRegs > ACUVIM_MAX_PROFILE_REGS))
+  {
+    Serial.println("Acuvim register profile too large");
     AcuvimFault = ACU_FAULT_NO_ETH_CONNECTION;
   }
-  else
+
+  if (ACU_FAULT_SHIELD_OK == AcuvimFault)
   {
-    AcuvimFault = ACU_FAULT_SHIELD_OK;
+    pollThread.start(mbed::callback(this, &ACUVIM_II::PollTask));
   }
 }
 
 /***********************************************************************************************
  * Control
  * 
- * This is the main control state machine for reading and retrieving measurement data from the
- * meter.
+ * This function is called by the control loop to collect the latest measurements published by
+ * the meter's poll thread. It never waits on the meter.
  *
  * Parameters:
  * measurements - pointer to measurement structure.
@@ -281,31 +595,17 @@ void ACUVIM_II::Init(void)
 bool ACUVIM_II::Control(acuvimBasicMeasurement20ms_t *measurements)
 {
   bool isNewData = false;
-  static acuvimReadState_t readState = ACUVIM_READ_IDLE;    
 
   if (ACU_FAULT_SHIELD_OK == AcuvimFault)
   {
-    switch (readState)
+    dataMutex.lock();
+    if (true == isNewDataFlag)
     {
-      case ACUVIM_READ_IDLE:
-        BasicRequest20ms();                     // initiate new read
-        readState = ACUVIM_READ_IN_PROGRESS;
-        break;
-
-      case ACUVIM_READ_IN_PROGRESS:           // poll for data
-        isNewData = BasicRead20ms();
-        if (true == isNewData)
-        {
-          *measurements = acuvim;              // transfer read data to pointer
-          readState = ACUVIM_READ_IDLE;
-        }
-        break;
-
-      default:
-        /* invalid state, so reset */
-        readState = ACUVIM_READ_IDLE;
-        break;
-    } /* switch (readState) */
+      *measurements = acuvim;              // transfer read data to pointer
+      isNewDataFlag = false;
+      isNewData = true;
+    }
+    dataMutex.unlock();
   } /* if (ACU_FAULT_SHIELD_OK == AcuvimFault) */
 
   return isNewData;
@@ -328,7 +628,7 @@ bool ACUVIM_II::GetFaultState(void)
 {
   bool fault = false;
 
-  if (AcuvimFault != ACU_FAULT_SHIELD_OK)
+  if ((AcuvimFault != ACU_FAULT_SHIELD_OK) || (ACU_LINK_DOWN == linkState))
   {
     fault = true;
   }
@@ -336,5 +636,41 @@ bool ACUVIM_II::GetFaultState(void)
   return fault;  
 }
 
+/***********************************************************************************************
+ * IsConnected
+ * 
+ * This function returns the connection flag maintained by the meter's poll thread.
+ *
+ * Parameters:
+ * None.
+ *
+ * Return:
+ * true if the Modbus connection to the meter is up, otherwise false.
+ *
+ **********************************************************************************************/
+bool ACUVIM_II::IsConnected(void)
+{
+  return isConnectedFlag;
+}
+
+/***********************************************************************************************
+ * GetConnStats
+ * 
+ * This function copies the meter's connection statistics.
+ *
+ * Parameters:
+ * stats - pointer to the statistics structure to fill.
+ *
+ * Return:
+ * None.
+ *
+ **********************************************************************************************/
+void ACUVIM_II::GetConnStats(acuvimConnStats_t *stats)
+{
+  statsMutex.lock();
+  *stats = connStats;
+  statsMutex.unlock();
+}
+
 
 /* end public functions */
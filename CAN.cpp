@@ -470,6 +470,8 @@ bool APP_CAN::SetPower(int16_t realPower_kW, int16_t reactivePower_kVA)
 
   /* transmit the CAN message */
   comm_protocols.can.write(canProcessToInverter);
+
+  return true;
 }
 
 /***************************************************************************************************
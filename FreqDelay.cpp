@@ -0,0 +1,191 @@
+/***************************************************************************************************
+ * FreqDelay
+ *
+ * This module delays a frequency signal by a fixed time. Samples are stored with the time they
+ * were taken, and a read returns the frequency at exactly (now - delay), interpolated between
+ * the samples either side. The delay therefore holds when the sample cadence jitters or samples
+ * are missed, rather than depending on one call every 20ms.
+ *
+ * Reads must be made with a non-decreasing time. Samples older than the one before the read
+ * time are discarded as the read cursor moves forward, so a read is O(1) amortised and the
+ * buffer only ever holds the delay window.
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun Mcsherry
+ *
+ **************************************************************************************************/
+#include "APP/FreqDelay.h"
+
+#define RING_INDEX(index)   ((uint16_t)((index) % FREQ_DELAY_CAPACITY))
+
+/* Public functions */
+/***************************************************************************************************
+ * Init
+ *
+ * This function empties the delay line and sets its delay.
+ *
+ * Parameters:
+ * delay - the delay (ms)
+ * frequency - returned until the line holds a full delay of history, normally nominal frequency
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void FREQ_DELAY::Init(uint32_t delay, double frequency)
+{
+  tail = 0U;
+  count = 0U;
+  delay_ms = delay;
+  defaultFrequency = frequency;
+  achievedDelay_ms = 0U;
+}
+
+/***************************************************************************************************
+ * Push
+ *
+ * This function adds a sample. A sample with the same time as the newest replaces it, and one
+ * older than the newest is ignored. If the line is full the oldest sample is dropped.
+ *
+ * Parameters:
+ * time_ms - time the sample was taken (ms)
+ * frequency - the frequency (Hz)
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void FREQ_DELAY::Push(uint32_t time_ms, double frequency)
+{
+  freqDelaySampleStruct_t *newest;
+
+  if (count > 0U)
+  {
+    newest = &samples[RING_INDEX(tail + count - 1U)];
+
+    if (time_ms == newest->time_ms)
+    {
+      newest->frequency = frequency;
+      return;
+    }
+    else if ((int32_t)(time_ms - newest->time_ms) < 0)
+    {
+      return;
+    }
+  }
+
+  if (count >= FREQ_DELAY_CAPACITY)
+  {
+    tail = RING_INDEX(tail + 1U);
+    count--;
+  }
+
+  samples[RING_INDEX(tail + count)].time_ms = time_ms;
+  samples[RING_INDEX(tail + count)].frequency = frequency;
+  count++;
+}
+
+/***************************************************************************************************
+ * Read
+ *
+ * This function returns the frequency at (now - delay).
+ * - If the line does not yet hold that much history, the default frequency is returned.
+ * - If there is no sample after the read time (samples missed), the newest sample is held.
+ *
+ * Parameters:
+ * now_ms - the current time (ms)
+ *
+ * Return:
+ * The delayed frequency (Hz)
+ *
+ **************************************************************************************************/
+double FREQ_DELAY::Read(uint32_t now_ms)
+{
+  uint32_t target_ms;
+  const freqDelaySampleStruct_t *older;
+  const freqDelaySampleStruct_t *newer;
+  double fraction;
+  double frequency;
+
+  target_ms = now_ms - delay_ms;
+
+  /* move the read cursor up to the last sample at or before the read time */
+  while ((count >= 2U) && ((int32_t)(samples[RING_INDEX(tail + 1U)].time_ms - target_ms) <= 0))
+  {
+    tail = RING_INDEX(tail + 1U);
+    count--;
+  }
+
+  if (0U == count)
+  {
+    frequency = defaultFrequency;
+    achievedDelay_ms = 0U;
+  }
+  else
+  {
+    older = &samples[tail];
+
+    if ((int32_t)(older->time_ms - target_ms) > 0)
+    {
+      /* not enough history yet */
+      frequency = defaultFrequency;
+      achievedDelay_ms = 0U;
+    }
+    else if (1U == count)
+    {
+      /* no sample since the read time - hold the newest */
+      frequency = older->frequency;
+      achievedDelay_ms = now_ms - older->time_ms;
+    }
+    else
+    {
+      newer = &samples[RING_INDEX(tail + 1U)];
+      fraction = (double)(target_ms - older->time_ms) / (double)(newer->time_ms - older->time_ms);
+      frequency = older->frequency + (fraction * (newer->frequency - older->frequency));
+      achievedDelay_ms = delay_ms;
+    }
+  }
+
+  return frequency;
+}
+
+/***************************************************************************************************
+ * GetDelay
+ *
+ * This function returns the configured delay.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * Delay (ms)
+ *
+ **************************************************************************************************/
+uint32_t FREQ_DELAY::GetDelay(void)
+{
+  return delay_ms;
+}
+
+/***************************************************************************************************
+ * GetAchievedDelay
+ *
+ * This function returns the delay achieved by the last read: the configured delay when the read
+ * was interpolated, longer if the newest sample had to be held, or 0 if the line did not yet
+ * hold enough history.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * Achieved delay (ms)
+ *
+ **************************************************************************************************/
+uint32_t FREQ_DELAY::GetAchievedDelay(void)
+{
+  return achievedDelay_ms;
+}
+
+/* end public functions */
@@ -0,0 +1,327 @@
+/***************************************************************************************************
+ * FreqEst
+ *
+ * This module estimates grid frequency from a sampled voltage waveform (see HAL_ADC), giving a
+ * frequency source that is independent of the meters and updated every half cycle instead of
+ * every 20ms meter poll.
+ *
+ * Each sample is low pass filtered and has the DC offset (the mean over recent cycles) removed.
+ * Zero crossings, with hysteresis, are interpolated between the samples either side, and the
+ * half cycle is the least squares fit through the last FREQ_EST_WINDOW + 1 crossings. The window
+ * spans whole cycles, so any DC offset error cancels. With 10kHz sampling the resolution is well
+ * under 1mHz on a clean waveform. The estimate is the mean over the window, so it lags the
+ * waveform by half the window (40ms) - still less than the meter.
+ *
+ * RoCoF is the change in frequency over the last FREQ_EST_ROCOF_ESTIMATES estimates.
+ *
+ * The module does not use the Arduino libraries, so that it can be run on a host by
+ * tools/freq_est_check with synthetic waveforms.
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun Mcsherry
+ *
+ **************************************************************************************************/
+#include <math.h>
+#include <string.h>
+#include "APP/FreqEst.h"
+
+#ifndef M_PI
+ #define M_PI   3.14159265358979323846
+#endif
+
+/* private functions */
+/***************************************************************************************************
+ * Crossing
+ *
+ * This function adds a zero crossing to the window, restarting the window if the waveform is
+ * too small or the half cycle since the last crossing is implausible.
+ *
+ * Parameters:
+ * time - time of the crossing (samples)
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void FREQ_EST::Crossing(double time)
+{
+  double halfCycle;
+
+  if (amplitude < FREQ_EST_MIN_AMPLITUDE)
+  {
+    /* no waveform, or the first cycle - the offset and hysteresis are not known yet */
+    noofCrossings = 0U;
+    isValid = false;
+    return;
+  }
+
+  if (noofCrossings > 0U)
+  {
+    halfCycle = time - crossings[noofCrossings - 1U];
+
+    if ((halfCycle < (sampleRate / (2.0 * FREQ_EST_MAX_HZ))) ||
+        (halfCycle > (sampleRate / (2.0 * FREQ_EST_MIN_HZ))))
+    {
+      noofCrossings = 0U;
+      isValid = false;
+    }
+  }
+
+  if (noofCrossings > FREQ_EST_WINDOW)
+  {
+    memmove(&crossings[0], &crossings[1], FREQ_EST_WINDOW * sizeof(crossings[0]));
+    noofCrossings = FREQ_EST_WINDOW;
+  }
+
+  crossings[noofCrossings] = time;
+  noofCrossings++;
+
+  if (noofCrossings > FREQ_EST_WINDOW)
+  {
+    Estimate();
+  }
+}
+
+/***************************************************************************************************
+ * Estimate
+ *
+ * This function measures frequency over a full window of crossings and updates RoCoF.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void FREQ_EST::Estimate(void)
+{
+  const freqEstPointStruct_t *older;
+  double time = crossings[FREQ_EST_WINDOW];
+  double position;
+  double sumXT = 0.0;
+  double sumXX = 0.0;
+  uint8_t index;
+
+  /* least squares half cycle through all the crossings, about the middle one. The positions
+     are symmetric, so a DC offset error (alternate crossings early and late) cancels */
+  for (index = 0U; index <= FREQ_EST_WINDOW; index++)
+  {
+    position = (double)index - ((double)FREQ_EST_WINDOW / 2.0);
+    sumXT += position * (crossings[index] - crossings[0]);
+    sumXX += position * position;
+  }
+
+  frequency = sampleRate * sumXX / (2.0 * sumXT);
+  isValid = true;
+
+  history[historyHead].time = time;
+  history[historyHead].frequency = frequency;
+  historyHead = (uint8_t)((historyHead + 1U) % FREQ_EST_HISTORY);
+
+  if (noofHistory < FREQ_EST_HISTORY)
+  {
+    noofHistory++;
+  }
+
+  if (noofHistory > FREQ_EST_ROCOF_ESTIMATES)
+  {
+    older = &history[(historyHead + FREQ_EST_HISTORY - 1U - FREQ_EST_ROCOF_ESTIMATES) %
+                     FREQ_EST_HISTORY];
+    rocof = (frequency - older->frequency) * sampleRate / (time - older->time);
+    isRocofValid = true;
+  }
+}
+
+/* Public functions */
+/***************************************************************************************************
+ * Init
+ *
+ * This function sets the sample rate and restarts the estimator.
+ *
+ * Parameters:
+ * sampleRate_hz - waveform sample rate
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void FREQ_EST::Init(uint32_t sampleRate_hz)
+{
+  sampleRate = (double)sampleRate_hz;
+  lpfCoeff = 1.0 - exp(-2.0 * M_PI * FREQ_EST_LPF_HZ / sampleRate);
+  filtered = FREQ_EST_ADC_MID;
+  previous = 0.0;
+  dcOffset = FREQ_EST_ADC_MID;
+  amplitude = 0.0;
+  sampleCount = 0.0;
+  frequency = FREQ_EST_NOMINAL_HZ;
+  rocof = 0.0;
+
+  Reset();
+}
+
+/***************************************************************************************************
+ * Reset
+ *
+ * This function discards the crossings and history, e.g. after a gap in the samples. The
+ * estimate is invalid until a new window has been measured.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void FREQ_EST::Reset(void)
+{
+  dcSum = 0.0;
+  dcCount = 0U;
+  peak = 0.0;
+  isPositive = false;
+  isArmed = false;
+  isFullCycle = false;
+  noofCrossings = 0U;
+  historyHead = 0U;
+  noofHistory = 0U;
+  isValid = false;
+  isRocofValid = false;
+}
+
+/***************************************************************************************************
+ * Process
+ *
+ * This function processes a block of waveform samples. Blocks must be consecutive.
+ *
+ * Parameters:
+ * samples - raw ADC samples
+ * noofSamples - number of samples
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void FREQ_EST::Process(const uint16_t *samples, uint16_t noofSamples)
+{
+  uint16_t index;
+  double value;
+  double threshold;
+  double time;
+
+  for (index = 0U; index < noofSamples; index++)
+  {
+    sampleCount += 1.0;
+    filtered += lpfCoeff * ((double)samples[index] - filtered);
+    value = filtered - dcOffset;
+
+    dcSum += filtered;
+    dcCount++;
+    if (fabs(value) > peak)
+    {
+      peak = fabs(value);
+    }
+
+    threshold = FREQ_EST_HYSTERESIS * amplitude;
+
+    if ((false == isArmed) &&
+        (((true == isPositive) && (value > threshold)) ||
+         ((false == isPositive) && (value < -threshold))))
+    {
+      isArmed = true;
+    }
+    else if ((true == isArmed) &&
+             (((true == isPositive) && (value < 0.0)) ||
+              ((false == isPositive) && (value >= 0.0))))
+    {
+      /* the crossing is between the previous sample and this one */
+      time = (sampleCount - 1.0) + (previous / (previous - value));
+      isPositive = !isPositive;
+      isArmed = false;
+
+      if (true == isPositive)
+      {
+        /* a cycle since the last rising crossing - update the offset and amplitude. The
+           offset is smoothed, as a cycle is not a whole number of samples */
+        if (true == isFullCycle)
+        {
+          dcOffset += FREQ_EST_DC_GAIN * ((dcSum / (double)dcCount) - dcOffset);
+        }
+        amplitude = peak;
+        dcSum = 0.0;
+        dcCount = 0U;
+        peak = 0.0;
+        isFullCycle = true;
+      }
+
+      Crossing(time);
+    }
+    else if ((double)dcCount > (2.0 * sampleRate / FREQ_EST_MIN_HZ))
+    {
+      /* no cycle for too long - lost or no waveform, or the offset has moved past it */
+      dcOffset = dcSum / (double)dcCount;
+      amplitude = peak;
+      Reset();
+    }
+    else
+    {
+      /* between crossings */
+    }
+
+    previous = value;
+  }
+}
+
+/***************************************************************************************************
+ * GetFrequency
+ *
+ * This function returns the latest frequency estimate.
+ *
+ * Parameters:
+ * estimate - updated with the frequency (Hz)
+ * age_ms - updated with the time since the estimate was made, in waveform time
+ *
+ * Return:
+ * true if the estimate is valid, otherwise false
+ *
+ **************************************************************************************************/
+bool FREQ_EST::GetFrequency(double *estimate, uint16_t *age_ms)
+{
+  double age;
+
+  if (true == isValid)
+  {
+    *estimate = frequency;
+    age = (sampleCount - crossings[noofCrossings - 1U]) * 1000.0 / sampleRate;
+    *age_ms = (age < 65535.0) ? (uint16_t)age : 65535U;
+  }
+
+  return isValid;
+}
+
+/***************************************************************************************************
+ * GetRocof
+ *
+ * This function returns the latest rate of change of frequency.
+ *
+ * Parameters:
+ * estimate - updated with the RoCoF (Hz/s)
+ *
+ * Return:
+ * true if there is enough history for a RoCoF, otherwise false
+ *
+ **************************************************************************************************/
+bool FREQ_EST::GetRocof(double *estimate)
+{
+  if ((true == isValid) && (true == isRocofValid))
+  {
+    *estimate = rocof;
+  }
+
+  return ((true == isValid) && (true == isRocofValid));
+}
+
+/* end public functions */
@@ -0,0 +1,394 @@
+/***************************************************************************************************
+ * FreqSource
+ *
+ * This module provides the grid frequency used by the operating modes. It holds a primary source
+ * and one or more hot-standby secondaries (other meters, or the analogue input), all of which are
+ * read every control tick:
+ * - a source is dropped as soon as its sample is stale or implausible,
+ * - sources are cross-validated against each other; a source that disagrees with two others that
+ *   agree with each other is dropped as deviating,
+ * - the highest priority valid source is used, so failover happens within the tick that the
+ *   fault is detected,
+ * - any step between the old and new source is blended out over FREQ_BLEND_MS, so the delay line
+ *   and ramps in the operating modes see a continuous frequency.
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun Mcsherry
+ *
+ **************************************************************************************************/
+#include <Arduino_MachineControl.h>
+#include "APP/FreqSource.h"
+#include "APP/HIL_Test.h"
+#include "APP/FreqEst.h"
+#include "APP/Controller.h"
+
+/* Frequency sources in priority order. Meters are identified by their frequency priority in the
+   site meter configuration; sources that are not fitted are never valid and are skipped. The
+   waveform estimate, when fitted, leads as it has the lowest latency; the meters cross-check it. */
+static const freqSourceConfigStruct_t freqSourceConfig[] =
+{
+  /* type,                meter priority */
+#ifdef FREQ_EST_FITTED
+  { FREQ_SRC_WAVEFORM,    0U },
+#endif
+  { FREQ_SRC_METER,       0U },
+  { FREQ_SRC_METER,       1U },
+  { FREQ_SRC_ANALOGUE,    0U }
+};
+
+#define NOOF_CONFIGURED_SOURCES  (sizeof(freqSourceConfig) / sizeof(freqSourceConfig[0]))
+
+/* private functions */
+/***************************************************************************************************
+ * ReadSources
+ *
+ * This function reads the latest sample from every source and checks it is fresh and plausible.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void FREQ_SOURCE::ReadSources(void)
+{
+  uint8_t source;
+  bool isPresent;
+
+  for (source = 0U; source < noofSources; source++)
+  {
+    isPresent = false;
+
+    switch (freqSourceConfig[source].type)
+    {
+      case FREQ_SRC_METER:
+        isPresent = meterAgg->GetFrequencySample(freqSourceConfig[source].meterPriority,
+                                                 &samples[source].frequency,
+                                                 &samples[source].age_ms);
+        break;
+
+      case FREQ_SRC_ANALOGUE:
+        if (NULL != analogue)
+        {
+          samples[source].frequency = analogue->GetFreq();
+          samples[source].age_ms = 0U;
+          isPresent = true;
+        }
+        break;
+
+      case FREQ_SRC_WAVEFORM:
+        if (NULL != waveform)
+        {
+          isPresent = waveform->GetFrequency(&samples[source].frequency,
+                                             &samples[source].age_ms);
+        }
+        break;
+
+      default:
+        /* source not supported */
+        break;
+    }
+
+    samples[source].isFresh = false;
+
+    if ((true == isPresent) &&
+        (samples[source].age_ms < FREQ_STALE_MS) &&
+        (samples[source].frequency > FREQ_MIN_VALID_HZ) &&
+        (samples[source].frequency < FREQ_MAX_VALID_HZ))
+    {
+      samples[source].isFresh = true;
+    }
+  }
+}
+
+/***************************************************************************************************
+ * CrossValidate
+ *
+ * This function compares the fresh sources with each other. A source is deviating if two other
+ * sources agree with each other and it is outside tolerance of their average. With only two
+ * fresh sources a disagreement cannot be resolved, so both stay valid and an alarm is raised.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void FREQ_SOURCE::CrossValidate(void)
+{
+  uint8_t source;
+  uint8_t other1;
+  uint8_t other2;
+  uint8_t noofFresh = 0U;
+  bool isDeviating;
+  bool isAlarm = false;
+  double reference;
+
+  for (source = 0U; source < noofSources; source++)
+  {
+    if (true == samples[source].isFresh)
+    {
+      noofFresh++;
+    }
+  }
+
+  for (source = 0U; source < noofSources; source++)
+  {
+    isDeviating = false;
+
+    for (other1 = 0U; other1 < noofSources; other1++)
+    {
+      for (other2 = other1 + 1U; other2 < noofSources; other2++)
+      {
+        if ((source != other1) && (source != other2) &&
+            (true == samples[source].isFresh) &&
+            (true == samples[other1].isFresh) && (true == samples[other2].isFresh) &&
+            (fabs(samples[other1].frequency - samples[other2].frequency) <= FREQ_XVAL_TOL_HZ))
+        {
+          reference = (samples[other1].frequency + samples[other2].frequency) / 2.0;
+
+          if (fabs(samples[source].frequency - reference) > FREQ_XVAL_TOL_HZ)
+          {
+            isDeviating = true;
+          }
+        }
+      }
+
+      if ((2U == noofFresh) && (source != other1) &&
+          (true == samples[source].isFresh) && (true == samples[other1].isFresh) &&
+          (fabs(samples[source].frequency - samples[other1].frequency) > FREQ_XVAL_TOL_HZ))
+      {
+        isAlarm = true;
+      }
+    }
+
+    samples[source].isValid = ((true == samples[source].isFresh) && (false == isDeviating));
+  }
+
+  if ((true == isAlarm) && (false == isXvalAlarm))
+  {
+    stats.xvalAlarms++;
+    Serial.println("Frequency sources disagree");
+  }
+  isXvalAlarm = isAlarm;
+}
+
+/***************************************************************************************************
+ * SwitchSource
+ *
+ * This function changes the active source. If there was a previous source, the step between it
+ * and the new one is held as an offset that is blended to zero over FREQ_BLEND_MS.
+ *
+ * Parameters:
+ * newSource - index of the new source, or FREQ_NO_SOURCE
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void FREQ_SOURCE::SwitchSource(uint8_t newSource)
+{
+  if ((FREQ_NO_SOURCE != activeSource) && (FREQ_NO_SOURCE != newSource))
+  {
+    blendOffset = output - samples[newSource].frequency;
+    blendStep = blendOffset / (double)FREQ_BLEND_MS;
+  }
+  else
+  {
+    blendOffset = 0.0;
+    blendStep = 0.0;
+  }
+
+  activeSource = newSource;
+  restoreTime_ms = 0U;
+  stats.switchovers++;
+
+  Serial.print("Frequency source: ");
+  Serial.println(newSource);
+}
+
+/* Public functions */
+/***************************************************************************************************
+ * Init
+ *
+ * This function sets up the frequency sources.
+ *
+ * Parameters:
+ * meters - the site meters
+ * analogueIn - analogue frequency input, or NULL if not fitted
+ * waveformEst - waveform frequency estimator, or NULL if not fitted
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void FREQ_SOURCE::Init(METER_AGG *meters, HIL_TEST *analogueIn, FREQ_EST *waveformEst)
+{
+  uint8_t source;
+
+  meterAgg = meters;
+  analogue = analogueIn;
+  waveform = waveformEst;
+
+  noofSources = (uint8_t)NOOF_CONFIGURED_SOURCES;
+
+  if (noofSources > MAX_NOOF_FREQ_SOURCES)
+  {
+    noofSources = MAX_NOOF_FREQ_SOURCES;
+  }
+
+  for (source = 0U; source < noofSources; source++)
+  {
+    samples[source] = {0.0, UINT16_MAX, false, false};
+  }
+
+  activeSource = FREQ_NO_SOURCE;
+}
+
+/***************************************************************************************************
+ * Control
+ *
+ * This function should be called every 1ms, after the meters have been read. It reads and
+ * cross-validates every source, fails over or restores the active source, and updates the
+ * blended output frequency.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * true if a frequency is available, otherwise false.
+ *
+ **************************************************************************************************/
+bool FREQ_SOURCE::Control(void)
+{
+  uint8_t source;
+  uint8_t bestSource = FREQ_NO_SOURCE;
+
+  ReadSources();
+  CrossValidate();
+
+  for (source = 0U; (source < noofSources) && (FREQ_NO_SOURCE == bestSource); source++)
+  {
+    if (true == samples[source].isValid)
+    {
+      bestSource = source;
+    }
+  }
+
+  if (FREQ_NO_SOURCE == activeSource)
+  {
+    if (FREQ_NO_SOURCE != bestSource)
+    {
+      SwitchSource(bestSource);
+    }
+  }
+  else if (false == samples[activeSource].isValid)
+  {
+    /* fail over immediately */
+    if (false == samples[activeSource].isFresh)
+    {
+      stats.staleEvents++;
+    }
+    else
+    {
+      stats.deviationEvents++;
+    }
+    SwitchSource(bestSource);
+  }
+  else if (bestSource < activeSource)
+  {
+    /* a higher priority source has returned - only go back to it once it has proven stable */
+    restoreTime_ms++;
+
+    if (restoreTime_ms >= FREQ_RESTORE_MS)
+    {
+      SwitchSource(bestSource);
+    }
+  }
+  else
+  {
+    restoreTime_ms = 0U;
+  }
+
+  if (FREQ_NO_SOURCE != activeSource)
+  {
+    output = samples[activeSource].frequency + blendOffset;
+
+    if (fabs(blendOffset) > fabs(blendStep))
+    {
+      blendOffset -= blendStep;
+    }
+    else
+    {
+      blendOffset = 0.0;
+    }
+  }
+
+  return (FREQ_NO_SOURCE != activeSource);
+}
+
+/***********************************************************************************************
+ * GetFrequency
+ *
+ * This function returns the frequency from the active source.
+ *
+ * Parameters:
+ * frequency - updated with the frequency (Hz) if a source is available
+ *
+ * Return:
+ * true if a frequency is available, otherwise false.
+ *
+ **********************************************************************************************/
+bool FREQ_SOURCE::GetFrequency(double *frequency)
+{
+  bool isAvail = false;
+
+  if (FREQ_NO_SOURCE != activeSource)
+  {
+    *frequency = output;
+    isAvail = true;
+  }
+
+  return isAvail;
+}
+
+/***********************************************************************************************
+ * GetActiveSource
+ *
+ * This function returns the index of the active source in the source configuration.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * Index of the active source, or FREQ_NO_SOURCE
+ *
+ **********************************************************************************************/
+uint8_t FREQ_SOURCE::GetActiveSource(void)
+{
+  return activeSource;
+}
+
+/***********************************************************************************************
+ * GetStats
+ *
+ * This function returns the switchover and cross-validation counters.
+ *
+ * Parameters:
+ * sourceStats - updated with a copy of the counters
+ *
+ * Return:
+ * None
+ *
+ **********************************************************************************************/
+void FREQ_SOURCE::GetStats(freqSourceStatsStruct_t *sourceStats)
+{
+  *sourceStats = stats;
+}
+
+/* end public functions */
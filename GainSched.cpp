@@ -0,0 +1,247 @@
+/***************************************************************************************************
+ * GainSched
+ *
+ * This module schedules the power PID gains by operating mode and power level. The base gains
+ * (set by hand or by auto-tuning) are multiplied by factors from a table indexed by mode class and
+ * by power band, interpolated between the band edges, so the gains change smoothly with power.
+ * The band edges are evenly spaced, so finding them is one division whatever the power.
+ *
+ * The default power factors are the inverse of the slope of the CAB1000 characteristic about
+ * each band edge, relative to the slope at the PID_TEST2 demand where the gains are auto-tuned:
+ * the inverter gives less power per unit of request near zero than near rated, so the loop gain
+ * is kept the same across the range. Every class starts from these; a class is only given
+ * different factors (gs command) once they have been tuned on site.
+ *
+ * Scheduling is off at start up, so the base gains are used everywhere until "gs on".
+ *
+ * Gains are applied with PID_CTRL::SetTunings, which keeps the output continuous, so crossing a
+ * band or changing mode does not step the inverter command.
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun Mcsherry
+ *
+ **************************************************************************************************/
+#include <Arduino.h>
+#include <math.h>
+#include "APP/GainSched.h"
+#include "APP/SerialCmd.h"
+
+/* Default factors, at 0, 25, 50, 75 and 100% of rated power */
+static const gainSchedSetStruct_t GAIN_SCHED_DEFAULT[NOOF_GAIN_SCHED_CLASSES][GAIN_SCHED_BANDS] =
+{
+  /* TRADING */
+  {{1.10, 1.10, 1.10}, {0.98, 0.98, 0.98}, {0.95, 0.95, 0.95}, {0.95, 0.95, 0.95},
+   {0.91, 0.91, 0.91}},
+  /* RESPONSE */
+  {{1.10, 1.10, 1.10}, {0.98, 0.98, 0.98}, {0.95, 0.95, 0.95}, {0.95, 0.95, 0.95},
+   {0.91, 0.91, 0.91}},
+  /* TEST */
+  {{1.10, 1.10, 1.10}, {0.98, 0.98, 0.98}, {0.95, 0.95, 0.95}, {0.95, 0.95, 0.95},
+   {0.91, 0.91, 0.91}}
+};
+
+static const char *GAIN_SCHED_CLASS_NAMES[NOOF_GAIN_SCHED_CLASSES] = {"trading", "response",
+                                                                     "test"};
+
+GAIN_SCHED gainSchedObj;
+
+/* Public functions */
+/***************************************************************************************************
+ * Restore
+ *
+ * This function loads the default factors.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void GAIN_SCHED::Restore(void)
+{
+  uint8_t schedClass;
+  uint8_t band;
+
+  for (schedClass = 0U; schedClass < (uint8_t)NOOF_GAIN_SCHED_CLASSES; schedClass++)
+  {
+    for (band = 0U; band < GAIN_SCHED_BANDS; band++)
+    {
+      table[schedClass][band] = GAIN_SCHED_DEFAULT[schedClass][band];
+    }
+  }
+}
+
+/***************************************************************************************************
+ * GetFactors
+ *
+ * This function returns the gain factors for a mode class and power level.
+ *
+ * Parameters:
+ * schedClass - the operating mode class
+ * power - the power level, either direction (0.1kW units)
+ * rated - rated power (0.1kW units)
+ * factors - updated with the factors, all 1.0 if scheduling is off
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void GAIN_SCHED::GetFactors(gainSchedClassEnum_t schedClass, double power, double rated,
+                            gainSchedSetStruct_t *factors)
+{
+  const gainSchedSetStruct_t *lower;
+  const gainSchedSetStruct_t *upper;
+  double position;
+  double fraction;
+  uint8_t band;
+
+  if ((false == isEnabled) || (schedClass >= NOOF_GAIN_SCHED_CLASSES) || (rated <= 0.0))
+  {
+    *factors = {1.0, 1.0, 1.0};
+    return;
+  }
+
+  position = (fabs(power) / rated) * (double)(GAIN_SCHED_BANDS - 1U);
+  if (position >= (double)(GAIN_SCHED_BANDS - 1U))
+  {
+    *factors = table[schedClass][GAIN_SCHED_BANDS - 1U];
+    return;
+  }
+
+  band = (uint8_t)position;
+  fraction = position - (double)band;
+  lower = &table[schedClass][band];
+  upper = &table[schedClass][band + 1U];
+
+  factors->kp = lower->kp + (fraction * (upper->kp - lower->kp));
+  factors->ki = lower->ki + (fraction * (upper->ki - lower->ki));
+  factors->kd = lower->kd + (fraction * (upper->kd - lower->kd));
+}
+
+/***************************************************************************************************
+ * SetFactors
+ *
+ * This function changes the factors at one band edge.
+ *
+ * Parameters:
+ * schedClass - the operating mode class
+ * band - the band edge, 0 (zero power) to GAIN_SCHED_BANDS - 1 (rated power)
+ * factors - the factors, 0 to GAIN_SCHED_MAX_FACTOR; the integral factor must be above 0
+ *
+ * Return:
+ * true if changed, false if out of range
+ *
+ **************************************************************************************************/
+bool GAIN_SCHED::SetFactors(gainSchedClassEnum_t schedClass, uint8_t band,
+                            const gainSchedSetStruct_t *factors)
+{
+  if ((schedClass >= NOOF_GAIN_SCHED_CLASSES) || (band >= GAIN_SCHED_BANDS) ||
+      (factors->kp < 0.0) || (factors->kp > GAIN_SCHED_MAX_FACTOR) ||
+      (factors->ki <= 0.0) || (factors->ki > GAIN_SCHED_MAX_FACTOR) ||
+      (factors->kd < 0.0) || (factors->kd > GAIN_SCHED_MAX_FACTOR))
+  {
+    return false;
+  }
+
+  table[schedClass][band] = *factors;
+
+  return true;
+}
+
+/***************************************************************************************************
+ * Command
+ *
+ * This function runs a gain scheduling command received on the serial port:
+ *   gs                                 report the factors
+ *   gs on                              schedule the gains
+ *   gs off                             use the base gains everywhere
+ *   gs <class> <band> <kp> <ki> <kd>   set the factors at a band edge (class 0 trading,
+ *                                      1 response, 2 test; band 0 zero to 4 rated power)
+ *   gs clr                             load the default factors
+ *
+ * Parameters:
+ * command - the command
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void GAIN_SCHED::Command(String command)
+{
+  gainSchedSetStruct_t factors;
+  String action;
+  int position = 0;
+  uint8_t schedClass;
+  uint8_t band;
+  bool isOk = false;
+
+  command.trim();
+  (void)CMD_NextToken(command, &position);   /* "gs" */
+  action = CMD_NextToken(command, &position);
+
+  if (0 == action.length())
+  {
+    Serial.print("Gain scheduling: ");
+    Serial.println((true == isEnabled) ? "on" : "off");
+
+    for (schedClass = 0U; schedClass < (uint8_t)NOOF_GAIN_SCHED_CLASSES; schedClass++)
+    {
+      Serial.print(GAIN_SCHED_CLASS_NAMES[schedClass]);
+      Serial.println(" kp, ki, kd from zero to rated:");
+
+      for (band = 0U; band < GAIN_SCHED_BANDS; band++)
+      {
+        Serial.print("  ");
+        Serial.print(table[schedClass][band].kp, 2);
+        Serial.print(", ");
+        Serial.print(table[schedClass][band].ki, 2);
+        Serial.print(", ");
+        Serial.println(table[schedClass][band].kd, 2);
+      }
+    }
+    return;
+  }
+  else if ("on" == action)
+  {
+    isEnabled = true;
+    isOk = true;
+  }
+  else if ("off" == action)
+  {
+    isEnabled = false;
+    isOk = true;
+  }
+  else if ("clr" == action)
+  {
+    Restore();
+    isOk = true;
+  }
+  else if ((action.charAt(0) >= '0') && (action.charAt(0) <= '9'))
+  {
+    schedClass = (uint8_t)action.toInt();
+    band = (uint8_t)CMD_NextToken(command, &position).toInt();
+    factors.kp = CMD_NextToken(command, &position).toDouble();
+    factors.ki = CMD_NextToken(command, &position).toDouble();
+    factors.kd = CMD_NextToken(command, &position).toDouble();
+    isOk = SetFactors((gainSchedClassEnum_t)schedClass, band, &factors);
+  }
+  else
+  {
+    /* unknown command */
+  }
+
+  if (true == isOk)
+  {
+    Serial.println("gs ok");
+  }
+  else
+  {
+    Serial.println("gs rejected");
+  }
+}
+
+/* end public functions */
@@ -0,0 +1,23 @@
+/***************************************************************************************************
+ * 
+ * Header for for HAL_ADC.cpp
+ * 
+ * Date: 16/10/2026
+ * 
+ * Author: Shaun Mcsherry
+ * 
+ * ************************************************************************************************/
+#ifndef HAL_ADC_H
+#define HAL_ADC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ADC_WAVEFORM_INPUT      2         /* analog_in channel with the voltage waveform */
+#define ADC_DMA_BUFFER_SIZE     1024U     /* samples - 100ms at 10kHz, must be read within this */
+#define ADC_MAX_READ            64U       /* most samples returned by one read */
+
+extern bool ADC_Init(uint32_t sampleRate_hz);
+extern uint16_t ADC_Read(uint16_t *samples, uint16_t maxSamples);
+
+#endif /* HAL_ADC_H */
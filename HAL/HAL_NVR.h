@@ -0,0 +1,26 @@
+/***************************************************************************************************
+ * 
+ * Header for for HAL_NVR.cpp
+ * 
+ * Date: 16/10/2026
+ * 
+ * Author: Shaun Mcsherry
+ * 
+ * ************************************************************************************************/
+#ifndef HAL_NVR_H
+#define HAL_NVR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Keys must start with the "/kv/" partition prefix */
+#define NVR_MAX_KEY_LEN         24U
+#define NVR_MAX_RECORD_SIZE     512U
+#define NVR_NOOF_WRITE_SLOTS    4U
+
+extern void NVR_Init(void);
+extern bool NVR_Read(const char *key, void *data, size_t size);
+extern bool NVR_Write(const char *key, const void *data, size_t size);
+
+#endif /* HAL_NVR_H */
+  
@@ -0,0 +1,26 @@
+/***************************************************************************************************
+ *
+ * Header for for HAL_RTC.cpp
+ *
+ * Date: 16/10/2026
+ *
+ * Author: Shaun Mcsherry
+ *
+ * ************************************************************************************************/
+#ifndef HAL_RTC_H
+#define HAL_RTC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RTC_MIN_VALID_EPOCH     1704067200UL   /* 01/01/2024 - earlier times are not trusted */
+#define RTC_RESYNC_PERIOD_MS    3600000UL      /* re-align to the RTC chip every hour */
+#define RTC_EDGE_POLL_MS        10U            /* RTC thread period, the chip seconds poll */
+#define RTC_EDGE_TIMEOUT_MS     1500U          /* no edge in this time is a chip fault */
+
+extern void RTC_Init(void);
+extern bool RTC_GetTime(uint32_t *seconds, uint16_t *ms);
+extern bool RTC_SetTime(uint32_t seconds, uint16_t ms);
+
+#endif /* HAL_RTC_H */
+
@@ -0,0 +1,235 @@
+/***************************************************************************************************
+ * HAL_ADC
+ *
+ * This module is written as an interface to sample the grid voltage waveform using non-member
+ * functions. It is only built when FREQ_EST_FITTED is defined (Controller.h).
+ *
+ * analog_in.read() converts one sample on request and cannot run fast enough, so ADC1 is set up
+ * directly: TIM4 triggers a conversion at the sample rate and DMA2 stream 7 writes the results
+ * into a circular buffer. No interrupts are used - ADC_Read works out how far the DMA has got
+ * from its remaining count and copies out the samples since the last read.
+ *
+ * Circuit:
+ *  - Portenta H7
+ *  - Machine Control, voltage transducer on analogue input 2 (PA_1C, ADC1 INP1)
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun Mcsherry
+ *
+ **************************************************************************************************/
+#include <Arduino_MachineControl.h>
+#include "APP/Controller.h"
+#include "HAL/HAL_ADC.h"
+
+#ifdef FREQ_EST_FITTED
+#include "stm32h7xx_hal.h"
+
+using namespace machinecontrol;
+
+static ADC_HandleTypeDef adcHandle;
+static DMA_HandleTypeDef dmaHandle;
+static TIM_HandleTypeDef timHandle;
+
+/* Aligned to a cache line, as the cache must be invalidated before the DMA data is read */
+static uint16_t dmaBuffer[ADC_DMA_BUFFER_SIZE] __attribute__((aligned(32)));
+static uint16_t readIndex = 0U;
+static bool isSampling = false;
+
+/* Private functions */
+/***************************************************************************************************
+ * TimerInit
+ *
+ * This function sets TIM4 to output a trigger at the sample rate.
+ *
+ * Parameters:
+ * sampleRate_hz - sample rate
+ *
+ * Return:
+ * true if set up, otherwise false
+ *
+ **************************************************************************************************/
+static bool TimerInit(uint32_t sampleRate_hz)
+{
+  TIM_MasterConfigTypeDef master = {0};
+
+  __HAL_RCC_TIM4_CLK_ENABLE();
+
+  /* APB1 timers run at twice the bus clock when the bus is divided */
+  timHandle.Instance = TIM4;
+  timHandle.Init.Prescaler = 0U;
+  timHandle.Init.CounterMode = TIM_COUNTERMODE_UP;
+  timHandle.Init.Period = ((2U * HAL_RCC_GetPCLK1Freq()) / sampleRate_hz) - 1U;
+  timHandle.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+  timHandle.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+
+  master.MasterOutputTrigger = TIM_TRGO_UPDATE;
+  master.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+
+  return ((HAL_OK == HAL_TIM_Base_Init(&timHandle)) &&
+          (HAL_OK == HAL_TIMEx_MasterConfigSynchronization(&timHandle, &master)));
+}
+
+/***************************************************************************************************
+ * DmaInit
+ *
+ * This function sets DMA2 stream 7 to copy ADC1 results into the circular buffer.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * true if set up, otherwise false
+ *
+ **************************************************************************************************/
+static bool DmaInit(void)
+{
+  __HAL_RCC_DMA2_CLK_ENABLE();
+
+  dmaHandle.Instance = DMA2_Stream7;
+  dmaHandle.Init.Request = DMA_REQUEST_ADC1;
+  dmaHandle.Init.Direction = DMA_PERIPH_TO_MEMORY;
+  dmaHandle.Init.PeriphInc = DMA_PINC_DISABLE;
+  dmaHandle.Init.MemInc = DMA_MINC_ENABLE;
+  dmaHandle.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  dmaHandle.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+  dmaHandle.Init.Mode = DMA_CIRCULAR;
+  dmaHandle.Init.Priority = DMA_PRIORITY_HIGH;
+  dmaHandle.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+
+  __HAL_LINKDMA(&adcHandle, DMA_Handle, dmaHandle);
+
+  return (HAL_OK == HAL_DMA_Init(&dmaHandle));
+}
+
+/***************************************************************************************************
+ * AdcInit
+ *
+ * This function sets ADC1 to convert the waveform input on each timer trigger, at 16 bits.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * true if set up, otherwise false
+ *
+ **************************************************************************************************/
+static bool AdcInit(void)
+{
+  ADC_ChannelConfTypeDef channel = {0};
+
+  adcHandle.Instance = ADC1;
+  (void)HAL_ADC_DeInit(&adcHandle);   /* undo the single conversion set up by mbed */
+
+  adcHandle.Init.ClockPrescaler = ADC_CLOCK_ASYNC_DIV4;
+  adcHandle.Init.Resolution = ADC_RESOLUTION_16B;
+  adcHandle.Init.ScanConvMode = ADC_SCAN_DISABLE;
+  adcHandle.Init.EOCSelection = ADC_EOC_SINGLE_CONV;
+  adcHandle.Init.LowPowerAutoWait = DISABLE;
+  adcHandle.Init.ContinuousConvMode = DISABLE;
+  adcHandle.Init.NbrOfConversion = 1U;
+  adcHandle.Init.DiscontinuousConvMode = DISABLE;
+  adcHandle.Init.ExternalTrigConv = ADC_EXTERNALTRIG_T4_TRGO;
+  adcHandle.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_RISING;
+  adcHandle.Init.ConversionDataManagement = ADC_CONVERSIONDATA_DMA_CIRCULAR;
+  adcHandle.Init.Overrun = ADC_OVR_DATA_OVERWRITTEN;
+  adcHandle.Init.LeftBitShift = ADC_LEFTBITSHIFT_NONE;
+  adcHandle.Init.OversamplingMode = DISABLE;
+
+  channel.Channel = ADC_CHANNEL_1;
+  channel.Rank = ADC_REGULAR_RANK_1;
+  channel.SamplingTime = ADC_SAMPLETIME_64CYCLES_5;
+  channel.SingleDiff = ADC_SINGLE_ENDED;
+  channel.OffsetNumber = ADC_OFFSET_NONE;
+
+  return ((HAL_OK == HAL_ADC_Init(&adcHandle)) &&
+          (HAL_OK == HAL_ADC_ConfigChannel(&adcHandle, &channel)) &&
+          (HAL_OK == HAL_ADCEx_Calibration_Start(&adcHandle, ADC_CALIB_OFFSET_LINEARITY,
+                                                 ADC_SINGLE_ENDED)));
+}
+
+/* Public functions */
+/***************************************************************************************************
+ * ADC_Init
+ *
+ * This function starts sampling the waveform input.
+ *
+ * Parameters:
+ * sampleRate_hz - sample rate
+ *
+ * Return:
+ * true if sampling has started, otherwise false
+ *
+ **************************************************************************************************/
+bool ADC_Init(uint32_t sampleRate_hz)
+{
+  bool isStarted;
+
+  /* let mbed set up the pin, its analogue switch and the ADC clock */
+  analog_in.set0_10V();
+  (void)analog_in.read(ADC_WAVEFORM_INPUT);
+
+  __HAL_RCC_ADC12_CLK_ENABLE();
+
+  isStarted = ((true == AdcInit()) && (true == DmaInit()) && (true == TimerInit(sampleRate_hz)) &&
+               (HAL_OK == HAL_ADC_Start_DMA(&adcHandle, (uint32_t *)dmaBuffer,
+                                            ADC_DMA_BUFFER_SIZE)) &&
+               (HAL_OK == HAL_TIM_Base_Start(&timHandle)));
+
+  readIndex = 0U;
+  isSampling = isStarted;
+
+  if (false == isStarted)
+  {
+    Serial.println("Waveform ADC failed to start");
+  }
+
+  return isStarted;
+}
+
+/***************************************************************************************************
+ * ADC_Read
+ *
+ * This function copies out the samples converted since the last read. It must be called at
+ * least every ADC_DMA_BUFFER_SIZE samples, or samples are lost.
+ *
+ * Parameters:
+ * samples - updated with the samples, oldest first
+ * maxSamples - most samples to copy, any more are left for the next read
+ *
+ * Return:
+ * The number of samples copied, 0 if sampling has not started
+ *
+ **************************************************************************************************/
+uint16_t ADC_Read(uint16_t *samples, uint16_t maxSamples)
+{
+  uint16_t writeIndex;
+  uint16_t count = 0U;
+
+  if (false == isSampling)
+  {
+    return 0U;
+  }
+
+  writeIndex = (uint16_t)(ADC_DMA_BUFFER_SIZE - __HAL_DMA_GET_COUNTER(&dmaHandle));
+  if (writeIndex >= ADC_DMA_BUFFER_SIZE)
+  {
+    writeIndex = 0U;
+  }
+
+  SCB_InvalidateDCache_by_Addr((uint32_t *)dmaBuffer, (int32_t)sizeof(dmaBuffer));
+
+  while ((readIndex != writeIndex) && (count < maxSamples))
+  {
+    samples[count] = dmaBuffer[readIndex];
+    count++;
+    readIndex = (uint16_t)((readIndex + 1U) % ADC_DMA_BUFFER_SIZE);
+  }
+
+  return count;
+}
+
+/* end public functions */
+#endif /* FREQ_EST_FITTED */
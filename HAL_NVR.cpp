@@ -0,0 +1,192 @@
+/***************************************************************************************************
+ * HAL_NVR
+ * 
+ * This module is written as an interface to the non-volatile key-value store (internal flash)
+ * using non-member functions.
+ *
+ * Flash writes can block for a long time (a sector erase takes seconds), so writes are never made
+ * from the control loop. NVR_Write copies the record into a write slot and a low priority thread
+ * programs it into flash. A newer write of the same key replaces a record that is still waiting.
+ * Reads are blocking and should only be made at initialisation.
+ *
+ * Circuit:
+ *  - Portenta H7
+ *  - Machine Control
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun Mcsherry
+ *
+ **************************************************************************************************/
+#include <Arduino.h>
+#include <string.h>
+#include "mbed.h"
+#include "kvstore_global_api.h"
+#include "HAL/HAL_NVR.h"
+
+#define NVR_THREAD_STACK_SIZE   4096U
+#define NVR_THREAD_PERIOD_MS    100U
+
+typedef struct NVR_WRITE_SLOT_STRUCT
+{
+  char key[NVR_MAX_KEY_LEN];
+  uint8_t data[NVR_MAX_RECORD_SIZE];
+  size_t size;
+  bool isPending;
+}nvrWriteSlotStruct_t;
+
+static nvrWriteSlotStruct_t writeSlot[NVR_NOOF_WRITE_SLOTS];
+static rtos::Mutex slotMutex;
+static rtos::Thread nvrThread(osPriorityLow, NVR_THREAD_STACK_SIZE);
+
+/* Private functions */
+/***************************************************************************************************
+ * NVR_WriteTask
+ * 
+ * This thread programs pending write slots into flash. A slot is copied out under the mutex so
+ * that the control loop is never held while flash is being written.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+static void NVR_WriteTask(void)
+{
+  static nvrWriteSlotStruct_t record;
+  uint8_t slot;
+  bool isFound;
+
+  while (true)
+  {
+    for (slot = 0U; slot < NVR_NOOF_WRITE_SLOTS; slot++)
+    {
+      slotMutex.lock();
+      isFound = writeSlot[slot].isPending;
+      if (true == isFound)
+      {
+        record = writeSlot[slot];
+        writeSlot[slot].isPending = false;
+      }
+      slotMutex.unlock();
+
+      if ((true == isFound) && (MBED_SUCCESS != kv_set(record.key, record.data, record.size, 0U)))
+      {
+        Serial.print("NVR write failed: ");
+        Serial.println(record.key);
+      }
+    }
+
+    rtos::ThisThread::sleep_for(std::chrono::milliseconds(NVR_THREAD_PERIOD_MS));
+  }
+}
+
+/* Public functions */
+/***************************************************************************************************
+ * NVR_Init
+ * 
+ * This function starts the NVR write thread. It should be called once at start up.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void NVR_Init(void)
+{
+  static bool isStarted = false;
+
+  if (false == isStarted)
+  {
+    isStarted = true;
+    nvrThread.start(NVR_WriteTask);
+  }
+}
+
+/***************************************************************************************************
+ * NVR_Read
+ * 
+ * This function reads a record. The read blocks, so it must not be called from the control loop.
+ *
+ * Parameters:
+ * key - the record key
+ * data - updated with the record
+ * size - expected record size
+ *
+ * Return:
+ * true if a record of the expected size was read, otherwise false
+ *
+ **************************************************************************************************/
+bool NVR_Read(const char *key, void *data, size_t size)
+{
+  size_t actualSize = 0U;
+  bool isRead = false;
+
+  if ((MBED_SUCCESS == kv_get(key, data, size, &actualSize)) && (actualSize == size))
+  {
+    isRead = true;
+  }
+
+  return isRead;
+}
+
+/***************************************************************************************************
+ * NVR_Write
+ * 
+ * This function queues a record to be written by the NVR thread. It does not block.
+ *
+ * Parameters:
+ * key - the record key
+ * data - the record
+ * size - record size
+ *
+ * Return:
+ * true if the record has been queued, false if it is too large or no write slot is free
+ *
+ **************************************************************************************************/
+bool NVR_Write(const char *key, const void *data, size_t size)
+{
+  uint8_t slot;
+  uint8_t freeSlot = NVR_NOOF_WRITE_SLOTS;
+  bool isQueued = false;
+
+  if ((size <= NVR_MAX_RECORD_SIZE) && (strlen(key) < NVR_MAX_KEY_LEN))
+  {
+    slotMutex.lock();
+
+    /* replace a pending write of the same key, otherwise take a free slot */
+    for (slot = 0U; slot < NVR_NOOF_WRITE_SLOTS; slot++)
+    {
+      if ((true == writeSlot[slot].isPending) && (0 == strcmp(writeSlot[slot].key, key)))
+      {
+        freeSlot = slot;
+        break;
+      }
+      else if ((false == writeSlot[slot].isPending) && (NVR_NOOF_WRITE_SLOTS == freeSlot))
+      {
+        freeSlot = slot;
+      }
+    }
+
+    if (freeSlot < NVR_NOOF_WRITE_SLOTS)
+    {
+      strcpy(writeSlot[freeSlot].key, key);
+      memcpy(writeSlot[freeSlot].data, data, size);
+      writeSlot[freeSlot].size = size;
+      writeSlot[freeSlot].isPending = true;
+      isQueued = true;
+    }
+
+    slotMutex.unlock();
+  }
+
+  return isQueued;
+}
+
+/* End public functions */
@@ -0,0 +1,300 @@
+/***************************************************************************************************
+ * HAL_RTC
+ *
+ * This module is written as an interface to the PCF8563T real time clock using non-member
+ * functions. It provides wall clock time to the millisecond.
+ *
+ * The chip only counts whole seconds and is read over I2C, so it is not read on every call.
+ * Instead the time is kept as the epoch at a chip seconds edge plus the millis() elapsed since,
+ * and is re-aligned to a new edge every RTC_RESYNC_PERIOD_MS to remove drift. The edge is found
+ * by polling the seconds register, blocking at start up and from a low priority thread every
+ * RTC_EDGE_POLL_MS at run time, so the control loop never waits on I2C. Only the thread changes
+ * the base time once started; readers in other threads see it through the update counter. The base
+ * and pending fields are volatile so the compiler keeps their accesses in order around the counter
+ * and the pending flag.
+ *
+ * The time can be set from outside (e.g. by Flex). It is applied by the thread within
+ * RTC_EDGE_POLL_MS and written to the chip at the next seconds boundary, so the chip's edges stay
+ * aligned.
+ *
+ * Circuit:
+ *  - Portenta H7
+ *  - Machine Control
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun Mcsherry
+ *
+ **************************************************************************************************/
+#include <Arduino_MachineControl.h>
+#include "mbed.h"
+#include "HAL/HAL_RTC.h"
+
+using namespace machinecontrol;
+
+#define RTC_THREAD_STACK_SIZE   2048U
+
+static volatile uint32_t baseEpoch = 0U;   /* time at the last edge (s) */
+static volatile uint32_t baseMillis = 0U;  /* millis() at the last edge */
+static volatile uint32_t baseUpdates = 0U; /* odd while the base is being changed */
+
+static bool isHunting = false;
+static uint32_t huntStart_ms = 0U;
+static uint8_t lastSeconds = 0U;
+static bool isChipWritePending = false;
+
+static volatile bool isSetPending = false;
+static volatile uint32_t pendingEpoch = 0U;
+static volatile uint32_t pendingMillis = 0U;
+
+static rtos::Thread rtcThread(osPriorityLow, RTC_THREAD_STACK_SIZE);
+
+/* Private functions */
+/***************************************************************************************************
+ * SetBase
+ *
+ * This function sets the time at a known millis().
+ *
+ * Parameters:
+ * epoch - time (s)
+ * edge_ms - millis() at that time
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+static void SetBase(uint32_t epoch, uint32_t edge_ms)
+{
+  baseUpdates++;
+  baseEpoch = epoch;
+  baseMillis = edge_ms;
+  baseUpdates++;
+}
+
+/***************************************************************************************************
+ * PollEdge
+ *
+ * This function reads the chip seconds and, if they have changed since the last poll, re-aligns
+ * the time to the new second.
+ *
+ * Parameters:
+ * now_ms - millis() at the poll
+ *
+ * Return:
+ * true if an edge was found
+ *
+ **************************************************************************************************/
+static bool PollEdge(uint32_t now_ms)
+{
+  uint8_t seconds;
+  bool isEdge = false;
+
+  seconds = rtc_controller.getSeconds();
+
+  if (seconds != lastSeconds)
+  {
+    SetBase((uint32_t)rtc_controller.getEpoch(), now_ms);
+    isEdge = true;
+  }
+
+  lastSeconds = seconds;
+
+  return isEdge;
+}
+
+/***************************************************************************************************
+ * RTC_Task
+ *
+ * This thread applies a time set from outside, writes it to the chip and periodically re-aligns
+ * the time to the chip. It wakes every RTC_EDGE_POLL_MS, so while hunting for an edge each pass
+ * is one poll of the chip.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+static void RTC_Task(void)
+{
+  uint32_t now_ms;
+  uint32_t seconds;
+  uint16_t ms;
+
+  while (true)
+  {
+    now_ms = millis();
+
+    if (true == isSetPending)
+    {
+      SetBase(pendingEpoch, pendingMillis);
+      isSetPending = false;
+      isChipWritePending = true;
+      isHunting = false;
+    }
+
+    if (true == isChipWritePending)
+    {
+      /* write at a seconds boundary so that the chip's edges match the time */
+      (void)RTC_GetTime(&seconds, &ms);
+      if (ms < RTC_EDGE_POLL_MS)
+      {
+        rtc_controller.setEpoch((time_t)seconds);
+        SetBase(seconds, now_ms - ms);
+        isChipWritePending = false;
+      }
+    }
+    else if (true == isHunting)
+    {
+      if (true == PollEdge(now_ms))
+      {
+        isHunting = false;
+      }
+      else if ((now_ms - huntStart_ms) >= RTC_EDGE_TIMEOUT_MS)
+      {
+        /* free run on millis() until the next re-alignment */
+        Serial.println("RTC not running");
+        (void)RTC_GetTime(&seconds, &ms);
+        SetBase(seconds, now_ms - ms);
+        isHunting = false;
+      }
+    }
+    else if ((now_ms - baseMillis) >= RTC_RESYNC_PERIOD_MS)
+    {
+      isHunting = true;
+      huntStart_ms = now_ms;
+      lastSeconds = rtc_controller.getSeconds();
+    }
+    else
+    {
+      /* time is running from millis() */
+    }
+
+    rtos::ThisThread::sleep_for(std::chrono::milliseconds(RTC_EDGE_POLL_MS));
+  }
+}
+
+/* Public functions */
+/***************************************************************************************************
+ * RTC_Init
+ *
+ * This function starts the RTC, aligns the time to a chip seconds edge and starts the RTC thread.
+ * It blocks for up to RTC_EDGE_TIMEOUT_MS, so it should only be called once at start up.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void RTC_Init(void)
+{
+  static bool isStarted = false;
+  uint32_t start_ms;
+  bool isEdge = false;
+
+  if (true == isStarted)
+  {
+    return;
+  }
+  isStarted = true;
+
+  if (false == rtc_controller.begin())
+  {
+    Serial.println("RTC not found");
+  }
+
+  start_ms = millis();
+  lastSeconds = rtc_controller.getSeconds();
+
+  while ((false == isEdge) && ((millis() - start_ms) < RTC_EDGE_TIMEOUT_MS))
+  {
+    delay(1);
+    isEdge = PollEdge(millis());
+  }
+
+  if (false == isEdge)
+  {
+    Serial.println("RTC not running");
+  }
+  else if (baseEpoch < RTC_MIN_VALID_EPOCH)
+  {
+    Serial.println("RTC time not set");
+  }
+
+  rtcThread.start(RTC_Task);
+}
+
+/***************************************************************************************************
+ * RTC_GetTime
+ *
+ * This function returns the wall clock time. It may be called from any thread.
+ *
+ * Parameters:
+ * seconds - updated with the seconds since 01/01/1970 (UTC)
+ * ms - updated with the milliseconds into the second
+ *
+ * Return:
+ * true if the clock has been set, otherwise false
+ *
+ **************************************************************************************************/
+bool RTC_GetTime(uint32_t *seconds, uint16_t *ms)
+{
+  uint32_t updates;
+  uint32_t epoch;
+  uint32_t elapsed_ms;
+
+  /* re-read if the base changed part way through */
+  do
+  {
+    updates = baseUpdates;
+    epoch = baseEpoch;
+    elapsed_ms = millis() - baseMillis;
+  } while ((0U != (updates & 1U)) || (updates != baseUpdates));
+
+  *seconds = epoch + (elapsed_ms / 1000U);
+  *ms = (uint16_t)(elapsed_ms % 1000U);
+
+  return (epoch >= RTC_MIN_VALID_EPOCH);
+}
+
+/***************************************************************************************************
+ * RTC_SetTime
+ *
+ * This function sets the wall clock time. It may be called from any thread, and is applied by the
+ * RTC thread within RTC_EDGE_POLL_MS.
+ *
+ * Parameters:
+ * seconds - seconds since 01/01/1970 (UTC)
+ * ms - milliseconds into the second
+ *
+ * Return:
+ * true if the time will be applied, false if it is invalid or a previous set is still pending
+ *
+ **************************************************************************************************/
+bool RTC_SetTime(uint32_t seconds, uint16_t ms)
+{
+  bool isAccepted = false;
+
+  if (ms < 1000U)
+  {
+    /* check and claim the pending slot in one step, as several threads may set the time */
+    core_util_critical_section_enter();
+    if (false == isSetPending)
+    {
+      pendingEpoch = seconds;
+      pendingMillis = millis() - ms;
+      isSetPending = true;
+      isAccepted = true;
+    }
+    core_util_critical_section_exit();
+  }
+
+  return isAccepted;
+}
+
+/* end public functions */
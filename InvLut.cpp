@@ -0,0 +1,385 @@
+/***************************************************************************************************
+ * InvLut
+ *
+ * This module holds the measured characteristic of the inverter - the power it actually delivers
+ * for each requested power - and interpolates it both ways:
+ * - Command gives the request needed for a wanted power (the inverse characteristic), used as
+ *   the feedforward term of power control and for open-loop operation,
+ * - Power gives the power expected for a request, used by tools/plant_sim to model the inverter.
+ *
+ * Both are looked up on uniform grids (UniformLut.h), so a lookup takes the same time wherever it
+ * falls in the table. The grids for a table known at compile time can be built by the compiler
+ * (InvLutGrids) and passed to Init; otherwise, and whenever the points are learnt, they are
+ * resampled here.
+ *
+ * The characteristic drifts with temperature, DC voltage and inverter firmware, so the power
+ * column can be learnt online. Adapt takes a steady state (command, power) pair and moves the two
+ * points either side of the command by recursive least squares with exponential forgetting:
+ *
+ *   W = lambda.W + w^2,  P += (w / W).(power - predicted)
+ *
+ * where w is the interpolation weight of the point. Only points that are visited are forgotten,
+ * so a rarely used part of the characteristic keeps what it has learnt. Each point stays within
+ * maxDeviation of the loaded table and between its neighbours. Deciding which pairs are steady
+ * and plausible, and storing what has been learnt, is done by LutLearn.cpp.
+ *
+ * The module does not use the Arduino libraries, so that it can be run on a host.
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun Mcsherry
+ *
+ **************************************************************************************************/
+#include <stddef.h>
+#include <math.h>
+#include "APP/InvLut.h"
+
+/* private functions */
+/***************************************************************************************************
+ * Bound
+ *
+ * This function keeps a learnt point within maxDeviation of the loaded table and at least
+ * INV_LUT_MIN_STEP from its neighbours.
+ *
+ * Parameters:
+ * row - the point
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void INV_LUT::Bound(uint8_t row)
+{
+  double lower = loaded[row] - maxDeviation;
+  double upper = loaded[row] + maxDeviation;
+
+  if ((row > 0U) && (lower < (rows[row - 1U].power + INV_LUT_MIN_STEP)))
+  {
+    lower = rows[row - 1U].power + INV_LUT_MIN_STEP;
+  }
+  if ((row < (noofRows - 1U)) && (upper > (rows[row + 1U].power - INV_LUT_MIN_STEP)))
+  {
+    upper = rows[row + 1U].power - INV_LUT_MIN_STEP;
+  }
+
+  if (rows[row].power > upper)
+  {
+    rows[row].power = upper;
+  }
+  if (rows[row].power < lower)
+  {
+    rows[row].power = lower;
+  }
+}
+
+/***************************************************************************************************
+ * Resample
+ *
+ * This function rebuilds the lookup grids from the points.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void INV_LUT::Resample(void)
+{
+  grids = InvLutGrids(rows, noofRows);
+}
+
+/* Public functions */
+/***************************************************************************************************
+ * Init
+ *
+ * This function loads a characteristic.
+ *
+ * Parameters:
+ * table - the measured points, in increasing order
+ * tableRows - number of points
+ * tableGrids - the table resampled by InvLutGrids at compile time, or NULL to resample it here
+ *
+ * Return:
+ * true if loaded, false if the table is too long or too short, or does not increase
+ *
+ **************************************************************************************************/
+bool INV_LUT::Init(const invLutRowStruct_t *table, uint8_t tableRows,
+                   const invLutGridsStruct_t *tableGrids)
+{
+  uint8_t row;
+
+  if ((tableRows < 2U) || (tableRows > INV_LUT_MAX_ROWS))
+  {
+    return false;
+  }
+
+  for (row = 1U; row < tableRows; row++)
+  {
+    if ((table[row].command <= table[row - 1U].command) ||
+        (table[row].power <= table[row - 1U].power))
+    {
+      return false;
+    }
+  }
+
+  for (row = 0U; row < tableRows; row++)
+  {
+    rows[row] = table[row];
+    loaded[row] = table[row].power;
+    weight[row] = INV_LUT_PRIOR_WEIGHT;
+  }
+  noofRows = tableRows;
+
+  if (NULL != tableGrids)
+  {
+    grids = *tableGrids;
+  }
+  else
+  {
+    Resample();
+  }
+
+  return true;
+}
+
+/***************************************************************************************************
+ * Command
+ *
+ * This function returns the request that gives a wanted power.
+ *
+ * Parameters:
+ * power - the wanted power (0.1kW units)
+ *
+ * Return:
+ * The request (0.1kW units), or the wanted power if no characteristic is loaded
+ *
+ **************************************************************************************************/
+double INV_LUT::Command(double power)
+{
+  if (0U == noofRows)
+  {
+    return power;
+  }
+
+  return grids.inverse.Lookup(power);
+}
+
+/***************************************************************************************************
+ * Power
+ *
+ * This function returns the power the inverter delivers for a request.
+ *
+ * Parameters:
+ * command - the request (0.1kW units)
+ *
+ * Return:
+ * The power (0.1kW units), or the request if no characteristic is loaded
+ *
+ **************************************************************************************************/
+double INV_LUT::Power(double command)
+{
+  if (0U == noofRows)
+  {
+    return command;
+  }
+
+  return grids.forward.Lookup(command);
+}
+
+/***************************************************************************************************
+ * SetAdaptation
+ *
+ * This function sets how the power column is learnt.
+ *
+ * Parameters:
+ * newForgetting - forgetting factor per sample, INV_LUT_MIN_FORGETTING to 1.0 (1.0 never forgets)
+ * newMaxDeviation - furthest a point may move from the loaded table (0.1kW units), 0 to freeze it
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void INV_LUT::SetAdaptation(double newForgetting, double newMaxDeviation)
+{
+  if ((newForgetting >= INV_LUT_MIN_FORGETTING) && (newForgetting <= 1.0))
+  {
+    forgetting = newForgetting;
+  }
+  if (newMaxDeviation >= 0.0)
+  {
+    maxDeviation = newMaxDeviation;
+  }
+}
+
+/***************************************************************************************************
+ * Adapt
+ *
+ * This function learns from a steady state pair: the points either side of the command are moved
+ * towards the measured power.
+ *
+ * Parameters:
+ * command - the request (0.1kW units)
+ * power - the power measured in steady state for it (0.1kW units)
+ *
+ * Return:
+ * true if learnt, false if the command is outside the table or nothing is loaded
+ *
+ **************************************************************************************************/
+bool INV_LUT::Adapt(double command, double power)
+{
+  uint8_t row = 0U;
+  uint8_t point;
+  double fraction;
+  double error;
+  double pointFraction;
+
+  if ((noofRows < 2U) || (command < rows[0].command) ||
+      (command > rows[noofRows - 1U].command))
+  {
+    return false;
+  }
+
+  /* find the segment the request is in */
+  while ((row < (noofRows - 2U)) && (command > rows[row + 1U].command))
+  {
+    row++;
+  }
+
+  fraction = (command - rows[row].command) / (rows[row + 1U].command - rows[row].command);
+  error = power - (rows[row].power + (fraction * (rows[row + 1U].power - rows[row].power)));
+
+  for (point = row; point <= (row + 1U); point++)
+  {
+    pointFraction = (point == row) ? (1.0 - fraction) : fraction;
+
+    if (pointFraction > 0.0)
+    {
+      weight[point] = (forgetting * weight[point]) + (pointFraction * pointFraction);
+      rows[point].power += (pointFraction / weight[point]) * error;
+      Bound(point);
+    }
+  }
+  Resample();
+
+  return true;
+}
+
+/***************************************************************************************************
+ * Restore
+ *
+ * This function discards what has been learnt and goes back to the loaded table.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void INV_LUT::Restore(void)
+{
+  uint8_t row;
+
+  for (row = 0U; row < noofRows; row++)
+  {
+    rows[row].power = loaded[row];
+    weight[row] = INV_LUT_PRIOR_WEIGHT;
+  }
+  Resample();
+}
+
+/***************************************************************************************************
+ * GetNoofRows
+ *
+ * This function returns the number of points in the characteristic.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * Number of points, 0 if nothing is loaded
+ *
+ **************************************************************************************************/
+uint8_t INV_LUT::GetNoofRows(void)
+{
+  return noofRows;
+}
+
+/***************************************************************************************************
+ * GetRow
+ *
+ * This function returns one point of the characteristic.
+ *
+ * Parameters:
+ * row - the point
+ * point - updated with the request and the learnt power
+ * loadedPower - updated with the power as loaded by Init
+ * pointWeight - updated with the information behind the point
+ *
+ * Return:
+ * true if the point exists, otherwise false
+ *
+ **************************************************************************************************/
+bool INV_LUT::GetRow(uint8_t row, invLutRowStruct_t *point, double *loadedPower,
+                     double *pointWeight)
+{
+  if (row >= noofRows)
+  {
+    return false;
+  }
+
+  *point = rows[row];
+  *loadedPower = loaded[row];
+  *pointWeight = weight[row];
+
+  return true;
+}
+
+/***************************************************************************************************
+ * Load
+ *
+ * This function replaces the power column with one learnt earlier, e.g. restored from NVR. It is
+ * only accepted if it fits the loaded table: same number of points, increasing and within
+ * maxDeviation of it.
+ *
+ * Parameters:
+ * power - the learnt power column (0.1kW units)
+ * pointWeight - the information behind each point
+ * tableRows - number of points
+ *
+ * Return:
+ * true if accepted, otherwise false
+ *
+ **************************************************************************************************/
+bool INV_LUT::Load(const double *power, const double *pointWeight, uint8_t tableRows)
+{
+  uint8_t row;
+
+  if ((0U == noofRows) || (tableRows != noofRows))
+  {
+    return false;
+  }
+
+  for (row = 0U; row < noofRows; row++)
+  {
+    if ((fabs(power[row] - loaded[row]) > maxDeviation) || (pointWeight[row] <= 0.0) ||
+        ((row > 0U) && (power[row] < (power[row - 1U] + INV_LUT_MIN_STEP))))
+    {
+      return false;
+    }
+  }
+
+  for (row = 0U; row < noofRows; row++)
+  {
+    rows[row].power = power[row];
+    weight[row] = pointWeight[row];
+  }
+  Resample();
+
+  return true;
+}
+
+/* end public functions */
@@ -0,0 +1,430 @@
+/***************************************************************************************************
+ * LutLearn
+ *
+ * This module keeps the inverter characteristic (InvLut.cpp) up to date in the field, so the
+ * feedforward stays accurate as the inverter drifts with temperature, DC voltage and firmware
+ * without a new characterisation campaign.
+ *
+ * On every meter sample in power control the command sent to the inverter and the measured power
+ * are accumulated over LUT_LEARN_WINDOW_MS. If neither moved by more than its band during the
+ * window the inverter was in steady state, and the mean pair is passed to INV_LUT::Adapt. A pair
+ * far from the present characteristic (LUT_LEARN_OUTLIER) is rejected rather than learnt, as it
+ * is more likely a derating or a fault than drift.
+ *
+ * What has been learnt is stored in NVR every LUT_LEARN_SAVE_PERIOD_MS if it has changed, and
+ * restored at start up.
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun Mcsherry
+ *
+ **************************************************************************************************/
+#include <Arduino.h>
+#include <math.h>
+#include "APP/LutLearn.h"
+#include "APP/SerialCmd.h"
+#include "HAL/HAL_NVR.h"
+
+LUT_LEARN lutLearnObj;
+
+/* private functions */
+/***************************************************************************************************
+ * Learn
+ *
+ * This function learns a steady state pair, unless it is an outlier.
+ *
+ * Parameters:
+ * command - mean command over the window (0.1kW units)
+ * power - mean measured power over the window (0.1kW units)
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void LUT_LEARN::Learn(double command, double power)
+{
+  double error;
+
+  error = power - lut->Power(command);
+
+  if (fabs(error) > (LUT_LEARN_OUTLIER * maxPower))
+  {
+    stats.outliers++;
+  }
+  else if (true == lut->Adapt(command, power))
+  {
+    stats.learnt++;
+    stats.lastError = error;
+  }
+  else
+  {
+    /* outside the characteristic */
+  }
+}
+
+/***************************************************************************************************
+ * Save
+ *
+ * This function queues the learnt characteristic to be written to NVR.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void LUT_LEARN::Save(void)
+{
+  lutLearnNvrRecordStruct_t record;
+  invLutRowStruct_t point;
+  double loadedPower;
+  double pointWeight;
+  uint8_t row;
+
+  record.version = LUT_LEARN_NVR_VERSION;
+  record.noofRows = lut->GetNoofRows();
+
+  for (row = 0U; row < INV_LUT_MAX_ROWS; row++)
+  {
+    record.power[row] = 0.0;
+    record.weight[row] = 0.0F;
+
+    if (true == lut->GetRow(row, &point, &loadedPower, &pointWeight))
+    {
+      record.power[row] = point.power;
+      record.weight[row] = (float)pointWeight;
+    }
+  }
+
+  if (true == NVR_Write(LUT_LEARN_NVR_KEY, &record, sizeof(record)))
+  {
+    for (row = 0U; row < INV_LUT_MAX_ROWS; row++)
+    {
+      savedPower[row] = record.power[row];
+    }
+  }
+}
+
+/* Public functions */
+/***************************************************************************************************
+ * Init
+ *
+ * This function restores the learnt characteristic from NVR. It should be called once at start
+ * up, after the characteristic has been loaded and before the control loop starts.
+ *
+ * Parameters:
+ * characteristic - the characteristic to learn
+ * maxRated - the maximum rated power transfer of the inverter (0.1kW units)
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void LUT_LEARN::Init(INV_LUT *characteristic, uint16_t maxRated)
+{
+  static lutLearnNvrRecordStruct_t record;
+  double weight[INV_LUT_MAX_ROWS];
+  invLutRowStruct_t point;
+  double loadedPower;
+  double pointWeight;
+  uint8_t row;
+
+  lut = characteristic;
+  maxPower = (double)maxRated;
+  lut->SetAdaptation(LUT_LEARN_FORGETTING, LUT_LEARN_MAX_DEVIATION * maxPower);
+
+  NVR_Init();
+
+  if ((true == NVR_Read(LUT_LEARN_NVR_KEY, &record, sizeof(record))) &&
+      (LUT_LEARN_NVR_VERSION == record.version) &&
+      (record.noofRows <= INV_LUT_MAX_ROWS))
+  {
+    for (row = 0U; row < INV_LUT_MAX_ROWS; row++)
+    {
+      weight[row] = (double)record.weight[row];
+    }
+
+    if (false == lut->Load(record.power, weight, (uint8_t)record.noofRows))
+    {
+      Serial.println("Stored inverter characteristic does not fit, using measured table");
+    }
+  }
+  else
+  {
+    Serial.println("No stored inverter characteristic, using measured table");
+  }
+
+  for (row = 0U; row < INV_LUT_MAX_ROWS; row++)
+  {
+    savedPower[row] = 0.0;
+
+    if (true == lut->GetRow(row, &point, &loadedPower, &pointWeight))
+    {
+      savedPower[row] = point.power;
+    }
+  }
+
+  saveTimer_ms = 0U;
+  isTiming = false;
+  Restart();
+}
+
+/***************************************************************************************************
+ * Update
+ *
+ * This function accumulates a (command, power) pair and learns the mean at the end of each steady
+ * window. It should be called on every meter sample in power control, with the command in force
+ * when the power was measured.
+ *
+ * Parameters:
+ * command - command sent to the inverter (0.1kW units)
+ * measuredPower - measured real power, positive for export (0.1kW units)
+ * sysCount - system counter
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void LUT_LEARN::Update(double command, double measuredPower, uint16_t sysCount)
+{
+  uint16_t elapsed_ms;
+  invLutRowStruct_t point;
+  double loadedPower;
+  double pointWeight;
+  uint8_t row;
+  bool isChanged = false;
+
+  if (NULL == lut)
+  {
+    return;
+  }
+
+  elapsed_ms = sysCount - oldSysCount;
+  oldSysCount = sysCount;
+
+  /* the first sample after a stop only restarts the timing */
+  if ((false == isTiming) || (elapsed_ms > LUT_LEARN_MAX_STEP_MS))
+  {
+    isTiming = true;
+    Restart();
+    return;
+  }
+
+  saveTimer_ms += elapsed_ms;
+
+  if (true == isEnabled)
+  {
+    if ((0U == windowSamples) || (command < commandMin))
+    {
+      commandMin = command;
+    }
+    if ((0U == windowSamples) || (command > commandMax))
+    {
+      commandMax = command;
+    }
+    if ((0U == windowSamples) || (measuredPower < powerMin))
+    {
+      powerMin = measuredPower;
+    }
+    if ((0U == windowSamples) || (measuredPower > powerMax))
+    {
+      powerMax = measuredPower;
+    }
+    commandSum += command;
+    powerSum += measuredPower;
+    windowSamples++;
+    window_ms += elapsed_ms;
+
+    if (((commandMax - commandMin) > (LUT_LEARN_COMMAND_BAND * maxPower)) ||
+        ((powerMax - powerMin) > (LUT_LEARN_POWER_BAND * maxPower)))
+    {
+      /* not steady - start again from this sample */
+      Restart();
+      commandMin = command;
+      commandMax = command;
+      powerMin = measuredPower;
+      powerMax = measuredPower;
+      commandSum = command;
+      powerSum = measuredPower;
+      windowSamples = 1U;
+    }
+    else if (window_ms >= LUT_LEARN_WINDOW_MS)
+    {
+      Learn(commandSum / (double)windowSamples, powerSum / (double)windowSamples);
+      Restart();
+    }
+    else
+    {
+      /* still filling the window */
+    }
+  }
+
+  if (saveTimer_ms >= LUT_LEARN_SAVE_PERIOD_MS)
+  {
+    saveTimer_ms = 0U;
+
+    for (row = 0U; row < lut->GetNoofRows(); row++)
+    {
+      if ((true == lut->GetRow(row, &point, &loadedPower, &pointWeight)) &&
+          (fabs(point.power - savedPower[row]) >= LUT_LEARN_SAVE_CHANGE))
+      {
+        isChanged = true;
+      }
+    }
+
+    if (true == isChanged)
+    {
+      Save();
+    }
+  }
+}
+
+/***************************************************************************************************
+ * Restart
+ *
+ * This function discards the window being accumulated, e.g. when the command is not a steady
+ * power control command.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void LUT_LEARN::Restart(void)
+{
+  window_ms = 0U;
+  windowSamples = 0U;
+  commandSum = 0.0;
+  powerSum = 0.0;
+  commandMin = 0.0;
+  commandMax = 0.0;
+  powerMin = 0.0;
+  powerMax = 0.0;
+}
+
+/***************************************************************************************************
+ * GetStats
+ *
+ * This function returns the learning statistics.
+ *
+ * Parameters:
+ * learnStats - updated with the statistics
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void LUT_LEARN::GetStats(lutLearnStatsStruct_t *learnStats)
+{
+  *learnStats = stats;
+}
+
+/***************************************************************************************************
+ * Command
+ *
+ * This function runs a characteristic learning command received on the serial port:
+ *   lut                        report the characteristic and the learning statistics
+ *   lut on                     learn
+ *   lut off                    stop learning, keeping what has been learnt
+ *   lut save                   store what has been learnt now
+ *   lut clr                    go back to the measured table, and store it
+ *
+ * Parameters:
+ * command - the command
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void LUT_LEARN::Command(String command)
+{
+  String action;
+  invLutRowStruct_t point;
+  double loadedPower;
+  double pointWeight;
+  int position = 0;
+  uint8_t row;
+  bool isOk = false;
+
+  if (NULL == lut)
+  {
+    Serial.println("lut rejected");
+    return;
+  }
+
+  command.trim();
+  (void)CMD_NextToken(command, &position);   /* "lut" */
+  action = CMD_NextToken(command, &position);
+
+  if (0 == action.length())
+  {
+    Serial.println("Request, measured, learnt, weight (0.1kW units):");
+
+    for (row = 0U; row < lut->GetNoofRows(); row++)
+    {
+      (void)lut->GetRow(row, &point, &loadedPower, &pointWeight);
+      Serial.print(point.command, 0);
+      Serial.print(", ");
+      Serial.print(loadedPower, 0);
+      Serial.print(", ");
+      Serial.print(point.power, 1);
+      Serial.print(", ");
+      Serial.println(pointWeight, 1);
+    }
+
+    Serial.print("Learning: ");
+    Serial.println((true == isEnabled) ? "on" : "off");
+    Serial.print("Learnt, outliers: ");
+    Serial.print(stats.learnt);
+    Serial.print(", ");
+    Serial.println(stats.outliers);
+    Serial.print("Last error (0.1kW): ");
+    Serial.println(stats.lastError, 1);
+    return;
+  }
+  else if ("on" == action)
+  {
+    isEnabled = true;
+    Restart();
+    isOk = true;
+  }
+  else if ("off" == action)
+  {
+    isEnabled = false;
+    Restart();
+    isOk = true;
+  }
+  else if ("save" == action)
+  {
+    Save();
+    isOk = true;
+  }
+  else if ("clr" == action)
+  {
+    lut->Restore();
+    stats = {0U, 0U, 0.0};
+    Restart();
+    Save();
+    isOk = true;
+  }
+  else
+  {
+    /* unknown command */
+  }
+
+  if (true == isOk)
+  {
+    Serial.println("lut ok");
+  }
+  else
+  {
+    Serial.println("lut rejected");
+  }
+}
+
+/* end public functions */
@@ -0,0 +1,679 @@
+/***************************************************************************************************
+ * MbRegMap
+ *
+ * This module maps the Modbus slave's holding registers onto the application. It is called from
+ * the slave's hold_get/hold_set callbacks, which run in the Modbus context rather than the
+ * control loop, so it only ever writes staged data that the control loop swaps in between ticks.
+ *
+ * Response curves are loaded by:
+ * 1. writing the curve id to MB_CURVE_SELECT_REG,
+ * 2. writing the number of knots and the knot pairs,
+ * 3. writing MB_CURVE_CMD_COMMIT to MB_CURVE_COMMAND_REG, then reading it back until it reports
+ *    MB_CURVE_STATUS_ACTIVE (or MB_CURVE_STATUS_REJECTED).
+ *
+ * The user test profile is loaded by writing its segments, then the number of segments and
+ * passes, and is started by writing TP_PROFILE_USER to MB_TP_RUN_REG.
+ *
+ * The trading schedule is loaded in the same way as a curve: writing the start (high word first)
+ * begins a new staged schedule, then the number of periods, ramp and period powers are written
+ * and it is committed through MB_SCHED_COMMAND_REG. The clock is set by writing MB_TIME_HI_REG,
+ * MB_TIME_LO_REG then MB_TIME_MS_REG.
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun Mcsherry
+ *
+ **************************************************************************************************/
+#include <Arduino.h>
+#include "APP/MbRegMap.h"
+#include "APP/RespCurve.h"
+#include "APP/SocMgr.h"
+#include "APP/TestProfile.h"
+#include "APP/Schedule.h"
+#include "HAL/HAL_RTC.h"
+extern "C"
+{
+  #include "Modbus/mb_error.h"
+}
+
+static_assert(MB_CURVE_MAX_KNOTS <= RESP_CURVE_MAX_KNOTS, "Modbus knot registers exceed curve");
+static_assert(MB_TP_MAX_SEGMENTS <= TP_MAX_SEGMENTS, "Modbus segment registers exceed profile");
+static_assert((MB_CURVE_KNOT_BASE_REG + (2U * MB_CURVE_MAX_KNOTS)) <= MB_TP_RUN_REG,
+              "Modbus knot registers overlap test profile registers");
+static_assert(MB_TP_SEGMENT_END_REG <= MB_SCHED_START_HI_REG,
+              "Modbus segment registers overlap schedule registers");
+static_assert(MB_SCHED_MAX_PERIODS <= SCHED_MAX_PERIODS, "Modbus period registers exceed schedule");
+
+static uint16_t generalRegs[MB_GENERAL_REGS] = {0x1234, 0x5678, 0x55AA, 0xAA55, 0U, 0U, 0U, 0U};
+static uint16_t curveSelect = (uint16_t)RESP_CURVE_DC;
+static uint16_t curveStatus = MB_CURVE_STATUS_IDLE;
+static uint16_t schedStatus = MB_CURVE_STATUS_IDLE;
+static uint16_t schedStartHi = 0U;
+static uint16_t timeHi = 0U;
+static uint16_t timeLo = 0U;
+static uint16_t timeMs = 0U;
+
+/* private functions */
+/***************************************************************************************************
+ * CurveStatusRead
+ *
+ * This function returns the loading status of the selected curve, moving on from PENDING once
+ * the control loop has swapped the table in.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * MB_CURVE_STATUS_xxx
+ *
+ **************************************************************************************************/
+static uint16_t CurveStatusRead(void)
+{
+  if ((MB_CURVE_STATUS_PENDING == curveStatus) &&
+      (false == respCurveObj[curveSelect].IsSwapPending()))
+  {
+    curveStatus = MB_CURVE_STATUS_ACTIVE;
+  }
+
+  return curveStatus;
+}
+
+/***************************************************************************************************
+ * CurveKnotRead
+ *
+ * This function reads one register of the active knot table of the selected curve.
+ *
+ * Parameters:
+ * offset - register offset from MB_CURVE_KNOT_BASE_REG
+ *
+ * Return:
+ * Register value
+ *
+ **************************************************************************************************/
+static uint16_t CurveKnotRead(uint16_t offset)
+{
+  respCurveKnotStruct_t knot;
+  int16_t value = 0;
+
+  if (true == respCurveObj[curveSelect].GetKnot((uint8_t)(offset / 2U), &knot))
+  {
+    if (0U == (offset % 2U))
+    {
+      value = (int16_t)round(knot.x * MB_CURVE_X_SCALE);
+    }
+    else
+    {
+      value = (int16_t)round(knot.y * MB_CURVE_Y_SCALE);
+    }
+  }
+
+  return (uint16_t)value;
+}
+
+/***************************************************************************************************
+ * CurveKnotWrite
+ *
+ * This function writes one register of the staged knot table of the selected curve. The
+ * frequency and power of a knot are held separately until both have been written.
+ *
+ * Parameters:
+ * offset - register offset from MB_CURVE_KNOT_BASE_REG
+ * value - register value
+ *
+ * Return:
+ * 0 if written, otherwise a Modbus exception
+ *
+ **************************************************************************************************/
+static int CurveKnotWrite(uint16_t offset, uint16_t value)
+{
+  static double knotX[MB_CURVE_MAX_KNOTS];
+  uint8_t index;
+  int error = 0;
+
+  index = (uint8_t)(offset / 2U);
+
+  if (MB_CURVE_STATUS_STAGING != curveStatus)
+  {
+    /* a curve must be selected before its knots are written */
+    error = EILLEGAL_DATA_VALUE;
+  }
+  else if (0U == (offset % 2U))
+  {
+    knotX[index] = (double)(int16_t)value / MB_CURVE_X_SCALE;
+  }
+  else if (false == respCurveObj[curveSelect].SetKnot(index, knotX[index],
+                                                       (double)(int16_t)value / MB_CURVE_Y_SCALE))
+  {
+    error = ESLAVE_DEVICE_FAILURE;
+  }
+  else
+  {
+    /* knot staged */
+  }
+
+  return error;
+}
+
+/***************************************************************************************************
+ * CurveCommandWrite
+ *
+ * This function commits or discards the staged table of the selected curve.
+ *
+ * Parameters:
+ * command - MB_CURVE_CMD_xxx
+ *
+ * Return:
+ * 0 if the command was accepted, otherwise a Modbus exception
+ *
+ **************************************************************************************************/
+static int CurveCommandWrite(uint16_t command)
+{
+  int error = 0;
+
+  if (MB_CURVE_CMD_COMMIT == command)
+  {
+    if (MB_CURVE_STATUS_STAGING != curveStatus)
+    {
+      error = EILLEGAL_DATA_VALUE;
+    }
+    else if (true == respCurveObj[curveSelect].Commit())
+    {
+      curveStatus = MB_CURVE_STATUS_PENDING;
+    }
+    else
+    {
+      curveStatus = MB_CURVE_STATUS_REJECTED;
+    }
+  }
+  else if (MB_CURVE_CMD_DISCARD == command)
+  {
+    /* the staged table is simply not committed */
+    curveStatus = MB_CURVE_STATUS_IDLE;
+  }
+  else
+  {
+    error = EILLEGAL_DATA_VALUE;
+  }
+
+  return error;
+}
+
+/***************************************************************************************************
+ * SegmentRead
+ *
+ * This function reads one register of a user test profile segment.
+ *
+ * Parameters:
+ * offset - register offset from MB_TP_SEGMENT_BASE_REG
+ *
+ * Return:
+ * Register value
+ *
+ **************************************************************************************************/
+static uint16_t SegmentRead(uint16_t offset)
+{
+  tpSegmentStruct_t segment;
+  uint16_t value = 0U;
+
+  if (true == testProfileObj.GetSegment((uint8_t)(offset / MB_TP_REGS_PER_SEGMENT), &segment))
+  {
+    switch (offset % MB_TP_REGS_PER_SEGMENT)
+    {
+      case 0U:
+        value = (uint16_t)(segment.duration_ms / MB_TP_DURATION_SCALE);
+        break;
+
+      case 1U:
+        value = (uint16_t)segment.type;
+        break;
+
+      case 2U:
+        if (TP_SEG_STEP == segment.type)
+        {
+          segment.value -= TP_START_FREQ;
+        }
+        value = (uint16_t)(int16_t)round(segment.value * MB_TP_FREQ_SCALE);
+        break;
+
+      default:
+        value = (true == segment.marker) ? 1U : 0U;
+        break;
+    }
+  }
+
+  return value;
+}
+
+/***************************************************************************************************
+ * SegmentWrite
+ *
+ * This function writes one register of a user test profile segment. The fields are held until
+ * the marker, the last register of the segment, is written.
+ *
+ * Parameters:
+ * offset - register offset from MB_TP_SEGMENT_BASE_REG
+ * value - register value
+ *
+ * Return:
+ * 0 if written, otherwise a Modbus exception
+ *
+ **************************************************************************************************/
+static int SegmentWrite(uint16_t offset, uint16_t value)
+{
+  static tpSegmentStruct_t segment[MB_TP_MAX_SEGMENTS];
+  tpSegmentStruct_t newSegment;
+  uint8_t index;
+  int error = 0;
+
+  index = (uint8_t)(offset / MB_TP_REGS_PER_SEGMENT);
+
+  switch (offset % MB_TP_REGS_PER_SEGMENT)
+  {
+    case 0U:
+      segment[index].duration_ms = (uint32_t)value * MB_TP_DURATION_SCALE;
+      break;
+
+    case 1U:
+      if (value > (uint16_t)TP_SEG_RAMP)
+      {
+        error = EILLEGAL_DATA_VALUE;
+      }
+      else
+      {
+        segment[index].type = (tpSegTypeEnum_t)value;
+      }
+      break;
+
+    case 2U:
+      segment[index].value = (double)(int16_t)value / MB_TP_FREQ_SCALE;
+      break;
+
+    default:
+      segment[index].marker = (0U != value);
+      newSegment = segment[index];
+
+      if (TP_SEG_STEP == newSegment.type)
+      {
+        newSegment.value += TP_START_FREQ;
+      }
+
+      if (false == testProfileObj.SetSegment(index, &newSegment))
+      {
+        error = EILLEGAL_DATA_VALUE;
+      }
+      break;
+  }
+
+  return error;
+}
+
+/***************************************************************************************************
+ * SchedStatusRead
+ *
+ * This function returns the loading status of the trading schedule, moving on from PENDING once
+ * the control loop has swapped the schedule in.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * MB_CURVE_STATUS_xxx
+ *
+ **************************************************************************************************/
+static uint16_t SchedStatusRead(void)
+{
+  if ((MB_CURVE_STATUS_PENDING == schedStatus) && (false == scheduleObj.IsSwapPending()))
+  {
+    schedStatus = MB_CURVE_STATUS_ACTIVE;
+  }
+
+  return schedStatus;
+}
+
+/***************************************************************************************************
+ * SchedCommandWrite
+ *
+ * This function commits or discards the staged trading schedule.
+ *
+ * Parameters:
+ * command - MB_CURVE_CMD_xxx
+ *
+ * Return:
+ * 0 if the command was accepted, otherwise a Modbus exception
+ *
+ **************************************************************************************************/
+static int SchedCommandWrite(uint16_t command)
+{
+  int error = 0;
+
+  if (MB_CURVE_CMD_COMMIT == command)
+  {
+    if (MB_CURVE_STATUS_STAGING != schedStatus)
+    {
+      error = EILLEGAL_DATA_VALUE;
+    }
+    else if (true == scheduleObj.Commit())
+    {
+      schedStatus = MB_CURVE_STATUS_PENDING;
+    }
+    else
+    {
+      schedStatus = MB_CURVE_STATUS_REJECTED;
+    }
+  }
+  else if (MB_CURVE_CMD_DISCARD == command)
+  {
+    schedStatus = MB_CURVE_STATUS_IDLE;
+  }
+  else
+  {
+    error = EILLEGAL_DATA_VALUE;
+  }
+
+  return error;
+}
+
+/***************************************************************************************************
+ * TimeRead
+ *
+ * This function reads one clock register. Reading the high word latches the rest of the time, so
+ * the three registers are read as one.
+ *
+ * Parameters:
+ * address - register address
+ *
+ * Return:
+ * Register value
+ *
+ **************************************************************************************************/
+static uint16_t TimeRead(uint16_t address)
+{
+  uint32_t seconds;
+  uint16_t value;
+
+  if (MB_TIME_HI_REG == address)
+  {
+    (void)RTC_GetTime(&seconds, &timeMs);
+    timeLo = (uint16_t)(seconds & 0xFFFFU);
+    value = (uint16_t)(seconds >> 16);
+  }
+  else if (MB_TIME_LO_REG == address)
+  {
+    value = timeLo;
+  }
+  else
+  {
+    value = timeMs;
+  }
+
+  return value;
+}
+
+/* Public functions */
+/***************************************************************************************************
+ * MB_HoldRead
+ *
+ * This function reads one holding register.
+ *
+ * Parameters:
+ * address - register address
+ * value - updated with the register value
+ *
+ * Return:
+ * 0 if read, otherwise a Modbus exception
+ *
+ **************************************************************************************************/
+extern "C" int MB_HoldRead(uint16_t address, uint16_t *value)
+{
+  int error = 0;
+
+  if (address < MB_GENERAL_REGS)
+  {
+    *value = generalRegs[address];
+  }
+  else if (MB_CURVE_SELECT_REG == address)
+  {
+    *value = curveSelect;
+  }
+  else if (MB_CURVE_NOOF_KNOTS_REG == address)
+  {
+    *value = respCurveObj[curveSelect].GetNoofKnots();
+  }
+  else if (MB_CURVE_COMMAND_REG == address)
+  {
+    *value = CurveStatusRead();
+  }
+  else if (MB_BMS_SOC_REG == address)
+  {
+    *value = (uint16_t)round(socMgrObj.GetSoc() * MB_SOC_SCALE);
+  }
+  else if ((address >= MB_CURVE_KNOT_BASE_REG) && 
+           (address < (MB_CURVE_KNOT_BASE_REG + (2U * MB_CURVE_MAX_KNOTS))))
+  {
+    *value = CurveKnotRead(address - MB_CURVE_KNOT_BASE_REG);
+  }
+  else if (MB_TP_RUN_REG == address)
+  {
+    *value = (uint16_t)testProfileObj.GetRunningId();
+  }
+  else if (MB_TP_NOOF_SEGMENTS_REG == address)
+  {
+    *value = testProfileObj.GetNoofSegments();
+  }
+  else if (MB_TP_REPEATS_REG == address)
+  {
+    *value = testProfileObj.GetRepeats();
+  }
+  else if ((address >= MB_TP_SEGMENT_BASE_REG) && (address < MB_TP_SEGMENT_END_REG))
+  {
+    *value = SegmentRead(address - MB_TP_SEGMENT_BASE_REG);
+  }
+  else if (MB_SCHED_START_HI_REG == address)
+  {
+    *value = (uint16_t)(scheduleObj.GetStart() >> 16);
+  }
+  else if (MB_SCHED_START_LO_REG == address)
+  {
+    *value = (uint16_t)(scheduleObj.GetStart() & 0xFFFFU);
+  }
+  else if (MB_SCHED_NOOF_PERIODS_REG == address)
+  {
+    *value = scheduleObj.GetNoofPeriods();
+  }
+  else if (MB_SCHED_RAMP_REG == address)
+  {
+    *value = scheduleObj.GetRamp();
+  }
+  else if (MB_SCHED_COMMAND_REG == address)
+  {
+    *value = SchedStatusRead();
+  }
+  else if ((address >= MB_TIME_HI_REG) && (address <= MB_TIME_MS_REG))
+  {
+    *value = TimeRead(address);
+  }
+  else if ((address >= MB_SCHED_POWER_BASE_REG) && (address < MB_NOOF_HOLD_REGS))
+  {
+    *value = (uint16_t)scheduleObj.GetPower((uint8_t)(address - MB_SCHED_POWER_BASE_REG));
+  }
+  else
+  {
+    /* reserved register */
+    *value = 0U;
+  }
+
+  return error;
+}
+
+/***************************************************************************************************
+ * MB_HoldWrite
+ *
+ * This function writes one holding register.
+ *
+ * Parameters:
+ * address - register address
+ * value - register value
+ *
+ * Return:
+ * 0 if written, otherwise a Modbus exception
+ *
+ **************************************************************************************************/
+extern "C" int MB_HoldWrite(uint16_t address, uint16_t value)
+{
+  int error = 0;
+
+  if (address < MB_GENERAL_REGS)
+  {
+    generalRegs[address] = value;
+  }
+  else if (MB_CURVE_SELECT_REG == address)
+  {
+    if ((value < (uint16_t)NOOF_RESP_CURVES) && (true == respCurveObj[value].BeginEdit()))
+    {
+      curveSelect = value;
+      curveStatus = MB_CURVE_STATUS_STAGING;
+    }
+    else
+    {
+      error = EILLEGAL_DATA_VALUE;
+    }
+  }
+  else if (MB_CURVE_NOOF_KNOTS_REG == address)
+  {
+    if ((MB_CURVE_STATUS_STAGING != curveStatus) ||
+        (value > MB_CURVE_MAX_KNOTS) ||
+        (false == respCurveObj[curveSelect].SetNoofKnots((uint8_t)value)))
+    {
+      error = EILLEGAL_DATA_VALUE;
+    }
+  }
+  else if (MB_CURVE_COMMAND_REG == address)
+  {
+    error = CurveCommandWrite(value);
+  }
+  else if (MB_BMS_SOC_REG == address)
+  {
+    if (value <= (uint16_t)MB_SOC_SCALE)
+    {
+      socMgrObj.SetBmsSoc(value);
+    }
+    else
+    {
+      error = EILLEGAL_DATA_VALUE;
+    }
+  }
+  else if ((address >= MB_CURVE_KNOT_BASE_REG) && 
+           (address < (MB_CURVE_KNOT_BASE_REG + (2U * MB_CURVE_MAX_KNOTS))))
+  {
+    error = CurveKnotWrite(address - MB_CURVE_KNOT_BASE_REG, value);
+  }
+  else if (MB_TP_RUN_REG == address)
+  {
+    if (false == testProfileObj.Start((tpProfileIdEnum_t)value))
+    {
+      error = EILLEGAL_DATA_VALUE;
+    }
+  }
+  else if (MB_TP_NOOF_SEGMENTS_REG == address)
+  {
+    if ((value > MB_TP_MAX_SEGMENTS) ||
+        (false == testProfileObj.SetNoofSegments((uint8_t)value)))
+    {
+      error = EILLEGAL_DATA_VALUE;
+    }
+  }
+  else if (MB_TP_REPEATS_REG == address)
+  {
+    if (false == testProfileObj.SetRepeats(value))
+    {
+      error = EILLEGAL_DATA_VALUE;
+    }
+  }
+  else if ((address >= MB_TP_SEGMENT_BASE_REG) && (address < MB_TP_SEGMENT_END_REG))
+  {
+    error = SegmentWrite(address - MB_TP_SEGMENT_BASE_REG, value);
+  }
+  else if (MB_SCHED_START_HI_REG == address)
+  {
+    if (true == scheduleObj.BeginEdit())
+    {
+      schedStartHi = value;
+      schedStatus = MB_CURVE_STATUS_STAGING;
+    }
+    else
+    {
+      error = EILLEGAL_DATA_VALUE;
+    }
+  }
+  else if (MB_SCHED_START_LO_REG == address)
+  {
+    if ((MB_CURVE_STATUS_STAGING != schedStatus) ||
+        (false == scheduleObj.SetStart(((uint32_t)schedStartHi << 16) | value)))
+    {
+      error = EILLEGAL_DATA_VALUE;
+    }
+  }
+  else if (MB_SCHED_NOOF_PERIODS_REG == address)
+  {
+    if ((MB_CURVE_STATUS_STAGING != schedStatus) ||
+        (value > MB_SCHED_MAX_PERIODS) ||
+        (false == scheduleObj.SetNoofPeriods((uint8_t)value)))
+    {
+      error = EILLEGAL_DATA_VALUE;
+    }
+  }
+  else if (MB_SCHED_RAMP_REG == address)
+  {
+    if ((MB_CURVE_STATUS_STAGING != schedStatus) || (false == scheduleObj.SetRamp(value)))
+    {
+      error = EILLEGAL_DATA_VALUE;
+    }
+  }
+  else if (MB_SCHED_COMMAND_REG == address)
+  {
+    error = SchedCommandWrite(value);
+  }
+  else if (MB_TIME_HI_REG == address)
+  {
+    timeHi = value;
+  }
+  else if (MB_TIME_LO_REG == address)
+  {
+    timeLo = value;
+  }
+  else if (MB_TIME_MS_REG == address)
+  {
+    if (value >= 1000U)
+    {
+      error = EILLEGAL_DATA_VALUE;
+    }
+    else if (false == RTC_SetTime(((uint32_t)timeHi << 16) | timeLo, value))
+    {
+      /* a previous set has not been applied yet */
+      error = ESLAVE_DEVICE_FAILURE;
+    }
+    else
+    {
+      /* applied by the RTC thread */
+    }
+  }
+  else if ((address >= MB_SCHED_POWER_BASE_REG) && (address < MB_NOOF_HOLD_REGS))
+  {
+    if ((MB_CURVE_STATUS_STAGING != schedStatus) ||
+        (false == scheduleObj.SetPower((uint8_t)(address - MB_SCHED_POWER_BASE_REG),
+                                       (int16_t)value)))
+    {
+      error = EILLEGAL_DATA_VALUE;
+    }
+  }
+  else
+  {
+    error = EILLEGAL_DATA_ADDRESS;
+  }
+
+  return error;
+}
+
+/* end public functions */
@@ -0,0 +1,372 @@
+/***************************************************************************************************
+ * MeterAgg
+ *
+ * This module aggregates the measurements from every meter on site into the single set of
+ * measurements used by the power controller:
+ * - real and reactive power are summed over all incomers,
+ * - if an incomer is stale, power is taken from the inverter terminal meter instead,
+ * - frequency (and voltages/currents) come from the preferred healthy meter, failing over to the
+ *   next in priority order.
+ *
+ * Each meter polls on its own thread, so the control loop only ever copies published data here.
+ * A new aggregate is produced whenever the selected frequency meter delivers a sample, so adding
+ * meters does not add to the latency of the primary one.
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun Mcsherry
+ *
+ **************************************************************************************************/
+#include <Arduino_MachineControl.h>
+#include "APP/MeterAgg.h"
+#include "HAL/HAL_Timer.h"
+
+/* Meters fitted on site. The Acuvim IP addresses must be on the controller's subnet. */
+#if defined SITE_SINGLE_METER
+ static const meterConfigStruct_t meterConfig[] =
+ {
+   /* IP address,          register profile,            role,                freq priority */
+   { {192, 168, 20, 140},  &ACUVIM_PROFILE_BASIC_20MS,  METER_ROLE_INCOMER,  0U }
+ };
+#elif defined SITE_GRID_AND_INVERTER_METERS
+ static const meterConfigStruct_t meterConfig[] =
+ {
+   /* IP address,          register profile,            role,                freq priority */
+   { {192, 168, 20, 140},  &ACUVIM_PROFILE_BASIC_20MS,  METER_ROLE_INCOMER,  0U },
+   { {192, 168, 20, 141},  &ACUVIM_PROFILE_FREQ_POWER,  METER_ROLE_INVERTER, 1U }
+ };
+#elif defined SITE_DUAL_INCOMER
+ static const meterConfigStruct_t meterConfig[] =
+ {
+   /* IP address,          register profile,            role,                freq priority */
+   { {192, 168, 20, 140},  &ACUVIM_PROFILE_BASIC_20MS,  METER_ROLE_INCOMER,  0U },
+   { {192, 168, 20, 142},  &ACUVIM_PROFILE_FREQ_POWER,  METER_ROLE_INCOMER,  1U }
+ };
+#endif
+
+#define NOOF_CONFIGURED_METERS  (sizeof(meterConfig) / sizeof(meterConfig[0]))
+
+#define NO_METER                0xFFU
+
+/* private functions */
+/***************************************************************************************************
+ * IsMeterHealthy
+ *
+ * This function checks whether a meter is connected, free of faults and has delivered a sample
+ * recently.
+ *
+ * Parameters:
+ * meterIndex - index of the meter in meterConfig
+ *
+ * Return:
+ * true if the meter can be used, otherwise false
+ *
+ **************************************************************************************************/
+bool METER_AGG::IsMeterHealthy(uint8_t meterIndex)
+{
+  bool isHealthy = false;
+
+  if ((true == meters[meterIndex].IsConnected()) &&
+      (false == meters[meterIndex].GetFaultState()) &&
+      (sampleAge_ms[meterIndex] < METER_STALE_MS))
+  {
+    isHealthy = true;
+  }
+
+  return isHealthy;
+}
+
+/***************************************************************************************************
+ * SelectFreqMeter
+ *
+ * This function selects the healthy meter with the best (lowest) frequency priority.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * Index of the selected meter, or NO_METER if none are healthy
+ *
+ **************************************************************************************************/
+uint8_t METER_AGG::SelectFreqMeter(void)
+{
+  uint8_t meterIndex;
+  uint8_t selected = NO_METER;
+
+  for (meterIndex = 0U; meterIndex < noofMeters; meterIndex++)
+  {
+    if (true == IsMeterHealthy(meterIndex))
+    {
+      if ((NO_METER == selected) ||
+          (meterConfig[meterIndex].freqPriority < meterConfig[selected].freqPriority))
+      {
+        selected = meterIndex;
+      }
+    }
+  }
+
+  return selected;
+}
+
+/***************************************************************************************************
+ * AggregatePower
+ *
+ * This function sums real and reactive power over all incomers. If any incomer is stale the
+ * inverter terminal meter is used instead.
+ *
+ * Parameters:
+ * measurements - measurement structure to update with the aggregated power
+ *
+ * Return:
+ * true if a valid power measurement is available, otherwise false
+ *
+ **************************************************************************************************/
+bool METER_AGG::AggregatePower(acuvimBasicMeasurement20ms_t *measurements)
+{
+  uint8_t meterIndex;
+  double realSum = 0.0;
+  double reactiveSum = 0.0;
+  bool isIncomerSumValid = true;
+  uint8_t noofIncomers = 0U;
+  uint8_t inverterMeter = NO_METER;
+  bool isPowerValid = false;
+
+  for (meterIndex = 0U; meterIndex < noofMeters; meterIndex++)
+  {
+    switch (meterConfig[meterIndex].role)
+    {
+      case METER_ROLE_INCOMER:
+        noofIncomers++;
+        if (true == IsMeterHealthy(meterIndex))
+        {
+          realSum += latest[meterIndex].totalPowerReal;
+          reactiveSum += latest[meterIndex].totalPowerReactive;
+        }
+        else
+        {
+          isIncomerSumValid = false;
+        }
+        break;
+
+      case METER_ROLE_INVERTER:
+        if ((NO_METER == inverterMeter) && (true == IsMeterHealthy(meterIndex)))
+        {
+          inverterMeter = meterIndex;
+        }
+        break;
+
+      default:
+        /* power not used */
+        break;
+    }
+  }
+
+  if ((noofIncomers > 0U) && (true == isIncomerSumValid))
+  {
+    measurements->totalPowerReal = realSum;
+    measurements->totalPowerReactive = reactiveSum;
+    isPowerValid = true;
+  }
+  else if (NO_METER != inverterMeter)
+  {
+    measurements->totalPowerReal = latest[inverterMeter].totalPowerReal;
+    measurements->totalPowerReactive = latest[inverterMeter].totalPowerReactive;
+    isPowerValid = true;
+  }
+  else
+  {
+    /* no complete power measurement */
+  }
+
+  return isPowerValid;
+}
+
+/* Public functions */
+/***************************************************************************************************
+ * Init
+ *
+ * This function starts every meter configured for the site.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void METER_AGG::Init(void)
+{
+  uint8_t meterIndex;
+
+  noofMeters = (uint8_t)NOOF_CONFIGURED_METERS;
+
+  if (noofMeters > MAX_NOOF_METERS)
+  {
+    noofMeters = MAX_NOOF_METERS;
+  }
+
+  for (meterIndex = 0U; meterIndex < noofMeters; meterIndex++)
+  {
+    sampleAge_ms[meterIndex] = UINT16_MAX;
+    meters[meterIndex].Init(IPAddress(meterConfig[meterIndex].ipAddress[0],
+                                      meterConfig[meterIndex].ipAddress[1],
+                                      meterConfig[meterIndex].ipAddress[2],
+                                      meterConfig[meterIndex].ipAddress[3]),
+                            meterConfig[meterIndex].profile);
+  }
+
+  freqMeter = NO_METER;
+}
+
+/***************************************************************************************************
+ * Control
+ *
+ * This function should be called every 1ms. It collects any samples published by the meters,
+ * ages those that have not reported, and produces a new aggregate whenever the selected
+ * frequency meter delivers a sample.
+ *
+ * Parameters:
+ * measurements - pointer to measurement structure.
+ *
+ * Return:
+ * true if new set of measurements available, otherwise false.
+ *
+ **************************************************************************************************/
+bool METER_AGG::Control(acuvimBasicMeasurement20ms_t *measurements)
+{
+  uint8_t meterIndex;
+  bool isNewSample[MAX_NOOF_METERS];
+  bool isNewData = false;
+  acuvimBasicMeasurement20ms_t aggregate;
+
+  for (meterIndex = 0U; meterIndex < noofMeters; meterIndex++)
+  {
+    isNewSample[meterIndex] = meters[meterIndex].Control(&latest[meterIndex]);
+
+    if (true == isNewSample[meterIndex])
+    {
+      sampleAge_ms[meterIndex] = 0U;
+    }
+    else if (sampleAge_ms[meterIndex] < UINT16_MAX)
+    {
+      sampleAge_ms[meterIndex]++;
+    }
+  }
+
+  /* fail over to the next meter in priority order as soon as the preferred one goes stale */
+  freqMeter = SelectFreqMeter();
+
+  if ((NO_METER != freqMeter) && (true == isNewSample[freqMeter]))
+  {
+    aggregate = latest[freqMeter];
+
+    if (true == AggregatePower(&aggregate))
+    {
+      *measurements = aggregate;
+      isNewData = true;
+    }
+  }
+
+  return isNewData;
+}
+
+/***********************************************************************************************
+ * GetFaultState
+ *
+ * This function is called to determine whether there is a fault on every meter, preventing
+ * any measurements being provided.
+ *
+ * Parameters:
+ * None.
+ *
+ * Return:
+ * true if fault present on all meters, otherwise false.
+ *
+ **********************************************************************************************/
+bool METER_AGG::GetFaultState(void)
+{
+  uint8_t meterIndex;
+  bool fault = true;
+
+  for (meterIndex = 0U; meterIndex < noofMeters; meterIndex++)
+  {
+    if (false == meters[meterIndex].GetFaultState())
+    {
+      fault = false;
+    }
+  }
+
+  return fault;
+}
+
+/***********************************************************************************************
+ * GetFrequency
+ *
+ * This function returns the latest frequency from the meter configured with the given frequency
+ * priority, for use as an independent frequency source.
+ *
+ * Parameters:
+ * freqPriority - frequency priority of the meter in meterConfig
+ * frequency - updated with the meter's latest frequency
+ *
+ * Return:
+ * true if the meter is healthy, otherwise false.
+ *
+ **********************************************************************************************/
+bool METER_AGG::GetFrequency(uint8_t freqPriority, double *frequency)
+{
+  uint8_t meterIndex;
+  bool isValid = false;
+
+  for (meterIndex = 0U; meterIndex < noofMeters; meterIndex++)
+  {
+    if ((freqPriority == meterConfig[meterIndex].freqPriority) &&
+        (true == IsMeterHealthy(meterIndex)))
+    {
+      *frequency = latest[meterIndex].frequency;
+      isValid = true;
+    }
+  }
+
+  return isValid;
+}
+
+/***********************************************************************************************
+ * GetFrequencySample
+ *
+ * This function returns the latest frequency, and its age, from the meter configured with the
+ * given frequency priority. Unlike GetFrequency, the staleness of the sample is left for the
+ * caller to judge.
+ *
+ * Parameters:
+ * freqPriority - frequency priority of the meter in meterConfig
+ * frequency - updated with the meter's latest frequency
+ * age_ms - updated with the time since the meter delivered the sample
+ *
+ * Return:
+ * true if the meter is connected and free of faults, otherwise false.
+ *
+ **********************************************************************************************/
+bool METER_AGG::GetFrequencySample(uint8_t freqPriority, double *frequency, uint16_t *age_ms)
+{
+  uint8_t meterIndex;
+  bool isValid = false;
+
+  for (meterIndex = 0U; meterIndex < noofMeters; meterIndex++)
+  {
+    if ((freqPriority == meterConfig[meterIndex].freqPriority) &&
+        (true == meters[meterIndex].IsConnected()) &&
+        (false == meters[meterIndex].GetFaultState()))
+    {
+      *frequency = latest[meterIndex].frequency;
+      *age_ms = sampleAge_ms[meterIndex];
+      isValid = true;
+    }
+  }
+
+  return isValid;
+}
+
+/* end public functions */
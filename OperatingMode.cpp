@@ -13,29 +13,37 @@
  **************************************************************************************************/
 #include <Arduino_MachineControl.h>
 #include "APP/OperatingMode.h"
+#include "APP/RespCurve.h"
+#include "APP/Rocof.h"
 
 using namespace machinecontrol;
 
 #define DC_FREQ_NOMINAL            50     // in Hz
-#define DC_DEADBAND_FREQ_DEV_LIM   0.015F // deadband if frequency deviation between 
-                                          // -0.015 and +0.015 */
-#define DC_SMALL_DEL_FREQ_DEV_LIM  0.2F   // small power delivery if frequency deviation between 
-                                          // -0.2 to -0.015 and between +0.015 to 0.2.
-                                          // large power delivery if frequency deviation between 
-                                          // -0.5 to -0.2 and between +0.2 to 0.5 */
-#define DC_MAX_FREQ_DEV             0.5F
-#define MAX_FRACTION_SMALL_DELIVERY 0.05F
-#define MAX_FRACTION_LARGE_DELIVERY 1.0F
-
-#define LARGE_DELIVERY_SLOPE  ((MAX_FRACTION_LARGE_DELIVERY - MAX_FRACTION_SMALL_DELIVERY) / \
-                               (DC_MAX_FREQ_DEV - DC_SMALL_DEL_FREQ_DEV_LIM))
-
-#define SMALL_DELIVERY_SLOPE  ((MAX_FRACTION_SMALL_DELIVERY) / \
-                               (DC_SMALL_DEL_FREQ_DEV_LIM - DC_DEADBAND_FREQ_DEV_LIM))
-
-#define FREQ_BUFFER_SIZE           18U
-
 #define DC_THREE_HUNDRED_MS        300U  // Used as a 300ms counter in 1ms intervals */
+#define DC_DELAY_MS                340U  // frequency delay
+
+/* DM: initial delay <= 0.5s, full delivery <= 1s */
+#define DM_DELAY_MS                340U
+#define DM_RAMP_MS                 300U
+
+/* DR: initial delay <= 2s, full delivery <= 10s */
+#define DR_DELAY_MS                1000U
+#define DR_RAMP_MS                 8000U
+
+/* FFR service defaults - comment out FFR_STATIC_SERVICE to provide dynamic FFR */
+//#define FFR_STATIC_SERVICE
+#define FFR_STATIC_TRIGGER_FREQ    49.7F    // in Hz
+#define FFR_STATIC_REARM_FREQ      49.8F    // in Hz, static FFR re-arms above this frequency
+#define FFR_DYNAMIC_DEADBAND       0.015F   // in Hz
+#define FFR_DYNAMIC_DROOP          0.485F   // in Hz, full power at 0.5Hz deviation
+#define FFR_DELIVERY_MS            10000UL  // primary response, full power within 10s
+#define FFR_SUSTAIN_MS             1800000UL// 30 minutes
+#define FFR_DELAY_MS               0U
+
+/* DS3 reserve defaults */
+#define DS3_TRIGGER_FREQ           49.8F    // in Hz
+#define DS3_REARM_FREQ             49.9F    // in Hz, products re-arm above this frequency
+#define DS3_RAMP_DOWN_MS           10000UL  // time to withdraw full power once a window ends
 
 #define PID_TEST_INTERVAL          2000U // in ms
 #define PID_TEST_LOW               -10000     // in 0.1 kW units
@@ -43,159 +51,104 @@ using namespace machinecontrol;
 
 #define PID_TEST2_VALUE            5000  // in 0.1 kW units
 
-//#define DC_TEST_1_1
-//#define DC_TEST_1_2
-//#define DC_TEST_1_3
-//#define DC_TEST_1_4
-//#define DC_TEST_1_5
-//#define DC_TEST_1_6
-//#define DC_TEST_1_7
-//#define DC_TEST_1_8
-//#define DC_TEST_1_9
-//#define DC_TEST_1_10
-//#define DC_TEST_1_11
-//#define DC_TEST_1_12
-#define DC_TEST_1_13
-//#define DC_TEST_1_14
-
 double maxDeliveryPower = 0.0F;
 
-/* private functions */
-/***************************************************************************************************
- * UpdateHeadTail
- * 
- * This function increments the value of a ring buffer head pointer and resets to zero if overflow.
- * It also returns the tail pointer, reset to zero if overflowed.
- *
- * Parameters:
- * 
- *
- * Return:
- * Power demand
- *
- **************************************************************************************************/
-uint16_t OP_MODE::UpdateHeadTail(uint16_t *headIndex, uint16_t maxIndex)
+#ifdef FFR_STATIC_SERVICE
+ const ffrConfigStruct_t FFR_DEFAULT_CONFIG =
+ {
+   FFR_STATIC, 0.0, FFR_STATIC_TRIGGER_FREQ, 0.0, 0.0, FFR_DELIVERY_MS, FFR_SUSTAIN_MS, FFR_DELAY_MS
+ };
+#else
+ const ffrConfigStruct_t FFR_DEFAULT_CONFIG =
+ {
+   FFR_DYNAMIC, 0.0, 0.0, FFR_DYNAMIC_DEADBAND, FFR_DYNAMIC_DROOP, FFR_DELIVERY_MS, FFR_SUSTAIN_MS,
+   FFR_DELAY_MS
+ };
+#endif
+
+static const dynServiceConfigStruct_t DYN_SERVICE_CONFIG[NOOF_DYN_SERVICES] =
 {
-  uint16_t tailIndex;
-
-  *headIndex = *headIndex + 1U;
-
-  if(*headIndex >= maxIndex)
-  {
-    *headIndex = 0U;
-  }
-  
-  tailIndex = *headIndex + 1; // Point to oldest value
-  
-  if(tailIndex >= FREQ_BUFFER_SIZE)
-  {
-    tailIndex = 0U;
-  }  
+  /* response curve, delay (ms),  ramp (ms) */
+  { RESP_CURVE_DC,   DC_DELAY_MS, DC_THREE_HUNDRED_MS },   /* DC */
+  { RESP_CURVE_DM,   DM_DELAY_MS, DM_RAMP_MS          },   /* DM */
+  { RESP_CURVE_DR,   DR_DELAY_MS, DR_RAMP_MS          }    /* DR */
+};
 
-  return tailIndex;
-}
+const ds3ProductConfigStruct_t DS3_DEFAULT_CONFIG[NOOF_DS3_PRODUCTS] =
+{
+  /* volume, trigger freq,       RoCoF trigger, response (ms), sustain end (ms) */
+  { 1.0,     DS3_TRIGGER_FREQ,   true,          2000UL,        10000UL   },   /* FFR */
+  { 1.0,     DS3_TRIGGER_FREQ,   true,          5000UL,        15000UL   },   /* POR */
+  { 1.0,     DS3_TRIGGER_FREQ,   false,         15000UL,       90000UL   },   /* SOR */
+  { 1.0,     DS3_TRIGGER_FREQ,   false,         90000UL,       300000UL  },   /* TOR1 */
+  { 1.0,     DS3_TRIGGER_FREQ,   false,         300000UL,      1200000UL }    /* TOR2 */
+};
 
+/* private functions */
 /***************************************************************************************************
- * DC_SmallDelivery
+ * InitRamp
  * 
- * This function calculates the power demand for frequency changes that fall into the small
- * power delivery band.
+ * This function resets a power demand ramp to zero.
  *
  * Parameters:
- * freqDev - frequency deviation from nominal grid frequency
- * maxPowKw - maximum rated power demand of inverter.
+ * ramp - the ramp
  *
  * Return:
- * Power demand in kW
+ * None
  *
  **************************************************************************************************/
-uint16_t OP_MODE::DC_SmallDelivery (double freqDev)
+void OP_MODE::InitRamp(modeRampStruct_t *ramp)
 {
-  uint16_t smallPowerDemand;
-  double powerFraction; 
-  double freqDevOffset;
-
-  /* Limit frequency devation */
-  if(freqDev > DC_SMALL_DEL_FREQ_DEV_LIM)
-  {
-    freqDev = DC_SMALL_DEL_FREQ_DEV_LIM;    
-  }
-
-  freqDevOffset = freqDev - DC_DEADBAND_FREQ_DEV_LIM;
-
-  powerFraction = (SMALL_DELIVERY_SLOPE * freqDevOffset);  //y=a+bx 
-
-  /* Calculated value should be within limits, but limit it just in case */
-  if(powerFraction < 0)
-  {
-    powerFraction = 0;
-  }
-  else if (powerFraction > MAX_FRACTION_SMALL_DELIVERY)
-  {
-    powerFraction = MAX_FRACTION_SMALL_DELIVERY;
-  }
-  else
-  {
-    /* leave unchanged as it is within limits */
-  }
-
-  /* calculate power demand and round up/down */
-  smallPowerDemand =  int16_t((powerFraction * maxDeliveryPower) + 0.5F);
-
-  return smallPowerDemand;
+  ramp->target = 0;
+  ramp->demand = 0;
+  ramp->ratePer_ms = 0.0;
+  ramp->oldSysCount = 0U;
+  ramp->isRamping = false;
 }
 
 /***************************************************************************************************
- * DC_LargeDelivery
+ * RampDemand
  * 
- * This function calculates the power demand for frequency changes that fall into the large
- * power delivery band.
+ * This function moves a ramp's power demand towards its target at the ramp's rate, using the
+ * time elapsed since it was last called.
  *
  * Parameters:
- * freqDev - frequency deviation from nominal grid frequency
+ * ramp - the ramp, with target and ratePer_ms set by the operating mode
+ * sysCount - system counter
  *
  * Return:
- * Power demand in kW
+ * The updated power demand
  *
  **************************************************************************************************/
-uint16_t OP_MODE::DC_LargeDelivery (double freqDev)
+int16_t OP_MODE::RampDemand(modeRampStruct_t *ramp, uint16_t sysCount)
 {
-  uint16_t largePowerDemand;
-  double powerFraction; 
-  double freqDevOffset;
-
-  /* Limit frequency devation */
-  if(freqDev > DC_MAX_FREQ_DEV)
-  {
-    freqDev = DC_MAX_FREQ_DEV;    
-  }
-
-  freqDevOffset = freqDev - DC_SMALL_DEL_FREQ_DEV_LIM; 
-
-  powerFraction = MAX_FRACTION_SMALL_DELIVERY + (LARGE_DELIVERY_SLOPE * freqDevOffset);  //y=a+bx 
+  uint16_t rampTime;
+  int16_t newPowerDemand;
 
-  /* Calculated value should be within limits, but limit it just in case */
-  if(powerFraction < MAX_FRACTION_SMALL_DELIVERY)
-  {
-    powerFraction = MAX_FRACTION_SMALL_DELIVERY;
-  }
-  else if (powerFraction > MAX_FRACTION_LARGE_DELIVERY)
+  if(true == ramp->isRamping)
   {
-    powerFraction = MAX_FRACTION_LARGE_DELIVERY;
+    /* if output is ramping to new demand, get the elapsed time since the last ramp demand */
+    rampTime = sysCount - ramp->oldSysCount;
   }
   else
   {
-    /* leave unchanged as it is within limits */
+    rampTime = 0U;
   }
 
-  /* calculate power demand and round up/down */
-  largePowerDemand =  int16_t((powerFraction * maxDeliveryPower) + 0.5F);
+  ramp->isRamping = RampPowerDemand(ramp->target, 
+                                    ramp->demand, 
+                                    &newPowerDemand, 
+                                    rampTime, 
+                                    ramp->ratePer_ms);
+
+  ramp->oldSysCount = sysCount;
+  ramp->demand = newPowerDemand;
 
-  return largePowerDemand;
+  return newPowerDemand;
 }
 
 /***************************************************************************************************
- * DC_RampPowerDemand
+ * RampPowerDemand
  * 
  * This function adjusts the current power demand towards the target at a rate not exceeding the
  * target power.
@@ -208,11 +161,11 @@ uint16_t OP_MODE::DC_LargeDelivery (double freqDev)
  * The updated power demand with ramp rate applied
  *
  **************************************************************************************************/
-bool OP_MODE::DC_RampPowerDemand(int16_t target, 
-                                 int16_t oldDemand, 
-                                 int16_t *newDemand, 
-                                 uint16_t rampTime, 
-                                 double rampRatePer_ms)
+bool OP_MODE::RampPowerDemand(int16_t target, 
+                              int16_t oldDemand, 
+                              int16_t *newDemand, 
+                              uint16_t rampTime, 
+                              double rampRatePer_ms)
 {
   int16_t error;
   int16_t absError;
@@ -240,417 +193,617 @@ bool OP_MODE::DC_RampPowerDemand(int16_t target,
 }
 
 /***************************************************************************************************
- * UpdatePowerTarget
+ * Dyn_UpdatePowerTarget
  * 
- * This function adjusts the current power demand based on the frequency deviation from the
- * nominal.
+ * This function calculates the power demand for a frequency deviation from the nominal, using
+ * a dynamic service's response curve.
  *
  * Parameters:
+ * curve - the service's response curve
  * freqDiff - the deviation from the nominal frequency.
  *
  * Return:
  * The target power demand.
  *
  **************************************************************************************************/
-int16_t OP_MODE::DC_UpdatePowerTarget(double freqDiff)
+int16_t OP_MODE::Dyn_UpdatePowerTarget(respCurveIdEnum_t curve, double freqDiff)
 {
-  double absFreqDeviation;
-  int16_t targetPower;
+  double powerFraction;
 
-  absFreqDeviation = fabs(freqDiff);
+  /* the curve is negative above nominal, i.e. take power from grid to charge batteries */
+  powerFraction = respCurveObj[curve].Evaluate(freqDiff);
+
+  /* calculate power demand and round up/down */
+  return (int16_t)floor((powerFraction * maxDeliveryPower) + 0.5F);
+}
+
+/***************************************************************************************************
+ * Dyn_Control
+ * 
+ * This function implements the dynamic services (DC, DM and DR). It should be called on every
+ * meter sample. Every service's delay line is fed on every call so that any of them can take over at
+ * once. When the requested service changes, the new service's ramp starts from the power demand
+ * of the old one, so the change is bumpless and needs no STOP/INIT cycle.
+ *
+ * Parameters:
+ * service - the requested service
+ * frequency - the most current measured frequency
+ * sysCount - system counter
+ *
+ * Return:
+ * Power demand
+ *
+ **************************************************************************************************/
+int16_t OP_MODE::Dyn_Control(dynServiceEnum_t service, double frequency, uint16_t sysCount)
+{
+  uint8_t index;
+  uint32_t now_ms;
+  double freqDelayed[NOOF_DYN_SERVICES];
+  double freqDeviation;
+  dynServiceStateStruct_t *state = &dynState[service];
+  const dynServiceConfigStruct_t *config = &DYN_SERVICE_CONFIG[service];
 
-  if (absFreqDeviation <= DC_DEADBAND_FREQ_DEV_LIM)
+  now_ms = millis();
+
+  for (index = 0U; index < NOOF_DYN_SERVICES; index++)
   {
-    targetPower = 0;
+    dynState[index].delay.Push(now_ms, frequency);
+    freqDelayed[index] = dynState[index].delay.Read(now_ms);
   }
-  else if(absFreqDeviation <= DC_SMALL_DEL_FREQ_DEV_LIM)
+
+  if (service != dynActive)
   {
-    targetPower = (int16_t)DC_SmallDelivery(absFreqDeviation);
+    /* hand over from the old service's demand */
+    state->ramp = dynState[dynActive].ramp;
+    state->isTargetValid = false;
+    dynActive = service;
+    Serial.print("Dynamic service: ");
+    Serial.println(service);
   }
-  else
+
+  delayedFreq = freqDelayed[service];
+  freqDeviation = delayedFreq - DC_FREQ_NOMINAL;
+
+  /* if frequency deviation is less than 0.01Hz treat this as no change from previous
+     time when it was >= 0.01Hz */
+  if((false == state->isTargetValid) || (fabs(freqDeviation - state->oldFreqDeviation) >= 0.01))
   {
-    /* frequency deviation requires large power delivery */
-    targetPower = (int16_t)DC_LargeDelivery(absFreqDeviation);    
+    /* >= 0.01Hz, so update oldFreqDeviation */
+    state->oldFreqDeviation = freqDeviation;
+    state->isTargetValid = true;
+    state->ramp.target = Dyn_UpdatePowerTarget(config->curve, freqDeviation);
+    state->ramp.ratePer_ms = (double)(state->ramp.target - state->ramp.demand) / 
+                             (double)config->ramp_ms; 
   }
-
-  /* Take power from grid to charge batteries if frequency above nominal, i.e. negative demand */
-  if(freqDiff > 0.0F)
+  else
   {
-    targetPower *= -1;  
+    /* target is static, so use last calculated value */
   }
 
-  return targetPower;
+  return RampDemand(&state->ramp, sysCount);
 }
 
 /***************************************************************************************************
- * DC_Test_1_1
+ * FFR_UpdatePowerTarget
  * 
- * This function simulates Test 1.1 of National Grid DC spec. It should be called every 20ms.
+ * This function runs the FFR delivery state machine and returns the target power.
+ * Static FFR delivers the contracted power once frequency falls to the trigger. Dynamic FFR
+ * delivers power in proportion to the deviation outside the deadband, reaching the contracted
+ * power at deadband + droop. Delivery is limited to the sustain time, after which the target
+ * returns to zero until frequency has recovered.
  *
  * Parameters:
- * None
+ * frequency - the delayed frequency
+ * contractedPower - the power for a full response (0.1kW units)
+ * elapsed_ms - time since the last call
  *
  * Return:
- * Frequency in Hz
+ * The target power demand.
  *
  **************************************************************************************************/
-double OP_MODE::DC_Test_1_1(void)
+int16_t OP_MODE::FFR_UpdatePowerTarget(double frequency, double contractedPower, uint16_t elapsed_ms)
 {
-  static uint16_t dcTestCount = 0U;
-  static double testFreq = 50.00;
+  double freqDiff;
+  double absFreqDeviation;
+  double powerFraction = 0.0;
+  bool isTriggered;
+  bool isRecovered;
+  int16_t targetPower = 0;
 
-  dcTestCount++;
+  freqDiff = frequency - DC_FREQ_NOMINAL;
+  absFreqDeviation = fabs(freqDiff);
 
-  if (50U == dcTestCount)
+  if (FFR_STATIC == ffrConfig.type)
   {
-    testFreq = 50.01;
-    digital_outputs.set(1, HIGH); 
+    isTriggered = (frequency <= ffrConfig.triggerFreq);
+    isRecovered = (frequency >= FFR_STATIC_REARM_FREQ);
+    powerFraction = 1.0;
   }
-
-  if(dcTestCount >= 100U)
+  else
   {
-    dcTestCount = 0U;
-    testFreq = 50.00;
-    digital_outputs.set(1, LOW);
+    isTriggered = (absFreqDeviation > ffrConfig.deadband);
+    isRecovered = !isTriggered;
+    powerFraction = (absFreqDeviation - ffrConfig.deadband) / ffrConfig.droop;
+
+    if (powerFraction > 1.0)
+    {
+      powerFraction = 1.0;
+    }
+    else if (powerFraction < 0.0)
+    {
+      powerFraction = 0.0;
+    }
+    else
+    {
+      /* within limits */
+    }
   }
 
-  return testFreq;
+  switch (ffrState)
+  {
+    case FFR_ARMED:
+      if (true == isTriggered)
+      {
+        ffrDeliveryTime_ms = 0U;
+        ffrState = FFR_DELIVERING;
+      }
+      break;
+
+    case FFR_DELIVERING:
+      ffrDeliveryTime_ms += elapsed_ms;
+
+      if (ffrDeliveryTime_ms >= ffrConfig.sustain_ms)
+      {
+        ffrState = FFR_RECOVERING;
+        Serial.println("FFR sustain time expired");
+      }
+      else if ((FFR_DYNAMIC == ffrConfig.type) && (false == isTriggered))
+      {
+        /* dynamic response ends when frequency returns inside the deadband */
+        ffrState = FFR_ARMED;
+      }
+      else
+      {
+        /* continue delivering */
+      }
+      break;
+
+    case FFR_RECOVERING:
+      if (true == isRecovered)
+      {
+        ffrState = FFR_ARMED;
+      }
+      break;
+
+    default:
+      ffrState = FFR_ARMED;
+      break;
+  }
+
+  if (FFR_DELIVERING == ffrState)
+  {
+    targetPower = (int16_t)((powerFraction * contractedPower) + 0.5F);
+
+    /* Take power from grid to charge batteries if frequency above nominal, i.e. negative demand */
+    if (freqDiff > 0.0F)
+    {
+      targetPower *= -1;
+    }
+  }
+
+  return targetPower;
 }
 
 /***************************************************************************************************
- * DC_Test_1_2
+ * DS3_UpdateProduct
  * 
- * This function simulates Test 1.2 of National Grid DC spec. It should be called every 20ms.
+ * This function tracks one DS3 product through an event. Once triggered, the product's power
+ * rises linearly to its volume by the response time and is held until the end of its window.
+ * It then re-arms once frequency has recovered. A product triggered by RoCoF is timed from the
+ * start of the RoCoF window, so it already asks for power at the trigger.
  *
  * Parameters:
- * None
+ * product - the DS3 product
+ * isRocofEvent - true if there is a falling RoCoF event
+ * frequency - the most current measured frequency
+ * elapsed_ms - time since the last call
  *
  * Return:
- * Frequency in Hz
+ * The product's power demand (0.1kW units)
  *
  **************************************************************************************************/
-double OP_MODE::DC_Test_1_2(void)
+double OP_MODE::DS3_UpdateProduct(ds3ProductEnum_t product, bool isRocofEvent, double frequency, 
+                                  uint16_t elapsed_ms)
 {
-  static uint16_t dcTestCount = 0U;
-  static double testFreq = 50.00;
-
-  dcTestCount++;
+  ds3ProductConfigStruct_t *config = &ds3Config[product];
+  ds3ProductStatusStruct_t *status = &ds3Status[product];
+  double powerFraction;
+  double powerDemand = 0.0;
+  bool isRocofTrigger;
 
-  if (50U == dcTestCount)
+  switch (status->state)
   {
-    testFreq = 49.99;
-    digital_outputs.set(1, LOW); 
+    case DS3_ARMED:
+      isRocofTrigger = ((true == config->isRocofTriggered) && (true == isRocofEvent));
+
+      if ((config->volume > 0.0) && 
+          ((frequency <= config->triggerFreq) || (true == isRocofTrigger)))
+      {
+        status->elapsed_ms = 0U;
+        status->state = DS3_ACTIVE;
+
+        if (true == isRocofTrigger)
+        {
+          status->elapsed_ms = rocofObj.GetEventAge();
+
+          if (status->elapsed_ms > config->response_ms)
+          {
+            status->elapsed_ms = config->response_ms;
+          }
+        }
+      }
+      break;
+
+    case DS3_ACTIVE:
+      status->elapsed_ms += elapsed_ms;
+
+      if (status->elapsed_ms >= config->sustainEnd_ms)
+      {
+        status->state = DS3_COMPLETE;
+      }
+      break;
+
+    case DS3_COMPLETE:
+      if (frequency >= DS3_REARM_FREQ)
+      {
+        status->state = DS3_ARMED;
+      }
+      break;
+
+    default:
+      status->state = DS3_ARMED;
+      break;
   }
 
-  if(dcTestCount >= 100U)
+  if (DS3_ACTIVE == status->state)
   {
-    dcTestCount = 0U;
-    testFreq = 50.00;
-    digital_outputs.set(1, HIGH);
+    powerFraction = (double)status->elapsed_ms / (double)config->response_ms;
+
+    if (powerFraction > 1.0)
+    {
+      powerFraction = 1.0;
+    }
+
+    powerDemand = powerFraction * config->volume * maxDeliveryPower;
   }
 
-  return testFreq;
+  return powerDemand;
 }
 
+/* Public functions */
 /***************************************************************************************************
- * DC_Test_1_5
+ * Init
  * 
- * This function simulates Test 1.5 of National Grid DC spec. It should be called every 20ms.
+ * This function initialises power limits, delay lines and ramps for every operating mode.
  *
  * Parameters:
- * None
+ * maxPower - the maximum rated power transfer of the inverter
  *
  * Return:
- * Frequency in Hz
+ * None
  *
  **************************************************************************************************/
-double OP_MODE::DC_Test_1_5(void)
+void OP_MODE::Init(uint16_t maxPower)
 {
-  static uint16_t dcTestCount = 0U;
-  static double testFreq = 50.00;
-
-  dcTestCount++;
+  maxDeliveryPower = (double)maxPower;
 
-  if (50U == dcTestCount)
+  for (uint8_t service = 0U; service < NOOF_DYN_SERVICES; service++)
   {
-    testFreq = 50.10;
-    digital_outputs.set(1, HIGH); 
+    dynState[service].delay.Init(DYN_SERVICE_CONFIG[service].delay_ms, DC_FREQ_NOMINAL);
+    InitRamp(&dynState[service].ramp);
+    dynState[service].oldFreqDeviation = 0.0;
+    dynState[service].isTargetValid = false;
   }
+  dynActive = DYN_SERVICE_DC;
+
+  ffrDelay.Init(ffrConfig.delay_ms, DC_FREQ_NOMINAL);
+  InitRamp(&ffrRamp);
+  ffrState = FFR_ARMED;
+  ffrDeliveryTime_ms = 0U;
 
-  if(dcTestCount >= 100U)
+  InitRamp(&ds3Ramp);
+  for (uint8_t product = 0U; product < NOOF_DS3_PRODUCTS; product++)
   {
-    dcTestCount = 0U;
-    testFreq = 50.0;
-    digital_outputs.set(1, LOW);
+    ds3Status[product].state = DS3_ARMED;
+    ds3Status[product].elapsed_ms = 0U;
   }
-
-  return testFreq;
 }
 
 /***************************************************************************************************
- * DC_Test_1_7
+ * DC_Control
  * 
- * This function simulates Test 1.7 of National Grid DC spec. It should be called every 20ms.
+ * This function implements Dynamic Containment. It should be called once every 20ms.
+ * The specification for DC states that power response to frequency changes must be delayed between
+ * 250 to 500ms. In order to achieve this, measured frequency is held in a delay line and the
+ * delayed value is used to provide the required power response.
  *
  * Parameters:
- * None
+ * frequency - the most current measured frequency
+ * sysCount - system counter
  *
  * Return:
- * Frequency in Hz
+ * Power demand
  *
  **************************************************************************************************/
-double OP_MODE::DC_Test_1_7(void)
+int16_t OP_MODE::DC_Control(double frequency, uint16_t sysCount)
 {
-  static uint16_t dcTestCount = 0U;
-  static double testFreq = 50.00;
-
-  dcTestCount++;
-
-  if (50U == dcTestCount)
-  {
-    testFreq = 50.20;
-    digital_outputs.set(1, HIGH); 
-  }
+  return Dyn_Control(DYN_SERVICE_DC, frequency, sysCount);
+}
 
-  if(dcTestCount >= 100U)
-  {
-    dcTestCount = 0U;
-    testFreq = 50.0;
-    digital_outputs.set(1, LOW);
-  }
+/***************************************************************************************************
+ * DM_Control
+ * 
+ * This function implements Dynamic Moderation. It should be called once every 20ms.
+ *
+ * Parameters:
+ * frequency - the most current measured frequency
+ * sysCount - system counter
+ *
+ * Return:
+ * Power demand
+ *
+ **************************************************************************************************/
+int16_t OP_MODE::DM_Control(double frequency, uint16_t sysCount)
+{
+  return Dyn_Control(DYN_SERVICE_DM, frequency, sysCount);
+}
 
-  return testFreq;
+/***************************************************************************************************
+ * DR_Control
+ * 
+ * This function implements Dynamic Regulation. It should be called once every 20ms.
+ *
+ * Parameters:
+ * frequency - the most current measured frequency
+ * sysCount - system counter
+ *
+ * Return:
+ * Power demand
+ *
+ **************************************************************************************************/
+int16_t OP_MODE::DR_Control(double frequency, uint16_t sysCount)
+{
+  return Dyn_Control(DYN_SERVICE_DR, frequency, sysCount);
 }
 
 /***************************************************************************************************
- * DC_Test_1_9
+ * Dyn_GetAchievedDelay
  * 
- * This function simulates Test 1.9 of National Grid DC spec. It should be called every 20ms.
+ * This function returns the frequency delay achieved on the last call of the active dynamic
+ * service. This is the configured delay unless meter samples have been missed (longer) or the
+ * delay line is still filling (0).
  *
  * Parameters:
  * None
  *
  * Return:
- * Frequency in Hz
+ * Achieved delay (ms)
  *
  **************************************************************************************************/
-double OP_MODE::DC_Test_1_9(void)
+uint32_t OP_MODE::Dyn_GetAchievedDelay(void)
 {
-  static uint16_t dcTestCount = 0U;
-  static double testFreq = 50.00;
-
-  dcTestCount++;
-
-  if (50U == dcTestCount)
-  {
-    testFreq = 50.30;
-    digital_outputs.set(1, HIGH); 
-  }
-
-  if(dcTestCount >= 100U)
-  {
-    dcTestCount = 0U;
-    testFreq = 50.0;
-    digital_outputs.set(1, LOW);
-  }
-
-  return testFreq;
+  return dynState[dynActive].delay.GetAchievedDelay();
 }
 
 /***************************************************************************************************
- * DC_Test_1_11
+ * GetDelayedFrequency
  * 
- * This function simulates Test 1.7 of National Grid DC spec. It should be called every 20ms.
+ * This function returns the frequency that the last frequency response service responded to,
+ * after its delay. DS3 has no delay.
  *
  * Parameters:
  * None
  *
  * Return:
- * Frequency in Hz
+ * Delayed frequency (Hz)
  *
  **************************************************************************************************/
-double OP_MODE::DC_Test_1_11(void)
+double OP_MODE::GetDelayedFrequency(void)
 {
-  static uint16_t dcTestCount = 0U;
-  static double testFreq = 50.00;
+  return delayedFreq;
+}
 
-  dcTestCount++;
+/***************************************************************************************************
+ * FFR_Configure
+ * 
+ * This function sets the FFR service parameters. The frequency delay takes effect the next time
+ * the operating modes are initialised, all other parameters immediately.
+ *
+ * Parameters:
+ * config - the FFR service parameters
+ *
+ * Return:
+ * true if the parameters are valid and have been accepted, otherwise false
+ *
+ **************************************************************************************************/
+bool OP_MODE::FFR_Configure(const ffrConfigStruct_t *config)
+{
+  bool isValid = true;
 
-  if (50U == dcTestCount)
+  if ((0U == config->delivery_ms) || 
+      (0U == config->sustain_ms) ||
+      (config->contractedPower < 0.0) ||
+      (config->delay_ms > FREQ_DELAY_MAX_MS))
   {
-    testFreq = 50.40;
-    digital_outputs.set(1, HIGH); 
+    isValid = false;
   }
-
-  if(dcTestCount >= 100U)
+  else if ((FFR_STATIC == config->type) &&
+           ((config->triggerFreq >= FFR_STATIC_REARM_FREQ) || (config->triggerFreq <= 0.0)))
+  {
+    isValid = false;
+  }
+  else if ((FFR_DYNAMIC == config->type) &&
+           ((config->deadband < 0.0) || (config->droop <= 0.0)))
+  {
+    isValid = false;
+  }
+  else
   {
-    dcTestCount = 0U;
-    testFreq = 50.0;
-    digital_outputs.set(1, LOW);
+    ffrConfig = *config;
   }
 
-  return testFreq;
+  return isValid;
 }
 
 /***************************************************************************************************
- * DC_Test_1_13
+ * FFR_Control
  * 
- * This function simulates Test 1.13 of National Grid DC spec. It should be called every 20ms.
+ * This function implements Firm Frequency Response, static or dynamic as configured. It should
+ * be called on every meter sample. The frequency is delayed and the power demand ramped using the
+ * same pipeline as DC, with the ramp rate set so that full contracted power is reached in the
+ * delivery time.
  *
  * Parameters:
- * None
+ * frequency - the most current measured frequency
+ * sysCount - system counter
  *
  * Return:
- * Frequency in Hz
+ * Power demand
  *
  **************************************************************************************************/
-double OP_MODE::DC_Test_1_13(void)
+int16_t OP_MODE::FFR_Control(double frequency, uint16_t sysCount)
 {
-  static uint16_t dcTestCount = 0U;
-  static double testFreq = 50.00;
+  uint32_t now_ms;
+  double freqDelayed;
+  double contractedPower;
+  int16_t targetPowerDemand;
+  uint16_t elapsed_ms;
 
-  dcTestCount++;
+  now_ms = millis();
+  ffrDelay.Push(now_ms, frequency);
+  freqDelayed = ffrDelay.Read(now_ms);
+  delayedFreq = freqDelayed;
 
-  if (50U == dcTestCount)
+  if ((ffrConfig.contractedPower > 0.0) && (ffrConfig.contractedPower < maxDeliveryPower))
+  {
+    contractedPower = ffrConfig.contractedPower;
+  }
+  else
   {
-    testFreq = 50.50;
-    digital_outputs.set(1, HIGH); 
+    contractedPower = maxDeliveryPower;
   }
 
-  if(dcTestCount >= 100U)
+  elapsed_ms = sysCount - ffrRamp.oldSysCount;
+
+  targetPowerDemand = FFR_UpdatePowerTarget(freqDelayed, contractedPower, elapsed_ms);
+
+  if (targetPowerDemand != ffrRamp.target)
   {
-    dcTestCount = 0U;
-    testFreq = 50.0;
-    digital_outputs.set(1, LOW);
+    ffrRamp.target = targetPowerDemand;
+    ffrRamp.ratePer_ms = contractedPower / (double)ffrConfig.delivery_ms;
+
+    if (ffrRamp.target < ffrRamp.demand)
+    {
+      ffrRamp.ratePer_ms = -ffrRamp.ratePer_ms;
+    }
   }
 
-  return testFreq;
+  return RampDemand(&ffrRamp, sysCount);
 }
 
-/* Public functions */
 /***************************************************************************************************
- * DC_Init
+ * DS3_Configure
  * 
- * This function initialises power limits for dynamic containment.
+ * This function sets the parameters of one DS3 product.
  *
  * Parameters:
- * maxPower - the maximum rated power transfer of the inverter
- * systemCounter
+ * product - the DS3 product
+ * config - the product parameters
  *
  * Return:
- * None
+ * true if the parameters are valid and have been accepted, otherwise false
  *
  **************************************************************************************************/
-void OP_MODE::DC_Init(uint16_t maxPower, uint16_t systemCounter)
+bool OP_MODE::DS3_Configure(ds3ProductEnum_t product, const ds3ProductConfigStruct_t *config)
 {
-  maxDeliveryPower = (double)maxPower;
+  bool isValid = false;
+
+  if ((product < NOOF_DS3_PRODUCTS) &&
+      (config->volume >= 0.0) && (config->volume <= 1.0) &&
+      (config->triggerFreq < DS3_REARM_FREQ) &&
+      (config->response_ms > 0U) &&
+      (config->sustainEnd_ms >= config->response_ms))
+  {
+    ds3Config[product] = *config;
+    isValid = true;
+  }
+
+  return isValid;
 }
 
 /***************************************************************************************************
- * DC_Control
+ * DS3_Control
  * 
- * This function implements Dynamic Containment. It should be called once every 20ms.
- * The specification for DC states that power response to frequency changes must be delayed between
- * 250 to 500ms. In order to achieve this, measured frequency is held in a ring buffer containing
- * the last 18 samples (320ms delay), using the tail value (oldest value) of the buffer to 
- * provide the required power response.
+ * This function implements the EirGrid DS3 reserve products (FFR, POR, SOR, TOR1 and TOR2). It
+ * should be called on every meter sample. Each product is triggered and timed independently so
+ * they stack; the power demand at any time is the largest of the active products, which covers
+ * every contracted volume whose window is open. Power is withdrawn at a limited rate when a
+ * window ends.
  *
  * Parameters:
  * frequency - the most current measured frequency
+ * sysCount - system counter
  *
  * Return:
  * Power demand
  *
  **************************************************************************************************/
-int16_t OP_MODE::DC_Control(double frequency, uint16_t sysCount)
+int16_t OP_MODE::DS3_Control(double frequency, uint16_t sysCount)
 {
-  static double freqBuffer[FREQ_BUFFER_SIZE] =
-  {
-    0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 
-    0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0
-  };
-  static uint16_t headPtr = 0;
-  uint16_t tailPtr;
-  double freqDelayed; 
-  double freqDeviation;
-  static double oldFreqDeviation = 0.0;
-  static int16_t targetPowerDemand = 0;
-  static uint16_t oldSysCount;
-  uint16_t rampTime = 0U;
-  int16_t newPowerDemand;
-  static int16_t oldPowerDemand = 0;
-  static double rampRatePer_ms = 0.0;
-  static bool isRamping = false;
-
-  #ifdef DC_TEST_1_1
-    freqBuffer[headPtr] = DC_Test_1_1();
-  #elif defined DC_TEST_1_2
-    freqBuffer[headPtr] = DC_Test_1_2();
-  #elif defined DC_TEST_1_5
-    freqBuffer[headPtr] = DC_Test_1_5();
-  #elif defined DC_TEST_1_7
-    freqBuffer[headPtr] = DC_Test_1_7();
-  #elif defined DC_TEST_1_9
-    freqBuffer[headPtr] = DC_Test_1_9();
-  #elif defined DC_TEST_1_11
-    freqBuffer[headPtr] = DC_Test_1_11();
-  #elif defined DC_TEST_1_13
-    freqBuffer[headPtr] = DC_Test_1_13();
-  #else
-   freqBuffer[headPtr] = frequency;
-  #endif
-
-  tailPtr = UpdateHeadTail(&headPtr, FREQ_BUFFER_SIZE);
-
-  freqDelayed = freqBuffer[tailPtr];
-
-  freqDeviation = freqDelayed - DC_FREQ_NOMINAL;
+  uint8_t product;
+  uint16_t elapsed_ms;
+  bool isRocofEvent;
+  double productDemand;
+  double targetDemand = 0.0;
+  int16_t powerDemand;
 
-  /* if frequency deviation is less than 0.01Hz treat this as no change from previous
-     time when it was >= 0.01Hz */
-  if(fabs(freqDeviation - oldFreqDeviation) >= 0.01)
-  {
-    /* >= 0.01Hz, so update oldFreqDeviation */
-    oldFreqDeviation = freqDeviation;
-    targetPowerDemand = DC_UpdatePowerTarget(freqDeviation);
-    rampRatePer_ms = (double)(targetPowerDemand - oldPowerDemand) / (double)DC_THREE_HUNDRED_MS; 
-  }
-  else
+  elapsed_ms = sysCount - ds3OldSysCount;
+  ds3OldSysCount = sysCount;
+
+  /* DS3 responds to undelayed frequency */
+  delayedFreq = frequency;
+
+  /* RoCoF only triggers for a falling frequency that is already below nominal */
+  isRocofEvent = ((ROCOF_FALLING == rocofObj.GetEvent()) && (frequency < DC_FREQ_NOMINAL));
+
+  for (product = 0U; product < NOOF_DS3_PRODUCTS; product++)
   {
-    /* targetPowerDemand is static, so use last calculated value */
+    productDemand = DS3_UpdateProduct((ds3ProductEnum_t)product, isRocofEvent, frequency, 
+                                      elapsed_ms);
+
+    if (productDemand > targetDemand)
+    {
+      targetDemand = productDemand;
+    }
   }
 
-  if(true == isRamping)
+  ds3Ramp.target = (int16_t)(targetDemand + 0.5F);
+
+  if (ds3Ramp.target >= ds3Ramp.demand)
   {
-    /* if output is ramping to new demand, get the elapsed time since the last ramp demand */
-    rampTime = sysCount - oldSysCount;
+    /* the products set their own rise time */
+    ds3Ramp.demand = ds3Ramp.target;
+    ds3Ramp.isRamping = false;
+    ds3Ramp.oldSysCount = sysCount;
+    powerDemand = ds3Ramp.demand;
   }
   else
   {
-    rampTime = 0U;
+    ds3Ramp.ratePer_ms = -(maxDeliveryPower / (double)DS3_RAMP_DOWN_MS);
+    powerDemand = RampDemand(&ds3Ramp, sysCount);
   }
 
-  isRamping = DC_RampPowerDemand(targetPowerDemand, 
-                                 oldPowerDemand, 
-                                 &newPowerDemand, 
-                                 rampTime, 
-                                 rampRatePer_ms);
-
-  oldSysCount = sysCount;
-  oldPowerDemand = newPowerDemand;
-
-  //return targetPowerDemand;
-  return newPowerDemand;
-}
-
-uint16_t OP_MODE::FFR_Control(double frequency)
-{
-
-}
-
-uint16_t OP_MODE::DS3_Control(double frequency)
-{
-
+  return powerDemand;
 }
 
 int16_t OP_MODE::PID_TestControl1(uint16_t sysCount)
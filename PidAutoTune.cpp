@@ -0,0 +1,488 @@
+/***************************************************************************************************
+ * PidAutoTune
+ *
+ * This module tunes the power PID by relay feedback (Astrom-Hagglund), so a new site can be
+ * commissioned without tuning by hand.
+ *
+ * Relay experiment - the output is switched to the operating command + d when the measurement
+ * falls below the operating point - h, and to - d when it rises above + h. The loop settles into
+ * a limit cycle at the ultimate period Tu, with amplitude a, which gives the ultimate gain
+ *
+ *   Ku = 4.d / (pi.sqrt(a^2 - h^2))
+ *
+ * once AUTOTUNE_CYCLES cycles in a row agree within AUTOTUNE_CYCLE_TOLERANCE.
+ *
+ * Tuning rules:
+ *              PI                         PID
+ *   ZN         Kp = 0.45Ku, Ti = Tu/1.2   Kp = 0.6Ku, Ti = Tu/2, Td = Tu/8
+ *   TL         Kp = Ku/3.2, Ti = 2.2Tu    Kp = Ku/2.2, Ti = 2.2Tu, Td = Tu/6.3
+ *   SIMC       first order plus delay model fitted to Ku, Tu and the process gain K, then
+ *              Kp = tau / (K.(tc + theta)), Ti = min(tau, 4.(tc + theta)), with tc = theta
+ * The first order plus delay model is reported whatever the rule, for the Smith predictor
+ * (SmithPred.cpp).
+ *
+ * Validation - the new gains hold the operating point for AUTOTUNE_HOLD_S, then take a setpoint
+ * step of AUTOTUNE_STEP. The gains are only reported as good if the step settles within
+ * AUTOTUNE_MAX_SETTLE_S without more than AUTOTUNE_MAX_OVERSHOOT.
+ *
+ * The module does not use the Arduino libraries, so that it can be run on a host.
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun Mcsherry
+ *
+ **************************************************************************************************/
+#include <math.h>
+#include "APP/PidAutoTune.h"
+
+#define AUTOTUNE_PI                3.14159265358979
+#define AUTOTUNE_HOLD_S            1.0       /* at the operating point before the step */
+
+/* private functions */
+/***************************************************************************************************
+ * Fail
+ *
+ * This function ends the auto-tune without a result.
+ *
+ * Parameters:
+ * reason - why, for reporting
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void PID_AUTOTUNE::Fail(const char *reason)
+{
+  state = AUTOTUNE_FAILED;
+  failure = reason;
+}
+
+/***************************************************************************************************
+ * Relay
+ *
+ * This function runs one step of the relay experiment, and moves on to validation once the
+ * oscillation is steady.
+ *
+ * Parameters:
+ * measured - the measurement
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void PID_AUTOTUNE::Relay(double measured)
+{
+  double error = measured - setpoint;
+  double period_s;
+  double cycleAmplitude;
+
+  if (measured > cycleMax)
+  {
+    cycleMax = measured;
+  }
+  if (measured < cycleMin)
+  {
+    cycleMin = measured;
+  }
+
+  if ((true == isRelayHigh) && (error > hysteresis))
+  {
+    isRelayHigh = false;
+    output = command - amplitude;
+  }
+  else if ((false == isRelayHigh) && (error < -hysteresis))
+  {
+    isRelayHigh = true;
+    output = command + amplitude;
+
+    /* each switch high ends a cycle, apart from the first */
+    if (lastRise_s >= 0.0)
+    {
+      period_s = time_s - lastRise_s;
+      cycleAmplitude = (cycleMax - cycleMin) / 2.0;
+
+      if ((cycles > 0U) &&
+          ((fabs(period_s - lastPeriod_s) > (AUTOTUNE_CYCLE_TOLERANCE * lastPeriod_s)) ||
+           (fabs(cycleAmplitude - lastAmplitude) > (AUTOTUNE_CYCLE_TOLERANCE * lastAmplitude))))
+      {
+        /* not steady yet - count again from this cycle */
+        cycles = 1U;
+      }
+      else
+      {
+        cycles++;
+      }
+      lastPeriod_s = period_s;
+      lastAmplitude = cycleAmplitude;
+    }
+
+    lastRise_s = time_s;
+    cycleMax = measured;
+    cycleMin = measured;
+
+    if (cycles >= AUTOTUNE_CYCLES)
+    {
+      if (true == Calculate())
+      {
+        /* carry on from the relay output without a step */
+        config.kp = result.kp;
+        config.ki = result.ki;
+        config.kd = result.kd;
+        pid.SetConfig(&config);
+        pid.Reset(output, measured);
+        state = AUTOTUNE_VALIDATE;
+        time_s = 0.0;
+        result.overshoot = 0.0;
+        result.settle_s = 0.0;
+      }
+      return;
+    }
+  }
+  else
+  {
+    /* relay holds */
+  }
+
+  if (time_s > AUTOTUNE_RELAY_TIMEOUT_S)
+  {
+    Fail("no steady oscillation");
+  }
+}
+
+/***************************************************************************************************
+ * Calculate
+ *
+ * This function calculates the ultimate gain from the oscillation, and the gains by the rule.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * true if the gains are usable, otherwise false (and failed)
+ *
+ **************************************************************************************************/
+bool PID_AUTOTUNE::Calculate(void)
+{
+  double ti_s = 0.0;
+  double td_s = 0.0;
+  double omega;
+  double loopGain;
+  double tau_s = 0.0;
+  double theta_s;
+  double closedLoop_s;
+
+  if (lastAmplitude <= hysteresis)
+  {
+    Fail("oscillation within the hysteresis");
+    return false;
+  }
+
+  result.ku = (4.0 * amplitude) / (AUTOTUNE_PI * sqrt((lastAmplitude * lastAmplitude) -
+                                                      (hysteresis * hysteresis)));
+  result.tu_s = lastPeriod_s;
+  result.kd = 0.0;
+
+  /* first order plus delay K.exp(-theta.s) / (tau.s + 1) with the same ultimate point:
+     K.Ku = sqrt(1 + (tau.w)^2) and theta.w + atan(tau.w) = pi */
+  omega = (2.0 * AUTOTUNE_PI) / result.tu_s;
+  loopGain = processGain * result.ku;
+  if (loopGain > 1.0)
+  {
+    tau_s = sqrt((loopGain * loopGain) - 1.0) / omega;
+  }
+  theta_s = (AUTOTUNE_PI - atan(tau_s * omega)) / omega;
+  result.tau_s = tau_s;
+  result.theta_s = theta_s;
+
+  switch (rule)
+  {
+    case AUTOTUNE_ZN:
+      result.kp = (true == isDerivative) ? (0.6 * result.ku) : (0.45 * result.ku);
+      ti_s = (true == isDerivative) ? (result.tu_s / 2.0) : (result.tu_s / 1.2);
+      td_s = (true == isDerivative) ? (result.tu_s / 8.0) : 0.0;
+      break;
+
+    case AUTOTUNE_TL:
+      result.kp = (true == isDerivative) ? (result.ku / 2.2) : (result.ku / 3.2);
+      ti_s = 2.2 * result.tu_s;
+      td_s = (true == isDerivative) ? (result.tu_s / 6.3) : 0.0;
+      break;
+
+    case AUTOTUNE_SIMC:
+    default:
+      closedLoop_s = 2.0 * theta_s;     /* tc + theta, with tc = theta */
+
+      result.kp = tau_s / (processGain * closedLoop_s);
+      ti_s = (tau_s < (4.0 * closedLoop_s)) ? tau_s : (4.0 * closedLoop_s);
+      if (ti_s <= 0.0)
+      {
+        /* pure delay - integral action only */
+        result.ki = 1.0 / (processGain * closedLoop_s);
+      }
+      break;
+  }
+
+  if (ti_s > 0.0)
+  {
+    result.ki = result.kp / ti_s;
+  }
+  result.kd = result.kp * td_s;
+
+  if ((false == isfinite(result.kp)) || (false == isfinite(result.ki)) ||
+      (result.kp < 0.0) || (result.ki <= 0.0))
+  {
+    Fail("gains out of range");
+    return false;
+  }
+
+  return true;
+}
+
+/***************************************************************************************************
+ * Validate
+ *
+ * This function runs one step of the validation step test with the new gains.
+ *
+ * Parameters:
+ * measured - the measurement
+ * dt_s - time since the last step
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void PID_AUTOTUNE::Validate(double measured, double dt_s)
+{
+  double target = setpoint + step;
+  double after_s;
+  double overshoot;
+
+  if (time_s < AUTOTUNE_HOLD_S)
+  {
+    output = pid.Compute(setpoint, measured, dt_s);
+    return;
+  }
+
+  output = pid.Compute(target, measured, dt_s);
+  after_s = time_s - AUTOTUNE_HOLD_S;
+
+  overshoot = (measured - target) / step;
+  if (overshoot > result.overshoot)
+  {
+    result.overshoot = overshoot;
+  }
+  if (fabs(measured - target) > (AUTOTUNE_SETTLE_BAND * fabs(step)))
+  {
+    result.settle_s = after_s;
+  }
+
+  if (after_s >= AUTOTUNE_VALIDATE_S)
+  {
+    if (result.settle_s > AUTOTUNE_MAX_SETTLE_S)
+    {
+      result.settle_s = -1.0;
+      Fail("step did not settle");
+    }
+    else if (result.overshoot > AUTOTUNE_MAX_OVERSHOOT)
+    {
+      Fail("step overshoot too large");
+    }
+    else
+    {
+      state = AUTOTUNE_DONE;
+    }
+  }
+}
+
+/* Public functions */
+/***************************************************************************************************
+ * Start
+ *
+ * This function starts the relay experiment about an operating point. The loop should be steady
+ * at the operating point.
+ *
+ * Parameters:
+ * operatingPoint - the measurement to oscillate about
+ * operatingCommand - the output that holds it there
+ * base - the PID configuration the gains are for; its limits bound the relay and the step
+ * gain - process gain at the operating point (measurement per output), for SIMC
+ * tuneRule - the tuning rule
+ * useDerivative - true for PID gains, false for PI (SIMC is always PI)
+ *
+ * Return:
+ * true if started, false if the configuration leaves no room for the experiment
+ *
+ **************************************************************************************************/
+bool PID_AUTOTUNE::Start(double operatingPoint, double operatingCommand,
+                         const pidCtrlConfigStruct_t *base, double gain,
+                         autotuneRuleEnum_t tuneRule, bool useDerivative)
+{
+  double range = base->outMax;
+
+  amplitude = AUTOTUNE_RELAY_AMPLITUDE * range;
+  hysteresis = AUTOTUNE_HYSTERESIS * range;
+  step = AUTOTUNE_STEP * range;
+
+  if ((range <= 0.0) || (gain <= 0.0) ||
+      ((operatingCommand + amplitude) > base->outMax) ||
+      ((operatingCommand - amplitude) < base->outMin))
+  {
+    return false;
+  }
+
+  /* step away from the nearer limit */
+  if ((operatingPoint + step) > (base->outMax - amplitude))
+  {
+    step = -step;
+  }
+
+  config = *base;
+  processGain = gain;
+  rule = tuneRule;
+  isDerivative = (true == useDerivative) && (AUTOTUNE_SIMC != tuneRule);
+  setpoint = operatingPoint;
+  command = operatingCommand;
+  output = command + amplitude;
+  isRelayHigh = true;
+  time_s = 0.0;
+  lastRise_s = -1.0;
+  cycleMax = operatingPoint;
+  cycleMin = operatingPoint;
+  cycles = 0U;
+  lastPeriod_s = 0.0;
+  lastAmplitude = 0.0;
+  result = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, -1.0};
+  failure = "";
+  state = AUTOTUNE_RELAY;
+
+  return true;
+}
+
+/***************************************************************************************************
+ * Update
+ *
+ * This function runs one step of the auto-tune. It should be called on each new measurement
+ * while IsRunning.
+ *
+ * Parameters:
+ * measured - the measurement
+ * dt_s - time since the last step
+ *
+ * Return:
+ * The output to apply
+ *
+ **************************************************************************************************/
+double PID_AUTOTUNE::Update(double measured, double dt_s)
+{
+  if (dt_s > 0.0)
+  {
+    time_s += dt_s;
+  }
+
+  if (AUTOTUNE_RELAY == state)
+  {
+    Relay(measured);
+  }
+  else if (AUTOTUNE_VALIDATE == state)
+  {
+    Validate(measured, dt_s);
+  }
+  else
+  {
+    /* not running */
+  }
+
+  return output;
+}
+
+/***************************************************************************************************
+ * Stop
+ *
+ * This function abandons a running auto-tune.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void PID_AUTOTUNE::Stop(void)
+{
+  if (true == IsRunning())
+  {
+    Fail("stopped");
+  }
+}
+
+/***************************************************************************************************
+ * IsRunning
+ *
+ * This function reports whether the auto-tune is driving the output.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * true during the relay experiment and the validation step
+ *
+ **************************************************************************************************/
+bool PID_AUTOTUNE::IsRunning(void)
+{
+  return ((AUTOTUNE_RELAY == state) || (AUTOTUNE_VALIDATE == state));
+}
+
+/***************************************************************************************************
+ * GetState
+ *
+ * This function returns the auto-tune state.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * The state
+ *
+ **************************************************************************************************/
+autotuneStateEnum_t PID_AUTOTUNE::GetState(void)
+{
+  return state;
+}
+
+/***************************************************************************************************
+ * GetFailure
+ *
+ * This function returns why the last auto-tune failed.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * The reason, empty if it has not failed
+ *
+ **************************************************************************************************/
+const char *PID_AUTOTUNE::GetFailure(void)
+{
+  return failure;
+}
+
+/***************************************************************************************************
+ * GetResult
+ *
+ * This function returns the identified ultimate point, the gains and the validation result.
+ *
+ * Parameters:
+ * tuneResult - updated with the result
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void PID_AUTOTUNE::GetResult(autotuneResultStruct_t *tuneResult)
+{
+  *tuneResult = result;
+}
+
+/* end public functions */
@@ -0,0 +1,370 @@
+/***************************************************************************************************
+ * PidCtrl
+ *
+ * This module is a fixed step PID controller, replacing the PID_v1 library for power control.
+ * PID_v1 decides for itself whether to run from millis(), so its steps depend on wall clock
+ * alignment rather than on when a new measurement arrived. Compute here runs exactly once per
+ * call, with the time step passed in by the caller.
+ *
+ *   u = kp.(b.r - y) + I + D
+ *   D = kd.d/dt(c.r - y), through a first order filter of time constant kd / (kp.N)
+ *   I = integral of ki.(r - y) + (u_applied - u) / Tt
+ *
+ * - Setpoint weighting (b, c): b < 1 reduces overshoot on setpoint steps without slowing the
+ *   response to disturbances; c = 0 keeps setpoint steps out of the derivative.
+ * - Back-calculation anti-windup: when the output is limited, either here (limits and rate limit)
+ *   or downstream (Track), the integrator is wound back towards the output actually applied with
+ *   time constant Tt, so it never runs away and recovers without overshoot.
+ * - Output rate limiting.
+ *
+ * The module does not use the Arduino libraries, so that it can be run on a host.
+ * The controller is written against its numeric type T, so the same code runs in double, float
+ * or fixed point (FixedQ.h); literals are written T(x) so a float or fixed point instance does no
+ * double arithmetic.
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun Mcsherry
+ *
+ **************************************************************************************************/
+#include <cmath>
+#include "APP/PidCtrl.h"
+#include "APP/FixedQ.h"
+
+/* private functions */
+/***************************************************************************************************
+ * TrackingGain
+ *
+ * This function returns the fraction of the difference between the applied and unlimited output
+ * that is fed back into the integrator in one step. When no tracking time is configured it is
+ * derived from the gains: Ti for a PI controller, sqrt(Ti.Td) with derivative action.
+ *
+ * Parameters:
+ * dt_s - the time step
+ *
+ * Return:
+ * Tracking gain, 0 to 1
+ *
+ **************************************************************************************************/
+template <typename T>
+T PID_CTRL_T<T>::TrackingGain(T dt_s)
+{
+  using std::sqrt;
+  T tracking_s = config.trackingTime_s;
+  T gain;
+
+  if (config.ki <= T(0.0))
+  {
+    return T(0.0);
+  }
+
+  if (tracking_s <= T(0.0))
+  {
+    tracking_s = config.kp / config.ki;
+
+    if (config.kd > T(0.0))
+    {
+      tracking_s = sqrt(tracking_s * (config.kd / config.kp));
+    }
+  }
+
+  gain = (tracking_s > dt_s) ? (dt_s / tracking_s) : T(1.0);
+
+  return gain;
+}
+
+/* Public functions */
+/***************************************************************************************************
+ * SetConfig
+ *
+ * This function sets the gains, weights and limits. The controller state is kept, so it can be
+ * called while running.
+ *
+ * Parameters:
+ * newConfig - the configuration
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+template <typename T>
+void PID_CTRL_T<T>::SetConfig(const PID_CTRL_CONFIG_STRUCT<T> *newConfig)
+{
+  config = *newConfig;
+}
+
+/***************************************************************************************************
+ * GetConfig
+ *
+ * This function returns the configuration.
+ *
+ * Parameters:
+ * currentConfig - updated with the configuration
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+template <typename T>
+void PID_CTRL_T<T>::GetConfig(PID_CTRL_CONFIG_STRUCT<T> *currentConfig)
+{
+  *currentConfig = config;
+}
+
+/***************************************************************************************************
+ * SetTunings
+ *
+ * This function changes the gains while running. Negative gains are ignored. The integrator
+ * takes up the change in the proportional term, so the output does not step (e.g. when the gains
+ * are scheduled).
+ *
+ * Parameters:
+ * kp - proportional gain
+ * ki - integral gain (per second)
+ * kd - derivative gain (seconds)
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+template <typename T>
+void PID_CTRL_T<T>::SetTunings(T kp, T ki, T kd)
+{
+  if ((kp >= T(0.0)) && (ki >= T(0.0)) && (kd >= T(0.0)))
+  {
+    if (true == isStarted)
+    {
+      integral += (config.kp - kp) * lastPropInput;
+    }
+    config.kp = kp;
+    config.ki = ki;
+    config.kd = kd;
+  }
+}
+
+/***************************************************************************************************
+ * SetOutputLimits
+ *
+ * This function changes the output limits.
+ *
+ * Parameters:
+ * outMin - lowest output
+ * outMax - highest output
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+template <typename T>
+void PID_CTRL_T<T>::SetOutputLimits(T outMin, T outMax)
+{
+  if (outMin < outMax)
+  {
+    config.outMin = outMin;
+    config.outMax = outMax;
+  }
+}
+
+/***************************************************************************************************
+ * Reset
+ *
+ * This function restarts the controller so that the next Compute continues from a known output
+ * without a step (bumpless transfer), e.g. after open loop operation.
+ *
+ * Parameters:
+ * initialOutput - the output the controller takes over from
+ * measured - the present measurement
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+template <typename T>
+void PID_CTRL_T<T>::Reset(T initialOutput, T measured)
+{
+  /* the proportional term is taken out of the integrator on the first Compute, when the
+     setpoint is known */
+  integral = initialOutput;
+  derivative = T(0.0);
+  lastDerivInput = -measured;
+  lastPropInput = -measured;
+  output = initialOutput;
+  unlimited = initialOutput;
+  lastDt_s = T(0.0);
+  isSaturated = false;
+  isStarted = false;
+}
+
+/***************************************************************************************************
+ * Compute
+ *
+ * This function runs one step of the controller.
+ *
+ * Parameters:
+ * setpoint - the setpoint
+ * measured - the measurement
+ * dt_s - time since the last step, limited to PID_CTRL_MAX_DT_S
+ *
+ * Return:
+ * The output, within the limits
+ *
+ **************************************************************************************************/
+template <typename T>
+T PID_CTRL_T<T>::Compute(T setpoint, T measured, T dt_s)
+{
+  T proportional;
+  T derivInput;
+  T filter_s;
+  T limited;
+  T step;
+
+  if (dt_s <= T(0.0))
+  {
+    return output;
+  }
+  if (dt_s > T(PID_CTRL_MAX_DT_S))
+  {
+    dt_s = T(PID_CTRL_MAX_DT_S);
+  }
+
+  lastPropInput = (config.setpointWeight * setpoint) - measured;
+  proportional = config.kp * lastPropInput;
+  derivInput = (config.derivWeight * setpoint) - measured;
+
+  if (false == isStarted)
+  {
+    integral -= proportional;
+    lastDerivInput = derivInput;
+    isStarted = true;
+  }
+
+  if ((config.kd > T(0.0)) && (config.kp > T(0.0)))
+  {
+    /* backward Euler, stable for any step */
+    filter_s = config.kd / (config.kp * T(PID_CTRL_DERIV_N));
+    derivative = ((filter_s * derivative) + (config.kd * (derivInput - lastDerivInput))) /
+                 (filter_s + dt_s);
+  }
+  else
+  {
+    derivative = T(0.0);
+  }
+  lastDerivInput = derivInput;
+
+  unlimited = proportional + integral + derivative;
+
+  limited = unlimited;
+  if (limited > config.outMax)
+  {
+    limited = config.outMax;
+  }
+  else if (limited < config.outMin)
+  {
+    limited = config.outMin;
+  }
+  else
+  {
+    /* within limits */
+  }
+
+  if (config.rateLimit > T(0.0))
+  {
+    step = config.rateLimit * dt_s;
+
+    if (limited > (output + step))
+    {
+      limited = output + step;
+    }
+    else if (limited < (output - step))
+    {
+      limited = output - step;
+    }
+    else
+    {
+      /* within the rate limit */
+    }
+  }
+
+  isSaturated = (limited != unlimited);
+
+  integral += (config.ki * (setpoint - measured) * dt_s) +
+              (TrackingGain(dt_s) * (limited - unlimited));
+
+  output = limited;
+  lastDt_s = dt_s;
+
+  return output;
+}
+
+/***************************************************************************************************
+ * Track
+ *
+ * This function tells the controller the output actually applied, when it differs from the last
+ * output because the actuator saturated downstream. The integrator is wound back towards it in
+ * the same way as for the controller's own limits. It should be called after Compute.
+ *
+ * Parameters:
+ * applied - the output actually applied, in the controller's output units
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+template <typename T>
+void PID_CTRL_T<T>::Track(T applied)
+{
+  if (applied != output)
+  {
+    integral += TrackingGain(lastDt_s) * (applied - output);
+    output = applied;
+    isSaturated = true;
+  }
+}
+
+/***************************************************************************************************
+ * IsSaturated
+ *
+ * This function reports whether the last output was limited.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * true if the output was limited by the limits, the rate limit or Track
+ *
+ **************************************************************************************************/
+template <typename T>
+bool PID_CTRL_T<T>::IsSaturated(void)
+{
+  return isSaturated;
+}
+
+/***************************************************************************************************
+ * GetOutput
+ *
+ * This function returns the last output.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * The output
+ *
+ **************************************************************************************************/
+template <typename T>
+T PID_CTRL_T<T>::GetOutput(void)
+{
+  return output;
+}
+
+/* end public functions */
+
+/* The firmware uses double; float and the Q formats are for the host checks (kernel_check) and
+   for running the loop on a core without a double precision FPU. Instantiations that are not
+   used are dropped by the linker. */
+template class PID_CTRL_T<double>;
+template class PID_CTRL_T<float>;
+template class PID_CTRL_T<fixedQ16_t>;
+template class PID_CTRL_T<fixedQ24_t>;
@@ -13,24 +13,46 @@
  *
  **************************************************************************************************/
 #include <Arduino_MachineControl.h>
-#include <PID_v1.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include "APP/PowerControl.h"
+#include "APP/PidCtrl.h"
+#include "APP/CtrlKernel.h"
+#include "APP/PidAutoTune.h"
+#include "APP/SmithPred.h"
+#include "APP/ReactCtrl.h"
+#include "APP/GainSched.h"
+#include "APP/InvLut.h"
+#include "APP/LutLearn.h"
 #include "APP/Acuvim2.h"
+#include "APP/MeterAgg.h"
+#include "APP/FreqSource.h"
 #include "APP/APP_CAN.h"
 #include "APP/Controller.h"
 #include "HAL/HAL_Timer.h"
 #include "APP/Flex.h"
 #include "APP/Controller.h"
 #include "APP/OperatingMode.h"
+#include "APP/RespCurve.h"
+#include "APP/SocMgr.h"
+#include "APP/TestProfile.h"
+#include "APP/Schedule.h"
+#include "HAL/HAL_RTC.h"
+#include "HAL/HAL_NVR.h"
+#include "APP/Rocof.h"
+#include "APP/SerialCmd.h"
 extern "C" 
 {
   #include "UTILS/lp_filter.h"
 }
-#ifdef HIL_TST
+#if defined HIL_TST || defined FREQ_ANALOGUE_FITTED
  #include "APP/HIL_Test.h"
-
+#endif
+#ifdef FREQ_EST_FITTED
+ #include "APP/FreqEst.h"
+ #include "HAL/HAL_ADC.h"
+#endif
+#ifdef HIL_TST
  #define METER_DELAY_20MS  2U // in 10ms units
 #endif 
 
@@ -38,6 +60,30 @@ using namespace machinecontrol;
 
 #define INVERTER_ON_OFF_SCHEDULE 100U  // in ms units
 #define CAN_TX_DELAY_TIME        3U    // in ms units
+#define OPEN_LOOP_SCHEDULE       20U   // in ms units, matches the meter cadence
+#define ROCOF_MIN_DEMAND_STEP    1.0   // in 0.1kW units, a smaller change waits for the meter
+
+/* Power PID - proportional setpoint weight, and the output rate limit in rated power per second */
+#define POWER_PID_SETPOINT_WEIGHT 1.0
+#define POWER_PID_RATE_LIMIT      5.0
+#define PID_MAX_GAP_MS            100U  // in ms units, a longer gap between PID steps is a restart
+
+/* Feedforward plus trim - the trim setpoint follows the demand through a first order model of the
+   inverter response with this time constant, one step late, so the PID does not act on the lag
+   the feedforward is already correcting */
+#define CTRL_FF_MODEL_MS          100.0 // in ms units
+
+/* Smith predictor model until auto-tuning identifies one - the inverter time constant, and the
+   dead time of CAN, the inverter and the meter latency. The dead time then follows measurement */
+#define CTRL_SMITH_TAU_MS         100.0 // in ms units
+#define CTRL_SMITH_DEAD_TIME_MS   30.0  // in ms units
+
+/* Reactive power rating of the inverter, either direction */
+#define REACT_MAX_REACTIVE        ((double)CAB1000_MAX_REACTIVE_P_KVA * 10.0) // in 0.1kVAr units
+
+/* Power PID gains found by auto-tuning are stored in NVR */
+#define PID_NVR_KEY               "/kv/pid"
+#define PID_NVR_VERSION           1U
 
 typedef enum CONTROLLER_STATE_ENUM
 {
@@ -46,54 +92,50 @@ typedef enum CONTROLLER_STATE_ENUM
   CONTROLLER_STATE_INIT_ENTRY     = 2,
   CONTROLLER_STATE_INIT_DURING    = 3,
   CONTROLLER_STATE_RUN_ENTRY      = 4,
-  CONTROLLER_STATE_RUN_DURING     = 5
+  CONTROLLER_STATE_RUN_DURING     = 5,
+  CONTROLLER_STATE_DEGRADED_ENTRY = 6,
+  CONTROLLER_STATE_DEGRADED_DURING= 7
 }controllerStateEnum_t;
 
-double CAB1000_LUT[LUT_MAX_INDEX][2] =
-{
-   /* Requested power, actual power - all in 0.1kW units */
-  {   -15000.0,           -15000.0}, 
-  {   -14000.0,           -14005.0}, 
-  {   -13000.0,           -13000.0}, 
-  {   -12000.0,           -11906.0}, 
-  {   -11000.0,           -10905.0}, 
-  {   -10000.0,           -9920.0}, 
-  {   -9000.0,            -8890.0}, 
-  {   -8000.0,            -7840.0}, 
-  {   -7000.0,            -6810.0}, 
-  {   -6000.0,            -5800.0}, 
-  {   -5000.0,            -4770.0}, 
-  {   -4000.0,            -3750.0}, 
-  {   -3000.0,            -2780.0}, 
-  {   -2000.0,            -1780.0}, 
-  {   -1000.0,            -890.0}, 
-  {   0.0,                10.0}, 
-  {   1000.0,             890.0},
-  {   2000.0,             1780.0},
-  {   3000.0,             2800.0},
-  {   4000.0,             3800.0},
-  {   5000.0,             4750.0},
-  {   6000.0,             5760.0},
-  {   7000.0,             6780.0},
-  {   8000.0,             7810.0},
-  {   9000.0,             8820.0},
-  {   10000.0,            9850.0},
-  {   11000.0,            10870.0},
-  {   12000.0,            11900.0},
-  {   13000.0,            12910.0},
-  {   14000.0,            13920.0},
-  {   15000.0,            15000.0}
-};
-
-ACUVIM_II acuvimObj;
+typedef struct PID_NVR_RECORD_STRUCT
+{
+  uint32_t version;
+  double kp;
+  double ki;
+  double kd;
+}pidNvrRecordStruct_t;
+
+METER_AGG meterAggObj;
+FREQ_SOURCE freqSourceObj;
 FLEX flexObj;
 APP_CAN canObj;
 OP_MODE opModeObj;
+INV_LUT invLutObj;
+
+/* Inverter characteristic for the configured inverter firmware and grid voltage, resampled onto
+   the lookup grids at compile time. Only the CAB1000 on a 690V grid has been measured, so every
+   configuration uses that table until the others are; demands are limited to maxRated first */
+#if defined CAB1000_FW_3C625C9 || defined CAB1000_FW_6DE948B
+ #if defined GRID_VOLTAGE_480_RMS || defined GRID_VOLTAGE_600_RMS || \
+     defined GRID_VOLTAGE_630_RMS || defined GRID_VOLTAGE_660_RMS || defined GRID_VOLTAGE_690_RMS
+  #define INV_TABLE           CAB1000_LUT
+  #define INV_TABLE_ROWS      CAB1000_LUT_ROWS
+ #endif
+#endif
 
-#ifdef HIL_TST
+static constexpr invLutGridsStruct_t INV_GRIDS = InvLutGrids(INV_TABLE, INV_TABLE_ROWS);
+
+#if defined HIL_TST || defined FREQ_ANALOGUE_FITTED
  HIL_TEST hilTestObj;
 #endif
 
+#ifdef FREQ_EST_FITTED
+ FREQ_EST freqEstObj;
+ #define WAVEFORM_EST  (&freqEstObj)
+#else
+ #define WAVEFORM_EST  NULL
+#endif
+
 acuvimBasicMeasurement20ms_t meterData;
 flexOperatingStateStruct_t requestedState;
 static bool newMeterData = false;
@@ -110,30 +152,106 @@ static bool newMeterData = false;
  uint16_t maxRated = 15000U; // in 0.1kW units
 #endif
 
+/* Nominal line voltage, per unit for volt-var */
+#ifdef GRID_VOLTAGE_480_RMS
+ #define NOMINAL_LINE_VOLTAGE 480.0 // in volts
+#elif defined GRID_VOLTAGE_600_RMS
+ #define NOMINAL_LINE_VOLTAGE 600.0 // in volts
+#elif defined GRID_VOLTAGE_630_RMS
+ #define NOMINAL_LINE_VOLTAGE 630.0 // in volts
+#elif defined GRID_VOLTAGE_660_RMS
+ #define NOMINAL_LINE_VOLTAGE 660.0 // in volts
+#elif defined GRID_VOLTAGE_690_RMS
+ #define NOMINAL_LINE_VOLTAGE 690.0 // in volts
+#endif
+
 /* array of objects to control */
 pcAcObjStruct_t pcAcObj[(uint8_t)NOOF_PC_AC_OBJECTS];
 
-/* set up PID objects for current and power */
-PID powerPid(&pcAcObj[AC_POWER_CONTROL].measuredScaled, 
-             &pcAcObj[AC_POWER_CONTROL].pidOutput, 
-             &pcAcObj[AC_POWER_CONTROL].setPointScaled,
-             pcAcObj[AC_POWER_CONTROL].pGain, 
-             pcAcObj[AC_POWER_CONTROL].iGain,
-             pcAcObj[AC_POWER_CONTROL].dGain, DIRECT);
-
-PID currentPid(&pcAcObj[AC_CURRENT_CONTROL].measuredScaled, 
-               &pcAcObj[AC_CURRENT_CONTROL].pidOutput, 
-               &pcAcObj[AC_CURRENT_CONTROL].setPointScaled,
-               pcAcObj[AC_CURRENT_CONTROL].pGain, 
-               pcAcObj[AC_CURRENT_CONTROL].iGain,
-               pcAcObj[AC_CURRENT_CONTROL].dGain, DIRECT);
+/* PID objects for current and power, configured in Init */
+PID_CTRL powerPid;
+PID_CTRL currentPid;
+PID_AUTOTUNE autoTuneObj;
+SMITH_PRED smithPredObj;
 
 lp_filter_ModelData hil_filter;
 
+/***************************************************************************************************
+ * IsDynamicMode
+ * 
+ * This function checks whether an operating mode is one of the dynamic services (DC, DM, DR),
+ * which can be switched between while running.
+ *
+ * Parameters:
+ * operatingMode - the operating mode
+ *
+ * Return:
+ * true if a dynamic service, otherwise false
+ *
+ **************************************************************************************************/
+static bool IsDynamicMode(flexControlModeEnum_t operatingMode)
+{
+  return ((DC == operatingMode) || (DM == operatingMode) || (DR == operatingMode));
+}
+
+/***************************************************************************************************
+ * IsRocofMode
+ * 
+ * This function checks whether an operating mode responds to RoCoF events, so that its demand
+ * should be sent as soon as an event starts rather than on the next meter sample.
+ *
+ * Parameters:
+ * operatingMode - the operating mode
+ *
+ * Return:
+ * true if the mode responds to RoCoF, otherwise false
+ *
+ **************************************************************************************************/
+static bool IsRocofMode(flexControlModeEnum_t operatingMode)
+{
+  return (DS3 == operatingMode);
+}
+
+/***************************************************************************************************
+ * GainSchedClass
+ * 
+ * This function returns the gain scheduling class of an operating mode.
+ *
+ * Parameters:
+ * operatingMode - the operating mode
+ *
+ * Return:
+ * The gain scheduling class
+ *
+ **************************************************************************************************/
+static gainSchedClassEnum_t GainSchedClass(flexControlModeEnum_t operatingMode)
+{
+  gainSchedClassEnum_t schedClass;
+
+  switch (operatingMode)
+  {
+    case TRADING:
+      schedClass = GAIN_SCHED_TRADING;
+      break;
+
+    case PID_TEST1:
+    case PID_TEST2:
+      schedClass = GAIN_SCHED_TEST;
+      break;
+
+    default:
+      schedClass = GAIN_SCHED_RESPONSE;
+      break;
+  }
+
+  return schedClass;
+}
+
 /***************************************************************************************************
  * GetStoredParams
  * 
  * This function is called at initialisation, and reads the PID process parameters from NVR.
+ * Only the power PID gains are stored, once they have been found by auto-tuning.
  *
  * Parameters:
  * None
@@ -144,7 +262,49 @@ lp_filter_ModelData hil_filter;
  **************************************************************************************************/
 void POWER_CTRL::GetStoredParams(void)
 {
-    /* todo read parameters from NVR */
+  pidNvrRecordStruct_t record;
+
+  NVR_Init();
+
+  if ((true == NVR_Read(PID_NVR_KEY, &record, sizeof(record))) &&
+      (PID_NVR_VERSION == record.version) &&
+      (record.kp >= 0.0) && (record.ki > 0.0) && (record.kd >= 0.0))
+  {
+    p_realPowerGain = record.kp;
+    i_realPowerGain = record.ki;
+    d_realPowerGain = record.kd;
+  }
+  else
+  {
+    Serial.println("No stored power PID gains, using defaults");
+  }
+}
+
+/***************************************************************************************************
+ * SaveParams
+ * 
+ * This function queues the power PID gains to be written to NVR.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void POWER_CTRL::SaveParams(void)
+{
+  pidNvrRecordStruct_t record;
+
+  record.version = PID_NVR_VERSION;
+  record.kp = pcAcObj[AC_POWER_CONTROL].pGain;
+  record.ki = pcAcObj[AC_POWER_CONTROL].iGain;
+  record.kd = pcAcObj[AC_POWER_CONTROL].dGain;
+
+  if (false == NVR_Write(PID_NVR_KEY, &record, sizeof(record)))
+  {
+    Serial.println("Power PID gains not saved");
+  }
 }
 
 /***************************************************************************************************
@@ -169,27 +329,7 @@ void POWER_CTRL::GetStoredParams(void)
  **************************************************************************************************/
 inline double POWER_CTRL::ScaleEngUnit(int16_t value, int16_t min, int16_t max, bool limit)
 {
-    double scaledValue;
-
-    scaledValue = (double)((double)value / (((double)max - (double)min) / 2.0));
-
-    if (true == limit)
-    {
-        if (scaledValue > 1.0)
-        {
-            scaledValue = 1.0;
-        }
-        else if (scaledValue < -1.0)
-        {
-            scaledValue = -1.0;
-        }
-        else
-        {
-            /* within limits */
-        }
-    }   
-
-    return scaledValue;
+    return KERNEL_ScaleEngUnit<double>(value, min, max, limit);
 }
 
 /***************************************************************************************************
@@ -209,24 +349,7 @@ inline double POWER_CTRL::ScaleEngUnit(int16_t value, int16_t min, int16_t max,
  **************************************************************************************************/
 inline int16_t POWER_CTRL::Unscale(double value, int16_t min, int16_t max)
 {
-    int16_t engUnit;
-
-    engUnit = (int16_t)(value * (double)(((double)max - (double)min)/2.0));
-
-    if (engUnit > max)
-    {
-        engUnit = max;
-    }
-    else if (engUnit < min)
-    {
-        engUnit = min;
-    }
-    else
-    {
-        /* within limits */
-    }
-
-    return engUnit;
+    return KERNEL_Unscale<double>(value, min, max);
 }
 
 /***************************************************************************************************
@@ -250,11 +373,11 @@ bool POWER_CTRL::ReadMeter(void)
   bool meterAvailable = true;
   bool isMeterFault;
   
-  isMeterFault = acuvimObj.GetFaultState();
+  isMeterFault = meterAggObj.GetFaultState();
 
   if(false == isMeterFault) // Only proceed if no fault detected with meter
   {
-    isMeterDataAvail = acuvimObj.Control(&meterData);   //poll meter for new measurements.
+    isMeterDataAvail = meterAggObj.Control(&meterData); //collect new meter measurements.
 
     if (true == isMeterDataAvail)   // proceed if fresh meter data
     {
@@ -263,7 +386,7 @@ bool POWER_CTRL::ReadMeter(void)
     }
     else
     {
-      if (meterLatency_ms <= UINT16_MAX)
+      if (meterLatency_ms < UINT16_MAX)
       {
         meterLatency_ms++;
       }
@@ -293,20 +416,7 @@ bool POWER_CTRL::ReadMeter(void)
  **************************************************************************************************/
 double POWER_CTRL::ScaleAnalogue(double value)
 {
-  double scaledValue;
-
-  scaledValue = ((value / 2) + 0.5) * 10.5 ;
-
-  if(scaledValue > 10.5F)
-  {
-    scaledValue > 10.5F;
-  }
-  if(scaledValue < 0.0F)
-  {
-    scaledValue = 0.0F;
-  }
-
-  return scaledValue;
+  return KERNEL_ScaleAnalogue<double>(value);
 }
 
 /***************************************************************************************************
@@ -343,227 +453,933 @@ void POWER_CTRL::PidParamsAnaOut(double setpoint, double measuredValue, double p
 
 /***************************************************************************************************
  *
- * ManagePower
- * This function is called to get the power demand and run the PID.
+ * GetModeDemand
+ * This function gets the power demand of the requested operating mode. Frequency response
+ * services have the SoC management baseline added, and all demands are limited to the power
+ * available at the present SoC.
  *
  * Parameter(s): 
- * None
+ * frequency - the grid frequency to respond to
+ * sysCount - system counter
  *
  * Return:
- * true if CAN message has been transmitted.
+ * The power demand (0.1kW units)
  *
  **************************************************************************************************/
-bool POWER_CTRL::ManagePower(uint16_t sysCount)
+double POWER_CTRL::GetModeDemand(double frequency, uint16_t sysCount)
 {
-  double unadjustedDemand;
-  double adjustedDemand;
-  bool txInProgress = false;
-  static bool pinToggle = false;
-  double error;
+  double demand = 0.0;
+  bool isResponseService = true;
 
-  if(true == pinToggle)
-  {
-    digital_outputs.set(0, HIGH);
-    pinToggle = false;
-  }
-  else
-  {
-    digital_outputs.set(0, LOW);
-    pinToggle = true;
-  }
+  /* a running test profile replaces the measured frequency */
+  (void)testProfileObj.GetFrequency(&frequency);
 
   switch (requestedState.operatingMode)
   {
     case TRADING:
-      unadjustedDemand = flexObj.GetDemand();
+      /* the schedule runs on its own clock, Flex's live demand is only used outside it */
+      if (false == scheduleObj.GetDemand(&demand))
+      {
+        demand = flexObj.GetDemand();
+      }
+      isResponseService = false;
       break;
 
     case DC:
-      unadjustedDemand = opModeObj.DC_Control(meterData.frequency, sysCount);
+      demand = opModeObj.DC_Control(frequency, sysCount);
+      break;        
+
+    case DM:
+      demand = opModeObj.DM_Control(frequency, sysCount);
+      break;        
+
+    case DR:
+      demand = opModeObj.DR_Control(frequency, sysCount);
       break;        
       
     case FFR:
-      unadjustedDemand = opModeObj.FFR_Control(meterData.frequency);
+      demand = opModeObj.FFR_Control(frequency, sysCount);
       break;
 
     case DS3:
-      unadjustedDemand = opModeObj.DS3_Control(meterData.frequency);
+      demand = opModeObj.DS3_Control(frequency, sysCount);
       break;
 
     case PID_TEST1:
-      unadjustedDemand = opModeObj.PID_TestControl1(sysCount);
+      demand = opModeObj.PID_TestControl1(sysCount);
+      isResponseService = false;
       break;
 
     case PID_TEST2:
-      unadjustedDemand = opModeObj.PID_TestControl2();
+      demand = opModeObj.PID_TestControl2();
+      isResponseService = false;
       break;
 
     default:
       /* invalid state */
+      isResponseService = false;
       break;
   }
 
-  if (AC_POWER_CONTROL_MODE == mode)
+  /* frequency response services carry the SoC management baseline */
+  if (true == isResponseService)
   {
-    pcAcObj[AC_POWER_CONTROL].setPointScaled = unadjustedDemand;
-    pcAcObj[AC_POWER_CONTROL].measuredScaled = meterData.totalPowerReal;
+    demand += socMgrObj.GetBaseline();
+  }
+
+  return socMgrObj.Limit(demand);
+}
+
+/***************************************************************************************************
+ *
+ * ManagePowerOpenLoop
+ * This function is called in degraded mode, when there is no power measurement to close the loop
+ * on. The mode demand is converted to an inverter command through the inverse characteristic of
+ * the inverter (DemandAdjust) and sent without PID correction.
+ *
+ * Parameter(s): 
+ * frequency - the grid frequency from the degraded frequency source
+ * sysCount - system counter
+ *
+ * Return:
+ * true if CAN message has been transmitted.
+ *
+ **************************************************************************************************/
+bool POWER_CTRL::ManagePowerOpenLoop(double frequency, uint16_t sysCount)
+{
+  double unadjustedDemand;
+
+  /* no measurement, so the SoC is tracked from the last demand */
+  socMgrObj.Update(pcAcObj[AC_POWER_CONTROL].setPointScaled, sysCount);
+
+  unadjustedDemand = GetModeDemand(frequency, sysCount);
+
+  openLoopDemand = DemandAdjust(unadjustedDemand);
+
+  pcAcObj[AC_POWER_CONTROL].setPointScaled = unadjustedDemand;
+
+  return canObj.SetPower(openLoopDemand, reactCtrlObj.Hold(openLoopDemand, (double)maxRated));
+}
+
+/***************************************************************************************************
+ *
+ * ManagePowerRocof
+ * This function is called between meter samples while a RoCoF event is waiting for a response.
+ * The mode demand for the latest frequency is found early, so a product the event triggers is
+ * armed now rather than at the next meter sample. The modes step on the time elapsed since their
+ * last call, so the extra calls between samples do not move a ramp on any further.
+ * Only if the demand has moved is it sent straight away through the inverse characteristic of the
+ * inverter, and the PID restarted from that command so the next meter sample carries on from it.
+ * Otherwise the PID keeps its state and no frame is sent.
+ *
+ * Parameter(s): 
+ * sysCount - system counter
+ *
+ * Return:
+ * true if CAN message has been transmitted.
+ *
+ **************************************************************************************************/
+bool POWER_CTRL::ManagePowerRocof(uint16_t sysCount)
+{
+  double unadjustedDemand;
+  double frequency;
+
+  if ((AC_POWER_CONTROL_MODE != mode) || (false == freqSourceObj.GetFrequency(&frequency)))
+  {
+    return false;
+  }
+
+  unadjustedDemand = GetModeDemand(frequency, sysCount);
+
+  if (fabs(unadjustedDemand - pcAcObj[AC_POWER_CONTROL].setPointScaled) < ROCOF_MIN_DEMAND_STEP)
+  {
+    return false;
+  }
+
+  openLoopDemand = DemandAdjust(unadjustedDemand);
+  pcAcObj[AC_POWER_CONTROL].setPointScaled = unadjustedDemand;
+  ResumeClosedLoop();
+
+  return canObj.SetPower(openLoopDemand, reactCtrlObj.Hold(openLoopDemand, (double)maxRated));
+}
+
+/***************************************************************************************************
+ *
+ * ResumeClosedLoop
+ * This function is called when the meter returns after degraded mode. The PID is restarted with
+ * its output equal to the last open-loop command, so the inverter command does not step.
+ *
+ * Parameter(s): 
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void POWER_CTRL::ResumeClosedLoop(void)
+{
+  pcAcObj[AC_POWER_CONTROL].pidOutput = openLoopDemand;
+  pcAcObj[AC_POWER_CONTROL].measuredScaled = meterData.totalPowerReal;
+  /* the open-loop commands were not modelled, so the model starts again where the inverter is */
+  smithPredObj.Reset(meterData.totalPowerReal, micros());
+  /* the next PID step carries on from the open-loop command, which is all feedforward */
+  if (CTRL_FF_PLUS_TRIM == ctrlStructure)
+  {
+    feedforward = openLoopDemand;
+    powerPid.Reset(0.0, meterData.totalPowerReal);
+    trimReference = meterData.totalPowerReal;
+  }
+  else
+  {
+    feedforward = 0.0;
+    powerPid.Reset(openLoopDemand, meterData.totalPowerReal);
+  }
+  isStructureChanged = false;
+}
+
+/***************************************************************************************************
+ *
+ * ManageAutoTune
+ * This function is called on each meter sample while the power PID is being auto-tuned. The
+ * auto-tune drives the inverter command, and the experiment is only kept going at the constant
+ * PID_TEST2 demand. When it ends, good gains are applied and stored, and the PID carries on from
+ * the last command.
+ *
+ * Parameter(s): 
+ * dt_s - time since the last meter sample
+ *
+ * Return:
+ * true if CAN message has been transmitted.
+ *
+ **************************************************************************************************/
+bool POWER_CTRL::ManageAutoTune(double dt_s)
+{
+  autotuneResultStruct_t result;
+  gainSchedSetStruct_t factors;
+  smithModelStruct_t smithModel;
+
+  if (PID_TEST2 != requestedState.operatingMode)
+  {
+    autoTuneObj.Stop();
+  }
+  else
+  {
+    openLoopDemand = autoTuneObj.Update(meterData.totalPowerReal, dt_s);
+  }
+  pcAcObj[AC_POWER_CONTROL].measuredScaled = meterData.totalPowerReal;
+  lutLearnObj.Restart();
+
+  if (false == autoTuneObj.IsRunning())
+  {
+    autoTuneObj.GetResult(&result);
+
+    if (AUTOTUNE_DONE == autoTuneObj.GetState())
+    {
+      /* the tuned gains are right at the tuning point, so the base gains are the tuned gains
+         without the scheduling factors there */
+      gainSchedObj.GetFactors(GAIN_SCHED_TEST, pcAcObj[AC_POWER_CONTROL].setPointScaled,
+                              (double)maxRated, &factors);
+      pcAcObj[AC_POWER_CONTROL].pGain = (factors.kp > 0.0) ? (result.kp / factors.kp) :
+                                                             result.kp;
+      pcAcObj[AC_POWER_CONTROL].iGain = result.ki / factors.ki;
+      pcAcObj[AC_POWER_CONTROL].dGain = (factors.kd > 0.0) ? (result.kd / factors.kd) : 0.0;
+      powerPid.SetTunings(result.kp, result.ki, result.kd);
+      SaveParams();
+      Serial.println("Auto-tune done, gains stored");
+
+      /* the relay experiment also identifies the inverter for the Smith predictor */
+      smithPredObj.GetModel(&smithModel);
+      smithModel.tau_s = result.tau_s;
+      smithModel.deadTime_s = result.theta_s;
+      if (false == smithPredObj.SetModel(&smithModel))
+      {
+        Serial.println("Identified model out of range, Smith predictor model kept");
+      }
+    }
+    else
+    {
+      Serial.print("Auto-tune failed: ");
+      Serial.println(autoTuneObj.GetFailure());
+    }
+
+    ResumeClosedLoop();
+  }
+
+  return canObj.SetPower(openLoopDemand, reactCtrlObj.Hold(openLoopDemand, (double)maxRated));
+}
+
+/***************************************************************************************************
+ *
+ * ManagePower
+ * This function is called to get the power demand and run the PID.
+ *
+ * Parameter(s): 
+ * None
+ *
+ * Return:
+ * true if CAN message has been transmitted.
+ *
+ **************************************************************************************************/
+bool POWER_CTRL::ManagePower(uint16_t sysCount)
+{
+  double unadjustedDemand;
+  double adjustedDemand;
+  bool txInProgress = false;
+  static bool pinToggle = false;
+  double error;
+  double frequency;
+  static double lastFrequency = NOMINAL_GRID_FREQ;
+  uint16_t elapsed_ms;
+  double dt_s;
+  double reference;
+  double feedback;
+  double demand;
+  double realLimit;
+  double reactiveLimit;
+  double reactiveCommand;
+  gainSchedSetStruct_t factors;
+
+  /* the PID steps once per meter sample, over the time since the last one. After a gap (start up
+     or degraded mode) the step is taken as one meter period */
+  elapsed_ms = (uint16_t)(sysCount - pidSysCount);
+  pidSysCount = sysCount;
+  if (elapsed_ms > PID_MAX_GAP_MS)
+  {
+    elapsed_ms = OPEN_LOOP_SCHEDULE;
+    /* the loop was not running, so an auto-tune has lost its operating point */
+    autoTuneObj.Stop();
+  }
+  dt_s = (double)elapsed_ms / 1000.0;
+
+  if(true == pinToggle)
+  {
+    digital_outputs.set(0, HIGH);
+    pinToggle = false;
+  }
+  else
+  {
+    digital_outputs.set(0, LOW);
+    pinToggle = true;
+  }
+
+  /* frequency comes from the active frequency source, which may not be the meter that delivered
+     this power measurement */
+  if (false == freqSourceObj.GetFrequency(&frequency))
+  {
+    frequency = lastFrequency;
+  }
+  lastFrequency = frequency;
+
+  socMgrObj.Update(meterData.totalPowerReal, sysCount);
+
+  unadjustedDemand = GetModeDemand(frequency, sysCount);
+
+  if ((AC_POWER_CONTROL_MODE == mode) && (true == autoTuneObj.IsRunning()))
+  {
+    pcAcObj[AC_POWER_CONTROL].setPointScaled = unadjustedDemand;
+    txInProgress = ManageAutoTune(dt_s);
+  }
+  else if (AC_POWER_CONTROL_MODE == mode)
+  {
+    pcAcObj[AC_POWER_CONTROL].setPointScaled = unadjustedDemand;
+    pcAcObj[AC_POWER_CONTROL].measuredScaled = meterData.totalPowerReal;
+
+    /* with the Smith predictor on, the PID sees the power the inverter will deliver once the dead
+       time has passed, otherwise the measured power */
+    feedback = smithPredObj.Feedback(meterData.totalPowerReal, micros());
+
+    /* the reactive power target, then the share of the apparent rating left for real power */
+    (void)reactCtrlObj.Target(meterData.totalPowerReal, meterData.averageLineVoltage, dt_s);
+    reactCtrlObj.Limits(unadjustedDemand, (double)maxRated, &realLimit, &reactiveLimit);
+    demand = unadjustedDemand;
+    if (demand > realLimit)
+    {
+      demand = realLimit;
+    }
+    else if (demand < -realLimit)
+    {
+      demand = -realLimit;
+    }
+    else
+    {
+      /* within the limit */
+    }
+
+    /* learn the inverter characteristic from the command in force when the power was measured */
+    lutLearnObj.Update(pcAcObj[AC_POWER_CONTROL].pidOutput, meterData.totalPowerReal, sysCount);
+    
+    /* the feedforward gives the command the inverter characteristic needs for the demand, so
+       the PID only has to correct the residual */
+    if (true == isStructureChanged)
+    {
+      trimReference = pcAcObj[AC_POWER_CONTROL].measuredScaled;
+    }
+
+    if (CTRL_FF_PLUS_TRIM == ctrlStructure)
+    {
+      feedforward = DemandAdjust(demand);
+      reference = trimReference;
+      trimReference += (1.0 - exp(-((double)elapsed_ms / CTRL_FF_MODEL_MS))) *
+                       (demand - trimReference);
+    }
+    else
+    {
+      feedforward = 0.0;
+      reference = demand;
+    }
+
+    if (true == isStructureChanged)
+    {
+      /* carry on from the last command without a step */
+      powerPid.Reset(pcAcObj[AC_POWER_CONTROL].pidOutput - feedforward, feedback);
+      isStructureChanged = false;
+    }
+
+    /* gains for the mode and power level; the PID takes up the change without a step */
+    gainSchedObj.GetFactors(GainSchedClass(requestedState.operatingMode), unadjustedDemand,
+                            (double)maxRated, &factors);
+    powerPid.SetTunings(pcAcObj[AC_POWER_CONTROL].pGain * factors.kp,
+                        pcAcObj[AC_POWER_CONTROL].iGain * factors.ki,
+                        pcAcObj[AC_POWER_CONTROL].dGain * factors.kd);
+
+    /* Run the PID controller, limited so that the total command stays within the rating */
+    powerPid.SetOutputLimits(-realLimit - feedforward, realLimit - feedforward);
+    pcAcObj[AC_POWER_CONTROL].pidOutput = feedforward + 
+                                          powerPid.Compute(reference, feedback, dt_s);
+
+    /* the PID's own limits already wind its integrator back. Only if the command has to be
+       clamped again to fit the frame does the integrator track the command actually sent */
+    adjustedDemand = pcAcObj[AC_POWER_CONTROL].pidOutput;
+    if (adjustedDemand > (double)maxRated)
+    {
+      adjustedDemand = (double)maxRated;
+    }
+    else if (adjustedDemand < -(double)maxRated)
+    {
+      adjustedDemand = -(double)maxRated;
+    }
+    else
+    {
+      /* within the frame's range */
+    }
+
+    if (adjustedDemand != pcAcObj[AC_POWER_CONTROL].pidOutput)
+    {
+      powerPid.Track(adjustedDemand - feedforward);
+      pcAcObj[AC_POWER_CONTROL].pidOutput = adjustedDemand;
+    }
+
+    /* real and reactive power go in the same frame */
+    reactiveCommand = reactCtrlObj.Compute(reactiveLimit, meterData.totalPowerReactive, dt_s);
+    txInProgress = canObj.SetPower(adjustedDemand, reactiveCommand);
+    smithPredObj.Sent(invLutObj.Power(adjustedDemand), micros());
+    
+    /* write representation of PID parameters to Analogue out for test/tuning */
+    PidParamsAnaOut(pcAcObj[AC_POWER_CONTROL].setPointScaled,   /* AO 0 */
+                    pcAcObj[AC_POWER_CONTROL].measuredScaled,   /* AO 1 */
+                    pcAcObj[AC_POWER_CONTROL].pidOutput);       /* AO 2 */
+  }
+  else if (AC_CURRENT_CONTROL_MODE == mode)
+  {
+    /* Scale the setpoint between -1.0 and +1.0 */
+    SetCurrentSetpoint(adjustedDemand);
+
+    pcAcObj[AC_CURRENT_CONTROL].measuredScaled = ScaleEngUnit(meterData.averagePhaseCurrent, 
+                                                                  -(maxRated), 
+                                                                  maxRated, 
+                                                                  false);
+    
+    /* real current PID control. Output is a scaled number from -1.0 to +1.0 */
+    //pid_output = pidObj.Update(&pcAcObj[AC_CURRENT_CONTROL_MODE].real);
+    pcAcObj[AC_CURRENT_CONTROL].pidOutput = 
+      currentPid.Compute(pcAcObj[AC_CURRENT_CONTROL].setPointScaled,
+                         pcAcObj[AC_CURRENT_CONTROL].measuredScaled,
+                         dt_s);
+    /* Convert scaled output into real units */        
+    adjustedDemand = SetCurrentControl(pcAcObj[AC_CURRENT_CONTROL].pidOutput);
+    
+    //txInProgress = canObj.SetCurrent(adjustedDemand, 0);
+    txInProgress = canObj.SetCurrent(adjustedDemand, 0);
+
+    /* write representation of PID parameters to Analogue out for test/tuning */
+    PidParamsAnaOut(pcAcObj[AC_CURRENT_CONTROL].setPointScaled,
+                    pcAcObj[AC_CURRENT_CONTROL].measuredScaled, 
+                    pcAcObj[AC_CURRENT_CONTROL].pidOutput);
+  }
+  else
+  {
+    /* invalid control mode */
+  } 
+
+  #ifdef CTRL_TRACE
+   TraceSample(frequency, unadjustedDemand);
+  #endif
+
+  return txInProgress;
+}
+
+/***************************************************************************************************
+ *
+ * TxSchedule
+ * This function is called to schedule transmission of the periodic CAN messages. It ensures
+ * a gap between transmission to prevent message overrun.
+ *
+ * Parameter(s): 
+ * sysCounter
+ *
+ * Return:
+ * true if CAN message sent (will always be this), otherwise false
+ *
+ **************************************************************************************************/
+bool POWER_CTRL::TxInverterOnOff(bool inverterEnable)
+{
+  bool txInProgress = false;
+  // Send inverter disable/enable signal every 100ms
+  if (true == inverterEnable)
+  {
+    txInProgress = canObj.InverterEnable();
+  }
+  else
+  {
+    txInProgress = canObj.InverterDisable();
+  }
+  return txInProgress;
+}
+
+/***************************************************************************************************
+ *
+ * DisplayControllerState
+ * This function is called to transmit the inverter state out of the debug port.
+ *
+ * Parameter(s): 
+ * state
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void POWER_CTRL::DisplayControllerState(statusBitsEnum_t state)
+{
+  Serial.print("Inverter State: ");
+
+  switch (state)
+  {
+    case POWER_ON_RESET: 
+      Serial.println("POWER_ON_RESET");
+      break;
+    case READY: 
+      Serial.println("READY");
+      break;        
+    case FOLLOWING: 
+      Serial.println("FOLLOWING");
+      break;     
+    case FAULT:          
+      Serial.println("FAULT");
+      break;
+    case FORMING:        
+      Serial.println("FORMING");
+      break;
+    case RECONNECT_DELAY:
+      Serial.println("RECONNECT_DELAY");
+      break;
+    case NA_1:           
+      Serial.println("NA_1");
+      break;
+    case GRID_LOST:      
+      Serial.println("GRID_LOST");
+      break;
+    case CHARGING:       
+      Serial.println("CHARGING");
+      break;
+    case RIDE_THROUGH:   
+      Serial.println("RIDE_THROUGH");
+      break;
+    case CESSATION:      
+      Serial.println("CESSATION");
+      break;
+    case TRANSITIONING:  
+      Serial.println("TRANSITIONING");
+      break;
+    case INHIBITED:      
+      Serial.println("INHIBITED");
+      break;
+    case CONNECT_DELAY:  
+      Serial.println("CONNECT_DELAY");
+      break;
+    case NA_2:           
+      Serial.println("NA_2");
+      break;
+    case NA_3:           
+      Serial.println("NA_3");
+      break;
+    default:
+      Serial.println("UNKNOWN_STATE");
+      break;  
+  }
+}
+
+/***************************************************************************************************
+ *
+ * SerialCommand
+ * This function reads a command from the serial port, if one has arrived, and passes it on by its
+ * first word:
+ *   tp       test profile engine (TestProfile.cpp)
+ *   rocof    RoCoF measurement (Rocof.cpp)
+ *   ctrl     control structure (CtrlCommand)
+ *   lut      inverter characteristic learning (LutLearn.cpp)
+ *   tune     power PID auto-tuning (AutoTuneCommand)
+ *   gs       gain scheduling (GainSched.cpp)
+ *   smith    Smith predictor (SmithCommand)
+ *   q        reactive power control (ReactCtrl.cpp)
+ * The first word must match exactly, so e.g. "quit" is not a reactive power command. With PID_TUNE
+ * defined anything else is a PID tuning command.
+ *
+ * Parameter(s): 
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void POWER_CTRL::SerialCommand(void)
+{
+  String command;
+  String name;
+  int position = 0;
+
+  if (Serial.available() > 0)
+  {
+    command = Serial.readString();
+
+    /* the command itself is passed on as received, the PID tuning command counts its line end */
+    name = command;
+    name.trim();
+    name = CMD_NextToken(name, &position);
+
+    if ("tp" == name)
+    {
+      testProfileObj.Command(command);
+    }
+    else if ("rocof" == name)
+    {
+      rocofObj.Command(command);
+    }
+    else if ("ctrl" == name)
+    {
+      CtrlCommand(command);
+    }
+    else if ("lut" == name)
+    {
+      lutLearnObj.Command(command);
+    }
+    else if ("tune" == name)
+    {
+      AutoTuneCommand(command);
+    }
+    else if ("gs" == name)
+    {
+      gainSchedObj.Command(command);
+    }
+    else if ("smith" == name)
+    {
+      SmithCommand(command);
+    }
+    else if ("q" == name)
+    {
+      reactCtrlObj.Command(command);
+    }
+    #ifdef PID_TUNE
+    else
+    {
+      /* allow update of PID gains via serial port */
+      PID_TuneParams(command);
+    }
+    #endif
+  }
+}
+
+/***************************************************************************************************
+ *
+ * CtrlCommand
+ * This function runs a control structure command received on the serial port:
+ *   ctrl          report the control structure
+ *   ctrl pid      PID only
+ *   ctrl ff       feedforward plus PID trim
+ *
+ * Parameter(s): 
+ * command - the command
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void POWER_CTRL::CtrlCommand(String command)
+{
+  command.trim();
+
+  if (true == command.endsWith("pid"))
+  {
+    SetCtrlStructure(CTRL_PID_ONLY);
+  }
+  else if (true == command.endsWith("ff"))
+  {
+    SetCtrlStructure(CTRL_FF_PLUS_TRIM);
+  }
+  else
+  {
+    /* report only */
+  }
+
+  Serial.print("Control structure: ");
+  Serial.println((CTRL_FF_PLUS_TRIM == ctrlStructure) ? "ff + trim" : "pid");
+}
+
+/***************************************************************************************************
+ *
+ * AutoTuneCommand
+ * This function runs a power PID auto-tune command received on the serial port:
+ *   tune                       report the auto-tune state and the last result
+ *   tune zn|tl|simc [pid]      auto-tune by the rule, PI unless pid is given
+ *   tune stop                  abandon the auto-tune
+ * An auto-tune can only be started in the PID_TEST2 mode, about its constant demand.
+ *
+ * Parameter(s): 
+ * command - the command
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void POWER_CTRL::AutoTuneCommand(String command)
+{
+  static const char *STATE_NAMES[] = {"idle", "relay", "validate", "done", "failed"};
+  autotuneResultStruct_t result;
+  pidCtrlConfigStruct_t pidConfig;
+  autotuneRuleEnum_t rule = AUTOTUNE_SIMC;
+  double command0;
+  double gain;
+  bool isOk = false;
 
-    
-    /* Run the PID controller */
-    powerPid.Compute();
-    /* Filter PID output */
-    adjustedDemand = pcAcObj[AC_POWER_CONTROL].pidOutput;
+  command.trim();
 
-    txInProgress = canObj.SetPower(adjustedDemand, 0);
-    
-    /* write representation of PID parameters to Analogue out for test/tuning */
-    PidParamsAnaOut(pcAcObj[AC_POWER_CONTROL].setPointScaled,   /* AO 0 */
-                    pcAcObj[AC_POWER_CONTROL].measuredScaled,   /* AO 1 */
-                    pcAcObj[AC_POWER_CONTROL].pidOutput);       /* AO 2 */
+  if ("tune" == command)
+  {
+    autoTuneObj.GetResult(&result);
+    Serial.print("Auto-tune: ");
+    Serial.print(STATE_NAMES[autoTuneObj.GetState()]);
+    Serial.print(" ");
+    Serial.println(autoTuneObj.GetFailure());
+    Serial.print("Ku, Tu (s): ");
+    Serial.print(result.ku, 3);
+    Serial.print(", ");
+    Serial.println(result.tu_s, 3);
+    Serial.print("P, I, D: ");
+    Serial.print(result.kp, 3);
+    Serial.print(", ");
+    Serial.print(result.ki, 3);
+    Serial.print(", ");
+    Serial.println(result.kd, 4);
+    Serial.print("Step overshoot (%), settle (s): ");
+    Serial.print(result.overshoot * 100.0, 1);
+    Serial.print(", ");
+    Serial.println(result.settle_s, 3);
+    return;
   }
-  else if (AC_CURRENT_CONTROL_MODE == mode)
+  else if (true == command.endsWith("stop"))
   {
-    /* Scale the setpoint between -1.0 and +1.0 */
-    SetCurrentSetpoint(adjustedDemand);
+    autoTuneObj.Stop();
+    isOk = true;
+  }
+  else if ((PID_TEST2 == requestedState.operatingMode) && (AC_POWER_CONTROL_MODE == mode) &&
+           (false == autoTuneObj.IsRunning()))
+  {
+    if (true == command.startsWith("tune zn"))
+    {
+      rule = AUTOTUNE_ZN;
+      isOk = true;
+    }
+    else if (true == command.startsWith("tune tl"))
+    {
+      rule = AUTOTUNE_TL;
+      isOk = true;
+    }
+    else if (true == command.startsWith("tune simc"))
+    {
+      rule = AUTOTUNE_SIMC;
+      isOk = true;
+    }
+    else
+    {
+      /* unknown rule */
+    }
 
-    pcAcObj[AC_CURRENT_CONTROL].measuredScaled = ScaleEngUnit(meterData.averagePhaseCurrent, 
-                                                                  -(maxRated), 
-                                                                  maxRated, 
-                                                                  false);
-    
-    /* real current PID control. Output is a scaled number from -1.0 to +1.0 */
-    //pid_output = pidObj.Update(&pcAcObj[AC_CURRENT_CONTROL_MODE].real);
-    currentPid.Compute();
-    /* Convert scaled output into real units */        
-    adjustedDemand = SetCurrentControl(pcAcObj[AC_CURRENT_CONTROL].pidOutput);
-    
-    //txInProgress = canObj.SetCurrent(adjustedDemand, 0);
-    txInProgress = canObj.SetCurrent(adjustedDemand, 0);
+    if (true == isOk)
+    {
+      /* the relay drives the inverter command directly, so the process gain is the slope of the
+         inverter characteristic at the operating command */
+      command0 = pcAcObj[AC_POWER_CONTROL].pidOutput;
+      gain = (invLutObj.Power(command0 + 100.0) - invLutObj.Power(command0 - 100.0)) / 200.0;
 
-    /* write representation of PID parameters to Analogue out for test/tuning */
-    PidParamsAnaOut(pcAcObj[AC_CURRENT_CONTROL].setPointScaled,
-                    pcAcObj[AC_CURRENT_CONTROL].measuredScaled, 
-                    pcAcObj[AC_CURRENT_CONTROL].pidOutput);
+      powerPid.GetConfig(&pidConfig);
+      pidConfig.outMin = -(double)maxRated;
+      pidConfig.outMax = (double)maxRated;
+
+      isOk = autoTuneObj.Start(pcAcObj[AC_POWER_CONTROL].setPointScaled, command0, &pidConfig,
+                               gain, rule, command.endsWith("pid"));
+    }
   }
   else
   {
-    /* invalid control mode */
-  } 
+    /* not in the PID_TEST2 mode, or already running */
+  }
 
-  return txInProgress;
+  if (true == isOk)
+  {
+    Serial.println("tune ok");
+  }
+  else
+  {
+    Serial.println("tune rejected");
+  }
 }
 
 /***************************************************************************************************
  *
- * TxSchedule
- * This function is called to schedule transmission of the periodic CAN messages. It ensures
- * a gap between transmission to prevent message overrun.
+ * SmithCommand
+ * This function runs a Smith predictor command received on the serial port:
+ *   smith                      report the model and the measured dead time
+ *   smith on                   the PID sees the predicted power
+ *   smith off                  the PID sees the measured power
+ *   smith track                the model dead time follows the measured dead time
+ *   smith fixed                the model dead time stays as set
+ *   smith <tau ms> <dead ms>   set the model time constant and dead time
  *
  * Parameter(s): 
- * sysCounter
+ * command - the command
  *
  * Return:
- * true if CAN message sent (will always be this), otherwise false
+ * None
  *
  **************************************************************************************************/
-bool POWER_CTRL::TxInverterOnOff(bool inverterEnable)
+void POWER_CTRL::SmithCommand(String command)
 {
-  bool txInProgress = false;
-  // Send inverter disable/enable signal every 100ms
-  if (true == inverterEnable)
+  smithModelStruct_t smithModel;
+  smithDeadTimeStruct_t deadTime;
+  int separator;
+  bool isOk = false;
+
+  command.trim();
+  smithPredObj.GetModel(&smithModel);
+
+  if ("smith" == command)
   {
-    txInProgress = canObj.InverterEnable();
+    smithPredObj.GetDeadTime(&deadTime);
+    Serial.print("Smith predictor: ");
+    Serial.println((true == smithPredObj.IsEnabled()) ? "on" : "off");
+    Serial.print("Model gain, tau (ms), dead time (ms): ");
+    Serial.print(smithModel.gain, 3);
+    Serial.print(", ");
+    Serial.print(smithModel.tau_s * 1000.0, 1);
+    Serial.print(", ");
+    Serial.print(smithModel.deadTime_s * 1000.0, 1);
+    Serial.println((true == smithPredObj.IsDeadTimeTracked()) ? " tracked" : " fixed");
+    Serial.print("Measured dead time (ms), last (ms), steps, timeouts: ");
+    Serial.print(deadTime.deadTime_s * 1000.0, 1);
+    Serial.print(", ");
+    Serial.print(deadTime.last_s * 1000.0, 1);
+    Serial.print(", ");
+    Serial.print(deadTime.measurements);
+    Serial.print(", ");
+    Serial.println(deadTime.timeouts);
+    return;
+  }
+  else if ("smith on" == command)
+  {
+    smithPredObj.SetEnabled(true);
+    isOk = true;
+  }
+  else if ("smith off" == command)
+  {
+    smithPredObj.SetEnabled(false);
+    isOk = true;
+  }
+  else if ("smith track" == command)
+  {
+    smithPredObj.SetDeadTimeTracked(true);
+    isOk = true;
+  }
+  else if ("smith fixed" == command)
+  {
+    smithPredObj.SetDeadTimeTracked(false);
+    isOk = true;
   }
   else
   {
-    txInProgress = canObj.InverterDisable();
+    separator = command.indexOf(' ', 6);
+
+    if ((command.length() > 6) && (command.charAt(6) >= '0') && (command.charAt(6) <= '9') &&
+        (separator > 0))
+    {
+      smithModel.tau_s = command.substring(6, separator).toDouble() / 1000.0;
+      smithModel.deadTime_s = command.substring(separator + 1).toDouble() / 1000.0;
+      isOk = smithPredObj.SetModel(&smithModel);
+    }
+  }
+
+  if (true == isOk)
+  {
+    Serial.println("smith ok");
+  }
+  else
+  {
+    Serial.println("smith rejected");
   }
-  return txInProgress;
 }
 
+#ifdef CTRL_TRACE
 /***************************************************************************************************
  *
- * DisplayControllerState
- * This function is called to transmit the inverter state out of the debug port.
+ * TraceSample
+ * This function outputs one trace line on the serial port, for analysis by 
+ * tools/compliance_analyser:
+ *   TR,<time ms>,<frequency mHz>,<delayed frequency mHz>,<demand 0.1kW>,<measured 0.1kW>,<marker>
+ * Values are sent as integers so that no floating point formatting is needed.
  *
  * Parameter(s): 
- * state
+ * frequency - the measured frequency
+ * demand - the power demand of the operating mode (0.1kW units)
  *
  * Return:
  * None
  *
  **************************************************************************************************/
-void POWER_CTRL::DisplayControllerState(statusBitsEnum_t state)
+void POWER_CTRL::TraceSample(double frequency, double demand)
 {
-  Serial.print("Inverter State: ");
+  char line[80];
 
-  switch (state)
-  {
-    case POWER_ON_RESET: 
-      Serial.println("POWER_ON_RESET");
-      break;
-    case READY: 
-      Serial.println("READY");
-      break;        
-    case FOLLOWING: 
-      Serial.println("FOLLOWING");
-      break;     
-    case FAULT:          
-      Serial.println("FAULT");
-      break;
-    case FORMING:        
-      Serial.println("FORMING");
-      break;
-    case RECONNECT_DELAY:
-      Serial.println("RECONNECT_DELAY");
-      break;
-    case NA_1:           
-      Serial.println("NA_1");
-      break;
-    case GRID_LOST:      
-      Serial.println("GRID_LOST");
-      break;
-    case CHARGING:       
-      Serial.println("CHARGING");
-      break;
-    case RIDE_THROUGH:   
-      Serial.println("RIDE_THROUGH");
-      break;
-    case CESSATION:      
-      Serial.println("CESSATION");
-      break;
-    case TRANSITIONING:  
-      Serial.println("TRANSITIONING");
-      break;
-    case INHIBITED:      
-      Serial.println("INHIBITED");
-      break;
-    case CONNECT_DELAY:  
-      Serial.println("CONNECT_DELAY");
-      break;
-    case NA_2:           
-      Serial.println("NA_2");
-      break;
-    case NA_3:           
-      Serial.println("NA_3");
-      break;
-    default:
-      Serial.println("UNKNOWN_STATE");
-      break;  
-  }
+  /* trace the frequency the mode responded to */
+  (void)testProfileObj.GetFrequency(&frequency);
+
+  snprintf(line, sizeof(line), "TR,%lu,%ld,%ld,%ld,%ld,%d",
+           (unsigned long)millis(),
+           (long)round(frequency * 1000.0),
+           (long)round(opModeObj.GetDelayedFrequency() * 1000.0),
+           (long)round(demand),
+           (long)round(meterData.totalPowerReal),
+           (true == testProfileObj.GetMarker()) ? 1 : 0);
+
+  Serial.println(line);
 }
+#endif
 
 #ifdef PID_TUNE
-void POWER_CTRL::PID_TuneParams(void)
+void POWER_CTRL::PID_TuneParams(String pidCommand)
 {
-  String pidCommand;
   String pidType;
   String valueString;
   double value;
   int strLen;
 
-  pidCommand = Serial.readString();
-
   strLen = pidCommand.length();
   
   if(5U == strLen)
@@ -625,6 +1441,10 @@ void POWER_CTRL::PID_TuneParams(void)
  **************************************************************************************************/
 void POWER_CTRL::Init(void)
 {
+    pidCtrlConfigStruct_t pidConfig;
+    smithModelStruct_t smithModel = {1.0, CTRL_SMITH_TAU_MS / 1000.0,
+                                     CTRL_SMITH_DEAD_TIME_MS / 1000.0};
+
     pcAcObj[AC_POWER_CONTROL].setPointScaled = 0.0;
     pcAcObj[AC_POWER_CONTROL].measuredScaled = 0.0;
 
@@ -643,28 +1463,52 @@ void POWER_CTRL::Init(void)
     pcAcObj[AC_CURRENT_CONTROL].dGain = d_currentGain;
     /* End GetStoredParams must be called before initialising these params */
 
-    acuvimObj.Init();   /* Initialise the meter */
+    (void)invLutObj.Init(INV_TABLE, INV_TABLE_ROWS, &INV_GRIDS);  /* inverter characteristic */
+    lutLearnObj.Init(&invLutObj, maxRated);   /* Restore what has been learnt of it */
+    (void)smithPredObj.Init(&smithModel, (double)maxRated);   /* Dead time compensation */
+    smithPredObj.SetEnabled(CTRL_SMITH_DEFAULT);
+    smithPredObj.SetDeadTimeTracked(true);
+    reactCtrlObj.Init(NOMINAL_LINE_VOLTAGE, REACT_MAX_REACTIVE);   /* Reactive power control */
+    meterAggObj.Init(); /* Initialise the meters */
+    CURVE_Init();       /* Load the default response curves */
+    socMgrObj.Init(maxRated); /* Restore the battery SoC */
+    RTC_Init();               /* Align the clock to the RTC */
+    scheduleObj.Init();       /* Restore the trading schedule */
+    testProfileObj.Init();    /* Start the power up test profile, if there is one */
     canObj.Init();      /* Initialise the CAN bus */
-    #ifdef HIL_TST
+    #ifdef FREQ_EST_FITTED
+     freqEstObj.Init(FREQ_EST_SAMPLE_RATE_HZ);
+     (void)ADC_Init(FREQ_EST_SAMPLE_RATE_HZ);   /* start sampling the voltage waveform */
+    #endif
+    #if defined HIL_TST || defined FREQ_ANALOGUE_FITTED
      hilTestObj.Init(maxRated);
+     freqSourceObj.Init(&meterAggObj, &hilTestObj, WAVEFORM_EST);
+    #else
+     freqSourceObj.Init(&meterAggObj, NULL, WAVEFORM_EST);
     #endif
-    powerPid.SetOutputLimits(-(double)maxRated, (double)maxRated);
-    powerPid.SetTunings(pcAcObj[AC_POWER_CONTROL].pGain,
-                        pcAcObj[AC_POWER_CONTROL].iGain, 
-                        pcAcObj[AC_POWER_CONTROL].dGain);
-    powerPid.SetSampleTime(20);
-    powerPid.SetMode(AUTOMATIC);
-
-    currentPid.SetOutputLimits(-10.0, 10.0);
-    currentPid.SetTunings(pcAcObj[AC_CURRENT_CONTROL].pGain,
-                          pcAcObj[AC_CURRENT_CONTROL].iGain, 
-                          pcAcObj[AC_CURRENT_CONTROL].dGain);
-    currentPid.SetSampleTime(20);
-    currentPid.SetMode(AUTOMATIC);
+    pidConfig.kp = pcAcObj[AC_POWER_CONTROL].pGain;
+    pidConfig.ki = pcAcObj[AC_POWER_CONTROL].iGain;
+    pidConfig.kd = pcAcObj[AC_POWER_CONTROL].dGain;
+    pidConfig.setpointWeight = POWER_PID_SETPOINT_WEIGHT;
+    pidConfig.derivWeight = 0.0;
+    pidConfig.trackingTime_s = 0.0;
+    pidConfig.outMin = -(double)maxRated;
+    pidConfig.outMax = (double)maxRated;
+    pidConfig.rateLimit = POWER_PID_RATE_LIMIT * (double)maxRated;
+    powerPid.SetConfig(&pidConfig);
+    powerPid.Reset(0.0, 0.0);
+
+    pidConfig.kp = pcAcObj[AC_CURRENT_CONTROL].pGain;
+    pidConfig.ki = pcAcObj[AC_CURRENT_CONTROL].iGain;
+    pidConfig.kd = pcAcObj[AC_CURRENT_CONTROL].dGain;
+    pidConfig.setpointWeight = 1.0;
+    pidConfig.outMin = -10.0;
+    pidConfig.outMax = 10.0;
+    pidConfig.rateLimit = 0.0;
+    currentPid.SetConfig(&pidConfig);
+    currentPid.Reset(0.0, 0.0);
 
-    #ifdef PID_TUNE
     Serial.setTimeout(1);  /*2ms timeout for reading serial port */
-    #endif
     lp_filter_init(&hil_filter);
 }
 
@@ -701,6 +1545,19 @@ void POWER_CTRL::Control(uint16_t sysCounter)
   static uint16_t txDelay = 0U;
   static bool toggle0 = false;
   static bool toggle1 = false;
+  static uint32_t degradedTime_ms = 0U;
+  static uint16_t noFreqTime_ms = 0U;
+  static double rocofBaseDemand = 0.0;
+  bool isFreqOk;
+  bool isRocofEvent;
+  double degradedFreq;
+  double rocofFreq;
+  flexOperatingStateStruct_t newState = requestedState;
+
+  CURVE_Update();                       // swap in any response curves loaded since last tick
+  scheduleObj.Update();                 // swap in a trading schedule loaded since last tick
+  testProfileObj.Control(sysCounter);   // step the frequency test profile, if one is running
+  SerialCommand();                      // test profile and PID tuning commands
 
   #ifdef HIL_TST
    static uint16_t meterDelay = 0U;
@@ -714,6 +1571,54 @@ void POWER_CTRL::Control(uint16_t sysCounter)
    flexFault = flexObj.Control();        // comms with Flex controller
   #endif
 
+  #ifdef FREQ_EST_FITTED
+   static uint16_t waveform[ADC_MAX_READ];
+   uint16_t noofSamples;
+   uint16_t totalSamples = 0U;
+
+   /* estimate frequency from the waveform sampled since last tick */
+   do
+   {
+     noofSamples = ADC_Read(waveform, ADC_MAX_READ);
+     freqEstObj.Process(waveform, noofSamples);
+     totalSamples += noofSamples;
+   } while (ADC_MAX_READ == noofSamples);
+
+   if (0U == totalSamples)
+   {
+     freqEstObj.Reset();   /* sampling has stopped, so the estimate would never age */
+   }
+  #endif
+
+  isFreqOk = freqSourceObj.Control();   // select and cross-check the frequency source
+
+  /* RoCoF runs on the frequency the modes respond to, including a test profile */
+  if (true == freqSourceObj.GetFrequency(&rocofFreq))
+  {
+    (void)testProfileObj.GetFrequency(&rocofFreq);
+    rocofObj.Update(rocofFreq);
+  }
+  else
+  {
+    rocofObj.Reset();
+  }
+  isRocofEvent = rocofObj.GetNewEvent();
+
+  if (true == isRocofEvent)
+  {
+    /* the response is the first frame that moves the demand from here */
+    rocofBaseDemand = pcAcObj[AC_POWER_CONTROL].setPointScaled;
+  }
+
+  if (true == isFreqOk)
+  {
+    noFreqTime_ms = 0U;
+  }
+  else if (noFreqTime_ms < UINT16_MAX)
+  {
+    noFreqTime_ms++;
+  }
+
   canRxTimeout = canObj.RxPoll();       // poll for received CAN messages 
 
   /* if controller state changes, output new state to debug port */
@@ -750,16 +1655,19 @@ void POWER_CTRL::Control(uint16_t sysCounter)
         {
           case TRADING:
           case DC:
+          case DM:
+          case DR:
+          case FFR:
+          case DS3:
+          case PID_TEST1:
+          case PID_TEST2:
             #ifdef HIL_TST
              /* leave maxRated as default value */
             #else
              maxRated = flexObj.GetMaxPowerRating();
             #endif
-            opModeObj.DC_Init(maxRated, sysCounter);            
-          case FFR:
-          case DS3:
-          case PID_TEST1:
-          case PID_TEST2:
+            opModeObj.Init(maxRated);
+
             /* valid operating state received, so move to next state */
             txInProgress = canObj.InverterClrFaults();
             startTime = sysCounter;
@@ -815,15 +1723,37 @@ void POWER_CTRL::Control(uint16_t sysCounter)
       inverterState = canObj.GetInverterState();
       
       if((true == canRxTimeout) ||
-         (false == isMeterOk)   ||
          (true == flexFault)    ||
          (FAULT == inverterState))       
       {
         controllerState = CONTROLLER_STATE_STOP_ENTRY;
         Serial.println("Controller State: RUN TO STOP");
       }
+      else if (noFreqTime_ms >= FREQ_LOSS_STOP_MS)
+      {
+        controllerState = CONTROLLER_STATE_STOP_ENTRY;
+        Serial.println("Controller State: RUN TO STOP (no frequency)");
+      }
+      else if (false == isMeterOk)
+      {
+        controllerState = CONTROLLER_STATE_DEGRADED_ENTRY;
+        Serial.println("Controller State: RUN TO DEGRADED");
+      }
       else
       {
+        #ifndef HIL_TST
+         /* DC, DM and DR can be switched between without a STOP/INIT cycle */
+         flexObj.GetOperatingState(&newState);
+
+         if ((newState.operatingMode != requestedState.operatingMode) &&
+             (true == IsDynamicMode(newState.operatingMode)) &&
+             (true == IsDynamicMode(requestedState.operatingMode)))
+         {
+           requestedState.operatingMode = newState.operatingMode;
+           Serial.println("Controller State: RUN, dynamic service changed");
+         }
+        #endif
+
         #ifdef HIL_TST
          if((0 == (sysCounter % 20U)) &&
         #else
@@ -832,15 +1762,85 @@ void POWER_CTRL::Control(uint16_t sysCounter)
             (FOLLOWING == inverterState))
         {
           newMeterData = false;
-          #ifdef PID_TUNE
-           /* allow update of PID gains via serial port */
-           PID_TuneParams();
-          #endif
 
           txInProgress = ManagePower(sysCounter);                    
         } //if(true == newMeterData) 
+        else if ((true == rocofObj.IsResponsePending()) &&
+                 (true == IsRocofMode(requestedState.operatingMode)) &&
+                 (FOLLOWING == inverterState))
+        {
+          /* pre-empt the meter cadence */
+          txInProgress = ManagePowerRocof(sysCounter);
+        }
+        else
+        {
+          /* wait for the next meter sample */
+        }
+
+        if ((true == txInProgress) && (true == rocofObj.IsResponsePending()) &&
+            (fabs(pcAcObj[AC_POWER_CONTROL].setPointScaled - rocofBaseDemand) >=
+             ROCOF_MIN_DEMAND_STEP))
+        {
+          rocofObj.RecordResponse();
+        }
       }     
       break;
+
+    case CONTROLLER_STATE_DEGRADED_ENTRY:
+      degradedTime_ms = 0U;
+
+      /* Only the frequency response and trading modes can run without measured power */
+      if ((PID_TEST1 == requestedState.operatingMode) ||
+          (PID_TEST2 == requestedState.operatingMode))
+      {
+        controllerState = CONTROLLER_STATE_STOP_ENTRY;
+        Serial.println("Controller State: DEGRADED TO STOP (mode)");
+      }
+      else
+      {
+        controllerState = CONTROLLER_STATE_DEGRADED_DURING;
+      }
+      break;
+
+    case CONTROLLER_STATE_DEGRADED_DURING:
+      inverterState = canObj.GetInverterState();
+      degradedTime_ms++;
+
+      if((true == canRxTimeout) ||
+         (true == flexFault)    ||
+         (FAULT == inverterState))       
+      {
+        controllerState = CONTROLLER_STATE_STOP_ENTRY;
+        Serial.println("Controller State: DEGRADED TO STOP");
+      }
+      else if (degradedTime_ms >= DEGRADED_MAX_TIME_MS)
+      {
+        controllerState = CONTROLLER_STATE_STOP_ENTRY;
+        Serial.println("Controller State: DEGRADED TO STOP (time limit)");
+      }
+      else if ((true == isMeterOk) && (true == newMeterData))
+      {
+        /* meter has returned - hand back to the PID without a step in the command */
+        ResumeClosedLoop();
+        controllerState = CONTROLLER_STATE_RUN_DURING;
+        Serial.println("Controller State: DEGRADED TO RUN");
+      }
+      else if (noFreqTime_ms >= FREQ_LOSS_STOP_MS)
+      {
+        controllerState = CONTROLLER_STATE_STOP_ENTRY;
+        Serial.println("Controller State: DEGRADED TO STOP (no frequency)");
+      }
+      else if ((0U == (sysCounter % OPEN_LOOP_SCHEDULE)) &&
+               (true == freqSourceObj.GetFrequency(&degradedFreq)) &&
+               (FOLLOWING == inverterState))
+      {
+        txInProgress = ManagePowerOpenLoop(degradedFreq, sysCounter);
+      }
+      else
+      {
+        /* hold the last open-loop command */
+      }
+      break;
       
     default:
       /* invalid state */
@@ -978,8 +1978,6 @@ int16_t POWER_CTRL::SetCurrentControl(double controlScaled)
  **************************************************************************************************/
 double POWER_CTRL::DemandAdjust(double powerDemand)
 {
-  uint16_t lutRowIndex = 0;  
-  double rangeFraction;
   double adjustedPowerDemand;
   
   /* limit the power demand */
@@ -996,20 +1994,47 @@ double POWER_CTRL::DemandAdjust(double powerDemand)
     /* demanded power is within range */
   }
 
-  while (powerDemand > CAB1000_LUT[lutRowIndex][1U])
+  /* the request that gives the demanded power, truncated to whole CAN units */
+  adjustedPowerDemand = (int16_t)invLutObj.Command(powerDemand);
+  
+  return adjustedPowerDemand;
+}
+
+/***************************************************************************************************
+ * SetCtrlStructure
+ * 
+ * This function selects the power control structure. The change takes effect on the next PID
+ * step, which carries on from the last command without a step.
+ *
+ * Parameters:
+ * structure - the control structure
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void POWER_CTRL::SetCtrlStructure(ctrlStructureEnum_t structure)
+{
+  if (structure != ctrlStructure)
   {
-    /* Find the row in the LUT where the range starts */
-    lutRowIndex++;
+    ctrlStructure = structure;
+    isStructureChanged = true;
   }
+}
 
-  rangeFraction = ((powerDemand - CAB1000_LUT[lutRowIndex][1U]) / 
-                   (CAB1000_LUT[lutRowIndex + 1U][1U] - CAB1000_LUT[lutRowIndex][1U]));
-
-  /* apply the fraction from the right hand column of LUT to the left hand column and interpolate
-     it, round it up/down and cast back to integer. */
-  adjustedPowerDemand = (int16_t)(((CAB1000_LUT[lutRowIndex + 1U][0U] - 
-                                     CAB1000_LUT[lutRowIndex][0U]) * rangeFraction) + 
-                                     CAB1000_LUT[lutRowIndex][0U]);
-  
-  return adjustedPowerDemand;
+/***************************************************************************************************
+ * GetCtrlStructure
+ * 
+ * This function returns the power control structure.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * The control structure
+ *
+ **************************************************************************************************/
+ctrlStructureEnum_t POWER_CTRL::GetCtrlStructure(void)
+{
+  return ctrlStructure;
 }
@@ -0,0 +1,543 @@
+/***************************************************************************************************
+ * ReactCtrl
+ *
+ * This module controls the reactive power of the inverter, alongside the real power control in
+ * PowerControl.cpp. It runs in the same tick, and its command goes in the same CAN mode 2 frame.
+ *
+ * Modes:
+ *   REACT_OFF       - no reactive power is commanded, as before this module
+ *   REACT_FIXED_Q   - a fixed reactive power
+ *   REACT_FIXED_PF  - Q = |P|.tan(acos(|pf|)), exported for a positive power factor setting and
+ *                     imported for a negative one, from the measured real power
+ *   REACT_VOLT_VAR  - Q from the measured line voltage by a piecewise linear droop curve, the
+ *                     IEEE 1547 category B default unless changed. The voltage is filtered by
+ *                     REACT_VOLT_VAR_TAU_MS, so the response is slow enough not to fight other
+ *                     voltage controllers on the feeder
+ *
+ * The target is passed through as feedforward, and a PI trims the command so the measured
+ * reactive power meets it.
+ *
+ * Real and reactive power share the apparent power rating. With REACT_PRIORITY_P the reactive
+ * power gets what the real demand leaves; with REACT_PRIORITY_Q the real power gets what the
+ * reactive target leaves. Reactive power is also limited to CAB1000_MAX_REACTIVE_P_KVA.
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun Mcsherry
+ *
+ **************************************************************************************************/
+#include <Arduino.h>
+#include <math.h>
+#include "APP/ReactCtrl.h"
+#include "APP/SerialCmd.h"
+
+static const char *REACT_MODE_NAMES[NOOF_REACT_MODES] = {"off", "fixed q", "fixed pf", "volt-var"};
+
+REACT_CTRL reactCtrlObj;
+
+/* private functions */
+/***************************************************************************************************
+ * VoltVar
+ *
+ * This function interpolates the volt-var curve.
+ *
+ * Parameters:
+ * perUnit - the line voltage, per unit
+ *
+ * Return:
+ * The reactive power, as a fraction of the reactive rating, held at the end values beyond the
+ * curve
+ *
+ **************************************************************************************************/
+double REACT_CTRL::VoltVar(double perUnit)
+{
+  uint8_t point;
+
+  if (perUnit <= curve[0].voltage)
+  {
+    return curve[0].reactive;
+  }
+
+  for (point = 1U; point < VOLT_VAR_POINTS; point++)
+  {
+    if (perUnit < curve[point].voltage)
+    {
+      return curve[point - 1U].reactive +
+             (((perUnit - curve[point - 1U].voltage) /
+               (curve[point].voltage - curve[point - 1U].voltage)) *
+              (curve[point].reactive - curve[point - 1U].reactive));
+    }
+  }
+
+  return curve[VOLT_VAR_POINTS - 1U].reactive;
+}
+
+/* Public functions */
+/***************************************************************************************************
+ * Init
+ *
+ * This function sets the ratings and configures the trim PI.
+ *
+ * Parameters:
+ * nominalLineVoltage - nominal line voltage of the grid (volts)
+ * ratedReactive - the most reactive power the inverter can give, either direction (0.1kVAr units)
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void REACT_CTRL::Init(double nominalLineVoltage, double ratedReactive)
+{
+  pidCtrlConfigStruct_t pidConfig;
+
+  nominalVoltage = nominalLineVoltage;
+  maxReactive = ratedReactive;
+
+  pidConfig.kp = REACT_PID_KP;
+  pidConfig.ki = REACT_PID_KI;
+  pidConfig.kd = 0.0;
+  pidConfig.setpointWeight = 1.0;
+  pidConfig.derivWeight = 0.0;
+  pidConfig.trackingTime_s = 0.0;
+  pidConfig.outMin = -maxReactive;
+  pidConfig.outMax = maxReactive;
+  pidConfig.rateLimit = REACT_RATE_LIMIT * maxReactive;
+  pid.SetConfig(&pidConfig);
+  pid.Reset(0.0, 0.0);
+}
+
+/***************************************************************************************************
+ * SetMode
+ *
+ * This function changes the reactive power mode. The trim starts again from zero.
+ *
+ * Parameters:
+ * newMode - the mode
+ * value - the reactive power for REACT_FIXED_Q (0.1kVAr units), or the power factor for
+ *         REACT_FIXED_PF (REACT_MIN_PF to 1, either sign); not used by the other modes
+ *
+ * Return:
+ * true if changed, false if out of range
+ *
+ **************************************************************************************************/
+bool REACT_CTRL::SetMode(reactModeEnum_t newMode, double value)
+{
+  if (REACT_FIXED_Q == newMode)
+  {
+    if (fabs(value) > maxReactive)
+    {
+      return false;
+    }
+    fixedReactive = value;
+  }
+  else if (REACT_FIXED_PF == newMode)
+  {
+    if ((fabs(value) < REACT_MIN_PF) || (fabs(value) > 1.0))
+    {
+      return false;
+    }
+    powerFactor = value;
+  }
+  else if (newMode >= NOOF_REACT_MODES)
+  {
+    return false;
+  }
+  else
+  {
+    /* no setting */
+  }
+
+  mode = newMode;
+  pid.Reset(0.0, measured);
+
+  return true;
+}
+
+/***************************************************************************************************
+ * SetCurve
+ *
+ * This function changes the volt-var curve.
+ *
+ * Parameters:
+ * points - VOLT_VAR_POINTS points, voltage increasing and reactive power not increasing (a droop),
+ *          reactive power -1 to 1
+ *
+ * Return:
+ * true if changed, false if not a droop curve
+ *
+ **************************************************************************************************/
+bool REACT_CTRL::SetCurve(const voltVarPointStruct_t *points)
+{
+  uint8_t point;
+
+  for (point = 0U; point < VOLT_VAR_POINTS; point++)
+  {
+    if ((points[point].voltage <= REACT_MIN_VOLTAGE) || (fabs(points[point].reactive) > 1.0))
+    {
+      return false;
+    }
+
+    if ((point > 0U) && ((points[point].voltage <= points[point - 1U].voltage) ||
+                         (points[point].reactive > points[point - 1U].reactive)))
+    {
+      return false;
+    }
+  }
+
+  for (point = 0U; point < VOLT_VAR_POINTS; point++)
+  {
+    curve[point] = points[point];
+  }
+
+  return true;
+}
+
+/***************************************************************************************************
+ * SetPriority
+ *
+ * This function chooses which of real and reactive power is cut back when both do not fit in the
+ * apparent power rating.
+ *
+ * Parameters:
+ * newPriority - the priority
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void REACT_CTRL::SetPriority(reactPriorityEnum_t newPriority)
+{
+  priority = newPriority;
+}
+
+/***************************************************************************************************
+ * Target
+ *
+ * This function works out the reactive power the mode wants. It should be called on every meter
+ * sample, as the voltage filter runs whatever the mode.
+ *
+ * Parameters:
+ * realPower - measured real power (0.1kW units)
+ * lineVoltage - measured average line voltage (volts)
+ * dt_s - time since the last call
+ *
+ * Return:
+ * The target reactive power (0.1kVAr units)
+ *
+ **************************************************************************************************/
+double REACT_CTRL::Target(double realPower, double lineVoltage, double dt_s)
+{
+  double perUnit;
+  double magnitude;
+
+  perUnit = lineVoltage / nominalVoltage;
+
+  if (perUnit >= REACT_MIN_VOLTAGE)
+  {
+    if (false == isVoltageValid)
+    {
+      voltage = perUnit;
+      isVoltageValid = true;
+    }
+    else
+    {
+      voltage += (1.0 - exp(-((dt_s * 1000.0) / REACT_VOLT_VAR_TAU_MS))) * (perUnit - voltage);
+    }
+  }
+
+  switch (mode)
+  {
+    case REACT_FIXED_Q:
+      target = fixedReactive;
+      break;
+
+    case REACT_FIXED_PF:
+      magnitude = fabs(powerFactor);
+      target = fabs(realPower) * (sqrt(1.0 - (magnitude * magnitude)) / magnitude);
+      if (powerFactor < 0.0)
+      {
+        target = -target;
+      }
+      break;
+
+    case REACT_VOLT_VAR:
+      /* without a voltage measurement the last target is held */
+      if (true == isVoltageValid)
+      {
+        target = VoltVar(voltage) * maxReactive;
+      }
+      break;
+
+    case REACT_OFF:
+    default:
+      target = 0.0;
+      break;
+  }
+
+  return target;
+}
+
+/***************************************************************************************************
+ * Limits
+ *
+ * This function shares the apparent power rating between real and reactive power, by the
+ * priority. It should be called after Target.
+ *
+ * Parameters:
+ * realDemand - the real power demand (0.1kW units)
+ * apparentRating - the apparent power rating (0.1kVA units)
+ * realLimit - updated with the largest real power, either direction (0.1kW units)
+ * reactiveLimit - updated with the largest reactive power, either direction (0.1kVAr units)
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void REACT_CTRL::Limits(double realDemand, double apparentRating, double *realLimit,
+                        double *reactiveLimit)
+{
+  double reactiveCap;
+  double share;
+
+  reactiveCap = (maxReactive < apparentRating) ? maxReactive : apparentRating;
+
+  if (REACT_OFF == mode)
+  {
+    *realLimit = apparentRating;
+    *reactiveLimit = 0.0;
+  }
+  else if (REACT_PRIORITY_Q == priority)
+  {
+    share = (fabs(target) < reactiveCap) ? fabs(target) : reactiveCap;
+    *realLimit = sqrt((apparentRating * apparentRating) - (share * share));
+    *reactiveLimit = reactiveCap;
+  }
+  else
+  {
+    share = (fabs(realDemand) < apparentRating) ? fabs(realDemand) : apparentRating;
+    *realLimit = apparentRating;
+    *reactiveLimit = sqrt((apparentRating * apparentRating) - (share * share));
+    if (*reactiveLimit > reactiveCap)
+    {
+      *reactiveLimit = reactiveCap;
+    }
+  }
+}
+
+/***************************************************************************************************
+ * Compute
+ *
+ * This function runs the trim PI and returns the reactive power command.
+ *
+ * Parameters:
+ * reactiveLimit - the largest reactive power, either direction, from Limits (0.1kVAr units)
+ * measuredReactive - measured reactive power, positive for export (0.1kVAr units)
+ * dt_s - time since the last call
+ *
+ * Return:
+ * The reactive power command (0.1kVAr units)
+ *
+ **************************************************************************************************/
+double REACT_CTRL::Compute(double reactiveLimit, double measuredReactive, double dt_s)
+{
+  double limited;
+
+  measured = measuredReactive;
+
+  if (REACT_OFF == mode)
+  {
+    reactiveCommand = 0.0;
+    return reactiveCommand;
+  }
+
+  limited = target;
+  if (limited > reactiveLimit)
+  {
+    limited = reactiveLimit;
+  }
+  else if (limited < -reactiveLimit)
+  {
+    limited = -reactiveLimit;
+  }
+  else
+  {
+    /* within the limit */
+  }
+
+  /* the trim is limited so that the whole command stays within the limit */
+  pid.SetOutputLimits(-reactiveLimit - limited, reactiveLimit - limited);
+  reactiveCommand = limited + pid.Compute(limited, measuredReactive, dt_s);
+
+  return reactiveCommand;
+}
+
+/***************************************************************************************************
+ * Hold
+ *
+ * This function returns the last reactive power command for a real power command sent without
+ * the closed loop (degraded mode, RoCoF response, auto-tuning), cut back if the real power command
+ * leaves less of the apparent rating.
+ *
+ * Parameters:
+ * realCommand - the real power command (0.1kW units)
+ * apparentRating - the apparent power rating (0.1kVA units)
+ *
+ * Return:
+ * The reactive power command (0.1kVAr units)
+ *
+ **************************************************************************************************/
+double REACT_CTRL::Hold(double realCommand, double apparentRating)
+{
+  double room;
+
+  room = (apparentRating * apparentRating) - (realCommand * realCommand);
+  room = (room > 0.0) ? sqrt(room) : 0.0;
+
+  if (reactiveCommand > room)
+  {
+    return room;
+  }
+  if (reactiveCommand < -room)
+  {
+    return -room;
+  }
+
+  return reactiveCommand;
+}
+
+/***************************************************************************************************
+ * Command
+ *
+ * This function runs a reactive power command received on the serial port:
+ *   q                                  report the mode, the target and the measurement
+ *   q off                              no reactive power
+ *   q fixed <q>                        fixed reactive power (0.1kVAr units, positive exports)
+ *   q pf <pf>                          fixed power factor (positive exports reactive power)
+ *   q vv                               volt-var
+ *   q vv <v1> <q1> ... <v4> <q4>       volt-var with a new curve (voltage per unit, reactive
+ *                                      power as a fraction of the rating)
+ *   q prio p|q                         real or reactive power priority
+ *
+ * Parameters:
+ * command - the command
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void REACT_CTRL::Command(String command)
+{
+  voltVarPointStruct_t points[VOLT_VAR_POINTS];
+  String action;
+  String setting;
+  int position = 0;
+  uint8_t point;
+  bool isOk = false;
+
+  command.trim();
+  (void)CMD_NextToken(command, &position);   /* "q" */
+  action = CMD_NextToken(command, &position);
+
+  if (0 == action.length())
+  {
+    Serial.print("Reactive power: ");
+    Serial.print(REACT_MODE_NAMES[mode]);
+    Serial.println((REACT_PRIORITY_Q == priority) ? ", q priority" : ", p priority");
+    Serial.print("Fixed q (0.1kVAr), pf: ");
+    Serial.print(fixedReactive, 0);
+    Serial.print(", ");
+    Serial.println(powerFactor, 3);
+    Serial.print("Target, command, measured (0.1kVAr): ");
+    Serial.print(target, 0);
+    Serial.print(", ");
+    Serial.print(reactiveCommand, 0);
+    Serial.print(", ");
+    Serial.println(measured, 0);
+    Serial.print("Voltage (pu): ");
+    Serial.println((true == isVoltageValid) ? voltage : 0.0, 3);
+    Serial.println("Volt-var curve (pu, fraction of rating):");
+
+    for (point = 0U; point < VOLT_VAR_POINTS; point++)
+    {
+      Serial.print("  ");
+      Serial.print(curve[point].voltage, 3);
+      Serial.print(", ");
+      Serial.println(curve[point].reactive, 3);
+    }
+    return;
+  }
+  else if ("off" == action)
+  {
+    isOk = SetMode(REACT_OFF, 0.0);
+  }
+  else if ("fixed" == action)
+  {
+    setting = CMD_NextToken(command, &position);
+    isOk = (setting.length() > 0) && SetMode(REACT_FIXED_Q, setting.toDouble());
+  }
+  else if ("pf" == action)
+  {
+    setting = CMD_NextToken(command, &position);
+    isOk = (setting.length() > 0) && SetMode(REACT_FIXED_PF, setting.toDouble());
+  }
+  else if ("vv" == action)
+  {
+    setting = CMD_NextToken(command, &position);
+    isOk = true;
+
+    if (setting.length() > 0)
+    {
+      for (point = 0U; point < VOLT_VAR_POINTS; point++)
+      {
+        if (point > 0U)
+        {
+          setting = CMD_NextToken(command, &position);
+        }
+        points[point].voltage = setting.toDouble();
+        points[point].reactive = CMD_NextToken(command, &position).toDouble();
+      }
+      isOk = SetCurve(points);
+    }
+
+    if (true == isOk)
+    {
+      isOk = SetMode(REACT_VOLT_VAR, 0.0);
+    }
+  }
+  else if ("prio" == action)
+  {
+    setting = CMD_NextToken(command, &position);
+
+    if ("p" == setting)
+    {
+      SetPriority(REACT_PRIORITY_P);
+      isOk = true;
+    }
+    else if ("q" == setting)
+    {
+      SetPriority(REACT_PRIORITY_Q);
+      isOk = true;
+    }
+    else
+    {
+      /* unknown priority */
+    }
+  }
+  else
+  {
+    /* unknown command */
+  }
+
+  if (true == isOk)
+  {
+    Serial.println("q ok");
+  }
+  else
+  {
+    Serial.println("q rejected");
+  }
+}
+
+/* end public functions */
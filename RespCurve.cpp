@@ -0,0 +1,371 @@
+/***************************************************************************************************
+ * RespCurve
+ *
+ * This module evaluates piecewise-linear frequency response curves. A curve is a table of knots
+ * mapping frequency deviation to a fraction of rated power, which may be asymmetric. Segment
+ * slopes are computed once when a table is committed, so evaluation is a segment lookup and one
+ * multiply-add:
+ * - tables with equally spaced knots are indexed directly,
+ * - other tables are binary searched (at most log2(RESP_CURVE_MAX_KNOTS) steps).
+ *
+ * The table build and evaluation (CURVE_Build, CURVE_Evaluate in RespCurve.h) are templated on
+ * the numeric type, so a curve can also be evaluated in float or fixed point; the firmware uses
+ * double.
+ *
+ * Each curve holds two tables. New tables are staged in the inactive one (e.g. from the Modbus
+ * register map) and swapped in by CURVE_Update at the start of a control tick, so a curve never
+ * changes part way through an evaluation.
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun Mcsherry
+ *
+ **************************************************************************************************/
+#include <Arduino.h>
+#include "APP/RespCurve.h"
+
+RESP_CURVE respCurveObj[NOOF_RESP_CURVES];
+
+/* private functions */
+/***************************************************************************************************
+ * Prepare
+ *
+ * This function checks a table is valid and precomputes its segment slopes and grid spacing.
+ *
+ * Parameters:
+ * table - the table to prepare
+ *
+ * Return:
+ * true if the table is valid, otherwise false
+ *
+ **************************************************************************************************/
+bool RESP_CURVE::Prepare(respCurveTableStruct_t *table)
+{
+  uint8_t knot;
+  bool isValid = true;
+
+  if ((table->noofKnots < 2U) || (table->noofKnots > RESP_CURVE_MAX_KNOTS))
+  {
+    isValid = false;
+  }
+
+  for (knot = 0U; (true == isValid) && (knot < table->noofKnots); knot++)
+  {
+    if (fabs(table->knots[knot].y) > RESP_CURVE_MAX_Y)
+    {
+      isValid = false;
+    }
+    else if ((knot > 0U) && (table->knots[knot].x <= table->knots[knot - 1U].x))
+    {
+      /* knots must be in strictly increasing frequency order */
+      isValid = false;
+    }
+    else
+    {
+      /* valid knot */
+    }
+  }
+
+  if (true == isValid)
+  {
+    CURVE_Build(table->knots, table->noofKnots, table);
+  }
+
+  return isValid;
+}
+
+/* Public functions */
+/***************************************************************************************************
+ * Init
+ *
+ * This function loads a table directly into the active buffer. It must only be called before
+ * the control loop starts evaluating the curve.
+ *
+ * Parameters:
+ * knots - the knot table
+ * noofKnots - number of knots in the table
+ *
+ * Return:
+ * true if the table is valid and has been loaded, otherwise false
+ *
+ **************************************************************************************************/
+bool RESP_CURVE::Init(const respCurveKnotStruct_t *knots, uint8_t noofKnots)
+{
+  respCurveTableStruct_t *table = &tables[activeTable];
+  uint8_t knot;
+  bool isValid = false;
+
+  if (noofKnots <= RESP_CURVE_MAX_KNOTS)
+  {
+    for (knot = 0U; knot < noofKnots; knot++)
+    {
+      table->knots[knot] = knots[knot];
+    }
+    table->noofKnots = noofKnots;
+
+    isValid = Prepare(table);
+
+    if (false == isValid)
+    {
+      table->noofKnots = 0U;
+    }
+  }
+
+  isSwapPending = false;
+
+  return isValid;
+}
+
+/***************************************************************************************************
+ * BeginEdit
+ *
+ * This function starts staging a new table, initialised as a copy of the active one.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * true if staging has started, false if a previous commit is still waiting to be swapped in
+ *
+ **************************************************************************************************/
+bool RESP_CURVE::BeginEdit(void)
+{
+  bool isStarted = false;
+
+  if (false == isSwapPending)
+  {
+    tables[activeTable ^ 1U] = tables[activeTable];
+    isStarted = true;
+  }
+
+  return isStarted;
+}
+
+/***************************************************************************************************
+ * SetKnot
+ *
+ * This function sets one knot of the staged table.
+ *
+ * Parameters:
+ * index - knot index
+ * x - frequency deviation (Hz)
+ * y - power fraction
+ *
+ * Return:
+ * true if the knot has been set, otherwise false
+ *
+ **************************************************************************************************/
+bool RESP_CURVE::SetKnot(uint8_t index, double x, double y)
+{
+  bool isSet = false;
+
+  if ((false == isSwapPending) && (index < RESP_CURVE_MAX_KNOTS))
+  {
+    tables[activeTable ^ 1U].knots[index].x = x;
+    tables[activeTable ^ 1U].knots[index].y = y;
+    isSet = true;
+  }
+
+  return isSet;
+}
+
+/***************************************************************************************************
+ * SetNoofKnots
+ *
+ * This function sets the number of knots in the staged table.
+ *
+ * Parameters:
+ * noofKnots - number of knots
+ *
+ * Return:
+ * true if set, otherwise false
+ *
+ **************************************************************************************************/
+bool RESP_CURVE::SetNoofKnots(uint8_t noofKnots)
+{
+  bool isSet = false;
+
+  if ((false == isSwapPending) && (noofKnots <= RESP_CURVE_MAX_KNOTS))
+  {
+    tables[activeTable ^ 1U].noofKnots = noofKnots;
+    isSet = true;
+  }
+
+  return isSet;
+}
+
+/***************************************************************************************************
+ * Commit
+ *
+ * This function validates the staged table and, if valid, requests that it is swapped in at the
+ * start of the next control tick.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * true if the staged table is valid and will be swapped in, otherwise false
+ *
+ **************************************************************************************************/
+bool RESP_CURVE::Commit(void)
+{
+  bool isValid = false;
+
+  if (false == isSwapPending)
+  {
+    isValid = Prepare(&tables[activeTable ^ 1U]);
+
+    if (true == isValid)
+    {
+      isSwapPending = true;
+    }
+  }
+
+  return isValid;
+}
+
+/***************************************************************************************************
+ * Update
+ *
+ * This function swaps in a committed table. It must be called from the control loop, between
+ * evaluations.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void RESP_CURVE::Update(void)
+{
+  if (true == isSwapPending)
+  {
+    activeTable ^= 1U;
+    isSwapPending = false;
+  }
+}
+
+/***************************************************************************************************
+ * Evaluate
+ *
+ * This function interpolates the active table. Outside the table the end values are held.
+ *
+ * Parameters:
+ * x - frequency deviation from nominal (Hz)
+ *
+ * Return:
+ * Power fraction, positive for export. Zero if no table is loaded.
+ *
+ **************************************************************************************************/
+double RESP_CURVE::Evaluate(double x)
+{
+  return CURVE_Evaluate(&tables[activeTable], x);
+}
+
+/***************************************************************************************************
+ * IsSwapPending
+ *
+ * This function reports whether a committed table is waiting to be swapped in.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * true if a swap is pending, otherwise false
+ *
+ **************************************************************************************************/
+bool RESP_CURVE::IsSwapPending(void)
+{
+  return isSwapPending;
+}
+
+/***************************************************************************************************
+ * GetNoofKnots
+ *
+ * This function returns the number of knots in the active table.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * Number of knots
+ *
+ **************************************************************************************************/
+uint8_t RESP_CURVE::GetNoofKnots(void)
+{
+  return tables[activeTable].noofKnots;
+}
+
+/***************************************************************************************************
+ * GetKnot
+ *
+ * This function returns one knot of the active table.
+ *
+ * Parameters:
+ * index - knot index
+ * knot - updated with the knot
+ *
+ * Return:
+ * true if the knot exists, otherwise false
+ *
+ **************************************************************************************************/
+bool RESP_CURVE::GetKnot(uint8_t index, respCurveKnotStruct_t *knot)
+{
+  const respCurveTableStruct_t *table = &tables[activeTable];
+  bool isValid = false;
+
+  if (index < table->noofKnots)
+  {
+    *knot = table->knots[index];
+    isValid = true;
+  }
+
+  return isValid;
+}
+
+/***************************************************************************************************
+ * CURVE_Init
+ *
+ * This function loads the default response curves. It should be called once at start up.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void CURVE_Init(void)
+{
+  respCurveObj[RESP_CURVE_DC].Init(RESP_CURVE_DC_KNOTS, RESP_CURVE_DC_NOOF_KNOTS);
+  respCurveObj[RESP_CURVE_DM].Init(RESP_CURVE_DM_KNOTS, RESP_CURVE_DM_NOOF_KNOTS);
+  respCurveObj[RESP_CURVE_DR].Init(RESP_CURVE_DR_KNOTS, RESP_CURVE_DR_NOOF_KNOTS);
+}
+
+/***************************************************************************************************
+ * CURVE_Update
+ *
+ * This function swaps in any committed curves. It should be called at the start of every control
+ * tick, before any curve is evaluated.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void CURVE_Update(void)
+{
+  uint8_t curve;
+
+  for (curve = 0U; curve < NOOF_RESP_CURVES; curve++)
+  {
+    respCurveObj[curve].Update();
+  }
+}
+
+/* end public functions */
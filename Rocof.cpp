@@ -0,0 +1,524 @@
+/***************************************************************************************************
+ * Rocof
+ *
+ * This module measures the rate of change of frequency (RoCoF) and raises an event when it passes
+ * a trigger, so that services and protection can act on it within tens of milliseconds instead of
+ * on the next 20ms meter sample.
+ *
+ * The frequency stream is sampled into a FREQ_DELAY when it changes (at most every
+ * ROCOF_MIN_SAMPLE_MS) and RoCoF is the change over the configured window, through a first order
+ * noise filter. A short window and filter responds quickly but passes more measurement noise; the
+ * trigger duration can be used to reject single noisy samples.
+ *
+ * An event starts when RoCoF has been past the trigger for the trigger duration, and ends once
+ * it falls back below ROCOF_REARM_FRACTION of the trigger. The start of each event is flagged
+ * once (GetNewEvent) so the controller can send a demand straight away, and the time from the
+ * trigger to the first CAN frame that changes the demand (RecordResponse) is kept as latency
+ * statistics. The response stays pending until then, or until the event ends. Nothing is printed
+ * between the trigger and the frame; the event is reported once the frame has been queued, and
+ * by the rocof command.
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun Mcsherry
+ *
+ **************************************************************************************************/
+#include <Arduino.h>
+#include <math.h>
+#include "APP/Rocof.h"
+#include "APP/SerialCmd.h"
+
+ROCOF rocofObj;
+
+/* private functions */
+/***************************************************************************************************
+ * UpdateEvent
+ *
+ * This function starts and ends RoCoF events.
+ *
+ * Parameters:
+ * elapsed_ms - time since the last update
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void ROCOF::UpdateEvent(uint16_t elapsed_ms)
+{
+  rocofEventEnum_t direction = ROCOF_NO_EVENT;
+
+  if (rocof <= -config.trigger)
+  {
+    direction = ROCOF_FALLING;
+  }
+  else if (rocof >= config.trigger)
+  {
+    direction = ROCOF_RISING;
+  }
+  else
+  {
+    /* within the trigger */
+  }
+
+  if (ROCOF_NO_EVENT == event)
+  {
+    if (ROCOF_NO_EVENT == direction)
+    {
+      beyond_ms = 0U;
+    }
+    else
+    {
+      beyond_ms += elapsed_ms;
+
+      if (beyond_ms >= config.duration_ms)
+      {
+        event = direction;
+        isNewEvent = true;
+        isResponsePending = true;
+        trigger_us = micros();
+        windowStart_ms = millis() - config.window_ms - beyond_ms;
+        stats.events++;
+        stats.lastEventRocof = rocof;
+      }
+    }
+  }
+  else if ((fabs(rocof) < (ROCOF_REARM_FRACTION * config.trigger)) ||
+           ((ROCOF_NO_EVENT != direction) && (direction != event)))
+  {
+    event = ROCOF_NO_EVENT;
+    isResponsePending = false;
+    beyond_ms = 0U;
+  }
+  else
+  {
+    /* event continues */
+  }
+}
+
+/* Public functions */
+/***************************************************************************************************
+ * Reset
+ *
+ * This function empties the window and ends any event, e.g. when the frequency source is lost.
+ * RoCoF is invalid until a full window has been measured again.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void ROCOF::Reset(void)
+{
+  window.Init(config.window_ms, 0.0);
+  rocof = 0.0;
+  lastFrequency = 0.0;
+  lastSample_ms = 0U;
+  lastUpdate_ms = 0U;
+  beyond_ms = 0U;
+  isSampled = false;
+  isValid = false;
+  event = ROCOF_NO_EVENT;
+  isNewEvent = false;
+  isResponsePending = false;
+  windowStart_ms = 0U;
+}
+
+/***************************************************************************************************
+ * Update
+ *
+ * This function adds the latest frequency and updates RoCoF and the event. It should be called
+ * every control tick (1ms) while there is a valid frequency.
+ *
+ * Parameters:
+ * frequency - the latest frequency (Hz)
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void ROCOF::Update(double frequency)
+{
+  uint32_t now_ms;
+  uint32_t sinceSample_ms;
+  uint16_t elapsed_ms = 0U;
+  double oldFrequency;
+  double raw;
+  double coeff;
+
+  now_ms = millis();
+
+  if (true == isSampled)
+  {
+    elapsed_ms = (uint16_t)(now_ms - lastUpdate_ms);
+  }
+  lastUpdate_ms = now_ms;
+  sinceSample_ms = now_ms - lastSample_ms;
+
+  if ((false == isSampled) ||
+      ((frequency != lastFrequency) && (sinceSample_ms >= ROCOF_MIN_SAMPLE_MS)) ||
+      (sinceSample_ms >= ROCOF_MAX_SAMPLE_MS))
+  {
+    window.Push(now_ms, frequency);
+    oldFrequency = window.Read(now_ms);
+
+    /* no RoCoF until a full window of history is held */
+    if (window.GetAchievedDelay() > 0U)
+    {
+      raw = (frequency - oldFrequency) * 1000.0 / (double)window.GetAchievedDelay();
+
+      if ((false == isValid) || (0U == config.filter_ms))
+      {
+        rocof = raw;
+      }
+      else
+      {
+        coeff = (double)sinceSample_ms / (double)(config.filter_ms + sinceSample_ms);
+        rocof += coeff * (raw - rocof);
+      }
+      isValid = true;
+    }
+
+    lastFrequency = frequency;
+    lastSample_ms = now_ms;
+    isSampled = true;
+  }
+
+  if (true == isValid)
+  {
+    UpdateEvent(elapsed_ms);
+  }
+}
+
+/***************************************************************************************************
+ * GetRocof
+ *
+ * This function returns the filtered RoCoF.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * RoCoF in Hz/s, 0 if not yet valid
+ *
+ **************************************************************************************************/
+double ROCOF::GetRocof(void)
+{
+  return rocof;
+}
+
+/***************************************************************************************************
+ * IsValid
+ *
+ * This function reports whether a full window has been measured.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * true if RoCoF is valid
+ *
+ **************************************************************************************************/
+bool ROCOF::IsValid(void)
+{
+  return isValid;
+}
+
+/***************************************************************************************************
+ * GetEvent
+ *
+ * This function returns the event in progress.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * The event, ROCOF_NO_EVENT if RoCoF is within the trigger
+ *
+ **************************************************************************************************/
+rocofEventEnum_t ROCOF::GetEvent(void)
+{
+  return event;
+}
+
+/***************************************************************************************************
+ * GetNewEvent
+ *
+ * This function reports the start of an event, once.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * true if an event has started since the last call
+ *
+ **************************************************************************************************/
+bool ROCOF::GetNewEvent(void)
+{
+  bool isNew = isNewEvent;
+
+  isNewEvent = false;
+
+  return isNew;
+}
+
+/***************************************************************************************************
+ * GetEventAge
+ *
+ * This function returns how long the frequency has been changing for the current event, from the
+ * start of the window that triggered it. A service triggered by RoCoF can credit this time, as the
+ * change began a window (and the trigger duration) before the event was raised.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * time since the triggering window began (ms), 0 if there is no event
+ *
+ **************************************************************************************************/
+uint32_t ROCOF::GetEventAge(void)
+{
+  uint32_t age_ms = 0U;
+
+  if (ROCOF_NO_EVENT != event)
+  {
+    age_ms = millis() - windowStart_ms;
+  }
+
+  return age_ms;
+}
+
+/***************************************************************************************************
+ * IsResponsePending
+ *
+ * This function reports whether the current event is still waiting for a changed demand.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * true if no response has been recorded for the event yet
+ *
+ **************************************************************************************************/
+bool ROCOF::IsResponsePending(void)
+{
+  return isResponsePending;
+}
+
+/***************************************************************************************************
+ * RecordResponse
+ *
+ * This function records that a changed demand for the current event has been sent, and updates
+ * the trigger to frame latency. It should be called as soon as the CAN frame has been queued, and
+ * only the first call for each event is counted.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void ROCOF::RecordResponse(void)
+{
+  uint32_t latency_us;
+
+  if (false == isResponsePending)
+  {
+    return;
+  }
+  isResponsePending = false;
+
+  latency_us = micros() - trigger_us;
+
+  if ((0U == stats.responses) || (latency_us < stats.minLatency_us))
+  {
+    stats.minLatency_us = latency_us;
+  }
+  if (latency_us > stats.maxLatency_us)
+  {
+    stats.maxLatency_us = latency_us;
+  }
+
+  stats.lastLatency_us = latency_us;
+  stats.totalLatency_us += latency_us;
+  stats.responses++;
+
+  Serial.print("RoCoF event (Hz/s), response (us): ");
+  Serial.print(stats.lastEventRocof, 3);
+  Serial.print(", ");
+  Serial.println(latency_us);
+}
+
+/***************************************************************************************************
+ * SetConfig
+ *
+ * This function changes the window, filter and trigger. The window is restarted.
+ *
+ * Parameters:
+ * newConfig - the new configuration
+ *
+ * Return:
+ * true if the configuration is in range and has been applied, otherwise false
+ *
+ **************************************************************************************************/
+bool ROCOF::SetConfig(const rocofConfigStruct_t *newConfig)
+{
+  bool isSet = false;
+
+  if ((newConfig->window_ms >= ROCOF_MIN_WINDOW_MS) &&
+      (newConfig->window_ms <= ROCOF_MAX_WINDOW_MS) &&
+      (newConfig->filter_ms <= ROCOF_MAX_FILTER_MS) &&
+      (newConfig->trigger > 0.0))
+  {
+    config = *newConfig;
+    Reset();
+    isSet = true;
+  }
+
+  return isSet;
+}
+
+/***************************************************************************************************
+ * GetConfig
+ *
+ * This function returns the configuration.
+ *
+ * Parameters:
+ * currentConfig - updated with the configuration
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void ROCOF::GetConfig(rocofConfigStruct_t *currentConfig)
+{
+  *currentConfig = config;
+}
+
+/***************************************************************************************************
+ * GetStats
+ *
+ * This function returns the event and latency statistics.
+ *
+ * Parameters:
+ * rocofStats - updated with the statistics
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void ROCOF::GetStats(rocofStatsStruct_t *rocofStats)
+{
+  *rocofStats = stats;
+}
+
+/***************************************************************************************************
+ * Command
+ *
+ * This function runs a RoCoF command received on the serial port:
+ *   rocof                      report RoCoF, the configuration and the latency statistics
+ *   rocof win <ms>             set the window
+ *   rocof filt <ms>            set the noise filter time constant, 0 for none
+ *   rocof trig <Hz/s>          set the trigger
+ *   rocof dur <ms>             set the time RoCoF must stay past the trigger
+ *   rocof clr                  clear the statistics
+ *
+ * Parameters:
+ * command - the command
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void ROCOF::Command(String command)
+{
+  rocofConfigStruct_t newConfig = config;
+  String action;
+  int position = 0;
+  bool isOk = false;
+
+  command.trim();
+  (void)CMD_NextToken(command, &position);   /* "rocof" */
+  action = CMD_NextToken(command, &position);
+
+  if (0 == action.length())
+  {
+    Serial.print("RoCoF (Hz/s): ");
+    Serial.println(rocof, 3);
+    Serial.print("Window, filter, duration (ms): ");
+    Serial.print(config.window_ms);
+    Serial.print(", ");
+    Serial.print(config.filter_ms);
+    Serial.print(", ");
+    Serial.println(config.duration_ms);
+    Serial.print("Trigger (Hz/s): ");
+    Serial.println(config.trigger, 3);
+    Serial.print("Events, responses: ");
+    Serial.print(stats.events);
+    Serial.print(", ");
+    Serial.println(stats.responses);
+
+    if (stats.events > 0U)
+    {
+      Serial.print("Last event (Hz/s): ");
+      Serial.println(stats.lastEventRocof, 3);
+    }
+
+    if (stats.responses > 0U)
+    {
+      Serial.print("Latency last, min, mean, max (us): ");
+      Serial.print(stats.lastLatency_us);
+      Serial.print(", ");
+      Serial.print(stats.minLatency_us);
+      Serial.print(", ");
+      Serial.print(stats.totalLatency_us / stats.responses);
+      Serial.print(", ");
+      Serial.println(stats.maxLatency_us);
+    }
+    return;
+  }
+  else if ("win" == action)
+  {
+    newConfig.window_ms = (uint16_t)CMD_NextToken(command, &position).toInt();
+    isOk = SetConfig(&newConfig);
+  }
+  else if ("filt" == action)
+  {
+    newConfig.filter_ms = (uint16_t)CMD_NextToken(command, &position).toInt();
+    isOk = SetConfig(&newConfig);
+  }
+  else if ("trig" == action)
+  {
+    newConfig.trigger = CMD_NextToken(command, &position).toDouble();
+    isOk = SetConfig(&newConfig);
+  }
+  else if ("dur" == action)
+  {
+    newConfig.duration_ms = (uint16_t)CMD_NextToken(command, &position).toInt();
+    isOk = SetConfig(&newConfig);
+  }
+  else if ("clr" == action)
+  {
+    stats = {0U, 0U, 0U, 0U, 0U, 0U, 0.0};
+    isOk = true;
+  }
+  else
+  {
+    /* unknown command */
+  }
+
+  if (true == isOk)
+  {
+    Serial.println("rocof ok");
+  }
+  else
+  {
+    Serial.println("rocof rejected");
+  }
+}
+
+/* end public functions */
@@ -0,0 +1,448 @@
+/***************************************************************************************************
+ * Schedule
+ *
+ * This module runs the trading schedule: the power positions for a run of settlement periods,
+ * loaded ahead of time (e.g. by Flex through the Modbus register map). The demand is worked out
+ * from the wall clock (HAL_RTC) on every tick, so the schedule keeps running to the millisecond
+ * without Flex, and is held in NVR so that it survives a reset.
+ *
+ * Between periods of different power the demand ramps linearly over the configured ramp time,
+ * centred on the period boundary so that the energy in each period is unchanged. Before the first
+ * and after the last period the position is taken to be zero.
+ *
+ * The schedule is double buffered. A replacement is staged and committed as a whole, and swapped
+ * in by Update at the start of a control tick, so a partly loaded schedule never runs.
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun Mcsherry
+ *
+ **************************************************************************************************/
+#include <Arduino.h>
+#include <math.h>
+#include "APP/Schedule.h"
+#include "HAL/HAL_RTC.h"
+#include "HAL/HAL_NVR.h"
+
+SCHEDULE scheduleObj;
+
+/* private functions */
+/***************************************************************************************************
+ * IsValid
+ *
+ * This function checks a table: it must start on a period boundary, hold at least one period,
+ * and its ramps must not overlap.
+ *
+ * Parameters:
+ * table - the table
+ *
+ * Return:
+ * true if the table is valid, otherwise false
+ *
+ **************************************************************************************************/
+static bool IsValid(const schedTableStruct_t *table)
+{
+  return ((SCHED_NVR_VERSION == table->version) &&
+          (0U == (table->start % SCHED_PERIOD_S)) &&
+          (table->noofPeriods > 0U) &&
+          (table->noofPeriods <= SCHED_MAX_PERIODS) &&
+          (table->ramp_s <= SCHED_PERIOD_S));
+}
+
+/***************************************************************************************************
+ * PeriodPower
+ *
+ * This function returns the position for a period, zero outside the schedule.
+ *
+ * Parameters:
+ * table - the table
+ * period - period index from the start of the schedule
+ *
+ * Return:
+ * Power (0.1kW units)
+ *
+ **************************************************************************************************/
+double SCHEDULE::PeriodPower(const schedTableStruct_t *table, int32_t period)
+{
+  double power = 0.0;
+
+  if ((period >= 0) && (period < (int32_t)table->noofPeriods))
+  {
+    power = (double)table->power[period];
+  }
+
+  return power;
+}
+
+/* Public functions */
+/***************************************************************************************************
+ * Init
+ *
+ * This function restores the schedule from NVR. It should be called once at start up, after
+ * NVR_Init.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void SCHEDULE::Init(void)
+{
+  activeTable = 0U;
+  isSwapPending = false;
+  isSavePending = false;
+
+  if ((true == NVR_Read(SCHED_NVR_KEY, &tables[0], sizeof(tables[0]))) &&
+      (true == IsValid(&tables[0])))
+  {
+    Serial.println("Trading schedule restored");
+  }
+  else
+  {
+    tables[0].version = SCHED_NVR_VERSION;
+    tables[0].start = 0U;
+    tables[0].ramp_s = SCHED_DEFAULT_RAMP_S;
+    tables[0].noofPeriods = 0U;
+  }
+}
+
+/***************************************************************************************************
+ * BeginEdit
+ *
+ * This function starts staging a new schedule, initialised as a copy of the active one.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * true if staging has started, false if a previous commit is still waiting to be swapped in
+ *
+ **************************************************************************************************/
+bool SCHEDULE::BeginEdit(void)
+{
+  bool isStarted = false;
+
+  if (false == isSwapPending)
+  {
+    tables[activeTable ^ 1U] = tables[activeTable];
+    isStarted = true;
+  }
+
+  return isStarted;
+}
+
+/***************************************************************************************************
+ * SetStart
+ *
+ * This function sets the start of the first period of the staged schedule.
+ *
+ * Parameters:
+ * start - seconds since 01/01/1970 (UTC), on a period boundary
+ *
+ * Return:
+ * true if set, otherwise false
+ *
+ **************************************************************************************************/
+bool SCHEDULE::SetStart(uint32_t start)
+{
+  bool isSet = false;
+
+  if ((false == isSwapPending) && (0U == (start % SCHED_PERIOD_S)))
+  {
+    tables[activeTable ^ 1U].start = start;
+    isSet = true;
+  }
+
+  return isSet;
+}
+
+/***************************************************************************************************
+ * SetPower
+ *
+ * This function sets the position for one period of the staged schedule.
+ *
+ * Parameters:
+ * index - period index from the start of the schedule
+ * power - power (0.1kW units, + is export)
+ *
+ * Return:
+ * true if set, otherwise false
+ *
+ **************************************************************************************************/
+bool SCHEDULE::SetPower(uint8_t index, int16_t power)
+{
+  bool isSet = false;
+
+  if ((false == isSwapPending) && (index < SCHED_MAX_PERIODS))
+  {
+    tables[activeTable ^ 1U].power[index] = power;
+    isSet = true;
+  }
+
+  return isSet;
+}
+
+/***************************************************************************************************
+ * SetNoofPeriods
+ *
+ * This function sets the number of periods in the staged schedule.
+ *
+ * Parameters:
+ * noofPeriods - number of periods
+ *
+ * Return:
+ * true if set, otherwise false
+ *
+ **************************************************************************************************/
+bool SCHEDULE::SetNoofPeriods(uint8_t noofPeriods)
+{
+  bool isSet = false;
+
+  if ((false == isSwapPending) && (noofPeriods <= SCHED_MAX_PERIODS))
+  {
+    tables[activeTable ^ 1U].noofPeriods = noofPeriods;
+    isSet = true;
+  }
+
+  return isSet;
+}
+
+/***************************************************************************************************
+ * SetRamp
+ *
+ * This function sets the ramp time between periods of the staged schedule.
+ *
+ * Parameters:
+ * ramp_s - ramp time (s), 0 to step at the boundary
+ *
+ * Return:
+ * true if set, otherwise false
+ *
+ **************************************************************************************************/
+bool SCHEDULE::SetRamp(uint16_t ramp_s)
+{
+  bool isSet = false;
+
+  if ((false == isSwapPending) && (ramp_s <= SCHED_PERIOD_S))
+  {
+    tables[activeTable ^ 1U].ramp_s = ramp_s;
+    isSet = true;
+  }
+
+  return isSet;
+}
+
+/***************************************************************************************************
+ * Commit
+ *
+ * This function validates the staged schedule and, if valid, requests that it is swapped in at
+ * the start of the next control tick.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * true if the staged schedule is valid and will be swapped in, otherwise false
+ *
+ **************************************************************************************************/
+bool SCHEDULE::Commit(void)
+{
+  bool isValid = false;
+
+  if (false == isSwapPending)
+  {
+    tables[activeTable ^ 1U].version = SCHED_NVR_VERSION;
+    isValid = IsValid(&tables[activeTable ^ 1U]);
+
+    if (true == isValid)
+    {
+      isSwapPending = true;
+    }
+  }
+
+  return isValid;
+}
+
+/***************************************************************************************************
+ * Update
+ *
+ * This function swaps in a committed schedule and queues it to be saved. It must be called from
+ * the control loop, before GetDemand.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void SCHEDULE::Update(void)
+{
+  if (true == isSwapPending)
+  {
+    activeTable ^= 1U;
+    isSwapPending = false;
+    isSavePending = true;
+  }
+
+  /* retried on later ticks if the NVR write slots are busy */
+  if ((true == isSavePending) &&
+      (true == NVR_Write(SCHED_NVR_KEY, &tables[activeTable], sizeof(tables[activeTable]))))
+  {
+    isSavePending = false;
+  }
+}
+
+/***************************************************************************************************
+ * GetDemand
+ *
+ * This function returns the scheduled power at the present time.
+ *
+ * Parameters:
+ * demand - updated with the scheduled power (0.1kW units), if there is one
+ *
+ * Return:
+ * true if the schedule covers the present time, false if there is no position (no schedule,
+ * clock not set, or outside the schedule and its ramps)
+ *
+ **************************************************************************************************/
+bool SCHEDULE::GetDemand(double *demand)
+{
+  const schedTableStruct_t *table = &tables[activeTable];
+  uint32_t seconds;
+  uint16_t ms;
+  double elapsed_s;
+  double offset_s;
+  double halfRamp_s;
+  double previous;
+  double present;
+  int32_t period;
+
+  if ((0U == table->noofPeriods) || (false == RTC_GetTime(&seconds, &ms)))
+  {
+    return false;
+  }
+
+  elapsed_s = (double)(int32_t)(seconds - table->start) + ((double)ms / 1000.0);
+  halfRamp_s = (double)table->ramp_s / 2.0;
+
+  if ((elapsed_s < -halfRamp_s) ||
+      (elapsed_s >= (((double)table->noofPeriods * SCHED_PERIOD_S) + halfRamp_s)))
+  {
+    return false;
+  }
+
+  period = (int32_t)floor(elapsed_s / SCHED_PERIOD_S);
+  offset_s = elapsed_s - ((double)period * SCHED_PERIOD_S);
+  present = PeriodPower(table, period);
+
+  if (offset_s < halfRamp_s)
+  {
+    /* ramping in from the previous period */
+    previous = PeriodPower(table, period - 1);
+    *demand = previous + ((present - previous) * (offset_s + halfRamp_s) / table->ramp_s);
+  }
+  else if (offset_s > (SCHED_PERIOD_S - halfRamp_s))
+  {
+    /* ramping out to the next period */
+    *demand = present + ((PeriodPower(table, period + 1) - present) *
+                         (offset_s - (SCHED_PERIOD_S - halfRamp_s)) / table->ramp_s);
+  }
+  else
+  {
+    *demand = present;
+  }
+
+  return true;
+}
+
+/***************************************************************************************************
+ * IsSwapPending
+ *
+ * This function reports whether a committed schedule is waiting to be swapped in.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * true if a swap is pending
+ *
+ **************************************************************************************************/
+bool SCHEDULE::IsSwapPending(void)
+{
+  return isSwapPending;
+}
+
+/***************************************************************************************************
+ * GetStart
+ *
+ * This function returns the start of the active schedule.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * Seconds since 01/01/1970 (UTC)
+ *
+ **************************************************************************************************/
+uint32_t SCHEDULE::GetStart(void)
+{
+  return tables[activeTable].start;
+}
+
+/***************************************************************************************************
+ * GetNoofPeriods
+ *
+ * This function returns the number of periods in the active schedule.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * Number of periods
+ *
+ **************************************************************************************************/
+uint8_t SCHEDULE::GetNoofPeriods(void)
+{
+  return tables[activeTable].noofPeriods;
+}
+
+/***************************************************************************************************
+ * GetRamp
+ *
+ * This function returns the ramp time of the active schedule.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * Ramp time (s)
+ *
+ **************************************************************************************************/
+uint16_t SCHEDULE::GetRamp(void)
+{
+  return tables[activeTable].ramp_s;
+}
+
+/***************************************************************************************************
+ * GetPower
+ *
+ * This function returns the position for one period of the active schedule.
+ *
+ * Parameters:
+ * index - period index from the start of the schedule
+ *
+ * Return:
+ * Power (0.1kW units), 0 outside the schedule
+ *
+ **************************************************************************************************/
+int16_t SCHEDULE::GetPower(uint8_t index)
+{
+  return (int16_t)PeriodPower(&tables[activeTable], (int32_t)index);
+}
+
+/* end public functions */
@@ -0,0 +1,56 @@
+/***************************************************************************************************
+ * SerialCmd
+ *
+ * This module holds what the serial port commands of the other modules (e.g. rocof, tp, lut, gs,
+ * q) have in common, using non-member functions. A command is a line of space separated tokens,
+ * the first naming the module.
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun Mcsherry
+ *
+ **************************************************************************************************/
+#include <Arduino.h>
+#include "APP/SerialCmd.h"
+
+/* Public functions */
+/***************************************************************************************************
+ * CMD_NextToken
+ *
+ * This function returns the next space separated token of a command.
+ *
+ * Parameters:
+ * command - the command
+ * position - position to search from, updated to the end of the token
+ *
+ * Return:
+ * The token, empty if there are no more
+ *
+ **************************************************************************************************/
+String CMD_NextToken(const String &command, int *position)
+{
+  int start;
+  int end;
+
+  start = *position;
+
+  while ((start < command.length()) && (' ' == command.charAt(start)))
+  {
+    start++;
+  }
+
+  end = command.indexOf(' ', start);
+
+  if (end < 0)
+  {
+    end = command.length();
+  }
+
+  *position = end;
+
+  return command.substring(start, end);
+}
+
+/* end public functions */
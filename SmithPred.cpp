@@ -0,0 +1,440 @@
+/***************************************************************************************************
+ * SmithPred
+ *
+ * This module compensates the dead time in the power loop (CAN transmission, the inverter's own
+ * response delay and the meter latency) with a Smith predictor. The PID acts on the measured power
+ * after its step has been seen, so with dead time theta its gains must stay low enough that it
+ * does not keep pushing for theta after the power has started to move.
+ *
+ * The inverter is modelled from the command to the measured power as first order plus dead time,
+ * on top of the inverter characteristic: the model input is the power the characteristic expects
+ * for the command sent. The PID is given
+ *
+ *   feedback = measured + model(t) - model(t - theta)
+ *
+ * which, while the model is right, is the power the inverter will deliver once the dead time has
+ * passed. Where the model is wrong the error still reaches the PID through the measurement, one
+ * dead time later, so the loop still settles on the measured power.
+ *
+ * The model comes from configuration, or from the relay auto-tune (PidAutoTune.cpp), which fits
+ * a first order plus dead time model. The dead time is also measured from timestamps: the time a
+ * command step is sent is recorded, and the time the measured power has moved SMITH_RESPONSE_DETECT
+ * of the step, less the time the first order lag takes to get there and half a sample (the power
+ * crossed on average half a sample before it was seen), is the dead time the loop sees.
+ *
+ * The module does not use the Arduino libraries, so that it can be run on a host.
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun Mcsherry
+ *
+ **************************************************************************************************/
+#include <math.h>
+#include "APP/SmithPred.h"
+
+/* private functions */
+/***************************************************************************************************
+ * Delayed
+ *
+ * This function returns the model output one dead time ago, interpolated between samples.
+ *
+ * Parameters:
+ * now_us - the time now
+ *
+ * Return:
+ * The delayed model output, the oldest held if the history does not go back far enough
+ *
+ **************************************************************************************************/
+double SMITH_PRED::Delayed(uint32_t now_us)
+{
+  uint32_t delay_us;
+  uint32_t age_us;
+  uint32_t span_us;
+  uint16_t index;
+  uint16_t newer;
+  uint16_t count;
+
+  delay_us = (uint32_t)(model.deadTime_s * 1000000.0);
+  index = head;
+  newer = head;
+
+  for (count = 0U; count < SMITH_HISTORY; count++)
+  {
+    age_us = now_us - history[index].time_us;
+
+    if (age_us >= delay_us)
+    {
+      span_us = history[newer].time_us - history[index].time_us;
+
+      if ((index == newer) || (0U == span_us))
+      {
+        return history[index].power;
+      }
+
+      return history[index].power + (((double)(age_us - delay_us) / (double)span_us) *
+                                     (history[newer].power - history[index].power));
+    }
+
+    newer = index;
+    index = (uint16_t)((index + SMITH_HISTORY - 1U) % SMITH_HISTORY);
+  }
+
+  return history[newer].power;
+}
+
+/***************************************************************************************************
+ * MeasureDeadTime
+ *
+ * This function checks a measurement for the response to a timed command step.
+ *
+ * Parameters:
+ * measured - the measured power
+ * now_us - the time it was received
+ * dt_s - time since the last measurement
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void SMITH_PRED::MeasureDeadTime(double measured, uint32_t now_us, double dt_s)
+{
+  double elapsed_s;
+  double sample_s;
+
+  if (false == isMeasuring)
+  {
+    return;
+  }
+
+  elapsed_s = (double)(now_us - stepTime_us) / 1000000.0;
+
+  if (((measured - stepBase) / stepSize) >= SMITH_RESPONSE_DETECT)
+  {
+    /* the lag takes -tau.ln(1 - detect) to get there once the dead time has passed */
+    sample_s = elapsed_s - (0.5 * dt_s) + (model.tau_s * log(1.0 - SMITH_RESPONSE_DETECT));
+
+    if (sample_s < 0.0)
+    {
+      sample_s = 0.0;
+    }
+    else if (sample_s > SMITH_MAX_DEAD_TIME_S)
+    {
+      sample_s = SMITH_MAX_DEAD_TIME_S;
+    }
+    else
+    {
+      /* in range */
+    }
+
+    deadTime.last_s = sample_s;
+    if (0U == deadTime.measurements)
+    {
+      deadTime.deadTime_s = sample_s;
+    }
+    else
+    {
+      deadTime.deadTime_s += SMITH_DEAD_TIME_FILTER * (sample_s - deadTime.deadTime_s);
+    }
+    deadTime.measurements++;
+
+    if (true == isDeadTimeTracked)
+    {
+      model.deadTime_s = deadTime.deadTime_s;
+    }
+    isMeasuring = false;
+  }
+  else if (elapsed_s > SMITH_MEASURE_TIMEOUT_S)
+  {
+    deadTime.timeouts++;
+    isMeasuring = false;
+  }
+  else
+  {
+    /* still waiting for the response */
+  }
+}
+
+/* Public functions */
+/***************************************************************************************************
+ * Init
+ *
+ * This function sets the model and the rating. The model starts when the first measurement
+ * arrives.
+ *
+ * Parameters:
+ * initModel - the model
+ * rated - rated power, for the step detection (0.1kW units)
+ *
+ * Return:
+ * true if the model is in range, otherwise false and the default model is kept
+ *
+ **************************************************************************************************/
+bool SMITH_PRED::Init(const smithModelStruct_t *initModel, double rated)
+{
+  maxPower = rated;
+  isStarted = false;
+  isMeasuring = false;
+
+  return SetModel(initModel);
+}
+
+/***************************************************************************************************
+ * SetModel
+ *
+ * This function changes the model. While the dead time is tracked and has been measured, the
+ * measured dead time is kept.
+ *
+ * Parameters:
+ * newModel - the model; gain SMITH_MIN_GAIN to SMITH_MAX_GAIN, time constant above 0 up to
+ *            SMITH_MAX_TAU_S, dead time 0 to SMITH_MAX_DEAD_TIME_S
+ *
+ * Return:
+ * true if changed, false if out of range
+ *
+ **************************************************************************************************/
+bool SMITH_PRED::SetModel(const smithModelStruct_t *newModel)
+{
+  if ((newModel->gain < SMITH_MIN_GAIN) || (newModel->gain > SMITH_MAX_GAIN) ||
+      (newModel->tau_s <= 0.0) || (newModel->tau_s > SMITH_MAX_TAU_S) ||
+      (newModel->deadTime_s < 0.0) || (newModel->deadTime_s > SMITH_MAX_DEAD_TIME_S))
+  {
+    return false;
+  }
+
+  model = *newModel;
+
+  if ((true == isDeadTimeTracked) && (deadTime.measurements > 0U))
+  {
+    model.deadTime_s = deadTime.deadTime_s;
+  }
+
+  return true;
+}
+
+/***************************************************************************************************
+ * GetModel
+ *
+ * This function returns the model in use.
+ *
+ * Parameters:
+ * currentModel - updated with the model
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void SMITH_PRED::GetModel(smithModelStruct_t *currentModel)
+{
+  *currentModel = model;
+}
+
+/***************************************************************************************************
+ * SetEnabled
+ *
+ * This function turns the prediction on or off. The model and the dead time measurement run
+ * either way, so turning it on does not step the feedback.
+ *
+ * Parameters:
+ * enable - true to give the PID the predicted feedback
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void SMITH_PRED::SetEnabled(bool enable)
+{
+  isEnabled = enable;
+}
+
+/***************************************************************************************************
+ * IsEnabled
+ *
+ * This function returns whether the prediction is on.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * true if on
+ *
+ **************************************************************************************************/
+bool SMITH_PRED::IsEnabled(void)
+{
+  return isEnabled;
+}
+
+/***************************************************************************************************
+ * SetDeadTimeTracked
+ *
+ * This function chooses whether the model dead time follows the measured dead time.
+ *
+ * Parameters:
+ * track - true to follow the measurement, false to keep the configured dead time
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void SMITH_PRED::SetDeadTimeTracked(bool track)
+{
+  isDeadTimeTracked = track;
+
+  if ((true == track) && (deadTime.measurements > 0U))
+  {
+    model.deadTime_s = deadTime.deadTime_s;
+  }
+}
+
+/***************************************************************************************************
+ * IsDeadTimeTracked
+ *
+ * This function returns whether the model dead time follows the measurement.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * true if it does
+ *
+ **************************************************************************************************/
+bool SMITH_PRED::IsDeadTimeTracked(void)
+{
+  return isDeadTimeTracked;
+}
+
+/***************************************************************************************************
+ * Reset
+ *
+ * This function restarts the model in steady state at a power, e.g. when closed loop control
+ * resumes after commands that were not passed to Sent.
+ *
+ * Parameters:
+ * power - the measured power (0.1kW units)
+ * now_us - the time now
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void SMITH_PRED::Reset(double power, uint32_t now_us)
+{
+  uint16_t index;
+
+  input = power / model.gain;
+  isInputKnown = false;
+  undelayed = power;
+
+  for (index = 0U; index < SMITH_HISTORY; index++)
+  {
+    history[index].time_us = now_us;
+    history[index].power = power;
+  }
+
+  head = 0U;
+  lastTime_us = now_us;
+  lastMeasured = power;
+  isMeasuring = false;
+  isStarted = true;
+}
+
+/***************************************************************************************************
+ * Sent
+ *
+ * This function is called when a command has been sent to the inverter, and times it if it is a
+ * step from steady state.
+ *
+ * Parameters:
+ * expectedPower - the power the inverter characteristic gives for the command (0.1kW units)
+ * now_us - the time it was sent
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void SMITH_PRED::Sent(double expectedPower, uint32_t now_us)
+{
+  double step;
+
+  step = model.gain * (expectedPower - input);
+
+  /* the first command after a restart is not a step, as the command before it is not known */
+  if ((true == isStarted) && (true == isInputKnown) && (false == isMeasuring) &&
+      (fabs(step) >= (SMITH_STEP_DETECT * maxPower)) &&
+      (fabs((model.gain * input) - Delayed(now_us)) < (0.5 * SMITH_RESPONSE_DETECT * fabs(step))))
+  {
+    isMeasuring = true;
+    stepTime_us = now_us;
+    stepSize = step;
+    stepBase = lastMeasured;
+  }
+
+  input = expectedPower;
+  isInputKnown = isStarted;
+}
+
+/***************************************************************************************************
+ * Feedback
+ *
+ * This function steps the model to a new measurement and returns the feedback for the PID. It
+ * should be called on every meter sample, before the PID.
+ *
+ * Parameters:
+ * measured - the measured power (0.1kW units)
+ * now_us - the time it was received
+ *
+ * Return:
+ * The measured power plus the modelled change still to come, or the measured power if the
+ * prediction is off
+ *
+ **************************************************************************************************/
+double SMITH_PRED::Feedback(double measured, uint32_t now_us)
+{
+  double dt_s;
+
+  dt_s = (double)(now_us - lastTime_us) / 1000000.0;
+
+  /* the first sample, or the first after a gap, starts the model where the inverter is */
+  if ((false == isStarted) || (dt_s > SMITH_MAX_GAP_S))
+  {
+    Reset(measured, now_us);
+    return measured;
+  }
+
+  lastTime_us = now_us;
+  undelayed += (1.0 - exp(-(dt_s / model.tau_s))) * ((model.gain * input) - undelayed);
+
+  head = (uint16_t)((head + 1U) % SMITH_HISTORY);
+  history[head].time_us = now_us;
+  history[head].power = undelayed;
+
+  MeasureDeadTime(measured, now_us, dt_s);
+  lastMeasured = measured;
+
+  if (false == isEnabled)
+  {
+    return measured;
+  }
+
+  return measured + undelayed - Delayed(now_us);
+}
+
+/***************************************************************************************************
+ * GetDeadTime
+ *
+ * This function returns the dead time measurements.
+ *
+ * Parameters:
+ * measuredDeadTime - updated with the measurements
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void SMITH_PRED::GetDeadTime(smithDeadTimeStruct_t *measuredDeadTime)
+{
+  *measuredDeadTime = deadTime;
+}
+
+/* end public functions */
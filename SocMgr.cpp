@@ -0,0 +1,306 @@
+/***************************************************************************************************
+ * SocMgr
+ *
+ * This module estimates the battery state of charge (SoC) and manages it while a frequency
+ * response service is running.
+ *
+ * SoC is estimated by integrating the measured real power on every meter sample, with separate
+ * charge and discharge efficiencies. The estimate drifts, so it is pulled towards the BMS SoC
+ * whenever one is written (see MbRegMap), and it is stored in NVR so that it survives a reset.
+ *
+ * SoC management adds a baseline power to the response demand to bring SoC back towards target
+ * once it leaves a deadband, and derates export (import) availability as SoC approaches its
+ * lower (upper) limit, so the service is not lost by running the battery empty or full.
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun Mcsherry
+ *
+ **************************************************************************************************/
+#include <Arduino.h>
+#include "APP/SocMgr.h"
+#include "HAL/HAL_NVR.h"
+
+SOC_MGR socMgrObj;
+
+/* private functions */
+/***************************************************************************************************
+ * Save
+ *
+ * This function queues the SoC to be written to NVR.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void SOC_MGR::Save(void)
+{
+  socNvrRecordStruct_t record;
+
+  record.version = SOC_NVR_VERSION;
+  record.soc = soc;
+
+  if (true == NVR_Write(SOC_NVR_KEY, &record, sizeof(record)))
+  {
+    savedSoc = soc;
+  }
+}
+
+/* Public functions */
+/***************************************************************************************************
+ * Init
+ *
+ * This function restores the SoC from NVR. It should be called once at start up, before the
+ * control loop starts.
+ *
+ * Parameters:
+ * maxRated - the maximum rated power transfer of the inverter (0.1kW units)
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void SOC_MGR::Init(uint16_t maxRated)
+{
+  socNvrRecordStruct_t record;
+
+  maxPower = (double)maxRated;
+
+  NVR_Init();
+
+  if ((true == NVR_Read(SOC_NVR_KEY, &record, sizeof(record))) &&
+      (SOC_NVR_VERSION == record.version) &&
+      (record.soc >= 0.0) && (record.soc <= 1.0))
+  {
+    soc = record.soc;
+  }
+  else
+  {
+    Serial.println("No stored SoC, using default");
+    soc = SOC_DEFAULT;
+  }
+
+  savedSoc = soc;
+  saveTimer_ms = 0U;
+  isTiming = false;
+}
+
+/***************************************************************************************************
+ * Update
+ *
+ * This function integrates the measured power into the SoC estimate and applies any BMS
+ * correction. It should be called on every meter sample.
+ *
+ * Parameters:
+ * measuredPower - measured real power, positive for export (0.1kW units)
+ * sysCount - system counter
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void SOC_MGR::Update(double measuredPower, uint16_t sysCount)
+{
+  uint16_t elapsed_ms;
+  double energy_kWh;
+
+  elapsed_ms = sysCount - oldSysCount;
+  oldSysCount = sysCount;
+
+  /* the first sample after a stop only restarts the timing */
+  if ((true == isTiming) && (elapsed_ms <= SOC_MAX_STEP_MS))
+  {
+    energy_kWh = (measuredPower * SOC_POWER_UNIT_KW * (double)elapsed_ms) / 3600000.0;
+
+    if (energy_kWh > 0.0)
+    {
+      /* export - the battery supplies the conversion losses */
+      soc -= (energy_kWh / SOC_DISCHARGE_EFFICIENCY) / SOC_CAPACITY_KWH;
+    }
+    else
+    {
+      soc -= (energy_kWh * SOC_CHARGE_EFFICIENCY) / SOC_CAPACITY_KWH;
+    }
+
+    saveTimer_ms += elapsed_ms;
+  }
+  isTiming = true;
+
+  if (true == isBmsPending)
+  {
+    isBmsPending = false;
+    soc += SOC_BMS_CORRECTION_GAIN * (((double)bmsSoc / 10000.0) - soc);
+  }
+
+  if (soc < 0.0)
+  {
+    soc = 0.0;
+  }
+  else if (soc > 1.0)
+  {
+    soc = 1.0;
+  }
+
+  if (saveTimer_ms >= SOC_SAVE_PERIOD_MS)
+  {
+    saveTimer_ms = 0U;
+
+    if (fabs(soc - savedSoc) >= SOC_SAVE_CHANGE)
+    {
+      Save();
+    }
+  }
+}
+
+/***************************************************************************************************
+ * SetBmsSoc
+ *
+ * This function passes a BMS SoC reading to be applied on the next Update. It may be called from
+ * the Modbus context.
+ *
+ * Parameters:
+ * bmsSoc_x100 - SoC reported by the BMS (0.01% units)
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void SOC_MGR::SetBmsSoc(uint16_t bmsSoc_x100)
+{
+  bmsSoc = bmsSoc_x100;
+  isBmsPending = true;
+}
+
+/***************************************************************************************************
+ * GetSoc
+ *
+ * This function returns the SoC estimate.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * SoC (0.0 to 1.0)
+ *
+ **************************************************************************************************/
+double SOC_MGR::GetSoc(void)
+{
+  return soc;
+}
+
+/***************************************************************************************************
+ * GetBaseline
+ *
+ * This function returns the SoC management baseline: export above the target deadband, import
+ * below it, proportional to the distance outside the deadband.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * Baseline power, positive for export (0.1kW units)
+ *
+ **************************************************************************************************/
+double SOC_MGR::GetBaseline(void)
+{
+  double socError;
+  double baseline = 0.0;
+
+  socError = soc - SOC_TARGET;
+
+  if (socError > SOC_BASELINE_DEADBAND)
+  {
+    baseline = SOC_BASELINE_GAIN * (socError - SOC_BASELINE_DEADBAND);
+  }
+  else if (socError < -SOC_BASELINE_DEADBAND)
+  {
+    baseline = SOC_BASELINE_GAIN * (socError + SOC_BASELINE_DEADBAND);
+  }
+
+  if (baseline > SOC_BASELINE_MAX)
+  {
+    baseline = SOC_BASELINE_MAX;
+  }
+  else if (baseline < -SOC_BASELINE_MAX)
+  {
+    baseline = -SOC_BASELINE_MAX;
+  }
+
+  return baseline * maxPower;
+}
+
+/***************************************************************************************************
+ * Limit
+ *
+ * This function limits a power demand to the available export or import power.
+ *
+ * Parameters:
+ * demand - power demand, positive for export (0.1kW units)
+ *
+ * Return:
+ * Limited power demand (0.1kW units)
+ *
+ **************************************************************************************************/
+double SOC_MGR::Limit(double demand)
+{
+  double exportAvail;
+  double importAvail;
+
+  GetAvailability(&exportAvail, &importAvail);
+
+  if (demand > (exportAvail * maxPower))
+  {
+    demand = exportAvail * maxPower;
+  }
+  else if (demand < -(importAvail * maxPower))
+  {
+    demand = -(importAvail * maxPower);
+  }
+
+  return demand;
+}
+
+/***************************************************************************************************
+ * GetAvailability
+ *
+ * This function returns the export and import availability, derated linearly to zero over the
+ * band inside each SoC limit.
+ *
+ * Parameters:
+ * exportAvail - updated with the export availability (fraction of rated power)
+ * importAvail - updated with the import availability (fraction of rated power)
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void SOC_MGR::GetAvailability(double *exportAvail, double *importAvail)
+{
+  *exportAvail = (soc - SOC_MIN) / SOC_DERATE_BAND;
+  *importAvail = (SOC_MAX - soc) / SOC_DERATE_BAND;
+
+  if (*exportAvail > 1.0)
+  {
+    *exportAvail = 1.0;
+  }
+  else if (*exportAvail < 0.0)
+  {
+    *exportAvail = 0.0;
+  }
+
+  if (*importAvail > 1.0)
+  {
+    *importAvail = 1.0;
+  }
+  else if (*importAvail < 0.0)
+  {
+    *importAvail = 0.0;
+  }
+}
+
+/* end public functions */
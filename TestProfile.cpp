@@ -0,0 +1,602 @@
+/***************************************************************************************************
+ * TestProfile
+ *
+ * This module replaces the measured grid frequency with a test profile, so that compliance tests
+ * can be run without a grid simulator. A profile is a table of segments, each holding a frequency
+ * or ramping at a slope for a time, with the level of the marker output (used to trigger a
+ * recorder) during the segment. Profiles repeat a set number of times, or for ever.
+ *
+ * The National Grid DC tests are built in. One user profile can be loaded at run time over the
+ * serial port (see Command) or Modbus (see MbRegMap). Start/stop requests from either are applied
+ * on the next control tick.
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun Mcsherry
+ *
+ **************************************************************************************************/
+#include <Arduino_MachineControl.h>
+#include "APP/TestProfile.h"
+#include "APP/SerialCmd.h"
+
+using namespace machinecontrol;
+
+/* National Grid DC tests: 1s at nominal, then a 1s step, repeated */
+static const tpSegmentStruct_t DC_1_1_SEGMENTS[] =
+{
+  /* duration, type,      value,  marker */
+  { 1000UL,    TP_SEG_STEP, 50.00, false },
+  { 1000UL,    TP_SEG_STEP, 50.01, true  }
+};
+
+static const tpSegmentStruct_t DC_1_2_SEGMENTS[] =
+{
+  { 1000UL,    TP_SEG_STEP, 50.00, true  },
+  { 1000UL,    TP_SEG_STEP, 49.99, false }
+};
+
+static const tpSegmentStruct_t DC_1_5_SEGMENTS[] =
+{
+  { 1000UL,    TP_SEG_STEP, 50.00, false },
+  { 1000UL,    TP_SEG_STEP, 50.10, true  }
+};
+
+static const tpSegmentStruct_t DC_1_7_SEGMENTS[] =
+{
+  { 1000UL,    TP_SEG_STEP, 50.00, false },
+  { 1000UL,    TP_SEG_STEP, 50.20, true  }
+};
+
+static const tpSegmentStruct_t DC_1_9_SEGMENTS[] =
+{
+  { 1000UL,    TP_SEG_STEP, 50.00, false },
+  { 1000UL,    TP_SEG_STEP, 50.30, true  }
+};
+
+static const tpSegmentStruct_t DC_1_11_SEGMENTS[] =
+{
+  { 1000UL,    TP_SEG_STEP, 50.00, false },
+  { 1000UL,    TP_SEG_STEP, 50.40, true  }
+};
+
+static const tpSegmentStruct_t DC_1_13_SEGMENTS[] =
+{
+  { 1000UL,    TP_SEG_STEP, 50.00, false },
+  { 1000UL,    TP_SEG_STEP, 50.50, true  }
+};
+
+#define NOOF_SEGMENTS(table)  ((uint8_t)(sizeof(table) / sizeof(table[0])))
+
+/* indexed from TP_PROFILE_DC_1_1 */
+static const tpProfileStruct_t BUILT_IN_PROFILES[] =
+{
+  { DC_1_1_SEGMENTS,  NOOF_SEGMENTS(DC_1_1_SEGMENTS),  0U },
+  { DC_1_2_SEGMENTS,  NOOF_SEGMENTS(DC_1_2_SEGMENTS),  0U },
+  { DC_1_5_SEGMENTS,  NOOF_SEGMENTS(DC_1_5_SEGMENTS),  0U },
+  { DC_1_7_SEGMENTS,  NOOF_SEGMENTS(DC_1_7_SEGMENTS),  0U },
+  { DC_1_9_SEGMENTS,  NOOF_SEGMENTS(DC_1_9_SEGMENTS),  0U },
+  { DC_1_11_SEGMENTS, NOOF_SEGMENTS(DC_1_11_SEGMENTS), 0U },
+  { DC_1_13_SEGMENTS, NOOF_SEGMENTS(DC_1_13_SEGMENTS), 0U }
+};
+
+static_assert((sizeof(BUILT_IN_PROFILES) / sizeof(BUILT_IN_PROFILES[0])) == 
+              (NOOF_TP_PROFILES - TP_PROFILE_DC_1_1), "Built in test profiles do not match ids");
+
+TEST_PROFILE testProfileObj;
+
+/* private functions */
+/***************************************************************************************************
+ * StartSegment
+ *
+ * This function starts the current segment and sets the marker output for it.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void TEST_PROFILE::StartSegment(void)
+{
+  segElapsed_ms = 0U;
+  SetMarker(profile->segments[segIndex].marker);
+}
+
+/***************************************************************************************************
+ * SetMarker
+ *
+ * This function sets the marker output, only writing it when the level changes.
+ *
+ * Parameters:
+ * level - the marker level
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void TEST_PROFILE::SetMarker(bool level)
+{
+  if (level != isMarker)
+  {
+    isMarker = level;
+    digital_outputs.set(TP_MARKER_OUTPUT, (true == level) ? HIGH : LOW);
+  }
+}
+
+/***************************************************************************************************
+ * IsUserEditable
+ *
+ * This function reports whether the user profile can be changed, i.e. it is not running or about
+ * to run.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * true if the user profile can be changed, otherwise false
+ *
+ **************************************************************************************************/
+bool TEST_PROFILE::IsUserEditable(void)
+{
+  return ((TP_PROFILE_USER != runningId) &&
+          ((false == isRequestPending) || (TP_PROFILE_USER != requestedId)));
+}
+
+/* Public functions */
+/***************************************************************************************************
+ * Init
+ *
+ * This function starts the power up profile, if there is one.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void TEST_PROFILE::Init(void)
+{
+  #ifdef TP_AUTOSTART_PROFILE
+   Start(TP_AUTOSTART_PROFILE);
+  #endif
+}
+
+/***************************************************************************************************
+ * Control
+ *
+ * This function applies start/stop requests and steps the running profile. It should be called
+ * every 1ms.
+ *
+ * Parameters:
+ * sysCount - system counter
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void TEST_PROFILE::Control(uint16_t sysCount)
+{
+  uint16_t elapsed_ms;
+  const tpSegmentStruct_t *segment;
+
+  elapsed_ms = sysCount - oldSysCount;
+  oldSysCount = sysCount;
+
+  if (true == isRequestPending)
+  {
+    isRequestPending = false;
+    runningId = requestedId;
+
+    if (TP_PROFILE_NONE == runningId)
+    {
+      profile = NULL;
+      SetMarker(false);
+      Serial.println("Test profile stopped");
+    }
+    else
+    {
+      if (TP_PROFILE_USER == runningId)
+      {
+        profile = &userProfile;
+      }
+      else
+      {
+        profile = &BUILT_IN_PROFILES[runningId - TP_PROFILE_DC_1_1];
+      }
+
+      segIndex = 0U;
+      passCount = 0U;
+      segStartFreq = TP_START_FREQ;
+      StartSegment();
+      elapsed_ms = 0U;
+      Serial.print("Test profile started: ");
+      Serial.println(runningId);
+    }
+  }
+
+  if (NULL != profile)
+  {
+    segElapsed_ms += elapsed_ms;
+
+    /* move on over any segments that have ended (all segments have a duration) */
+    while ((NULL != profile) && (segElapsed_ms >= profile->segments[segIndex].duration_ms))
+    {
+      segment = &profile->segments[segIndex];
+      segElapsed_ms -= segment->duration_ms;
+
+      if (TP_SEG_RAMP == segment->type)
+      {
+        segStartFreq += (segment->value * (double)segment->duration_ms) / 1000.0;
+      }
+      else
+      {
+        segStartFreq = segment->value;
+      }
+
+      segIndex++;
+
+      if (segIndex >= profile->noofSegments)
+      {
+        segIndex = 0U;
+        segStartFreq = TP_START_FREQ;
+        passCount++;
+
+        if ((0U != profile->repeats) && (passCount >= profile->repeats))
+        {
+          profile = NULL;
+          runningId = TP_PROFILE_NONE;
+          SetMarker(false);
+          Serial.println("Test profile complete");
+        }
+      }
+
+      if (NULL != profile)
+      {
+        SetMarker(profile->segments[segIndex].marker);
+      }
+    }
+
+    if (NULL != profile)
+    {
+      segment = &profile->segments[segIndex];
+
+      if (TP_SEG_RAMP == segment->type)
+      {
+        frequency = segStartFreq + ((segment->value * (double)segElapsed_ms) / 1000.0);
+      }
+      else
+      {
+        frequency = segment->value;
+      }
+
+      if (frequency < TP_MIN_FREQ)
+      {
+        frequency = TP_MIN_FREQ;
+      }
+      else if (frequency > TP_MAX_FREQ)
+      {
+        frequency = TP_MAX_FREQ;
+      }
+    }
+  }
+}
+
+/***************************************************************************************************
+ * GetFrequency
+ *
+ * This function returns the profile frequency while a profile is running.
+ *
+ * Parameters:
+ * testFrequency - updated with the profile frequency (Hz) if a profile is running
+ *
+ * Return:
+ * true if a profile is running, otherwise false
+ *
+ **************************************************************************************************/
+bool TEST_PROFILE::GetFrequency(double *testFrequency)
+{
+  bool isRunning = false;
+
+  if (NULL != profile)
+  {
+    *testFrequency = frequency;
+    isRunning = true;
+  }
+
+  return isRunning;
+}
+
+/***************************************************************************************************
+ * Start
+ *
+ * This function requests a profile to start, from the beginning, on the next control tick. It
+ * may be called from the Modbus context.
+ *
+ * Parameters:
+ * id - the profile, TP_PROFILE_NONE to stop
+ *
+ * Return:
+ * true if the request has been accepted, otherwise false
+ *
+ **************************************************************************************************/
+bool TEST_PROFILE::Start(tpProfileIdEnum_t id)
+{
+  bool isAccepted = false;
+
+  if ((id < NOOF_TP_PROFILES) &&
+      ((TP_PROFILE_USER != id) || (userProfile.noofSegments > 0U)))
+  {
+    requestedId = id;
+    isRequestPending = true;
+    isAccepted = true;
+  }
+
+  return isAccepted;
+}
+
+/***************************************************************************************************
+ * GetRunningId
+ *
+ * This function returns the running profile.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * The running profile, TP_PROFILE_NONE if stopped
+ *
+ **************************************************************************************************/
+tpProfileIdEnum_t TEST_PROFILE::GetRunningId(void)
+{
+  return runningId;
+}
+
+/***************************************************************************************************
+ * GetMarker
+ *
+ * This function returns the marker output level.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * true if the marker is high, otherwise false
+ *
+ **************************************************************************************************/
+bool TEST_PROFILE::GetMarker(void)
+{
+  return isMarker;
+}
+
+/***************************************************************************************************
+ * SetSegment
+ *
+ * This function sets one segment of the user profile. It is rejected while the user profile is
+ * running.
+ *
+ * Parameters:
+ * index - segment index
+ * segment - the segment
+ *
+ * Return:
+ * true if the segment is valid and has been set, otherwise false
+ *
+ **************************************************************************************************/
+bool TEST_PROFILE::SetSegment(uint8_t index, const tpSegmentStruct_t *segment)
+{
+  bool isSet = false;
+
+  if ((true == IsUserEditable()) &&
+      (index < TP_MAX_SEGMENTS) &&
+      (segment->duration_ms > 0U) &&
+      ((TP_SEG_RAMP == segment->type) ||
+       ((TP_SEG_STEP == segment->type) && 
+        (segment->value >= TP_MIN_FREQ) && (segment->value <= TP_MAX_FREQ))))
+  {
+    userSegments[index] = *segment;
+    isSet = true;
+  }
+
+  return isSet;
+}
+
+/***************************************************************************************************
+ * GetSegment
+ *
+ * This function returns one segment of the user profile.
+ *
+ * Parameters:
+ * index - segment index
+ * segment - updated with the segment
+ *
+ * Return:
+ * true if the segment exists, otherwise false
+ *
+ **************************************************************************************************/
+bool TEST_PROFILE::GetSegment(uint8_t index, tpSegmentStruct_t *segment)
+{
+  bool isValid = false;
+
+  if (index < TP_MAX_SEGMENTS)
+  {
+    *segment = userSegments[index];
+    isValid = true;
+  }
+
+  return isValid;
+}
+
+/***************************************************************************************************
+ * SetNoofSegments
+ *
+ * This function sets the number of segments in the user profile. Every segment in use must have
+ * been set.
+ *
+ * Parameters:
+ * noofSegments - number of segments
+ *
+ * Return:
+ * true if set, otherwise false
+ *
+ **************************************************************************************************/
+bool TEST_PROFILE::SetNoofSegments(uint8_t noofSegments)
+{
+  uint8_t index;
+  bool isSet = false;
+
+  if ((true == IsUserEditable()) && (noofSegments <= TP_MAX_SEGMENTS))
+  {
+    isSet = true;
+
+    for (index = 0U; index < noofSegments; index++)
+    {
+      if (0U == userSegments[index].duration_ms)
+      {
+        isSet = false;
+      }
+    }
+
+    if (true == isSet)
+    {
+      userProfile.noofSegments = noofSegments;
+    }
+  }
+
+  return isSet;
+}
+
+/***************************************************************************************************
+ * GetNoofSegments
+ *
+ * This function returns the number of segments in the user profile.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * Number of segments
+ *
+ **************************************************************************************************/
+uint8_t TEST_PROFILE::GetNoofSegments(void)
+{
+  return userProfile.noofSegments;
+}
+
+/***************************************************************************************************
+ * SetRepeats
+ *
+ * This function sets the number of passes of the user profile.
+ *
+ * Parameters:
+ * repeats - number of passes, 0 for ever
+ *
+ * Return:
+ * true if set, otherwise false
+ *
+ **************************************************************************************************/
+bool TEST_PROFILE::SetRepeats(uint16_t repeats)
+{
+  bool isSet = false;
+
+  if (true == IsUserEditable())
+  {
+    userProfile.repeats = repeats;
+    isSet = true;
+  }
+
+  return isSet;
+}
+
+/***************************************************************************************************
+ * GetRepeats
+ *
+ * This function returns the number of passes of the user profile.
+ *
+ * Parameters:
+ * None
+ *
+ * Return:
+ * Number of passes, 0 for ever
+ *
+ **************************************************************************************************/
+uint16_t TEST_PROFILE::GetRepeats(void)
+{
+  return userProfile.repeats;
+}
+
+/***************************************************************************************************
+ * Command
+ *
+ * This function runs a test profile command received on the serial port:
+ *   tp run <id>                                  start a profile (see tpProfileIdEnum_t)
+ *   tp stop                                      stop the running profile
+ *   tp seg <index> <ms> <s|r> <Hz|Hz/s> <0|1>    set a user profile segment
+ *   tp n <count>                                 set the number of user profile segments
+ *   tp rep <count>                               set the user profile passes, 0 for ever
+ *
+ * Parameters:
+ * command - the command
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+void TEST_PROFILE::Command(String command)
+{
+  tpSegmentStruct_t segment;
+  String action;
+  String type;
+  int position = 0;
+  uint8_t index;
+  bool isOk = false;
+
+  command.trim();
+  (void)CMD_NextToken(command, &position);   /* "tp" */
+  action = CMD_NextToken(command, &position);
+
+  if ("run" == action)
+  {
+    isOk = Start((tpProfileIdEnum_t)CMD_NextToken(command, &position).toInt());
+  }
+  else if ("stop" == action)
+  {
+    isOk = Start(TP_PROFILE_NONE);
+  }
+  else if ("seg" == action)
+  {
+    index = (uint8_t)CMD_NextToken(command, &position).toInt();
+    segment.duration_ms = (uint32_t)CMD_NextToken(command, &position).toInt();
+    type = CMD_NextToken(command, &position);
+    segment.type = ("r" == type) ? TP_SEG_RAMP : TP_SEG_STEP;
+    segment.value = CMD_NextToken(command, &position).toDouble();
+    segment.marker = (0 != CMD_NextToken(command, &position).toInt());
+    isOk = SetSegment(index, &segment);
+  }
+  else if ("n" == action)
+  {
+    isOk = SetNoofSegments((uint8_t)CMD_NextToken(command, &position).toInt());
+  }
+  else if ("rep" == action)
+  {
+    isOk = SetRepeats((uint16_t)CMD_NextToken(command, &position).toInt());
+  }
+  else
+  {
+    /* unknown command */
+  }
+
+  if (true == isOk)
+  {
+    Serial.println("tp ok");
+  }
+  else
+  {
+    Serial.println("tp rejected");
+  }
+}
+
+/* end public functions */
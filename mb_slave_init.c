@@ -16,12 +16,12 @@
 #include "Modbus/mb_slave_init.h"
 #include "Modbus/mb_tcp.h"
 #include "Modbus/mb_rtu.h"
+#include "APP/MbRegMap.h"
 //#include "osal.h"
 
 #include <string.h>
 
 static uint8_t coils[2] = {0x55, 0xAA};
-static uint16_t hold[4] = {0x1234, 0x5678, 0x55AA, 0xAA55};
 
 static int coil_get (uint16_t address, uint8_t * data, size_t quantity)
 {
@@ -67,27 +67,31 @@ static int input_get (uint16_t address, uint8_t * data, size_t quantity)
 static int hold_get (uint16_t address, uint8_t * data, size_t quantity)
 {
    uint16_t offset;
+   uint16_t value;
+   int error = 0;
 
-   for (offset = 0; offset < quantity; offset++)
+   for (offset = 0; (offset < quantity) && (error == 0); offset++)
    {
-      uint32_t reg = address + offset;
+      uint16_t reg = address + offset;
 
-      mb_slave_reg_set (data, offset, hold[reg]);
+      error = MB_HoldRead (reg, &value);
+      mb_slave_reg_set (data, offset, value);
    }
-   return 0;
+   return error;
 }
 
 static int hold_set (uint16_t address, uint8_t * data, size_t quantity)
 {
    uint16_t offset;
+   int error = 0;
 
-   for (offset = 0; offset < quantity; offset++)
+   for (offset = 0; (offset < quantity) && (error == 0); offset++)
    {
-      uint32_t reg = address + offset;
+      uint16_t reg = address + offset;
 
-      hold[reg] = mb_slave_reg_get (data, offset);
+      error = MB_HoldWrite (reg, mb_slave_reg_get (data, offset));
    }
-   return 0;
+   return error;
 }
 
 static int reg_get (uint16_t address, uint8_t * data, size_t quantity)
@@ -115,7 +119,7 @@ static const mb_vendor_func_t vendor_funcs[] = {
 const mb_iomap_t mb_slave_iomap = {
    .coils             = {0, coil_get, coil_set}, // 0 coils
    .inputs            = {0, input_get, NULL},    // 0 input status bits
-   .holding_registers = {8, hold_get, hold_set}, // 8 holding registers
+   .holding_registers = {MB_NOOF_HOLD_REGS, hold_get, hold_set}, // see MbRegMap.h
    .input_registers   = {0, reg_get, NULL}       // 0 input registers
 };
 
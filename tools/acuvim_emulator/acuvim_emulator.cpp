@@ -0,0 +1,800 @@
+/***************************************************************************************************
+ * acuvim_emulator
+ *
+ * Host-side (Linux) emulator of the Acuvim II meter. It serves the basic 20ms register block read
+ * by ACUVIM_II over Modbus TCP so the meter client and the power control loop can be exercised
+ * without site hardware, and measures how fast the client polls.
+ *
+ * - Frequency and power follow a scripted profile of steps, ramps and recorded traces.
+ * - Responses can be delayed (latency plus jitter), dropped, or the connection reset.
+ * - Values are IEEE-754 floats, high word first, as the meter sends them. Power is served in the
+ *   units the controller works in (0.1kW), so a script in kW reaches it at the right scale.
+ * - -e int only mimics an earlier client decode (unsigned 32-bit integer, low word first): it
+ *   sends whole Hz and wraps negative power, so it is not what a meter sends.
+ * - Request inter-arrival statistics are reported periodically and on exit (Ctrl-C).
+ *
+ * Build:
+ *   g++ -O2 -std=c++14 -o acuvim_emulator acuvim_emulator.cpp
+ *
+ * Usage:
+ *   acuvim_emulator [-p port] [-s script] [-e float|int] [-l latency_ms] [-j jitter_ms]
+ *                   [-d drop_probability] [-r reset_probability] [-i stats_interval_s]
+ *
+ * Profile script, one command per line, times in seconds from start, '#' starts a comment:
+ *   step  <t> <freq_hz> <power_kw>            jump to the values at t
+ *   ramp  <t> <duration> <freq_hz> <power_kw> move linearly to the values over duration
+ *   trace <t> <file.csv>                      replay "t,freq_hz,power_kw" rows from t
+ *   loop  <t>                                 restart the profile at t
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun McSherry
+ *
+ **************************************************************************************************/
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Register map - must match ACUVIM_PROFILE_BASIC_20MS in Acuvim2.cpp */
+#define ACUVIM_MB_BASIC_20MS_ADDR   0x3400U
+#define NOOF_BASIC_REGS_20MS        30U
+
+#define MB_TCP_PORT                 502
+#define MB_MBAP_SIZE                7U
+#define MB_MAX_ADU_SIZE             260U
+#define MB_MAX_READ_REGS            125U
+#define MB_MAX_CLIENTS              8U
+
+#define MB_FC_READ_HOLDING          0x03U
+#define MB_FC_READ_INPUT            0x04U
+
+#define MB_EX_ILLEGAL_FUNCTION      0x01U
+#define MB_EX_ILLEGAL_ADDRESS       0x02U
+#define MB_EX_ILLEGAL_VALUE         0x03U
+
+#define NOMINAL_FREQ_HZ             50.0
+#define NOMINAL_LINE_VOLTAGE        690.0
+#define POWER_UNITS_PER_KW          10.0      /* the controller works in 0.1kW */
+
+typedef enum ENCODING_ENUM
+{
+  ENCODING_FLOAT = 0,   /* IEEE-754 float, high word first (Acuvim II native) */
+  ENCODING_INT   = 1    /* unsigned 32-bit integer, low word first (an earlier client decode) */
+}encodingEnum_t;
+
+typedef struct KEYFRAME_STRUCT
+{
+  double time_s;
+  double freq_hz;
+  double power_kw;
+  bool isLinear;        /* interpolate from the previous keyframe, otherwise step */
+}keyframeStruct_t;
+
+typedef struct PENDING_RESPONSE_STRUCT
+{
+  double due_s;
+  std::vector<uint8_t> adu;
+}pendingResponseStruct_t;
+
+typedef struct CLIENT_STRUCT
+{
+  int fd;
+  std::vector<uint8_t> rxBuffer;
+  std::deque<pendingResponseStruct_t> pending;
+}clientStruct_t;
+
+typedef struct CONFIG_STRUCT
+{
+  int port;
+  std::string scriptFile;
+  encodingEnum_t encoding;
+  double latency_ms;
+  double jitter_ms;
+  double dropProbability;
+  double resetProbability;
+  double statsInterval_s;
+}configStruct_t;
+
+typedef struct STATS_STRUCT
+{
+  uint64_t requests;
+  uint64_t responses;
+  uint64_t drops;
+  uint64_t resets;
+  uint64_t exceptions;
+  double lastRequest_s;
+  std::vector<double> interArrival_ms;
+}statsStruct_t;
+
+static volatile sig_atomic_t isStopRequested = 0;
+
+static std::vector<keyframeStruct_t> keyframes;
+static double loopTime_s = 0.0;
+static statsStruct_t stats;
+static std::mt19937 rng(12345U);
+
+/***************************************************************************************************
+ * NowSeconds
+ *
+ * This function returns the monotonic time in seconds.
+ *
+ **************************************************************************************************/
+static double NowSeconds(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (double)ts.tv_sec + ((double)ts.tv_nsec * 1e-9);
+}
+
+static void SignalHandler(int signum)
+{
+  (void)signum;
+  isStopRequested = 1;
+}
+
+/***************************************************************************************************
+ * LoadTrace
+ *
+ * This function appends the rows of a recorded trace (t,freq_hz,power_kw) as linear keyframes,
+ * offset to start at startTime_s.
+ *
+ * Return:
+ * true if the file was read, otherwise false
+ *
+ **************************************************************************************************/
+static bool LoadTrace(const std::string &fileName, double startTime_s)
+{
+  std::ifstream file(fileName.c_str());
+  std::string line;
+  bool isFirst = true;
+  double firstTime_s = 0.0;
+
+  if (!file)
+  {
+    fprintf(stderr, "Cannot open trace %s\n", fileName.c_str());
+    return false;
+  }
+
+  while (std::getline(file, line))
+  {
+    keyframeStruct_t frame;
+    double t;
+
+    std::replace(line.begin(), line.end(), ',', ' ');
+    std::istringstream fields(line);
+
+    if (!(fields >> t >> frame.freq_hz >> frame.power_kw))
+    {
+      continue;   /* header or blank line */
+    }
+
+    if (true == isFirst)
+    {
+      firstTime_s = t;
+    }
+
+    frame.time_s = startTime_s + (t - firstTime_s);
+    frame.isLinear = (false == isFirst);
+    keyframes.push_back(frame);
+    isFirst = false;
+  }
+
+  return true;
+}
+
+/***************************************************************************************************
+ * LoadScript
+ *
+ * This function parses the profile script into keyframes.
+ *
+ * Return:
+ * true if the script was valid, otherwise false
+ *
+ **************************************************************************************************/
+static bool LoadScript(const std::string &fileName)
+{
+  std::ifstream file(fileName.c_str());
+  std::string line;
+  unsigned lineNumber = 0U;
+
+  if (!file)
+  {
+    fprintf(stderr, "Cannot open script %s\n", fileName.c_str());
+    return false;
+  }
+
+  while (std::getline(file, line))
+  {
+    std::string command;
+    keyframeStruct_t frame;
+    double duration_s;
+    std::string traceFile;
+
+    lineNumber++;
+    line = line.substr(0, line.find('#'));
+    std::istringstream fields(line);
+
+    if (!(fields >> command))
+    {
+      continue;
+    }
+
+    if ("step" == command)
+    {
+      if (!(fields >> frame.time_s >> frame.freq_hz >> frame.power_kw))
+      {
+        fprintf(stderr, "%s:%u: step <t> <freq_hz> <power_kw>\n", fileName.c_str(), lineNumber);
+        return false;
+      }
+      frame.isLinear = false;
+      keyframes.push_back(frame);
+    }
+    else if ("ramp" == command)
+    {
+      if (!(fields >> frame.time_s >> duration_s >> frame.freq_hz >> frame.power_kw))
+      {
+        fprintf(stderr, "%s:%u: ramp <t> <duration> <freq_hz> <power_kw>\n",
+                fileName.c_str(), lineNumber);
+        return false;
+      }
+      /* hold the previous values until the ramp starts */
+      keyframeStruct_t start = keyframes.empty() ?
+                               keyframeStruct_t{0.0, NOMINAL_FREQ_HZ, 0.0, false} :
+                               keyframes.back();
+      start.time_s = frame.time_s;
+      start.isLinear = false;
+      keyframes.push_back(start);
+
+      frame.time_s += duration_s;
+      frame.isLinear = true;
+      keyframes.push_back(frame);
+    }
+    else if ("trace" == command)
+    {
+      if (!(fields >> frame.time_s >> traceFile) || (false == LoadTrace(traceFile, frame.time_s)))
+      {
+        fprintf(stderr, "%s:%u: trace <t> <file.csv>\n", fileName.c_str(), lineNumber);
+        return false;
+      }
+    }
+    else if ("loop" == command)
+    {
+      if (!(fields >> loopTime_s))
+      {
+        fprintf(stderr, "%s:%u: loop <t>\n", fileName.c_str(), lineNumber);
+        return false;
+      }
+    }
+    else
+    {
+      fprintf(stderr, "%s:%u: unknown command %s\n", fileName.c_str(), lineNumber, command.c_str());
+      return false;
+    }
+  }
+
+  std::stable_sort(keyframes.begin(), keyframes.end(),
+                   [](const keyframeStruct_t &a, const keyframeStruct_t &b)
+                   { return a.time_s < b.time_s; });
+
+  return true;
+}
+
+/***************************************************************************************************
+ * ProfileValues
+ *
+ * This function evaluates the profile at time t (seconds since start).
+ *
+ **************************************************************************************************/
+static void ProfileValues(double t, double *freq_hz, double *power_kw)
+{
+  size_t index;
+
+  *freq_hz = NOMINAL_FREQ_HZ;
+  *power_kw = 0.0;
+
+  if (keyframes.empty())
+  {
+    return;
+  }
+
+  if ((loopTime_s > 0.0) && (t >= loopTime_s))
+  {
+    t = fmod(t, loopTime_s);
+  }
+
+  /* keyframes are sorted, find the last one at or before t */
+  index = (size_t)(std::upper_bound(keyframes.begin(), keyframes.end(), t,
+                                    [](double value, const keyframeStruct_t &frame)
+                                    { return value < frame.time_s; }) - keyframes.begin());
+
+  if (0U == index)
+  {
+    return;
+  }
+
+  const keyframeStruct_t &previous = keyframes[index - 1U];
+  *freq_hz = previous.freq_hz;
+  *power_kw = previous.power_kw;
+
+  if ((index < keyframes.size()) && (true == keyframes[index].isLinear))
+  {
+    const keyframeStruct_t &next = keyframes[index];
+    double fraction = (t - previous.time_s) / (next.time_s - previous.time_s);
+
+    *freq_hz += (next.freq_hz - previous.freq_hz) * fraction;
+    *power_kw += (next.power_kw - previous.power_kw) * fraction;
+  }
+}
+
+/***************************************************************************************************
+ * EncodeValue
+ *
+ * This function writes a measurement into a register pair using the configured encoding.
+ *
+ **************************************************************************************************/
+static void EncodeValue(uint16_t *regs, double value, encodingEnum_t encoding)
+{
+  uint32_t raw;
+
+  if (ENCODING_FLOAT == encoding)
+  {
+    float asFloat = (float)value;
+
+    memcpy(&raw, &asFloat, sizeof(raw));
+    regs[0] = (uint16_t)(raw >> 16U);
+    regs[1] = (uint16_t)(raw & 0xFFFFU);
+  }
+  else
+  {
+    raw = (uint32_t)(int32_t)lround(value);
+    regs[0] = (uint16_t)(raw & 0xFFFFU);
+    regs[1] = (uint16_t)(raw >> 16U);
+  }
+}
+
+/***************************************************************************************************
+ * BuildRegisterBlock
+ *
+ * This function fills the basic 20ms register block from the profile at time t.
+ *
+ **************************************************************************************************/
+static void BuildRegisterBlock(uint16_t *regs, double t, const configStruct_t &config)
+{
+  double freq_hz;
+  double power_kw;
+  double phaseVoltage = NOMINAL_LINE_VOLTAGE / sqrt(3.0);
+  double current;
+
+  ProfileValues(t, &freq_hz, &power_kw);
+
+  current = (power_kw * 1000.0) / (sqrt(3.0) * NOMINAL_LINE_VOLTAGE);
+
+  EncodeValue(&regs[0], freq_hz, config.encoding);
+  EncodeValue(&regs[2], phaseVoltage, config.encoding);
+  EncodeValue(&regs[4], phaseVoltage, config.encoding);
+  EncodeValue(&regs[6], phaseVoltage, config.encoding);
+  EncodeValue(&regs[8], phaseVoltage, config.encoding);
+  EncodeValue(&regs[10], NOMINAL_LINE_VOLTAGE, config.encoding);
+  EncodeValue(&regs[12], NOMINAL_LINE_VOLTAGE, config.encoding);
+  EncodeValue(&regs[14], NOMINAL_LINE_VOLTAGE, config.encoding);
+  EncodeValue(&regs[16], NOMINAL_LINE_VOLTAGE, config.encoding);
+  EncodeValue(&regs[18], fabs(current), config.encoding);
+  EncodeValue(&regs[20], fabs(current), config.encoding);
+  EncodeValue(&regs[22], fabs(current), config.encoding);
+  EncodeValue(&regs[24], fabs(current), config.encoding);
+  EncodeValue(&regs[26], power_kw * POWER_UNITS_PER_KW, config.encoding);
+  EncodeValue(&regs[28], 0.0, config.encoding);
+}
+
+/***************************************************************************************************
+ * ExceptionResponse
+ *
+ * This function builds a Modbus exception response PDU.
+ *
+ **************************************************************************************************/
+static void ExceptionResponse(std::vector<uint8_t> &pdu, uint8_t function, uint8_t code)
+{
+  pdu.clear();
+  pdu.push_back((uint8_t)(function | 0x80U));
+  pdu.push_back(code);
+  stats.exceptions++;
+}
+
+/***************************************************************************************************
+ * HandlePdu
+ *
+ * This function processes a request PDU and builds the response PDU.
+ *
+ **************************************************************************************************/
+static void HandlePdu(const uint8_t *request, size_t length, std::vector<uint8_t> &response,
+                      double t, const configStruct_t &config)
+{
+  uint8_t function = request[0];
+  uint16_t address;
+  uint16_t quantity;
+  uint16_t regs[NOOF_BASIC_REGS_20MS];
+  uint16_t index;
+
+  response.clear();
+
+  if (length < 5U)
+  {
+    ExceptionResponse(response, function, MB_EX_ILLEGAL_VALUE);
+    return;
+  }
+
+  address = (uint16_t)((request[1] << 8U) | request[2]);
+  quantity = (uint16_t)((request[3] << 8U) | request[4]);
+
+  switch (function)
+  {
+    case MB_FC_READ_HOLDING:
+    case MB_FC_READ_INPUT:
+      if ((0U == quantity) || (quantity > MB_MAX_READ_REGS))
+      {
+        ExceptionResponse(response, function, MB_EX_ILLEGAL_VALUE);
+      }
+      else if ((address < ACUVIM_MB_BASIC_20MS_ADDR) ||
+               ((address + quantity) > (ACUVIM_MB_BASIC_20MS_ADDR + NOOF_BASIC_REGS_20MS)))
+      {
+        ExceptionResponse(response, function, MB_EX_ILLEGAL_ADDRESS);
+      }
+      else
+      {
+        BuildRegisterBlock(regs, t, config);
+        response.push_back(function);
+        response.push_back((uint8_t)(quantity * 2U));
+        for (index = 0U; index < quantity; index++)
+        {
+          uint16_t value = regs[(address - ACUVIM_MB_BASIC_20MS_ADDR) + index];
+          response.push_back((uint8_t)(value >> 8U));
+          response.push_back((uint8_t)(value & 0xFFU));
+        }
+      }
+      break;
+
+    default:
+      ExceptionResponse(response, function, MB_EX_ILLEGAL_FUNCTION);
+      break;
+  }
+}
+
+/***************************************************************************************************
+ * RecordRequest
+ *
+ * This function records the inter-arrival time of requests for the poll rate benchmark.
+ *
+ **************************************************************************************************/
+static void RecordRequest(double now)
+{
+  if (stats.requests > 0U)
+  {
+    stats.interArrival_ms.push_back((now - stats.lastRequest_s) * 1000.0);
+  }
+  stats.lastRequest_s = now;
+  stats.requests++;
+}
+
+/***************************************************************************************************
+ * PrintStats
+ *
+ * This function reports the request statistics collected since the last report.
+ *
+ **************************************************************************************************/
+static void PrintStats(double interval_s)
+{
+  std::vector<double> &samples = stats.interArrival_ms;
+  double sum = 0.0;
+
+  printf("requests %llu responses %llu drops %llu resets %llu exceptions %llu",
+         (unsigned long long)stats.requests, (unsigned long long)stats.responses,
+         (unsigned long long)stats.drops, (unsigned long long)stats.resets,
+         (unsigned long long)stats.exceptions);
+
+  if (samples.empty())
+  {
+    printf("\n");
+    fflush(stdout);
+    return;
+  }
+
+  for (double sample : samples)
+  {
+    sum += sample;
+  }
+  std::sort(samples.begin(), samples.end());
+
+  printf(" | poll rate %.1f Hz, interval ms mean %.2f p50 %.2f p99 %.2f max %.2f\n",
+         (double)samples.size() / interval_s,
+         sum / (double)samples.size(),
+         samples[samples.size() / 2U],
+         samples[(samples.size() * 99U) / 100U],
+         samples.back());
+  fflush(stdout);
+
+  samples.clear();
+}
+
+/***************************************************************************************************
+ * CloseClient
+ *
+ * This function closes a client connection, optionally with a TCP reset.
+ *
+ **************************************************************************************************/
+static void CloseClient(clientStruct_t &client, bool isReset)
+{
+  if (true == isReset)
+  {
+    struct linger lingerOpt = {1, 0};
+
+    setsockopt(client.fd, SOL_SOCKET, SO_LINGER, &lingerOpt, sizeof(lingerOpt));
+    stats.resets++;
+  }
+  close(client.fd);
+  client.fd = -1;
+}
+
+/***************************************************************************************************
+ * ProcessRx
+ *
+ * This function extracts complete Modbus TCP frames from a client's receive buffer and queues
+ * the responses with the configured latency, or drops them / resets the connection.
+ *
+ **************************************************************************************************/
+static void ProcessRx(clientStruct_t &client, double now, double startTime,
+                      const configStruct_t &config)
+{
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+  while ((client.fd >= 0) && (client.rxBuffer.size() >= MB_MBAP_SIZE))
+  {
+    const uint8_t *mbap = client.rxBuffer.data();
+    uint16_t length = (uint16_t)((mbap[4] << 8U) | mbap[5]);
+    size_t frameSize = 6U + length;
+    std::vector<uint8_t> pdu;
+    pendingResponseStruct_t pending;
+
+    if ((length < 2U) || (frameSize > MB_MAX_ADU_SIZE))
+    {
+      CloseClient(client, true);   /* framing lost */
+      return;
+    }
+    if (client.rxBuffer.size() < frameSize)
+    {
+      return;
+    }
+
+    RecordRequest(now);
+
+    if (uniform(rng) < config.resetProbability)
+    {
+      CloseClient(client, true);
+      return;
+    }
+
+    if (uniform(rng) < config.dropProbability)
+    {
+      stats.drops++;
+    }
+    else
+    {
+      HandlePdu(&mbap[MB_MBAP_SIZE], frameSize - MB_MBAP_SIZE, pdu, now - startTime, config);
+
+      pending.adu.assign(mbap, mbap + MB_MBAP_SIZE);
+      pending.adu[4] = (uint8_t)((pdu.size() + 1U) >> 8U);
+      pending.adu[5] = (uint8_t)((pdu.size() + 1U) & 0xFFU);
+      pending.adu.insert(pending.adu.end(), pdu.begin(), pdu.end());
+
+      pending.due_s = now + ((config.latency_ms +
+                              ((uniform(rng) * 2.0) - 1.0) * config.jitter_ms) / 1000.0);
+      /* keep responses in order on the connection, as a real meter would */
+      if (!client.pending.empty())
+      {
+        pending.due_s = std::max(pending.due_s, client.pending.back().due_s);
+      }
+      client.pending.push_back(pending);
+    }
+
+    client.rxBuffer.erase(client.rxBuffer.begin(), client.rxBuffer.begin() + (long)frameSize);
+  }
+}
+
+/***************************************************************************************************
+ * SendDue
+ *
+ * This function transmits any queued responses whose latency has elapsed.
+ *
+ **************************************************************************************************/
+static void SendDue(clientStruct_t &client, double now)
+{
+  while ((client.fd >= 0) && !client.pending.empty() && (client.pending.front().due_s <= now))
+  {
+    const std::vector<uint8_t> &adu = client.pending.front().adu;
+
+    if (send(client.fd, adu.data(), adu.size(), MSG_NOSIGNAL) < 0)
+    {
+      CloseClient(client, false);
+      return;
+    }
+    stats.responses++;
+    client.pending.pop_front();
+  }
+}
+
+static void Usage(const char *name)
+{
+  fprintf(stderr,
+          "usage: %s [-p port] [-s script] [-e float|int] [-l latency_ms] [-j jitter_ms]\n"
+          "          [-d drop_probability] [-r reset_probability] [-i stats_interval_s]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+  configStruct_t config = {MB_TCP_PORT, "", ENCODING_FLOAT, 0.0, 0.0, 0.0, 0.0, 5.0};
+  int option;
+  int listenFd;
+  int enable = 1;
+  struct sockaddr_in address;
+  std::vector<clientStruct_t> clients;
+  double startTime;
+  double lastStats;
+
+  while ((option = getopt(argc, argv, "p:s:e:l:j:d:r:i:h")) != -1)
+  {
+    switch (option)
+    {
+      case 'p': config.port = atoi(optarg); break;
+      case 's': config.scriptFile = optarg; break;
+      case 'e': config.encoding = (0 == strcmp(optarg, "int")) ? ENCODING_INT : ENCODING_FLOAT;
+                break;
+      case 'l': config.latency_ms = atof(optarg); break;
+      case 'j': config.jitter_ms = atof(optarg); break;
+      case 'd': config.dropProbability = atof(optarg); break;
+      case 'r': config.resetProbability = atof(optarg); break;
+      case 'i': config.statsInterval_s = atof(optarg); break;
+      default:  Usage(argv[0]); return 1;
+    }
+  }
+
+  if (!config.scriptFile.empty() && (false == LoadScript(config.scriptFile)))
+  {
+    return 1;
+  }
+
+  signal(SIGINT, SignalHandler);
+  signal(SIGTERM, SignalHandler);
+
+  listenFd = socket(AF_INET, SOCK_STREAM, 0);
+  setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_ANY);
+  address.sin_port = htons((uint16_t)config.port);
+
+  if ((bind(listenFd, (struct sockaddr *)&address, sizeof(address)) < 0) ||
+      (listen(listenFd, (int)MB_MAX_CLIENTS) < 0))
+  {
+    perror("bind/listen");
+    return 1;
+  }
+
+  printf("Acuvim II emulator listening on port %d (%u keyframes)\n",
+         config.port, (unsigned)keyframes.size());
+  fflush(stdout);
+
+  startTime = NowSeconds();
+  lastStats = startTime;
+
+  while (0 == isStopRequested)
+  {
+    std::vector<struct pollfd> fds;
+    double now = NowSeconds();
+    int timeout_ms = 1;
+    size_t index;
+
+    fds.push_back({listenFd, POLLIN, 0});
+    for (clientStruct_t &client : clients)
+    {
+      fds.push_back({client.fd, POLLIN, 0});
+    }
+
+    if (poll(fds.data(), (nfds_t)fds.size(), timeout_ms) < 0)
+    {
+      if (EINTR == errno)
+      {
+        continue;
+      }
+      perror("poll");
+      break;
+    }
+
+    now = NowSeconds();
+
+    if ((fds[0].revents & POLLIN) != 0)
+    {
+      int fd = accept(listenFd, nullptr, nullptr);
+
+      if (fd >= 0)
+      {
+        if (clients.size() >= MB_MAX_CLIENTS)
+        {
+          close(fd);
+        }
+        else
+        {
+          setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+          fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+          clients.push_back(clientStruct_t{fd, {}, {}});
+          printf("client connected (%u)\n", (unsigned)clients.size());
+        }
+      }
+    }
+
+    for (index = 0U; index < clients.size(); index++)
+    {
+      clientStruct_t &client = clients[index];
+
+      if ((fds[index + 1U].revents & (POLLIN | POLLHUP | POLLERR)) != 0)
+      {
+        uint8_t buffer[MB_MAX_ADU_SIZE];
+        ssize_t received = recv(client.fd, buffer, sizeof(buffer), 0);
+
+        if (received <= 0)
+        {
+          CloseClient(client, false);
+        }
+        else
+        {
+          client.rxBuffer.insert(client.rxBuffer.end(), buffer, buffer + received);
+          ProcessRx(client, now, startTime, config);
+        }
+      }
+
+      SendDue(client, now);
+    }
+
+    clients.erase(std::remove_if(clients.begin(), clients.end(),
+                                 [](const clientStruct_t &client) { return client.fd < 0; }),
+                  clients.end());
+
+    if ((now - lastStats) >= config.statsInterval_s)
+    {
+      PrintStats(now - lastStats);
+      lastStats = now;
+    }
+  }
+
+  PrintStats(NowSeconds() - lastStats);
+
+  for (clientStruct_t &client : clients)
+  {
+    close(client.fd);
+  }
+  close(listenFd);
+
+  return 0;
+}
@@ -0,0 +1,639 @@
+/***************************************************************************************************
+ * compliance_analyser
+ *
+ * Host-side (Linux) analyser of controller traces recorded during DC, DM and DR compliance tests.
+ * It replaces checking scope captures by eye.
+ *
+ * Traces are the "TR," lines output by the controller when CTRL_TRACE is defined (Controller.h),
+ * captured from the serial port. Other lines in the capture are ignored:
+ *   TR,<time ms>,<frequency mHz>,<delayed frequency mHz>,<demand 0.1kW>,<measured 0.1kW>,<marker>
+ *
+ * Every step in frequency starts an event, which lasts until the next step. For each event the
+ * expected power is read from the service's response curve at the new frequency, and the measured
+ * power is checked for:
+ * - initial delay: time from the step until the power has moved 5% of the way to expected,
+ * - time to 100%: time from the step until the power is within tolerance of expected,
+ * - overshoot past expected, as a percentage of the change,
+ * - steady-state error: mean error once full delivery is due, as a percentage of rated power,
+ * - ramp-rate violations: times the power changed faster than the service's limit.
+ * Events are labelled with the DC_Test_1_x scenario whose step they match and a pass/fail summary
+ * is given per scenario. Each event is analysed as the trace streams past, so memory does not
+ * grow with the length of the recording.
+ *
+ * The response curves are the firmware defaults, from RespCurve.h.
+ *
+ * Build (from the repository root):
+ *   g++ -O2 -std=c++14 -I. -o compliance_analyser tools/compliance_analyser/compliance_analyser.cpp
+ *
+ * Usage:
+ *   compliance_analyser [-s dc|dm|dr] [-r rated_kw] [-e tolerance_pct] [-R ramp_pu_per_s] [-q]
+ *                       trace_file [...]
+ *   -q prints failed events and the summary only. A file of "-" reads stdin.
+ *   The exit status is 0 if every event passed.
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun McSherry
+ *
+ **************************************************************************************************/
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <string>
+
+#include <unistd.h>
+
+#include "APP/RespCurve.h"
+
+#define NOMINAL_FREQ_HZ          50.0
+#define STEP_DETECT_HZ           0.005    /* frequency change between samples that is a step */
+#define TEST_MATCH_HZ            0.002    /* step must be this close to a test's frequency */
+#define DELAY_THRESHOLD          0.05     /* fraction of the change that ends the initial delay */
+#define MIN_CHANGE_PU            0.02     /* smaller changes only have steady-state checked */
+#define OVERSHOOT_LIMIT_PCT      10.0
+#define RAMP_WINDOW_S            0.1      /* ramp rate is measured over at least this time */
+#define DEFAULT_RATED_KW         1500.0
+#define DEFAULT_TOLERANCE_PCT    3.0
+#define MAX_LINE_LEN             256U
+
+typedef struct SERVICE_STRUCT
+{
+  const char *name;
+  const respCurveKnotStruct_t *knots;
+  unsigned noofKnots;
+  double minInitialDelay_s;
+  double maxInitialDelay_s;
+  double maxFullDelivery_s;
+  double maxRamp_puPerSec;
+}serviceStruct_t;
+
+typedef struct TEST_STRUCT
+{
+  const char *name;
+  double stepFreq_hz;
+}testStruct_t;
+
+typedef struct SAMPLE_STRUCT
+{
+  double time_s;
+  double freq_hz;
+  double delayedFreq_hz;
+  double demand_kw;
+  double measured_kw;
+  int marker;
+}sampleStruct_t;
+
+typedef struct EVENT_STRUCT
+{
+  bool isOpen;
+  double start_s;
+  double fromFreq_hz;
+  double toFreq_hz;
+  double initial_kw;
+  double expected_kw;
+  double change_kw;
+  double delay_s;               /* < 0 until measured */
+  double full_s;                /* < 0 until measured */
+  double freqDelay_s;           /* < 0 until measured */
+  double overshoot_kw;
+  double steadyErrorSum_kw;
+  unsigned steadySamples;
+  unsigned rampViolations;
+  std::string test;
+}eventStruct_t;
+
+typedef struct RESULT_STRUCT
+{
+  unsigned events;
+  unsigned passed;
+}resultStruct_t;
+
+typedef struct CONFIG_STRUCT
+{
+  const serviceStruct_t *service;
+  double rated_kw;
+  double tolerance_pct;
+  double maxRamp_puPerSec;
+  bool isQuiet;
+}configStruct_t;
+
+/* National Grid delivery limits. Ramp limits are the controller's ramp times (OperatingMode.cpp)
+   with margin for meter noise */
+static const serviceStruct_t SERVICES[] =
+{
+  /* name, curve (RespCurve.h),                           delay min/max, full, ramp (pu/s) */
+  { "dc",  RESP_CURVE_DC_KNOTS, RESP_CURVE_DC_NOOF_KNOTS, 0.25, 0.5,     1.0,  4.0 },
+  { "dm",  RESP_CURVE_DM_KNOTS, RESP_CURVE_DM_NOOF_KNOTS, 0.0,  0.5,     1.0,  4.0 },
+  { "dr",  RESP_CURVE_DR_KNOTS, RESP_CURVE_DR_NOOF_KNOTS, 0.0,  2.0,     10.0, 0.2 }
+};
+
+/* The scenarios of the DC_Test_1_x profiles (TestProfile.cpp) */
+static const testStruct_t TESTS[] =
+{
+  { "DC_Test_1_1",  50.01 },
+  { "DC_Test_1_2",  49.99 },
+  { "DC_Test_1_5",  50.10 },
+  { "DC_Test_1_7",  50.20 },
+  { "DC_Test_1_9",  50.30 },
+  { "DC_Test_1_11", 50.40 },
+  { "DC_Test_1_13", 50.50 }
+};
+
+static std::map<std::string, resultStruct_t> results;
+
+/***************************************************************************************************
+ * CurveValue
+ *
+ * This function interpolates a response curve, holding the end values outside it.
+ *
+ * Parameters:
+ * service - the service
+ * freqDev_hz - frequency deviation from nominal
+ *
+ * Return:
+ * Power fraction, + is export
+ *
+ **************************************************************************************************/
+static double CurveValue(const serviceStruct_t *service, double freqDev_hz)
+{
+  const respCurveKnotStruct_t *knots = service->knots;
+  unsigned index;
+
+  if (freqDev_hz <= knots[0].x)
+  {
+    return knots[0].y;
+  }
+
+  for (index = 1U; index < service->noofKnots; index++)
+  {
+    if (freqDev_hz <= knots[index].x)
+    {
+      return knots[index - 1U].y + ((knots[index].y - knots[index - 1U].y) *
+             (freqDev_hz - knots[index - 1U].x) / (knots[index].x - knots[index - 1U].x));
+    }
+  }
+
+  return knots[service->noofKnots - 1U].y;
+}
+
+/***************************************************************************************************
+ * MatchTest
+ *
+ * This function names the test scenario a step belongs to: a step to a test's frequency, or the
+ * return from it to nominal.
+ *
+ * Parameters:
+ * fromFreq_hz - frequency before the step
+ * toFreq_hz - frequency after the step
+ *
+ * Return:
+ * The test name, "other" if there is no match
+ *
+ **************************************************************************************************/
+static std::string MatchTest(double fromFreq_hz, double toFreq_hz)
+{
+  for (const testStruct_t &test : TESTS)
+  {
+    if (fabs(toFreq_hz - test.stepFreq_hz) < TEST_MATCH_HZ)
+    {
+      return test.name;
+    }
+    else if ((fabs(fromFreq_hz - test.stepFreq_hz) < TEST_MATCH_HZ) &&
+             (fabs(toFreq_hz - NOMINAL_FREQ_HZ) < TEST_MATCH_HZ))
+    {
+      return std::string(test.name) + " return";
+    }
+  }
+
+  return "other";
+}
+
+/***************************************************************************************************
+ * OpenEvent
+ *
+ * This function starts a new event at a frequency step.
+ *
+ * Parameters:
+ * event - the event
+ * previous - the last sample before the step
+ * sample - the first sample after the step
+ * config - analysis configuration
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+static void OpenEvent(eventStruct_t &event, const sampleStruct_t &previous,
+                      const sampleStruct_t &sample, const configStruct_t &config)
+{
+  event.isOpen = true;
+  event.start_s = sample.time_s;
+  event.fromFreq_hz = previous.freq_hz;
+  event.toFreq_hz = sample.freq_hz;
+  event.initial_kw = previous.measured_kw;
+  event.expected_kw = CurveValue(config.service, sample.freq_hz - NOMINAL_FREQ_HZ) *
+                      config.rated_kw;
+  event.change_kw = event.expected_kw - event.initial_kw;
+  event.delay_s = -1.0;
+  event.full_s = -1.0;
+  event.freqDelay_s = -1.0;
+  event.overshoot_kw = 0.0;
+  event.steadyErrorSum_kw = 0.0;
+  event.steadySamples = 0U;
+  event.rampViolations = 0U;
+  event.test = MatchTest(event.fromFreq_hz, event.toFreq_hz);
+}
+
+/***************************************************************************************************
+ * UpdateEvent
+ *
+ * This function adds one sample to the open event.
+ *
+ * Parameters:
+ * event - the event
+ * sample - the sample
+ * config - analysis configuration
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+static void UpdateEvent(eventStruct_t &event, const sampleStruct_t &sample,
+                        const configStruct_t &config)
+{
+  double elapsed_s = sample.time_s - event.start_s;
+  double direction = (event.change_kw >= 0.0) ? 1.0 : -1.0;
+  double moved_kw = (sample.measured_kw - event.initial_kw) * direction;
+  double remaining_kw = (event.expected_kw - sample.measured_kw) * direction;
+  double tolerance_kw = (config.tolerance_pct / 100.0) * config.rated_kw;
+
+  if ((event.freqDelay_s < 0.0) &&
+      (fabs(sample.delayedFreq_hz - event.fromFreq_hz) >=
+       (0.5 * fabs(event.toFreq_hz - event.fromFreq_hz))))
+  {
+    event.freqDelay_s = elapsed_s;
+  }
+
+  if ((event.delay_s < 0.0) && (moved_kw >= (DELAY_THRESHOLD * fabs(event.change_kw))))
+  {
+    event.delay_s = elapsed_s;
+  }
+
+  if ((event.full_s < 0.0) && (remaining_kw <= tolerance_kw))
+  {
+    event.full_s = elapsed_s;
+  }
+
+  if (-remaining_kw > event.overshoot_kw)
+  {
+    event.overshoot_kw = -remaining_kw;
+  }
+
+  if (elapsed_s >= config.service->maxFullDelivery_s)
+  {
+    event.steadyErrorSum_kw += fabs(remaining_kw);
+    event.steadySamples++;
+  }
+}
+
+/***************************************************************************************************
+ * CloseEvent
+ *
+ * This function judges an event, prints it and adds it to its scenario's result.
+ *
+ * Parameters:
+ * event - the event
+ * config - analysis configuration
+ *
+ * Return:
+ * true if the event passed
+ *
+ **************************************************************************************************/
+static bool CloseEvent(eventStruct_t &event, const configStruct_t &config)
+{
+  const serviceStruct_t *service = config.service;
+  bool isChange = (fabs(event.change_kw) >= (MIN_CHANGE_PU * config.rated_kw));
+  double overshoot_pct = 0.0;
+  double steadyError_pct = 0.0;
+  std::string failures;
+  bool isPass;
+
+  event.isOpen = false;
+
+  if (true == isChange)
+  {
+    overshoot_pct = 100.0 * event.overshoot_kw / fabs(event.change_kw);
+
+    if ((event.delay_s < 0.0) || (event.delay_s > service->maxInitialDelay_s))
+    {
+      failures += " delay>max";
+    }
+    else if (event.delay_s < service->minInitialDelay_s)
+    {
+      failures += " delay<min";
+    }
+
+    if ((event.full_s < 0.0) || (event.full_s > service->maxFullDelivery_s))
+    {
+      failures += " full";
+    }
+
+    if (overshoot_pct > OVERSHOOT_LIMIT_PCT)
+    {
+      failures += " overshoot";
+    }
+  }
+
+  if (event.steadySamples > 0U)
+  {
+    steadyError_pct = 100.0 * (event.steadyErrorSum_kw / event.steadySamples) / config.rated_kw;
+
+    if (steadyError_pct > config.tolerance_pct)
+    {
+      failures += " steady";
+    }
+  }
+
+  if (event.rampViolations > 0U)
+  {
+    failures += " ramp";
+  }
+
+  isPass = failures.empty();
+
+  results[event.test].events++;
+  if (true == isPass)
+  {
+    results[event.test].passed++;
+  }
+
+  if ((false == isPass) || (false == config.isQuiet))
+  {
+    printf("t=%9.3fs %6.3f->%6.3fHz exp=%8.1fkW chg=%8.1fkW", event.start_s,
+           event.fromFreq_hz, event.toFreq_hz, event.expected_kw, event.change_kw);
+
+    if (true == isChange)
+    {
+      printf(" delay=%6.3fs full=%6.3fs over=%5.1f%%", event.delay_s, event.full_s,
+             overshoot_pct);
+    }
+    else
+    {
+      printf(" %-37s", " no change expected");
+    }
+
+    if (event.steadySamples > 0U)
+    {
+      printf(" ss=%5.1f%%", steadyError_pct);
+    }
+    else
+    {
+      printf(" ss=  n/a ");
+    }
+
+    printf(" ramp=%u fdelay=%6.3fs %s%s [%s]\n", event.rampViolations, event.freqDelay_s,
+           (true == isPass) ? "PASS" : "FAIL", failures.c_str(), event.test.c_str());
+  }
+
+  return isPass;
+}
+
+/***************************************************************************************************
+ * ParseLine
+ *
+ * This function decodes one trace line.
+ *
+ * Parameters:
+ * line - the line
+ * sample - updated with the sample
+ *
+ * Return:
+ * true if the line is a trace line
+ *
+ **************************************************************************************************/
+static bool ParseLine(const char *line, sampleStruct_t &sample)
+{
+  const char *position;
+  char *end;
+  double fields[6];
+  unsigned index;
+
+  position = strstr(line, "TR,");
+
+  if (NULL == position)
+  {
+    return false;
+  }
+
+  position += 3;
+
+  for (index = 0U; index < 6U; index++)
+  {
+    fields[index] = strtod(position, &end);
+
+    if ((end == position) || ((index < 5U) && (',' != *end)))
+    {
+      return false;
+    }
+    position = end + 1;
+  }
+
+  sample.time_s = fields[0] / 1000.0;
+  sample.freq_hz = fields[1] / 1000.0;
+  sample.delayedFreq_hz = fields[2] / 1000.0;
+  sample.demand_kw = fields[3] / 10.0;
+  sample.measured_kw = fields[4] / 10.0;
+  sample.marker = (int)fields[5];
+
+  return true;
+}
+
+/***************************************************************************************************
+ * AnalyseFile
+ *
+ * This function analyses one trace file in a single pass.
+ *
+ * Parameters:
+ * fileName - the trace file, "-" for stdin
+ * config - analysis configuration
+ *
+ * Return:
+ * Number of failed events, or -1 if the file cannot be read
+ *
+ **************************************************************************************************/
+static int AnalyseFile(const char *fileName, const configStruct_t &config)
+{
+  FILE *file;
+  char line[MAX_LINE_LEN];
+  sampleStruct_t sample = {};
+  sampleStruct_t previous = {};
+  std::deque<sampleStruct_t> rampWindow;
+  eventStruct_t event;
+  bool isFirst = true;
+  uint64_t noofSamples = 0U;
+  double timeOffset_s = 0.0;
+  int failures = 0;
+
+  file = (0 == strcmp(fileName, "-")) ? stdin : fopen(fileName, "r");
+
+  if (NULL == file)
+  {
+    fprintf(stderr, "Cannot open trace %s\n", fileName);
+    return -1;
+  }
+
+  event.isOpen = false;
+
+  while (NULL != fgets(line, sizeof(line), file))
+  {
+    if (false == ParseLine(line, sample))
+    {
+      continue;
+    }
+
+    /* the controller's millisecond time wraps after 49.7 days */
+    sample.time_s += timeOffset_s;
+    if ((false == isFirst) && (sample.time_s < (previous.time_s - 1000.0)))
+    {
+      timeOffset_s += 4294967.296;
+      sample.time_s += 4294967.296;
+    }
+
+    noofSamples++;
+
+    if (false == isFirst)
+    {
+      if ((fabs(sample.freq_hz - previous.freq_hz) >= STEP_DETECT_HZ) ||
+          (sample.marker != previous.marker))
+      {
+        if ((true == event.isOpen) && (false == CloseEvent(event, config)))
+        {
+          failures++;
+        }
+        OpenEvent(event, previous, sample, config);
+      }
+
+      if (true == event.isOpen)
+      {
+        UpdateEvent(event, sample, config);
+
+        /* ramp rate over at least RAMP_WINDOW_S */
+        rampWindow.push_back(sample);
+        while ((rampWindow.size() > 2U) &&
+               ((sample.time_s - rampWindow[1].time_s) >= RAMP_WINDOW_S))
+        {
+          rampWindow.pop_front();
+        }
+
+        if ((sample.time_s - rampWindow.front().time_s) >= RAMP_WINDOW_S)
+        {
+          if ((fabs(sample.measured_kw - rampWindow.front().measured_kw) /
+               (sample.time_s - rampWindow.front().time_s)) >
+              (config.maxRamp_puPerSec * config.rated_kw))
+          {
+            event.rampViolations++;
+            rampWindow.clear();
+          }
+        }
+      }
+    }
+
+    previous = sample;
+    isFirst = false;
+  }
+
+  if ((true == event.isOpen) && (false == CloseEvent(event, config)))
+  {
+    failures++;
+  }
+
+  if (stdin != file)
+  {
+    fclose(file);
+  }
+
+  fprintf(stderr, "%s: %llu samples\n", fileName, (unsigned long long)noofSamples);
+
+  return failures;
+}
+
+static void Usage(const char *name)
+{
+  fprintf(stderr,
+          "usage: %s [-s dc|dm|dr] [-r rated_kw] [-e tolerance_pct] [-R ramp_pu_per_s] [-q]\n"
+          "          trace_file [...]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+  configStruct_t config = {&SERVICES[0], DEFAULT_RATED_KW, DEFAULT_TOLERANCE_PCT, 0.0, false};
+  int option;
+  int failures = 0;
+  int fileFailures;
+  bool isRampSet = false;
+
+  while ((option = getopt(argc, argv, "s:r:e:R:qh")) != -1)
+  {
+    switch (option)
+    {
+      case 's':
+        config.service = NULL;
+        for (const serviceStruct_t &service : SERVICES)
+        {
+          if (0 == strcmp(optarg, service.name))
+          {
+            config.service = &service;
+          }
+        }
+        if (NULL == config.service)
+        {
+          Usage(argv[0]);
+          return 1;
+        }
+        break;
+      case 'r': config.rated_kw = atof(optarg); break;
+      case 'e': config.tolerance_pct = atof(optarg); break;
+      case 'R': config.maxRamp_puPerSec = atof(optarg); isRampSet = true; break;
+      case 'q': config.isQuiet = true; break;
+      default:  Usage(argv[0]); return 1;
+    }
+  }
+
+  if ((optind >= argc) || (config.rated_kw <= 0.0))
+  {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  if (false == isRampSet)
+  {
+    config.maxRamp_puPerSec = config.service->maxRamp_puPerSec;
+  }
+
+  for (; optind < argc; optind++)
+  {
+    fileFailures = AnalyseFile(argv[optind], config);
+
+    if (fileFailures < 0)
+    {
+      return 1;
+    }
+    failures += fileFailures;
+  }
+
+  printf("\nService %s, rated %.1fkW\n", config.service->name, config.rated_kw);
+  for (const auto &result : results)
+  {
+    printf("%-20s %6u events %6u passed  %s\n", result.first.c_str(), result.second.events,
+           result.second.passed,
+           (result.second.events == result.second.passed) ? "PASS" : "FAIL");
+  }
+
+  return (0 == failures) ? 0 : 2;
+}
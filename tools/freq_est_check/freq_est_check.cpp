@@ -0,0 +1,304 @@
+/***************************************************************************************************
+ * freq_est_check
+ *
+ * Host-side (Linux) check of the waveform frequency estimator (FreqEst.cpp). Synthetic voltage
+ * waveforms are sampled as the ADC would sample them and passed to the estimator in 1ms blocks,
+ * as the control loop does. Each scenario reports:
+ * - the largest and RMS frequency error once settled, against the true frequency at the centre of
+ *   the estimator's window (allowing for the delay of its low pass filter),
+ * - the time to settle within FREQ_TOL_HZ after a frequency step,
+ * - the largest RoCoF error during ramps.
+ *
+ * Build (from the repository root):
+ *   g++ -O2 -std=c++14 -I. -o freq_est_check tools/freq_est_check/freq_est_check.cpp FreqEst.cpp
+ *
+ * Usage:
+ *   freq_est_check [-r sample_rate_hz] [-t scenario_name]
+ *   -t writes a trace (time, true, estimate, RoCoF) of one scenario to stdout.
+ *   The exit status is 0 if every scenario passed.
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun McSherry
+ *
+ **************************************************************************************************/
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+#include <unistd.h>
+
+#include "APP/FreqEst.h"
+
+#define BLOCK_MS           1U        /* control loop period */
+#define SETTLE_S           0.5       /* not checked after the start or a step */
+#define FREQ_TOL_HZ        0.001     /* largest error once settled, clean waveform */
+#define NOISY_TOL_HZ       0.005     /* largest error once settled, with noise */
+#define STEP_TOL_HZ        0.005     /* settled after a step */
+#define STEP_MAX_S         0.1       /* largest time to settle after a step */
+#define ROCOF_TOL_HZ_S     0.02      /* largest RoCoF error during a ramp */
+#define ADC_MID            32768.0
+#define ADC_AMPLITUDE      20000.0   /* counts, peak */
+
+typedef struct SCENARIO_STRUCT
+{
+  const char *name;
+  double startFreq_hz;
+  double stepTime_s;        /* < 0 for no step */
+  double stepFreq_hz;
+  double ramp_hzPerSec;     /* from the start */
+  double amplitude;         /* fraction of ADC_AMPLITUDE */
+  double offset;            /* DC offset, fraction of ADC_AMPLITUDE */
+  double harmonic5;         /* 5th harmonic, fraction of the fundamental */
+  double harmonic7;         /* 7th harmonic */
+  double noise;             /* gaussian noise, RMS fraction of ADC_AMPLITUDE */
+  double duration_s;
+  bool isValidExpected;
+}scenarioStruct_t;
+
+typedef struct RESULT_STRUCT
+{
+  double maxError_hz;
+  double sumSqError;
+  uint32_t noofErrors;
+  double settle_s;
+  double maxRocofError;
+  bool isEverValid;
+}resultStruct_t;
+
+static const scenarioStruct_t SCENARIOS[] =
+{
+  /* name,         f0,      step t, step f, ramp,  amp,  offset, h5,   h7,   noise, time, valid */
+  { "nominal",     50.0,    -1.0,   0.0,    0.0,   1.0,  0.0,    0.0,  0.0,  0.0,   3.0,  true  },
+  { "resolution",  49.8734, -1.0,   0.0,    0.0,   1.0,  0.0,    0.0,  0.0,  0.0,   3.0,  true  },
+  { "step_down",   50.0,    1.0,    49.5,   0.0,   1.0,  0.0,    0.0,  0.0,  0.0,   3.0,  true  },
+  { "step_up",     50.0,    1.0,    50.5,   0.0,   1.0,  0.0,    0.0,  0.0,  0.0,   3.0,  true  },
+  { "ramp",        50.0,    -1.0,   0.0,    -1.0,  1.0,  0.0,    0.0,  0.0,  0.0,   4.0,  true  },
+  { "harmonics",   50.02,   -1.0,   0.0,    0.0,   1.0,  0.0,    0.05, 0.03, 0.0,   3.0,  true  },
+  { "noise",       49.95,   -1.0,   0.0,    0.0,   1.0,  0.1,    0.0,  0.0,  0.002, 3.0,  true  },
+  { "distorted",   50.1,    1.5,    49.9,   0.0,   0.5,  -0.2,   0.05, 0.03, 0.002, 3.0,  true  },
+  { "no_waveform", 50.0,    -1.0,   0.0,    0.0,   0.02, 0.0,    0.0,  0.0,  0.0,   2.0,  false }
+};
+
+/***************************************************************************************************
+ * TrueFrequency
+ *
+ * This function returns the frequency of a scenario's waveform at a time.
+ *
+ * Parameters:
+ * scenario - the scenario
+ * time_s - time
+ *
+ * Return:
+ * Frequency (Hz)
+ *
+ **************************************************************************************************/
+static double TrueFrequency(const scenarioStruct_t *scenario, double time_s)
+{
+  if ((scenario->stepTime_s >= 0.0) && (time_s >= scenario->stepTime_s))
+  {
+    return scenario->stepFreq_hz;
+  }
+
+  return scenario->startFreq_hz + (scenario->ramp_hzPerSec * time_s);
+}
+
+/***************************************************************************************************
+ * RunScenario
+ *
+ * This function runs one scenario through the estimator.
+ *
+ * Parameters:
+ * scenario - the scenario
+ * sampleRate - ADC sample rate (Hz)
+ * isTrace - write a trace to stdout
+ *
+ * Return:
+ * The results
+ *
+ **************************************************************************************************/
+static resultStruct_t RunScenario(const scenarioStruct_t *scenario, uint32_t sampleRate,
+                                  bool isTrace)
+{
+  static FREQ_EST estimator;
+  std::mt19937 random(1U);
+  std::normal_distribution<double> gaussian(0.0, 1.0);
+  uint16_t block[1000];
+  uint32_t blockSize = (sampleRate * BLOCK_MS) / 1000U;
+  uint32_t noofBlocks = (uint32_t)(scenario->duration_s * 1000.0 / BLOCK_MS);
+  uint32_t blockIndex;
+  uint32_t index;
+  resultStruct_t result = {0.0, 0.0, 0U, -1.0, 0.0, false};
+  double phase = 0.0;
+  double time_s;
+  double value;
+  double estimate;
+  double rocof;
+  double centre_s;
+  double frequency;
+  double error;
+  double lastChange_s = 0.0;
+  uint16_t age_ms;
+
+  estimator.Init(sampleRate);
+
+  for (blockIndex = 0U; blockIndex < noofBlocks; blockIndex++)
+  {
+    for (index = 0U; index < blockSize; index++)
+    {
+      time_s = (double)((blockIndex * blockSize) + index) / sampleRate;
+      phase += 2.0 * M_PI * TrueFrequency(scenario, time_s) / sampleRate;
+
+      value = scenario->amplitude * (sin(phase) + (scenario->harmonic5 * sin(5.0 * phase)) +
+                                     (scenario->harmonic7 * sin(7.0 * phase)));
+      value += scenario->offset + (scenario->noise * gaussian(random));
+      value = ADC_MID + (ADC_AMPLITUDE * value);
+
+      block[index] = (uint16_t)((value < 0.0) ? 0.0 : ((value > 65535.0) ? 65535.0 : value));
+    }
+
+    estimator.Process(block, (uint16_t)blockSize);
+    time_s = (double)((blockIndex + 1U) * BLOCK_MS) / 1000.0;
+
+    if ((scenario->stepTime_s >= 0.0) && (time_s >= scenario->stepTime_s) &&
+        (lastChange_s < scenario->stepTime_s))
+    {
+      lastChange_s = scenario->stepTime_s;
+    }
+
+    if (false == estimator.GetFrequency(&estimate, &age_ms))
+    {
+      continue;
+    }
+    result.isEverValid = true;
+
+    /* the estimate is the mean frequency over the window, which ends age_ms ago */
+    frequency = TrueFrequency(scenario, time_s);
+    centre_s = time_s - (age_ms / 1000.0) - (((double)FREQ_EST_WINDOW / 4.0) / frequency) -
+               (atan(frequency / FREQ_EST_LPF_HZ) / (2.0 * M_PI * frequency));
+    error = estimate - TrueFrequency(scenario, centre_s);
+
+    if (true == isTrace)
+    {
+      rocof = 0.0;
+      (void)estimator.GetRocof(&rocof);
+      printf("%.3f,%.5f,%.5f,%.4f\n", time_s, TrueFrequency(scenario, time_s), estimate, rocof);
+    }
+
+    if ((scenario->stepTime_s >= 0.0) && (time_s >= scenario->stepTime_s) &&
+        (result.settle_s < 0.0) && (fabs(estimate - scenario->stepFreq_hz) < STEP_TOL_HZ))
+    {
+      result.settle_s = time_s - scenario->stepTime_s;
+    }
+
+    if ((time_s - lastChange_s) >= SETTLE_S)
+    {
+      if (fabs(error) > result.maxError_hz)
+      {
+        result.maxError_hz = fabs(error);
+      }
+      result.sumSqError += error * error;
+      result.noofErrors++;
+
+      if ((0.0 != scenario->ramp_hzPerSec) && (true == estimator.GetRocof(&rocof)) &&
+          (fabs(rocof - scenario->ramp_hzPerSec) > result.maxRocofError))
+      {
+        result.maxRocofError = fabs(rocof - scenario->ramp_hzPerSec);
+      }
+    }
+  }
+
+  return result;
+}
+
+static void Usage(const char *name)
+{
+  fprintf(stderr, "usage: %s [-r sample_rate_hz] [-t scenario_name]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t sampleRate = FREQ_EST_SAMPLE_RATE_HZ;
+  const char *traceName = NULL;
+  resultStruct_t result;
+  bool isPass;
+  bool isAllPass = true;
+  int option;
+
+  while ((option = getopt(argc, argv, "r:t:h")) != -1)
+  {
+    switch (option)
+    {
+      case 'r': sampleRate = (uint32_t)atoi(optarg); break;
+      case 't': traceName = optarg; break;
+      default:  Usage(argv[0]); return 1;
+    }
+  }
+
+  if ((sampleRate < 1000U) || (sampleRate > 1000000U))
+  {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  for (const scenarioStruct_t &scenario : SCENARIOS)
+  {
+    if (NULL != traceName)
+    {
+      if (0 == strcmp(traceName, scenario.name))
+      {
+        (void)RunScenario(&scenario, sampleRate, true);
+        return 0;
+      }
+      continue;
+    }
+
+    result = RunScenario(&scenario, sampleRate, false);
+
+    if (false == scenario.isValidExpected)
+    {
+      isPass = (false == result.isEverValid);
+      printf("%-12s %s %s\n", scenario.name, (true == result.isEverValid) ? "valid" : "invalid",
+             (true == isPass) ? "PASS" : "FAIL");
+    }
+    else
+    {
+      isPass = (true == result.isEverValid) && (result.noofErrors > 0U) &&
+               (result.maxError_hz <= ((0.0 == scenario.noise) ? FREQ_TOL_HZ : NOISY_TOL_HZ)) &&
+               ((scenario.stepTime_s < 0.0) ||
+                ((result.settle_s >= 0.0) && (result.settle_s <= STEP_MAX_S))) &&
+               (result.maxRocofError <= ROCOF_TOL_HZ_S);
+
+      printf("%-12s max %.5fHz rms %.5fHz", scenario.name, result.maxError_hz,
+             sqrt(result.sumSqError / ((result.noofErrors > 0U) ? result.noofErrors : 1U)));
+
+      if (scenario.stepTime_s >= 0.0)
+      {
+        printf(" settle %.3fs", result.settle_s);
+      }
+      if (0.0 != scenario.ramp_hzPerSec)
+      {
+        printf(" rocof err %.4fHz/s", result.maxRocofError);
+      }
+      printf(" %s\n", (true == isPass) ? "PASS" : "FAIL");
+    }
+
+    if (false == isPass)
+    {
+      isAllPass = false;
+    }
+  }
+
+  if (NULL != traceName)
+  {
+    fprintf(stderr, "No scenario %s\n", traceName);
+    return 1;
+  }
+
+  return (true == isAllPass) ? 0 : 2;
+}
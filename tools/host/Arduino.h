@@ -0,0 +1,139 @@
+/***************************************************************************************************
+ *
+ * Host stand-in for the Arduino core
+ *
+ * Lets the host tools build the APP modules that use the Arduino core (e.g. Rocof.cpp,
+ * LutLearn.cpp) without change. Only what those modules use is provided:
+ * - millis() and micros() run from a simulated clock, moved on by HOST_SetTime_us, so a tool
+ *   steps the module in simulated time,
+ * - String, with the members the serial commands use,
+ * - Serial, printing to stdout unless muted by HOST_SetSerialMuted.
+ *
+ * Put this directory first on the include path, e.g. -Itools/host -I.
+ *
+ * Date: 16/10/2026
+ *
+ * Author: Shaun Mcsherry
+ *
+ * ************************************************************************************************/
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+
+/* Simulated clock */
+inline uint64_t *HOST_Time_us(void)
+{
+  static uint64_t time_us = 0U;
+
+  return &time_us;
+}
+
+inline void HOST_SetTime_us(uint64_t time_us)
+{
+  *HOST_Time_us() = time_us;
+}
+
+inline uint32_t millis(void)
+{
+  return (uint32_t)(*HOST_Time_us() / 1000U);
+}
+
+inline uint32_t micros(void)
+{
+  return (uint32_t)*HOST_Time_us();
+}
+
+class String
+{
+  private:
+    std::string text;
+
+  public:
+    String()  //constructor
+    {
+    }
+    String(const char *cstr) : text(cstr)
+    {
+    }
+    String(const std::string &str) : text(str)
+    {
+    }
+    int length(void) const { return (int)text.length(); }
+    char charAt(int index) const { return ((index >= 0) && (index < length())) ? text[index] : 0; }
+    const char *c_str(void) const { return text.c_str(); }
+    long toInt(void) const { return strtol(text.c_str(), NULL, 10); }
+    double toDouble(void) const { return strtod(text.c_str(), NULL); }
+    bool startsWith(const String &prefix) const { return (0U == text.rfind(prefix.text, 0U)); }
+
+    int indexOf(char ch, int from = 0) const
+    {
+      size_t found = text.find(ch, (size_t)from);
+
+      return (std::string::npos == found) ? -1 : (int)found;
+    }
+
+    String substring(int from, int to) const
+    {
+      return (to > from) ? String(text.substr((size_t)from, (size_t)(to - from))) : String();
+    }
+
+    void trim(void)
+    {
+      size_t first = text.find_first_not_of(" \t\r\n");
+      size_t last = text.find_last_not_of(" \t\r\n");
+
+      text = (std::string::npos == first) ? std::string() : text.substr(first, last - first + 1U);
+    }
+
+    friend bool operator==(const String &a, const String &b) { return a.text == b.text; }
+    friend bool operator!=(const String &a, const String &b) { return a.text != b.text; }
+};
+
+/* Serial port */
+class HOST_SERIAL
+{
+  private:
+    bool isMuted;
+
+  public:
+    HOST_SERIAL()  //constructor
+    {
+      isMuted = false;
+    }
+    void SetMuted(bool muted) { isMuted = muted; }
+    void print(const char *text) { if (false == isMuted) { printf("%s", text); } }
+    void print(const String &text) { print(text.c_str()); }
+    void print(double value, int digits = 2) { if (false == isMuted) { printf("%.*f", digits, value); } }
+    void print(int value) { if (false == isMuted) { printf("%d", value); } }
+    void print(unsigned int value) { if (false == isMuted) { printf("%u", value); } }
+    void print(long value) { if (false == isMuted) { printf("%ld", value); } }
+    void print(unsigned long value) { if (false == isMuted) { printf("%lu", value); } }
+
+    void println(void) { print("\n"); }
+
+    template <typename V>
+    void println(const V &value) { print(value); println(); }
+
+    void println(double value, int digits) { print(value, digits); println(); }
+};
+
+inline HOST_SERIAL &HOST_Serial(void)
+{
+  static HOST_SERIAL serial;
+
+  return serial;
+}
+
+inline void HOST_SetSerialMuted(bool isMuted)
+{
+  HOST_Serial().SetMuted(isMuted);
+}
+
+#define Serial  HOST_Serial()
+
+#endif /* HOST_ARDUINO_H */
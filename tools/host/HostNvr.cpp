@@ -0,0 +1,39 @@
+/***************************************************************************************************
+ * HostNvr
+ *
+ * Host stand-in for HAL_NVR.cpp, so the host tools can build the APP modules that persist what
+ * they learn (e.g. LutLearn.cpp). Nothing is stored: a read finds no record, so a module starts
+ * from its defaults, and a write is accepted and dropped.
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun Mcsherry
+ *
+ **************************************************************************************************/
+#include "HAL/HAL_NVR.h"
+
+/* Public functions */
+void NVR_Init(void)
+{
+}
+
+bool NVR_Read(const char *key, void *data, size_t size)
+{
+  (void)key;
+  (void)data;
+  (void)size;
+
+  return false;
+}
+
+bool NVR_Write(const char *key, const void *data, size_t size)
+{
+  (void)key;
+  (void)data;
+
+  return (size <= NVR_MAX_RECORD_SIZE);
+}
+
+/* end public functions */
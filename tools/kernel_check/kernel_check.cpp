@@ -0,0 +1,545 @@
+/***************************************************************************************************
+ * kernel_check
+ *
+ * Host-side (Linux) check of the control kernels in each numeric type: double, float, and the Q
+ * formats Q15.16 and Q7.24 (FixedQ.h). Each kernel is run on the same inputs in every type and
+ * compared with a double reference:
+ * - scale     KERNEL_ScaleEngUnit over every 0.1kW value of a +/-15000 range (per unit error),
+ * - unscale   KERNEL_Unscale over per unit values past the range (0.1kW error),
+ * - analogue  KERNEL_ScaleAnalogue over per unit values past the range (volt error),
+ * - curve     CURVE_Evaluate of the DC, DM and DR curves and an evenly spaced curve, over
+ *             +/-0.6Hz (power fraction error), against a direct interpolation of the knots,
+ * - lp_filter LP_FILTER on steps and noise (per unit error), against the generated lp_filter.c,
+ * - pi, pid   PID_CTRL_T closing the loop, in per unit, round a first order plus dead time plant on
+ *             setpoint steps with meter noise; the error is in the plant power, as delivered.
+ * The largest and RMS errors are reported against the bound set for each kernel and type, with
+ * the time per call. The times are for this host, so only their ratios carry over: the M7 core
+ * has a double precision FPU, the M4 core only single precision, so there double is done in
+ * software and float or fixed point is much cheaper.
+ *
+ * The Q formats are used in per unit: Q7.24 cannot hold engineering units (+/-128), Q15.16 can,
+ * at 1.5e-5 resolution.
+ *
+ * Build (from the repository root):
+ *   g++ -O2 -std=c++14 -I. -o kernel_check tools/kernel_check/kernel_check.cpp PidCtrl.cpp \
+ *       lp_filter.c
+ *
+ * Usage:
+ *   kernel_check [-n calls]
+ *   -n sets the number of calls timed for each kernel and type, 0 to skip the timing.
+ *   The exit status is 0 if every error is within its bound.
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun McSherry
+ *
+ **************************************************************************************************/
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+
+#include "APP/FixedQ.h"
+#include "APP/CtrlKernel.h"
+#include "APP/PidCtrl.h"
+#include "APP/RespCurve.h"
+#include "UTILS/lp_filter.h"
+
+#define RATED               15000     /* 0.1kW units, for the scaling */
+#define DT_S                0.02      /* meter cadence, as ManagePower */
+#define PLANT_TAU_S         0.1
+#define PLANT_DELAY_STEPS   2U        /* 40ms */
+#define SETPOINT_HOLD_S     3.0
+#define NOISE_PU            0.001     /* meter noise, peak */
+#define PID_KP              0.7       /* plant_sim default gains */
+#define PID_KI              10.0
+#define PID_KD              0.005
+#define PID_RATE_LIMIT      5.0       /* rated power per second, as POWER_PID_RATE_LIMIT */
+#define BENCH_INPUTS        1024U
+#define DEFAULT_CALLS       2000000U
+
+typedef enum TYPE_ENUM
+{
+  TYPE_DOUBLE   = 0,
+  TYPE_FLOAT    = 1,
+  TYPE_Q16      = 2,
+  TYPE_Q24      = 3,
+  NOOF_TYPES    = 4
+}typeEnum_t;
+
+typedef enum KERNEL_ENUM
+{
+  KERNEL_SCALE      = 0,
+  KERNEL_UNSCALE    = 1,
+  KERNEL_ANALOGUE   = 2,
+  KERNEL_CURVE      = 3,
+  KERNEL_LP_FILTER  = 4,
+  KERNEL_PI         = 5,
+  KERNEL_PID        = 6,
+  NOOF_KERNELS      = 7
+}kernelEnum_t;
+
+typedef struct ERROR_STRUCT
+{
+  double max;
+  double sumSquares;
+  uint32_t count;
+}errorStruct_t;
+
+static const char *TYPE_NAMES[NOOF_TYPES] = { "double", "float", "Q15.16", "Q7.24" };
+
+static const char *KERNEL_NAMES[NOOF_KERNELS] =
+{
+  "scale", "unscale", "analogue", "curve", "lp_filter", "pi", "pid"
+};
+
+static const char *KERNEL_UNITS[NOOF_KERNELS] =
+{
+  "pu", "0.1kW", "V", "fraction", "pu", "pu", "pu"
+};
+
+/* Largest acceptable error of each kernel in each type. double must match its reference exactly,
+   other than the curve, where the reference interpolates by division rather than by the stored
+   slope. The others are a few times the resolution of the type times the gain of the kernel
+   (10.5V full scale, curve slopes up to 9.5 per Hz). */
+static const double BOUNDS[NOOF_KERNELS][NOOF_TYPES] =
+{
+  /* double   float     Q15.16    Q7.24 */
+  {  0.0,     1.0e-7,   1.0e-5,   1.0e-7 },   /* scale */
+  {  0.0,     1.0,      1.0,      1.0    },   /* unscale */
+  {  0.0,     1.0e-5,   3.0e-4,   1.0e-6 },   /* analogue */
+  {  1.0e-12, 1.0e-6,   3.0e-4,   2.0e-6 },   /* curve */
+  {  0.0,     1.0e-6,   1.0e-4,   1.0e-6 },   /* lp_filter */
+  {  0.0,     1.0e-5,   1.0e-3,   1.0e-5 },   /* pi */
+  {  0.0,     1.0e-5,   1.0e-3,   1.0e-5 }    /* pid */
+};
+
+/* An evenly spaced curve for the indexed lookup, with the default curves (RespCurve.h) */
+static const respCurveKnotStruct_t UNIFORM_KNOTS[] =
+{
+  { -0.5, 1.0 }, { -0.25, 0.3 }, { 0.0, 0.0 }, { 0.25, -0.3 }, { 0.5, -1.0 }
+};
+
+typedef struct CURVE_STRUCT
+{
+  const respCurveKnotStruct_t *knots;
+  uint8_t noofKnots;
+}curveStruct_t;
+
+#define NOOF_KNOTS(table)  ((uint8_t)(sizeof(table) / sizeof(table[0])))
+
+static const curveStruct_t CURVES[] =
+{
+  { RESP_CURVE_DC_KNOTS, RESP_CURVE_DC_NOOF_KNOTS },
+  { RESP_CURVE_DM_KNOTS, RESP_CURVE_DM_NOOF_KNOTS },
+  { RESP_CURVE_DR_KNOTS, RESP_CURVE_DR_NOOF_KNOTS },
+  { UNIFORM_KNOTS, NOOF_KNOTS(UNIFORM_KNOTS) }
+};
+
+#define NOOF_CURVES  (sizeof(CURVES) / sizeof(CURVES[0]))
+
+static const double SETPOINTS[] = { 0.1, 0.5, -0.3, 0.97, 0.02, -1.2, 0.0 };
+
+#define NOOF_SETPOINTS  (sizeof(SETPOINTS) / sizeof(SETPOINTS[0]))
+
+/***************************************************************************************************
+ * AddError
+ *
+ * This function adds one comparison to an error record.
+ *
+ * Parameters:
+ * error - the record
+ * value - the value from the type under test
+ * reference - the double reference
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+static void AddError(errorStruct_t *error, double value, double reference)
+{
+  double difference = fabs(value - reference);
+
+  if (difference > error->max)
+  {
+    error->max = difference;
+  }
+  error->sumSquares += difference * difference;
+  error->count++;
+}
+
+/***************************************************************************************************
+ * Noise
+ *
+ * This function returns repeatable noise, so every type sees the same sequence.
+ *
+ * Parameters:
+ * state - the generator state
+ *
+ * Return:
+ * Noise, -1 to 1
+ *
+ **************************************************************************************************/
+static double Noise(uint32_t *state)
+{
+  *state = (*state * 1664525U) + 1013904223U;
+
+  return ((double)(*state >> 8) / (double)(1U << 23)) - 1.0;
+}
+
+/***************************************************************************************************
+ * ReferenceCurve
+ *
+ * This function interpolates knots directly, by a linear search in double.
+ *
+ * Parameters:
+ * curve - the curve
+ * x - frequency deviation (Hz)
+ *
+ * Return:
+ * Power fraction
+ *
+ **************************************************************************************************/
+static double ReferenceCurve(const curveStruct_t *curve, double x)
+{
+  uint8_t knot;
+
+  if (x <= curve->knots[0].x)
+  {
+    return curve->knots[0].y;
+  }
+
+  for (knot = 1U; knot < curve->noofKnots; knot++)
+  {
+    if (x < curve->knots[knot].x)
+    {
+      return curve->knots[knot - 1U].y +
+             (((x - curve->knots[knot - 1U].x) /
+               (curve->knots[knot].x - curve->knots[knot - 1U].x)) *
+              (curve->knots[knot].y - curve->knots[knot - 1U].y));
+    }
+  }
+
+  return curve->knots[curve->noofKnots - 1U].y;
+}
+
+/***************************************************************************************************
+ * RunLoop
+ *
+ * This function closes the loop round the plant with a PID in one type, and records the power
+ * delivered at each step.
+ *
+ * Parameters:
+ * kd - derivative gain, 0 for a PI
+ * power - updated with the plant power at each step
+ * steps - number of steps
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+template <typename T>
+static void RunLoop(double kd, double *power, uint32_t steps)
+{
+  PID_CTRL_T<T> pid;
+  PID_CTRL_CONFIG_STRUCT<T> config = {T(PID_KP), T(PID_KI), T(kd), T(1.0), T(0.0), T(0.0),
+                                      T(-1.0), T(1.0), T(PID_RATE_LIMIT)};
+  double delay[PLANT_DELAY_STEPS] = {0.0};
+  double plant = 0.0;
+  double measured;
+  double setpoint;
+  uint32_t noiseState = 12345U;
+  uint32_t step;
+  uint32_t holdSteps = (uint32_t)(SETPOINT_HOLD_S / DT_S);
+
+  pid.SetConfig(&config);
+  pid.Reset(T(0.0), T(0.0));
+
+  for (step = 0U; step < steps; step++)
+  {
+    setpoint = SETPOINTS[(step / holdSteps) % NOOF_SETPOINTS];
+    measured = plant + (NOISE_PU * Noise(&noiseState));
+
+    /* the command reaches the plant PLANT_DELAY_STEPS later */
+    plant += (1.0 - exp(-DT_S / PLANT_TAU_S)) * (delay[PLANT_DELAY_STEPS - 1U] - plant);
+    memmove(&delay[1], &delay[0], (PLANT_DELAY_STEPS - 1U) * sizeof(delay[0]));
+    delay[0] = (double)pid.Compute(T(setpoint), T(measured), T(DT_S));
+
+    power[step] = plant;
+  }
+}
+
+/***************************************************************************************************
+ * Check
+ *
+ * This function runs every kernel in one type and compares it with the double reference.
+ *
+ * Parameters:
+ * errors - updated with the error of each kernel
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+template <typename T>
+static void Check(errorStruct_t errors[NOOF_KERNELS])
+{
+  static double reference[(uint32_t)(NOOF_SETPOINTS * SETPOINT_HOLD_S / DT_S)];
+  static double power[(uint32_t)(NOOF_SETPOINTS * SETPOINT_HOLD_S / DT_S)];
+  const uint32_t steps = (uint32_t)(sizeof(power) / sizeof(power[0]));
+  RESP_CURVE_TABLE_STRUCT<T> table;
+  LP_FILTER<T> filter;
+  lp_filter_ExtIn extIn;
+  lp_filter_ExtOut extOut;
+  lp_filter_ModelSinks sinks;
+  lp_filter_ModelStates states;
+  lp_filter_ModelData generated = {&extIn, &extOut, &sinks, &states};
+  uint32_t noiseState = 777U;
+  double value;
+  double in;
+  int32_t engUnit;
+  uint32_t curve;
+  uint32_t step;
+  int32_t ref;
+
+  memset(errors, 0, NOOF_KERNELS * sizeof(errors[0]));
+
+  for (engUnit = -RATED; engUnit <= RATED; engUnit++)
+  {
+    value = (double)engUnit / (((double)RATED - (double)-RATED) / 2.0);
+    AddError(&errors[KERNEL_SCALE],
+             (double)KERNEL_ScaleEngUnit<T>((int16_t)engUnit, -RATED, RATED, true), value);
+  }
+
+  for (value = -1.05; value <= 1.05; value += 1.0e-5)
+  {
+    ref = (int32_t)(value * (((double)RATED - (double)-RATED) / 2.0));
+    ref = (ref > RATED) ? RATED : ((ref < -RATED) ? -RATED : ref);
+    AddError(&errors[KERNEL_UNSCALE], (double)KERNEL_Unscale<T>(T(value), -RATED, RATED),
+             (double)ref);
+
+    in = ((value / 2.0) + 0.5) * 10.5;
+    in = (in > 10.5) ? 10.5 : ((in < 0.0) ? 0.0 : in);
+    AddError(&errors[KERNEL_ANALOGUE], (double)KERNEL_ScaleAnalogue<T>(T(value)), in);
+  }
+
+  for (curve = 0U; curve < NOOF_CURVES; curve++)
+  {
+    CURVE_Build(CURVES[curve].knots, CURVES[curve].noofKnots, &table);
+
+    for (value = -0.6; value <= 0.6; value += 1.0e-5)
+    {
+      AddError(&errors[KERNEL_CURVE], (double)CURVE_Evaluate(&table, T(value)),
+               ReferenceCurve(&CURVES[curve], value));
+    }
+  }
+
+  lp_filter_init(&generated);
+  filter.Reset(T(0.0));
+  for (step = 0U; step < steps; step++)
+  {
+    in = SETPOINTS[(step / 50U) % NOOF_SETPOINTS] + (0.01 * Noise(&noiseState));
+    extIn.In2 = in;
+    lp_filter_step(&generated);
+    AddError(&errors[KERNEL_LP_FILTER], (double)filter.Step(T(in)), extOut.Out1);
+  }
+
+  RunLoop<double>(0.0, reference, steps);
+  RunLoop<T>(0.0, power, steps);
+  for (step = 0U; step < steps; step++)
+  {
+    AddError(&errors[KERNEL_PI], power[step], reference[step]);
+  }
+
+  RunLoop<double>(PID_KD, reference, steps);
+  RunLoop<T>(PID_KD, power, steps);
+  for (step = 0U; step < steps; step++)
+  {
+    AddError(&errors[KERNEL_PID], power[step], reference[step]);
+  }
+}
+
+/***************************************************************************************************
+ * Bench
+ *
+ * This function times every kernel in one type.
+ *
+ * Parameters:
+ * calls - number of calls of each kernel
+ * time_ns - updated with the time per call of each kernel
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+template <typename T>
+static void Bench(uint32_t calls, double time_ns[NOOF_KERNELS])
+{
+  static T inputs[BENCH_INPUTS];
+  static T outputs[BENCH_INPUTS];
+  static int16_t engUnits[BENCH_INPUTS];
+  static int16_t results[BENCH_INPUTS];
+  std::chrono::steady_clock::time_point start;
+  RESP_CURVE_TABLE_STRUCT<T> table;
+  LP_FILTER<T> filter;
+  PID_CTRL_T<T> pid;
+  PID_CTRL_CONFIG_STRUCT<T> config = {T(PID_KP), T(PID_KI), T(0.0), T(1.0), T(0.0), T(0.0),
+                                      T(-1.0), T(1.0), T(PID_RATE_LIMIT)};
+  uint32_t noiseState = 99U;
+  volatile double sink = 0.0;
+  uint32_t passes = (calls + BENCH_INPUTS - 1U) / BENCH_INPUTS;
+  uint32_t pass;
+  uint32_t index;
+  uint8_t kernel;
+
+  for (index = 0U; index < BENCH_INPUTS; index++)
+  {
+    inputs[index] = T(0.6 * Noise(&noiseState));
+    engUnits[index] = (int16_t)(RATED * Noise(&noiseState));
+  }
+  CURVE_Build(RESP_CURVE_DC_KNOTS, RESP_CURVE_DC_NOOF_KNOTS, &table);
+  pid.SetConfig(&config);
+
+  for (kernel = 0U; kernel < (uint8_t)NOOF_KERNELS; kernel++)
+  {
+    start = std::chrono::steady_clock::now();
+
+    for (pass = 0U; pass < passes; pass++)
+    {
+      for (index = 0U; index < BENCH_INPUTS; index++)
+      {
+        switch (kernel)
+        {
+          case KERNEL_SCALE:
+            outputs[index] = KERNEL_ScaleEngUnit<T>(engUnits[index], -RATED, RATED, true);
+            break;
+          case KERNEL_UNSCALE:
+            results[index] = KERNEL_Unscale<T>(inputs[index], -RATED, RATED);
+            break;
+          case KERNEL_ANALOGUE:
+            outputs[index] = KERNEL_ScaleAnalogue<T>(inputs[index]);
+            break;
+          case KERNEL_CURVE:
+            outputs[index] = CURVE_Evaluate(&table, inputs[index]);
+            break;
+          case KERNEL_LP_FILTER:
+            outputs[index] = filter.Step(inputs[index]);
+            break;
+          default:
+            outputs[index] = pid.Compute(inputs[index], outputs[(index - 1U) % BENCH_INPUTS],
+                                         T(DT_S));
+            break;
+        }
+      }
+      sink = sink + (double)outputs[pass % BENCH_INPUTS] + (double)results[pass % BENCH_INPUTS];
+    }
+
+    time_ns[kernel] = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start).count() /
+                      ((double)passes * (double)BENCH_INPUTS);
+
+    if (KERNEL_PI == kernel)
+    {
+      /* the same again with derivative action */
+      config.kd = T(PID_KD);
+      pid.SetConfig(&config);
+    }
+  }
+}
+
+/***************************************************************************************************
+ * Usage
+ *
+ * This function prints the command line options.
+ *
+ * Parameters:
+ * name - program name
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+static void Usage(const char *name)
+{
+  fprintf(stderr, "Usage: %s [-n calls]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+  static errorStruct_t errors[NOOF_TYPES][NOOF_KERNELS];
+  double time_ns[NOOF_TYPES][NOOF_KERNELS];
+  uint32_t calls = DEFAULT_CALLS;
+  bool isAllPassed = true;
+  bool isPassed;
+  double cheapest_ns;
+  int cheapest;
+  uint8_t kernel;
+  uint8_t type;
+  int option;
+
+  while ((option = getopt(argc, argv, "n:h")) != -1)
+  {
+    switch (option)
+    {
+      case 'n': calls = (uint32_t)strtoul(optarg, NULL, 10); break;
+      default:
+        Usage(argv[0]);
+        return 2;
+    }
+  }
+
+  Check<double>(errors[TYPE_DOUBLE]);
+  Check<float>(errors[TYPE_FLOAT]);
+  Check<fixedQ16_t>(errors[TYPE_Q16]);
+  Check<fixedQ24_t>(errors[TYPE_Q24]);
+
+  memset(time_ns, 0, sizeof(time_ns));
+  if (calls > 0U)
+  {
+    Bench<double>(calls, time_ns[TYPE_DOUBLE]);
+    Bench<float>(calls, time_ns[TYPE_FLOAT]);
+    Bench<fixedQ16_t>(calls, time_ns[TYPE_Q16]);
+    Bench<fixedQ24_t>(calls, time_ns[TYPE_Q24]);
+  }
+
+  printf("%-10s %-7s %12s %12s %12s %-9s %8s\n", "kernel", "type", "max error", "rms error",
+         "bound", "unit", "ns/call");
+
+  for (kernel = 0U; kernel < (uint8_t)NOOF_KERNELS; kernel++)
+  {
+    cheapest = -1;
+    cheapest_ns = 0.0;
+
+    for (type = 0U; type < (uint8_t)NOOF_TYPES; type++)
+    {
+      isPassed = (errors[type][kernel].max <= BOUNDS[kernel][type]);
+      isAllPassed = isAllPassed && isPassed;
+
+      if ((true == isPassed) && ((cheapest < 0) || (time_ns[type][kernel] < cheapest_ns)))
+      {
+        cheapest = type;
+        cheapest_ns = time_ns[type][kernel];
+      }
+
+      printf("%-10s %-7s %12.3e %12.3e %12.3e %-9s %8.2f %s\n", KERNEL_NAMES[kernel],
+             TYPE_NAMES[type], errors[type][kernel].max,
+             sqrt(errors[type][kernel].sumSquares / (double)errors[type][kernel].count),
+             BOUNDS[kernel][type], KERNEL_UNITS[kernel], time_ns[type][kernel],
+             (true == isPassed) ? "ok" : "FAIL");
+    }
+
+    if ((calls > 0U) && (cheapest >= 0))
+    {
+      printf("%-10s cheapest within bound on this host: %s\n", KERNEL_NAMES[kernel],
+             TYPE_NAMES[cheapest]);
+    }
+  }
+
+  return (true == isAllPassed) ? 0 : 1;
+}
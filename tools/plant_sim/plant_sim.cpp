@@ -0,0 +1,714 @@
+/***************************************************************************************************
+ * plant_sim
+ *
+ * Host-side (Linux) closed loop simulation of power control, for benchmarking the control
+ * structures (CTRL_PID_ONLY and CTRL_FF_PLUS_TRIM in PowerControl.h) on step responses. The
+ * controller is PID_CTRL (PidCtrl.cpp) stepped on each meter sample with the feedforward, trim
+ * reference model and limits of POWER_CTRL::ManagePower. The plant is:
+ * - the measured CAB1000 characteristic (InvLut.cpp), scaled by a gain error to model an
+ *   inverter that differs from the table,
+ * - a transport delay (CAN and inverter) and a first order lag,
+ * - a meter sampling the power every 20ms, delivered after a latency.
+ *
+ * For each step the rise time (10-90%), settling time (within SETTLE_BAND of the final value),
+ * overshoot and integral of absolute error are reported for both structures. Until the power
+ * first reaches the new level the command should only move in the direction of the step. The
+ * proportional kick eases back a little each sample as the error closes, but a step where the
+ * command moved back by more than REVERSE_LIMIT in one sample is marked "reversed".
+ *
+ * With -a the power PID is first auto-tuned on the plant by PID_AUTOTUNE (PidAutoTune.cpp), about
+ * AUTOTUNE_POINT as the PID_TEST2 mode does, and the steps are run with the tuned gains.
+ *
+ * With -S the PID sees the power through the Smith predictor (SmithPred.cpp), as POWER_CTRL does
+ * with CTRL_SMITH_DEFAULT true. The model is SMITH_TAU_MS and SMITH_DEAD_TIME_MS, or -m, or the
+ * model identified by -a; its dead time follows the dead time measured on the steps.
+ *
+ * With -L the controller's copy of the characteristic is first learnt online by LUT_LEARN
+ * (LutLearn.cpp), as in ManagePower, from the given number of steady (command, power) pairs. The
+ * loop is held at random setpoints across the range with meter noise of LEARN_NOISE. The RMS and
+ * largest error of the characteristic against the plant (gain error included) are reported before
+ * and after, and the steps are run with what has been learnt.
+ *
+ * Build (from the repository root):
+ *   g++ -O2 -std=c++14 -Itools/host -I. -o plant_sim tools/plant_sim/plant_sim.cpp PidCtrl.cpp \
+ *       InvLut.cpp PidAutoTune.cpp SmithPred.cpp LutLearn.cpp SerialCmd.cpp tools/host/HostNvr.cpp
+ *
+ * Usage:
+ *   plant_sim [-t tau_ms] [-d delay_ms] [-l meter_latency_ms] [-g gain] [-r rated]
+ *             [-p kp] [-i ki] [-a zn|tl|simc [-D]] [-S [-m tau_ms,dead_ms]] [-L pairs]
+ *             [-c pid|ff -s step]
+ *   -a auto-tunes the gains by the rule first, -D with derivative action.
+ *   -S compensates the dead time with the Smith predictor, -m sets its model.
+ *   -L learns the characteristic from this many pairs first, e.g. -g 0.95 -L 3000.
+ *   -c with -s writes a trace (time, setpoint, command, power) of one step to stdout.
+ *   The exit status is 0 if every step settled and no command moved against its step.
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun McSherry
+ *
+ **************************************************************************************************/
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+
+#include "APP/PidCtrl.h"
+#include "APP/PidAutoTune.h"
+#include "APP/InvLut.h"
+#include "APP/SmithPred.h"
+#include "APP/LutLearn.h"
+
+#define METER_PERIOD_MS     20U       /* meter sample cadence, as ManagePower */
+#define PRE_STEP_MS         3000U     /* held at the start level before the step */
+#define POST_STEP_MS        4000U     /* measured after the step */
+#define SETTLE_BAND         0.02      /* fraction of the step, or of MIN_BAND if larger */
+#define MIN_BAND            50.0      /* 0.1kW units */
+#define REVERSE_LIMIT       0.1       /* fraction of the step the command may move back per sample */
+#define MAX_DELAY_MS        200U
+#define RATE_LIMIT          5.0       /* rated power per second, as POWER_PID_RATE_LIMIT */
+#define MODEL_MS            100.0     /* trim reference model, as CTRL_FF_MODEL_MS */
+#define AUTOTUNE_POINT      5000.0    /* operating point for -a, as PID_TEST2_VALUE */
+#define AUTOTUNE_MAX_MS     60000U
+#define SMITH_TAU_MS        100.0     /* Smith predictor model, as CTRL_SMITH_TAU_MS */
+#define SMITH_DEAD_TIME_MS  30.0      /* as CTRL_SMITH_DEAD_TIME_MS */
+#define LEARN_HOLD_MS       5000U     /* each -L setpoint is held this long */
+#define LEARN_SETPOINT      0.95      /* -L setpoints are within this fraction of rated power */
+#define LEARN_NOISE         15.0      /* 0.1kW units, peak, on each meter sample for -L */
+#define LEARN_CHECK_STEP    100.0     /* 0.1kW units, between the commands the error is found at */
+
+typedef enum STRUCTURE_ENUM
+{
+  STRUCTURE_PID_ONLY    = 0,
+  STRUCTURE_FF_TRIM     = 1,
+  NOOF_STRUCTURES       = 2
+}structureEnum_t;
+
+typedef struct PLANT_CONFIG_STRUCT
+{
+  double tau_ms;
+  uint32_t delay_ms;
+  uint32_t meterLatency_ms;
+  double gain;
+  double rated;
+  double kp;
+  double ki;
+  double kd;
+  bool isSmith;             /* PID feedback through the Smith predictor */
+}plantConfigStruct_t;
+
+typedef struct STEP_STRUCT
+{
+  double from;              /* 0.1kW units */
+  double to;
+}stepStruct_t;
+
+typedef struct RESULT_STRUCT
+{
+  double rise_s;            /* < 0 if never reached */
+  double settle_s;          /* < 0 if never settled */
+  double overshoot;         /* percent of the step */
+  double iae;               /* 0.1kW.s */
+  bool isReversed;          /* command moved against the step before the power reached it */
+}resultStruct_t;
+
+static const stepStruct_t STEPS[] =
+{
+  {     0.0,   1000.0 },
+  {     0.0,   5000.0 },
+  {     0.0,  10000.0 },
+  {  5000.0,  -5000.0 },
+  { -2000.0,    500.0 },
+  {     0.0,  14500.0 },    /* into saturation */
+  { 14500.0,   2000.0 }     /* out of saturation */
+};
+
+#define NOOF_STEPS  (sizeof(STEPS) / sizeof(STEPS[0]))
+
+static const char *STRUCTURE_NAMES[NOOF_STRUCTURES] = { "pid", "ff" };
+
+static INV_LUT invLut;              /* the controller's characteristic, learnt by -L */
+static INV_LUT plantLut;            /* the inverter's, before its gain error */
+static SMITH_PRED smithPred;
+
+/***************************************************************************************************
+ * DemandAdjust
+ *
+ * This function returns the command for a demand, as POWER_CTRL::DemandAdjust.
+ *
+ * Parameters:
+ * demand - the demand
+ * rated - the rating
+ *
+ * Return:
+ * The command, truncated to whole CAN units
+ *
+ **************************************************************************************************/
+static double DemandAdjust(double demand, double rated)
+{
+  if (demand > rated)
+  {
+    demand = rated;
+  }
+  else if (demand < -rated)
+  {
+    demand = -rated;
+  }
+
+  return (double)(int16_t)invLut.Command(demand);
+}
+
+/***************************************************************************************************
+ * RunStep
+ *
+ * This function simulates one step for one control structure.
+ *
+ * Parameters:
+ * config - the plant
+ * step - the step
+ * structure - the control structure
+ * isTrace - write a trace to stdout
+ *
+ * Return:
+ * The step response measures
+ *
+ **************************************************************************************************/
+static resultStruct_t RunStep(const plantConfigStruct_t *config, const stepStruct_t *step,
+                              structureEnum_t structure, bool isTrace)
+{
+  PID_CTRL pid;
+  pidCtrlConfigStruct_t pidConfig = {config->kp, config->ki, config->kd, 1.0, 0.0, 0.0,
+                                     -config->rated, config->rated, RATE_LIMIT * config->rated};
+  static double commandLine[MAX_DELAY_MS + 1U];
+  static double meterLine[METER_PERIOD_MS * 16U];
+  resultStruct_t result = {-1.0, -1.0, 0.0, 0.0, false};
+  uint32_t total_ms = PRE_STEP_MS + POST_STEP_MS;
+  uint32_t time_ms;
+  uint32_t index;
+  double setpoint;
+  double measured = 0.0;
+  double power;
+  double command;
+  double lastCommand;
+  double feedforward;
+  double reference;
+  double model = step->from;
+  double modelCoeff = 1.0 - exp(-(double)METER_PERIOD_MS / MODEL_MS);
+  double target;
+  double size = step->to - step->from;
+  double band;
+  double coeff = 1.0 - exp(-1.0 / config->tau_ms);
+  double peak = 0.0;
+  double after_s;
+  double feedback;
+  bool isMeterValid = false;
+  bool isReached = false;
+
+  band = SETTLE_BAND * fabs(size);
+  if (band < MIN_BAND)
+  {
+    band = MIN_BAND;
+  }
+
+  /* start in the steady state for the first level */
+  pid.SetConfig(&pidConfig);
+  command = DemandAdjust(step->from, config->rated);
+  power = config->gain * plantLut.Power(command);
+  feedforward = (STRUCTURE_FF_TRIM == structure) ? command : 0.0;
+  pid.Reset(command - feedforward, power);
+  smithPred.Reset(power, 0U);
+
+  for (index = 0U; index <= MAX_DELAY_MS; index++)
+  {
+    commandLine[index] = command;
+  }
+  for (index = 0U; index < (sizeof(meterLine) / sizeof(meterLine[0])); index++)
+  {
+    meterLine[index] = power;
+  }
+
+  for (time_ms = 0U; time_ms < total_ms; time_ms++)
+  {
+    setpoint = (time_ms < PRE_STEP_MS) ? step->from : step->to;
+
+    /* meter sample, delivered after the latency */
+    meterLine[time_ms % (sizeof(meterLine) / sizeof(meterLine[0]))] = power;
+    if ((time_ms >= config->meterLatency_ms) &&
+        (0U == ((time_ms - config->meterLatency_ms) % METER_PERIOD_MS)))
+    {
+      measured = meterLine[(time_ms - config->meterLatency_ms) %
+                           (sizeof(meterLine) / sizeof(meterLine[0]))];
+      isMeterValid = true;
+    }
+
+    /* controller, on each new meter sample - as ManagePower */
+    if ((true == isMeterValid) && (0U == ((time_ms - config->meterLatency_ms) % METER_PERIOD_MS)))
+    {
+      feedback = smithPred.Feedback(measured, time_ms * 1000U);
+      feedforward = 0.0;
+      reference = setpoint;
+      if (STRUCTURE_FF_TRIM == structure)
+      {
+        /* the trim follows the modelled response to the feedforward, one sample late */
+        feedforward = DemandAdjust(setpoint, config->rated);
+        reference = model;
+        model += modelCoeff * (setpoint - model);
+      }
+      pid.SetOutputLimits(-config->rated - feedforward, config->rated - feedforward);
+      lastCommand = command;
+      command = feedforward + pid.Compute(reference, feedback, METER_PERIOD_MS / 1000.0);
+      command = (double)(int16_t)command;
+      smithPred.Sent(invLut.Power(command), time_ms * 1000U);
+
+      if ((time_ms >= PRE_STEP_MS) && (false == isReached) &&
+          (((command - lastCommand) / size) < -REVERSE_LIMIT))
+      {
+        result.isReversed = true;
+      }
+    }
+
+    /* inverter: transport delay then first order lag to its characteristic */
+    commandLine[time_ms % (config->delay_ms + 1U)] = command;
+    target = config->gain *
+             plantLut.Power(commandLine[(time_ms + 1U) % (config->delay_ms + 1U)]);
+    power += coeff * (target - power);
+
+    if (true == isTrace)
+    {
+      printf("%.3f,%.0f,%.0f,%.1f\n", time_ms / 1000.0, setpoint, command, power);
+    }
+
+    if (time_ms >= PRE_STEP_MS)
+    {
+      after_s = (double)(time_ms - PRE_STEP_MS) / 1000.0;
+      result.iae += fabs(step->to - power) / 1000.0;
+
+      if (((power - step->from) / size) >= 1.0)
+      {
+        isReached = true;
+      }
+
+      if ((result.rise_s < 0.0) &&
+          (((power - step->from) / size) >= 0.9))
+      {
+        result.rise_s = after_s;
+      }
+      if (((power - step->from) / size) > peak)
+      {
+        peak = (power - step->from) / size;
+      }
+
+      if (fabs(power - step->to) > band)
+      {
+        result.settle_s = -1.0;
+      }
+      else if (result.settle_s < 0.0)
+      {
+        result.settle_s = after_s;
+      }
+      else
+      {
+        /* still settled */
+      }
+    }
+  }
+
+  result.overshoot = (peak > 1.0) ? ((peak - 1.0) * 100.0) : 0.0;
+
+  return result;
+}
+
+/***************************************************************************************************
+ * RunAutoTune
+ *
+ * This function auto-tunes the PID on the plant about AUTOTUNE_POINT, as POWER_CTRL does in the
+ * PID_TEST2 mode.
+ *
+ * Parameters:
+ * config - the plant, updated with the tuned gains if the tune succeeds
+ * rule - the tuning rule
+ * isDerivative - tune PID rather than PI
+ * identified - updated with the first order plus dead time model if the tune succeeds
+ *
+ * Return:
+ * true if the tune succeeded, otherwise false
+ *
+ **************************************************************************************************/
+static bool RunAutoTune(plantConfigStruct_t *config, autotuneRuleEnum_t rule, bool isDerivative,
+                        smithModelStruct_t *identified)
+{
+  PID_AUTOTUNE autoTune;
+  autotuneResultStruct_t result;
+  pidCtrlConfigStruct_t pidConfig = {config->kp, config->ki, config->kd, 1.0, 0.0, 0.0,
+                                     -config->rated, config->rated, RATE_LIMIT * config->rated};
+  static double commandLine[MAX_DELAY_MS + 1U];
+  static double meterLine[METER_PERIOD_MS * 16U];
+  uint32_t time_ms;
+  uint32_t index;
+  double command;
+  double power;
+  double measured;
+  double target;
+  double slope;
+  double coeff = 1.0 - exp(-1.0 / config->tau_ms);
+
+  /* steady at the operating point */
+  command = DemandAdjust(AUTOTUNE_POINT, config->rated);
+  power = config->gain * plantLut.Power(command);
+  for (index = 0U; index <= MAX_DELAY_MS; index++)
+  {
+    commandLine[index] = command;
+  }
+  for (index = 0U; index < (sizeof(meterLine) / sizeof(meterLine[0])); index++)
+  {
+    meterLine[index] = power;
+  }
+
+  /* the process gain is the slope of the characteristic, as POWER_CTRL takes it */
+  slope = (invLut.Power(command + 100.0) - invLut.Power(command - 100.0)) / 200.0;
+
+  if (false == autoTune.Start(AUTOTUNE_POINT, command, &pidConfig, slope, rule, isDerivative))
+  {
+    printf("auto-tune did not start\n");
+    return false;
+  }
+
+  for (time_ms = 0U; (time_ms < AUTOTUNE_MAX_MS) && (true == autoTune.IsRunning()); time_ms++)
+  {
+    meterLine[time_ms % (sizeof(meterLine) / sizeof(meterLine[0]))] = power;
+    if ((time_ms >= config->meterLatency_ms) &&
+        (0U == ((time_ms - config->meterLatency_ms) % METER_PERIOD_MS)))
+    {
+      measured = meterLine[(time_ms - config->meterLatency_ms) %
+                           (sizeof(meterLine) / sizeof(meterLine[0]))];
+      command = (double)(int16_t)autoTune.Update(measured, METER_PERIOD_MS / 1000.0);
+    }
+
+    commandLine[time_ms % (config->delay_ms + 1U)] = command;
+    target = config->gain *
+             plantLut.Power(commandLine[(time_ms + 1U) % (config->delay_ms + 1U)]);
+    power += coeff * (target - power);
+  }
+
+  autoTune.GetResult(&result);
+  printf("auto-tune %.1fs: Ku %.3f, Tu %.3fs, tau %.0fms, theta %.0fms, kp %.3f, ki %.3f, "
+         "kd %.4f, step overshoot %.1f%%, settle %.3fs\n",
+         time_ms / 1000.0, result.ku, result.tu_s, result.tau_s * 1000.0, result.theta_s * 1000.0,
+         result.kp, result.ki, result.kd, result.overshoot * 100.0, result.settle_s);
+
+  if (AUTOTUNE_DONE != autoTune.GetState())
+  {
+    printf("auto-tune failed: %s\n", autoTune.GetFailure());
+    return false;
+  }
+
+  config->kp = result.kp;
+  config->ki = result.ki;
+  config->kd = result.kd;
+  identified->gain = 1.0;
+  identified->tau_s = result.tau_s;
+  identified->deadTime_s = result.theta_s;
+
+  return true;
+}
+
+/***************************************************************************************************
+ * Noise
+ *
+ * This function returns repeatable noise, so every run sees the same sequence.
+ *
+ * Parameters:
+ * state - the generator state
+ *
+ * Return:
+ * Noise, -1 to 1
+ *
+ **************************************************************************************************/
+static double Noise(uint32_t *state)
+{
+  *state = (*state * 1664525U) + 1013904223U;
+
+  return ((double)(*state >> 8) / (double)(1U << 23)) - 1.0;
+}
+
+/***************************************************************************************************
+ * CharacteristicError
+ *
+ * This function compares the controller's characteristic with the plant, gain error included,
+ * at commands every LEARN_CHECK_STEP across the range.
+ *
+ * Parameters:
+ * config - the plant
+ * rms - updated with the RMS error (0.1kW units)
+ * largest - updated with the largest error (0.1kW units)
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+static void CharacteristicError(const plantConfigStruct_t *config, double *rms, double *largest)
+{
+  double command;
+  double error;
+  double sumSquares = 0.0;
+  uint32_t count = 0U;
+
+  *largest = 0.0;
+
+  for (command = -config->rated; command <= config->rated; command += LEARN_CHECK_STEP)
+  {
+    error = invLut.Power(command) - (config->gain * plantLut.Power(command));
+    sumSquares += error * error;
+    count++;
+
+    if (fabs(error) > *largest)
+    {
+      *largest = fabs(error);
+    }
+  }
+
+  *rms = sqrt(sumSquares / (double)count);
+}
+
+/***************************************************************************************************
+ * RunLearning
+ *
+ * This function learns the controller's characteristic on the plant, as ManagePower does with
+ * LUT_LEARN. The loop is closed by the PID alone, and held at random setpoints for LEARN_HOLD_MS
+ * each until the pairs have been learnt.
+ *
+ * Parameters:
+ * config - the plant
+ * pairs - number of pairs to learn
+ *
+ * Return:
+ * true if the characteristic is closer to the plant afterwards, or within the meter noise of
+ * it, otherwise false
+ *
+ **************************************************************************************************/
+static bool RunLearning(const plantConfigStruct_t *config, uint32_t pairs)
+{
+  LUT_LEARN learn;
+  PID_CTRL pid;
+  pidCtrlConfigStruct_t pidConfig = {config->kp, config->ki, config->kd, 1.0, 0.0, 0.0,
+                                     -config->rated, config->rated, RATE_LIMIT * config->rated};
+  lutLearnStatsStruct_t stats = {0U, 0U, 0.0};
+  static double commandLine[MAX_DELAY_MS + 1U];
+  static double meterLine[METER_PERIOD_MS * 16U];
+  uint32_t maxTime_ms = pairs * 10U * LUT_LEARN_WINDOW_MS;
+  uint32_t noiseState = 2024U;
+  uint32_t time_ms;
+  uint32_t index;
+  double setpoint = 0.0;
+  double command = 0.0;
+  double power = 0.0;
+  double measured;
+  double target;
+  double coeff = 1.0 - exp(-1.0 / config->tau_ms);
+  double rmsBefore;
+  double largestBefore;
+  double rmsAfter;
+  double largestAfter;
+
+  CharacteristicError(config, &rmsBefore, &largestBefore);
+
+  /* nothing is stored on the host, so learning starts from the measured table */
+  HOST_SetSerialMuted(true);
+  learn.Init(&invLut, (uint16_t)config->rated);
+  HOST_SetSerialMuted(false);
+
+  pid.SetConfig(&pidConfig);
+  pid.Reset(command, power);
+  for (index = 0U; index <= MAX_DELAY_MS; index++)
+  {
+    commandLine[index] = command;
+  }
+  for (index = 0U; index < (sizeof(meterLine) / sizeof(meterLine[0])); index++)
+  {
+    meterLine[index] = power;
+  }
+
+  for (time_ms = 0U; (time_ms < maxTime_ms) && (stats.learnt < pairs); time_ms++)
+  {
+    if (0U == (time_ms % LEARN_HOLD_MS))
+    {
+      setpoint = (double)(int32_t)(LEARN_SETPOINT * config->rated * Noise(&noiseState));
+    }
+
+    meterLine[time_ms % (sizeof(meterLine) / sizeof(meterLine[0]))] =
+      power + (LEARN_NOISE * Noise(&noiseState));
+    if ((time_ms >= config->meterLatency_ms) &&
+        (0U == ((time_ms - config->meterLatency_ms) % METER_PERIOD_MS)))
+    {
+      measured = meterLine[(time_ms - config->meterLatency_ms) %
+                           (sizeof(meterLine) / sizeof(meterLine[0]))];
+
+      /* the command in force when the power was measured, as ManagePower */
+      learn.Update(command, measured, (uint16_t)time_ms);
+      learn.GetStats(&stats);
+
+      command = (double)(int16_t)pid.Compute(setpoint, measured, METER_PERIOD_MS / 1000.0);
+    }
+
+    commandLine[time_ms % (config->delay_ms + 1U)] = command;
+    target = config->gain *
+             plantLut.Power(commandLine[(time_ms + 1U) % (config->delay_ms + 1U)]);
+    power += coeff * (target - power);
+  }
+
+  CharacteristicError(config, &rmsAfter, &largestAfter);
+
+  printf("lut learning %.0fs: %u pairs learnt, %u outliers, characteristic error RMS %.1f -> "
+         "%.1f, largest %.1f -> %.1f (0.1kW)\n", time_ms / 1000.0, stats.learnt, stats.outliers,
+         rmsBefore, rmsAfter, largestBefore, largestAfter);
+
+  return ((rmsAfter < rmsBefore) || (rmsAfter <= LEARN_NOISE));
+}
+
+static void Usage(const char *name)
+{
+  fprintf(stderr, "usage: %s [-t tau_ms] [-d delay_ms] [-l meter_latency_ms] [-g gain] "
+                  "[-r rated] [-p kp] [-i ki] [-a zn|tl|simc [-D]] [-S [-m tau_ms,dead_ms]] "
+                  "[-L pairs] [-c pid|ff -s step]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+  plantConfigStruct_t config = {100.0, 10U, 20U, 1.0, 15000.0, 0.7, 10.0, 0.0, false};
+  smithModelStruct_t smithModel = {1.0, SMITH_TAU_MS / 1000.0, SMITH_DEAD_TIME_MS / 1000.0};
+  smithDeadTimeStruct_t deadTime;
+  int tuneRule = -1;
+  bool isDerivative = false;
+  int traceStructure = -1;
+  int traceStep = -1;
+  uint32_t learnPairs = 0U;
+  resultStruct_t result;
+  double sumSettle[NOOF_STRUCTURES] = {0.0, 0.0};
+  double sumIae[NOOF_STRUCTURES] = {0.0, 0.0};
+  bool isAllPassed = true;
+  uint32_t step;
+  uint8_t structure;
+  int option;
+
+  while ((option = getopt(argc, argv, "t:d:l:g:r:p:i:a:DSm:L:c:s:h")) != -1)
+  {
+    switch (option)
+    {
+      case 't': config.tau_ms = atof(optarg); break;
+      case 'd': config.delay_ms = (uint32_t)atoi(optarg); break;
+      case 'l': config.meterLatency_ms = (uint32_t)atoi(optarg); break;
+      case 'g': config.gain = atof(optarg); break;
+      case 'r': config.rated = atof(optarg); break;
+      case 'p': config.kp = atof(optarg); break;
+      case 'i': config.ki = atof(optarg); break;
+      case 'a': tuneRule = (0 == strcmp(optarg, "zn")) ? AUTOTUNE_ZN :
+                           ((0 == strcmp(optarg, "tl")) ? AUTOTUNE_TL :
+                           ((0 == strcmp(optarg, "simc")) ? AUTOTUNE_SIMC : -2)); break;
+      case 'D': isDerivative = true; break;
+      case 'S': config.isSmith = true; break;
+      case 'm': if (2 != sscanf(optarg, "%lf,%lf", &smithModel.tau_s, &smithModel.deadTime_s))
+                {
+                  Usage(argv[0]);
+                  return 1;
+                }
+                smithModel.tau_s /= 1000.0;
+                smithModel.deadTime_s /= 1000.0;
+                break;
+      case 'L': learnPairs = (uint32_t)strtoul(optarg, NULL, 10); break;
+      case 'c': traceStructure = (0 == strcmp(optarg, "ff")) ? STRUCTURE_FF_TRIM :
+                                 ((0 == strcmp(optarg, "pid")) ? STRUCTURE_PID_ONLY : -2); break;
+      case 's': traceStep = atoi(optarg); break;
+      default:  Usage(argv[0]); return 1;
+    }
+  }
+
+  if ((config.tau_ms < 1.0) || (config.delay_ms > MAX_DELAY_MS) ||
+      (config.meterLatency_ms >= (METER_PERIOD_MS * 16U)) || (config.gain <= 0.0) ||
+      (config.rated <= 0.0) || (-2 == traceStructure) || (-2 == tuneRule) ||
+      ((traceStructure >= 0) != (traceStep >= 0)) || (traceStep >= (int)NOOF_STEPS))
+  {
+    Usage(argv[0]);
+    return 1;
+  }
+
+  (void)invLut.Init(CAB1000_LUT, CAB1000_LUT_ROWS, NULL);
+  (void)plantLut.Init(CAB1000_LUT, CAB1000_LUT_ROWS, NULL);
+
+  if (false == smithPred.Init(&smithModel, config.rated))
+  {
+    Usage(argv[0]);
+    return 1;
+  }
+  smithPred.SetEnabled(config.isSmith);
+  smithPred.SetDeadTimeTracked(true);
+
+  if (tuneRule >= 0)
+  {
+    if (false == RunAutoTune(&config, (autotuneRuleEnum_t)tuneRule, isDerivative, &smithModel))
+    {
+      return 2;
+    }
+    /* the predictor takes the identified model, as POWER_CTRL does */
+    (void)smithPred.SetModel(&smithModel);
+  }
+
+  if ((learnPairs > 0U) && (false == RunLearning(&config, learnPairs)))
+  {
+    return 2;
+  }
+
+  if (traceStructure >= 0)
+  {
+    (void)RunStep(&config, &STEPS[traceStep], (structureEnum_t)traceStructure, true);
+    return 0;
+  }
+
+  printf("tau %.0fms, delay %ums, meter latency %ums, gain %.3f, kp %.3f, ki %.3f, kd %.4f\n",
+         config.tau_ms, config.delay_ms, config.meterLatency_ms, config.gain, config.kp, config.ki,
+         config.kd);
+  printf("step              structure  rise(s)  settle(s)  overshoot(%%)  IAE(0.1kW.s)\n");
+
+  for (step = 0U; step < NOOF_STEPS; step++)
+  {
+    for (structure = 0U; structure < NOOF_STRUCTURES; structure++)
+    {
+      result = RunStep(&config, &STEPS[step], (structureEnum_t)structure, false);
+
+      printf("%6.0f -> %6.0f  %-9s  %7.3f  %9.3f  %12.1f  %12.1f%s\n", STEPS[step].from,
+             STEPS[step].to, STRUCTURE_NAMES[structure], result.rise_s, result.settle_s,
+             result.overshoot, result.iae, (true == result.isReversed) ? "  reversed" : "");
+
+      if (true == result.isReversed)
+      {
+        isAllPassed = false;
+      }
+
+      if (result.settle_s < 0.0)
+      {
+        isAllPassed = false;
+      }
+      else
+      {
+        sumSettle[structure] += result.settle_s;
+      }
+      sumIae[structure] += result.iae;
+    }
+  }
+
+  smithPred.GetDeadTime(&deadTime);
+  printf("measured dead time %.1fms over %u steps, %u timed out\n", deadTime.deadTime_s * 1000.0,
+         deadTime.measurements, deadTime.timeouts);
+
+  for (structure = 0U; structure < NOOF_STRUCTURES; structure++)
+  {
+    printf("%-4s mean settle %.3fs, total IAE %.1f\n", STRUCTURE_NAMES[structure],
+           sumSettle[structure] / NOOF_STEPS, sumIae[structure]);
+  }
+
+  return (true == isAllPassed) ? 0 : 2;
+}
@@ -0,0 +1,320 @@
+/***************************************************************************************************
+ * rocof_check
+ *
+ * Host-side (Linux) check of RoCoF measurement and event detection (Rocof.cpp). The frequency is
+ * updated at the meter cadence and ROCOF::Update is called every 1ms control tick, as the control
+ * loop does, in simulated time. Each scenario holds the frequency, ramps it for RAMP_S and holds it
+ * again, and reports:
+ * - the events raised and their direction, against the events expected,
+ * - the time from the start of the ramp to the event,
+ * - the largest RoCoF error once settled into the ramp,
+ * - the largest RoCoF while the frequency holds, the noise floor against the trigger.
+ *
+ * Build (from the repository root):
+ *   g++ -O2 -std=c++14 -Itools/host -I. -o rocof_check tools/rocof_check/rocof_check.cpp \
+ *       Rocof.cpp FreqDelay.cpp SerialCmd.cpp
+ *
+ * Usage:
+ *   rocof_check [-w window_ms] [-f filter_ms] [-g trigger_hz_s] [-u duration_ms]
+ *               [-p meter_period_ms] [-t scenario_name]
+ *   -t writes a trace (time, frequency, RoCoF, event) of one scenario to stdout.
+ *   The exit status is 0 if every scenario passed.
+ *
+ * Date:
+ * 16/10/2026
+ *
+ * Author:
+ * Shaun McSherry
+ *
+ **************************************************************************************************/
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <unistd.h>
+
+#include "APP/Rocof.h"
+
+#define TICK_US             1000U     /* control loop period */
+#define METER_PERIOD_MS     20U       /* meter frequency cadence */
+#define NOMINAL_HZ          50.0
+#define HOLD_S              1.0       /* held before the ramp */
+#define RAMP_S              0.5
+#define END_S               3.0       /* scenario length */
+#define DETECT_MAX_MS       150U      /* largest time from the start of a ramp to its event */
+#define ROCOF_TOL_HZ_S      0.05      /* largest RoCoF error once settled into a ramp */
+
+typedef struct SCENARIO_STRUCT
+{
+  const char *name;
+  double rate;                 /* Hz/s during the ramp */
+  double noise;                /* Hz, peak, on each meter sample */
+  rocofEventEnum_t expected;   /* ROCOF_NO_EVENT if none should be raised */
+}scenarioStruct_t;
+
+typedef struct RESULT_STRUCT
+{
+  uint32_t events;
+  rocofEventEnum_t direction;
+  int32_t detect_ms;           /* -1 if no event */
+  double maxRampError;
+  double maxHoldRocof;
+}resultStruct_t;
+
+static const scenarioStruct_t SCENARIOS[] =
+{
+  { "steady",          0.0,   0.0,   ROCOF_NO_EVENT },
+  { "steady_noise",    0.0,   0.002, ROCOF_NO_EVENT },
+  { "slow_fall",       -0.2,  0.0,   ROCOF_NO_EVENT },
+  { "fast_fall",       -1.0,  0.0,   ROCOF_FALLING  },
+  { "fast_rise",       1.0,   0.0,   ROCOF_RISING   },
+  { "fast_fall_noise", -1.0,  0.002, ROCOF_FALLING  }
+};
+
+#define NOOF_SCENARIOS  (sizeof(SCENARIOS) / sizeof(SCENARIOS[0]))
+
+/***************************************************************************************************
+ * Noise
+ *
+ * This function returns repeatable noise, so every run sees the same sequence.
+ *
+ * Parameters:
+ * state - the generator state
+ *
+ * Return:
+ * Noise, -1 to 1
+ *
+ **************************************************************************************************/
+static double Noise(uint32_t *state)
+{
+  *state = (*state * 1664525U) + 1013904223U;
+
+  return ((double)(*state >> 8) / (double)(1U << 23)) - 1.0;
+}
+
+/***************************************************************************************************
+ * TrueFrequency
+ *
+ * This function returns the frequency of a scenario at a time.
+ *
+ * Parameters:
+ * scenario - the scenario
+ * time_s - time from the start
+ *
+ * Return:
+ * Frequency (Hz)
+ *
+ **************************************************************************************************/
+static double TrueFrequency(const scenarioStruct_t *scenario, double time_s)
+{
+  double rampTime_s = time_s - HOLD_S;
+
+  if (rampTime_s < 0.0)
+  {
+    rampTime_s = 0.0;
+  }
+  else if (rampTime_s > RAMP_S)
+  {
+    rampTime_s = RAMP_S;
+  }
+  else
+  {
+    /* ramping */
+  }
+
+  return NOMINAL_HZ + (scenario->rate * rampTime_s);
+}
+
+/***************************************************************************************************
+ * Run
+ *
+ * This function runs one scenario.
+ *
+ * Parameters:
+ * scenario - the scenario
+ * config - RoCoF configuration
+ * meterPeriod_ms - time between frequency updates
+ * isTrace - true to write a trace to stdout
+ * result - updated with the result
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+static void Run(const scenarioStruct_t *scenario, const rocofConfigStruct_t *config,
+                uint32_t meterPeriod_ms, bool isTrace, resultStruct_t *result)
+{
+  ROCOF rocof;
+  uint32_t noiseState = 4242U;
+  uint32_t tick;
+  uint32_t noofTicks = (uint32_t)(END_S * 1000.0);
+  uint32_t settle_ms = config->window_ms + (3U * config->filter_ms) + meterPeriod_ms;
+  double frequency = NOMINAL_HZ;
+  double time_s;
+  double error;
+  bool isRamping;
+  bool isSettled;
+
+  memset(result, 0, sizeof(*result));
+  result->detect_ms = -1;
+
+  (void)rocof.SetConfig(config);
+
+  for (tick = 0U; tick < noofTicks; tick++)
+  {
+    HOST_SetTime_us((uint64_t)tick * TICK_US);
+    time_s = (double)tick / 1000.0;
+
+    if (0U == (tick % meterPeriod_ms))
+    {
+      frequency = TrueFrequency(scenario, time_s) + (scenario->noise * Noise(&noiseState));
+    }
+
+    rocof.Update(frequency);
+
+    if (true == rocof.GetNewEvent())
+    {
+      result->events++;
+      result->direction = rocof.GetEvent();
+      if ((result->detect_ms < 0) && (time_s >= HOLD_S))
+      {
+        result->detect_ms = (int32_t)(tick - (uint32_t)(HOLD_S * 1000.0));
+      }
+    }
+
+    isRamping = ((time_s >= HOLD_S) && (time_s < (HOLD_S + RAMP_S)));
+    isSettled = (time_s >= (HOLD_S + ((double)settle_ms / 1000.0)));
+
+    if ((true == rocof.IsValid()) && (true == isRamping) && (true == isSettled))
+    {
+      error = fabs(rocof.GetRocof() - scenario->rate);
+      if (error > result->maxRampError)
+      {
+        result->maxRampError = error;
+      }
+    }
+    else if ((true == rocof.IsValid()) && (time_s < HOLD_S))
+    {
+      if (fabs(rocof.GetRocof()) > result->maxHoldRocof)
+      {
+        result->maxHoldRocof = fabs(rocof.GetRocof());
+      }
+    }
+    else
+    {
+      /* start up, or settling after a change of rate */
+    }
+
+    if (true == isTrace)
+    {
+      printf("%.3f,%.4f,%.4f,%d\n", time_s, frequency, rocof.GetRocof(), (int)rocof.GetEvent());
+    }
+  }
+}
+
+/***************************************************************************************************
+ * Usage
+ *
+ * This function prints the command line options.
+ *
+ * Parameters:
+ * name - program name
+ *
+ * Return:
+ * None
+ *
+ **************************************************************************************************/
+static void Usage(const char *name)
+{
+  fprintf(stderr, "Usage: %s [-w window_ms] [-f filter_ms] [-g trigger_hz_s] [-u duration_ms]\n"
+                  "          [-p meter_period_ms] [-t scenario_name]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+  rocofConfigStruct_t config = {ROCOF_DEFAULT_WINDOW_MS, ROCOF_DEFAULT_FILTER_MS,
+                                ROCOF_DEFAULT_TRIGGER, ROCOF_DEFAULT_DURATION_MS};
+  uint32_t meterPeriod_ms = METER_PERIOD_MS;
+  const char *traceName = NULL;
+  resultStruct_t result;
+  ROCOF check;
+  bool isAllPassed = true;
+  bool isPassed;
+  uint8_t scenario;
+  int option;
+
+  while ((option = getopt(argc, argv, "w:f:g:u:p:t:h")) != -1)
+  {
+    switch (option)
+    {
+      case 'w': config.window_ms = (uint16_t)atoi(optarg); break;
+      case 'f': config.filter_ms = (uint16_t)atoi(optarg); break;
+      case 'g': config.trigger = atof(optarg); break;
+      case 'u': config.duration_ms = (uint16_t)atoi(optarg); break;
+      case 'p': meterPeriod_ms = (uint32_t)atoi(optarg); break;
+      case 't': traceName = optarg; break;
+      default:
+        Usage(argv[0]);
+        return 2;
+    }
+  }
+
+  /* the module prints its own events */
+  HOST_SetSerialMuted(true);
+
+  if ((0U == meterPeriod_ms) || (false == check.SetConfig(&config)))
+  {
+    fprintf(stderr, "Configuration out of range\n");
+    return 2;
+  }
+
+  if (NULL != traceName)
+  {
+    for (scenario = 0U; scenario < NOOF_SCENARIOS; scenario++)
+    {
+      if (0 == strcmp(traceName, SCENARIOS[scenario].name))
+      {
+        Run(&SCENARIOS[scenario], &config, meterPeriod_ms, true, &result);
+        return 0;
+      }
+    }
+    fprintf(stderr, "Unknown scenario: %s\n", traceName);
+    return 2;
+  }
+
+  printf("window %u ms, filter %u ms, trigger %.3f Hz/s, duration %u ms, meter %u ms\n",
+         config.window_ms, config.filter_ms, config.trigger, config.duration_ms, meterPeriod_ms);
+  printf("%-16s %8s %7s %10s %14s %14s\n", "scenario", "rate", "events", "detect ms",
+         "ramp err Hz/s", "hold max Hz/s");
+
+  for (scenario = 0U; scenario < NOOF_SCENARIOS; scenario++)
+  {
+    Run(&SCENARIOS[scenario], &config, meterPeriod_ms, false, &result);
+
+    if (ROCOF_NO_EVENT == SCENARIOS[scenario].expected)
+    {
+      isPassed = (0U == result.events);
+    }
+    else
+    {
+      isPassed = ((1U == result.events) && (SCENARIOS[scenario].expected == result.direction) &&
+                  (result.detect_ms >= 0) && ((uint32_t)result.detect_ms <= DETECT_MAX_MS));
+    }
+
+    /* only a clean ramp is held to the RoCoF tolerance */
+    if ((0.0 == SCENARIOS[scenario].noise) && (result.maxRampError > ROCOF_TOL_HZ_S))
+    {
+      isPassed = false;
+    }
+
+    isAllPassed = isAllPassed && isPassed;
+
+    printf("%-16s %8.2f %7u %10d %14.4f %14.4f %s\n", SCENARIOS[scenario].name,
+           SCENARIOS[scenario].rate, result.events, result.detect_ms, result.maxRampError,
+           result.maxHoldRocof, (true == isPassed) ? "ok" : "FAIL");
+  }
+
+  return (true == isAllPassed) ? 0 : 1;
+}